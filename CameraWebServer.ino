@@ -2,6 +2,17 @@
 #include "FS.h"
 #include "SD_MMC.h"
 #include <WiFi.h>
+#include "app_boot.h"
+#include "app_burst.h"
+#include "app_catalog.h"
+#include "app_frame.h"
+#include "app_jpeghdr.h"
+#include "app_recompress.h"
+#include "app_recorder.h"
+#include "app_sensor.h"
+#include "app_similar.h"
+#include "app_summary.h"
+#include "app_storage.h"
 
 //
 // WARNING!!! PSRAM IC required for UXGA resolution and high JPEG quality
@@ -44,51 +55,14 @@ const char *password = "0979043780";
 void startCameraServer();
 void setupLedFlash(int pin);
 
-void setup() {
-  Serial.begin(115200);
-  Serial.setDebugOutput(true);
-  Serial.println();
-
-  // 1-bit mode  – thêm tên mount "/sdcard" + true
-  if (!SD_MMC.begin("/sdcard",  true,   false, 4000000)) {
-  //                   ^^^^     ^^^^    ^^^^^  ^^^^^^^
-  //        mountpoint  │        │       └─ keep CS low-speed (tuỳ) 
-  //                    └────── 1-bit mode
-      Serial.println("SD init fail");
-      return;
-  }
-
-  uint8_t cardType = SD_MMC.cardType();
-  if(cardType == CARD_NONE){
-    Serial.println("No SD card attached");
-    return;
-  } else {
-    Serial.print("SD card type: ");
-    Serial.println(cardType == CARD_MMC ? "MMC" :
-                  cardType == CARD_SD ? "SDSC" :
-                  cardType == CARD_SDHC ? "SDHC" : "UNKNOWN");
-  }
-
-  File testFile = SD_MMC.open("/test.txt", FILE_WRITE);
-  if (!testFile) {
-    Serial.println("❌ Cannot create test file");
-  } else {
-    testFile.println("Hello from ESP32-CAM");
-    testFile.close();
-    Serial.println("✅ Test file created");
-  }
-
-  #define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
-  #include "esp_log.h"
+// Recorder capture interval
+#define CAPTURE_INTERVAL_MS 1000
 
-  // Disable built-in flash LED to save power (GPIO 4)
-  pinMode(4, OUTPUT); 
-  digitalWrite(4, LOW);
-  
-  // Disable onboard status LED to save power (GPIO 33 on AI-Thinker)
-  pinMode(33, OUTPUT);
-  digitalWrite(33, LOW);
+// Store each distinct JPEG header set once in /headers.bin instead of in
+// every image (saves ~600 bytes per frame; keep /headers.bin with the images)
+#define DEDUP_HEADERS true
 
+static bool camera_stage() {
   camera_config_t config;
   config.ledc_channel = LEDC_CHANNEL_0;
   config.ledc_timer = LEDC_TIMER_0;
@@ -147,7 +121,7 @@ void setup() {
   esp_err_t err = esp_camera_init(&config);
   if (err != ESP_OK) {
     Serial.printf("Camera init failed with error 0x%x", err);
-    return;
+    return false;
   }
 
   sensor_t *s = esp_camera_sensor_get();
@@ -172,59 +146,106 @@ void setup() {
 #endif
 
 // Setup LED FLash if LED pin is defined in camera_pins.h
-#if defined(LED_GPIO_NUM)
+// (with SD_MMC_ALLOW_4BIT the LED pin belongs to the SD bus)
+#if defined(LED_GPIO_NUM) && !defined(SD_MMC_ALLOW_4BIT)
   setupLedFlash(LED_GPIO_NUM);
 #endif
+  // Every consumer takes frames from the hub from here on
+  return frame_hub_start();
+}
+
+static bool storage_stage() {
+  // Bus width and clock are benchmarked on first use of a card and stored
+  // in NVS; 4-bit mode only where camera_pins.h leaves D1-D3 free
+  if (!storage_mount(SD_MMC_4BIT_CAPABLE)) {
+      Serial.println("SD init fail");
+      return false;
+  }
+
+  uint8_t cardType = SD_MMC.cardType();
+  if(cardType == CARD_NONE){
+    Serial.println("No SD card attached");
+    return false;
+  } else {
+    Serial.print("SD card type: ");
+    Serial.println(cardType == CARD_MMC ? "MMC" :
+                  cardType == CARD_SD ? "SDSC" :
+                  cardType == CARD_SDHC ? "SDHC" : "UNKNOWN");
+  }
+
+  // Before the catalog, which may need it to size images when rebuilding
+  jpeghdr_load(SD_MMC, DEDUP_HEADERS);
+  return catalog_load(SD_MMC) == ESP_OK;
+}
 
+static bool network_stage() {
   WiFi.begin(ssid, password);
   WiFi.setSleep(false);
 
-  Serial.print("WiFi connecting");
+  Serial.println("WiFi connecting");
   while (WiFi.status() != WL_CONNECTED) {
-    delay(500);
-    Serial.print(".");
+    vTaskDelay(50 / portTICK_PERIOD_MS);
   }
-  Serial.println("");
   Serial.println("WiFi connected");
 
+  // Wall clock for recording timestamps, synced in the background
+  configTime(0, 0, "pool.ntp.org", "time.google.com");
+  return true;
+}
+
+static bool server_stage() {
   startCameraServer();
 
   Serial.print("Camera Ready! Use 'http://");
   Serial.print(WiFi.localIP());
   Serial.println("' to connect");
+  return true;
 }
 
-void loop() {
-  static unsigned long lastSaveTime = 0;
-  static int imgCounter = 0;
-
-  // Ghi ảnh mỗi 5 giây
-  if (millis() - lastSaveTime > 1000) {
-    lastSaveTime = millis();
-
-    camera_fb_t *fb = esp_camera_fb_get();
-    if (!fb) {
-      Serial.println("Camera capture failed");
-      return;
-    } else {
-      Serial.printf("Captured %ux%u  (%u bytes)\n",
-              fb->width, fb->height, fb->len);
-    }
+static bool recorder_stage() {
+  // Optional: bursts, similarity search and recompression are simply
+  // unavailable without PSRAM
+  burst_init();
+  similar_start(SD_MMC);
+  summary_start(SD_MMC);
+  recompress_start(SD_MMC);
+  return recorder_start(CAPTURE_INTERVAL_MS);
+}
 
-    // Tạo tên file ảnh
-    char filename[30];
-    sprintf(filename, "/img_%03d.jpg", imgCounter++);
-    Serial.printf("Saving %s\n", filename);
-
-    File file = SD_MMC.open(filename, FILE_WRITE);
-    if (!file) {
-      Serial.println("Failed to open file in writing mode");
-    } else {
-      file.write(fb->buf, fb->len);
-      Serial.println("File saved");
-      file.close();
-    }
+void setup() {
+  Serial.begin(115200);
+  Serial.setDebugOutput(true);
+  Serial.println();
 
-    esp_camera_fb_return(fb);
-  }
-}
\ No newline at end of file
+  #define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
+  #include "esp_log.h"
+
+  // Disable built-in flash LED to save power (GPIO 4)
+  pinMode(4, OUTPUT); 
+  digitalWrite(4, LOW);
+  
+  // Disable onboard status LED to save power (GPIO 33 on AI-Thinker)
+  pinMode(33, OUTPUT);
+  digitalWrite(33, LOW);
+
+  // Camera, SD card and WiFi come up in parallel. The recorder only needs the
+  // camera and buffers frames in PSRAM until storage is ready; the web server
+  // waits for the network and the camera driver.
+  sensor_ctrl_init();
+  boot_init();
+  boot_start_stage(BOOT_STAGE_CAMERA, "camera", 0, camera_stage, 4096, 5);
+  boot_start_stage(BOOT_STAGE_STORAGE, "storage", 0, storage_stage, 6144, 4);
+  boot_start_stage(BOOT_STAGE_NETWORK, "network", 0, network_stage, 4096, 4);
+  boot_start_stage(BOOT_STAGE_RECORDER, "recorder", BOOT_DEP(BOOT_STAGE_CAMERA), recorder_stage, 4096, 4);
+  boot_start_stage(BOOT_STAGE_SERVER, "server", BOOT_DEP(BOOT_STAGE_NETWORK) | BOOT_DEP(BOOT_STAGE_CAMERA), server_stage, 6144, 4);
+
+  boot_wait(BOOT_DEP(BOOT_STAGE_SERVER) | BOOT_DEP(BOOT_STAGE_RECORDER) | BOOT_DEP(BOOT_STAGE_STORAGE), portMAX_DELAY);
+  boot_log_summary();
+  // /status was first published before storage and boot timing were known
+  sensor_state_publish(false);
+}
+
+void loop() {
+  // Recording and serving run in their own tasks
+  delay(10000);
+}
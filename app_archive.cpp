@@ -0,0 +1,256 @@
+// Streaming TAR / ZIP archives of recorded frames
+#include "Arduino.h"
+#include "esp_rom_crc.h"
+#include "app_archive.h"
+#include "app_bytes.h"
+#include "app_catalog.h"
+#include "app_sdreader.h"
+
+#define TAR_BLOCK        512
+#define ZIP_LOCAL_LEN    30
+#define ZIP_DESC_LEN     16
+#define ZIP_CENTRAL_LEN  46
+#define ZIP_END_LEN      22
+#define ZIP_MAX_FILES    0xFFFF
+
+typedef struct {
+  archive_sink_t sink;
+  void *ctx;
+  bool ok;
+  uint64_t pos;
+} writer_t;
+
+static void put(writer_t *w, const uint8_t *data, size_t len) {
+  static const uint8_t zeros[64] = {0};
+  w->pos += len;
+  if (data) {
+    w->ok = w->ok && w->sink(w->ctx, data, len);
+    return;
+  }
+  while (len && w->ok) {
+    size_t part = len < sizeof(zeros) ? len : sizeof(zeros);
+    w->ok = w->sink(w->ctx, zeros, part);
+    len -= part;
+  }
+}
+
+// Member name without the leading slash
+static int member_name(const catalog_entry_t *entry, char *buf, size_t len) {
+  char path[32];
+  catalog_path(entry->seq, path, sizeof(path));
+  return snprintf(buf, len, "%s", path + 1);
+}
+
+static uint64_t tar_padded(uint32_t size) {
+  return (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+}
+
+static void dos_time(uint32_t time, uint16_t *dtime, uint16_t *ddate) {
+  struct tm tm;
+  time_t t = time;
+  localtime_r(&t, &tm);
+  if (!time || tm.tm_year < 80) {
+    *dtime = 0;
+    *ddate = (1 << 5) | 1;  // 1980-01-01
+    return;
+  }
+  *dtime = (tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2);
+  *ddate = ((tm.tm_year - 80) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday;
+}
+
+bool archive_plan(archive_plan_t *plan) {
+  plan->files = 0;
+  plan->total = 0;
+  uint64_t central = 0;
+  catalog_entry_t entry;
+  char name[32];
+  for (int r = 0; r < plan->count; r++) {
+    for (size_t i = plan->begin[r]; i < plan->end[r]; i++) {
+      if (!catalog_get(i, &entry)) {
+        return false;
+      }
+      plan->files++;
+      if (plan->format == ARCHIVE_TAR) {
+        plan->total += TAR_BLOCK + tar_padded(entry.size);
+      } else {
+        int name_len = member_name(&entry, name, sizeof(name));
+        plan->total += ZIP_LOCAL_LEN + name_len + entry.size + ZIP_DESC_LEN;
+        central += ZIP_CENTRAL_LEN + name_len;
+      }
+    }
+  }
+  if (!plan->files) {
+    return false;
+  }
+  if (plan->format == ARCHIVE_TAR) {
+    plan->total += 2 * TAR_BLOCK;  // end-of-archive marker
+    return true;
+  }
+  plan->total += central + ZIP_END_LEN;
+  if (plan->files > ZIP_MAX_FILES || plan->total > 0xFFFFFFFFULL) {
+    log_w("Archive: %u files / %llu bytes need ZIP64", plan->files, plan->total);
+    return false;
+  }
+  return true;
+}
+
+static void tar_header(writer_t *w, const catalog_entry_t *entry) {
+  uint8_t hdr[TAR_BLOCK];
+  memset(hdr, 0, sizeof(hdr));
+  member_name(entry, (char *)hdr, 100);
+  snprintf((char *)hdr + 100, 8, "%07o", 0644);
+  snprintf((char *)hdr + 108, 8, "%07o", 0);
+  snprintf((char *)hdr + 116, 8, "%07o", 0);
+  snprintf((char *)hdr + 124, 12, "%011o", (unsigned)entry->size);
+  snprintf((char *)hdr + 136, 12, "%011o", (unsigned)entry->time);
+  hdr[156] = '0';
+  memcpy(hdr + 257, "ustar", 6);
+  memcpy(hdr + 263, "00", 2);
+  // Checksum is taken with its own field set to spaces
+  memset(hdr + 148, ' ', 8);
+  unsigned sum = 0;
+  for (int i = 0; i < TAR_BLOCK; i++) {
+    sum += hdr[i];
+  }
+  snprintf((char *)hdr + 148, 8, "%06o", sum);
+  hdr[155] = ' ';
+  put(w, hdr, sizeof(hdr));
+}
+
+static void zip_local(writer_t *w, const catalog_entry_t *entry) {
+  uint8_t hdr[ZIP_LOCAL_LEN + 32];
+  uint16_t dtime, ddate;
+  dos_time(entry->time, &dtime, &ddate);
+  int name_len = member_name(entry, (char *)hdr + ZIP_LOCAL_LEN, 32);
+  uint8_t *p = put_le32(hdr, 0x04034b50);
+  p = put_le16(p, 20);      // version needed
+  p = put_le16(p, 0x0008);  // sizes and CRC follow in a data descriptor
+  p = put_le16(p, 0);       // stored
+  p = put_le16(p, dtime);
+  p = put_le16(p, ddate);
+  p = put_le32(p, 0);
+  p = put_le32(p, 0);
+  p = put_le32(p, 0);
+  p = put_le16(p, name_len);
+  p = put_le16(p, 0);
+  put(w, hdr, ZIP_LOCAL_LEN + name_len);
+}
+
+static void zip_descriptor(writer_t *w, uint32_t crc, uint32_t size) {
+  uint8_t desc[ZIP_DESC_LEN];
+  uint8_t *p = put_le32(desc, 0x08074b50);
+  p = put_le32(p, crc);
+  p = put_le32(p, size);
+  p = put_le32(p, size);
+  put(w, desc, sizeof(desc));
+}
+
+static void zip_central(writer_t *w, const archive_plan_t *plan, const uint32_t *crcs) {
+  uint64_t start = w->pos;
+  uint32_t offset = 0;
+  uint32_t n = 0;
+  catalog_entry_t entry;
+  uint8_t hdr[ZIP_CENTRAL_LEN + 32];
+  for (int r = 0; r < plan->count && w->ok; r++) {
+    for (size_t i = plan->begin[r]; i < plan->end[r] && w->ok; i++, n++) {
+      if (!catalog_get(i, &entry)) {
+        w->ok = false;
+        break;
+      }
+      uint16_t dtime, ddate;
+      dos_time(entry.time, &dtime, &ddate);
+      int name_len = member_name(&entry, (char *)hdr + ZIP_CENTRAL_LEN, 32);
+      uint8_t *p = put_le32(hdr, 0x02014b50);
+      p = put_le16(p, 20);  // made by
+      p = put_le16(p, 20);  // version needed
+      p = put_le16(p, 0x0008);
+      p = put_le16(p, 0);
+      p = put_le16(p, dtime);
+      p = put_le16(p, ddate);
+      p = put_le32(p, crcs[n]);
+      p = put_le32(p, entry.size);
+      p = put_le32(p, entry.size);
+      p = put_le16(p, name_len);
+      p = put_le16(p, 0);  // extra
+      p = put_le16(p, 0);  // comment
+      p = put_le16(p, 0);  // disk
+      p = put_le16(p, 0);  // internal attributes
+      p = put_le32(p, 0);  // external attributes
+      p = put_le32(p, offset);
+      put(w, hdr, ZIP_CENTRAL_LEN + name_len);
+      offset += ZIP_LOCAL_LEN + name_len + entry.size + ZIP_DESC_LEN;
+    }
+  }
+  uint8_t end[ZIP_END_LEN];
+  uint8_t *p = put_le32(end, 0x06054b50);
+  p = put_le16(p, 0);
+  p = put_le16(p, 0);
+  p = put_le16(p, plan->files);
+  p = put_le16(p, plan->files);
+  p = put_le32(p, w->pos - start);
+  p = put_le32(p, start);
+  p = put_le16(p, 0);
+  put(w, end, sizeof(end));
+}
+
+bool archive_write(fs::FS &fs, const archive_plan_t *plan, archive_sink_t sink, void *ctx) {
+  writer_t w = {sink, ctx, true, 0};
+  uint32_t *crcs = NULL;
+  if (plan->format == ARCHIVE_ZIP) {
+    size_t bytes = plan->files * sizeof(uint32_t);
+    crcs = (uint32_t *)(psramFound() ? ps_malloc(bytes) : malloc(bytes));
+    if (!crcs) {
+      log_e("Archive: no memory for %u CRCs", plan->files);
+      return false;
+    }
+  }
+
+  uint32_t n = 0;
+  for (int r = 0; r < plan->count && w.ok; r++) {
+    sd_reader_t *reader = sd_reader_open(fs, plan->begin[r], plan->end[r]);
+    if (!reader) {
+      w.ok = false;
+      break;
+    }
+    for (size_t i = plan->begin[r]; i < plan->end[r] && w.ok; i++, n++) {
+      sd_frame_t *f = sd_reader_next(reader, 5000 / portTICK_PERIOD_MS);
+      if (!f) {
+        log_e("Archive: reading frame %u timed out", i);
+        w.ok = false;
+        break;
+      }
+      // Members are exactly their catalog size, like the plan assumed
+      uint32_t size = f->entry.size;
+      uint32_t have = f->len < size ? f->len : size;
+      if (plan->format == ARCHIVE_TAR) {
+        tar_header(&w, &f->entry);
+        put(&w, f->buf, have);
+        put(&w, NULL, tar_padded(size) - have);
+      } else {
+        uint32_t crc = esp_rom_crc32_le(0, f->buf, have);
+        for (uint32_t pad = have; pad < size; pad++) {
+          static const uint8_t zero = 0;
+          crc = esp_rom_crc32_le(crc, &zero, 1);
+        }
+        crcs[n] = crc;
+        zip_local(&w, &f->entry);
+        put(&w, f->buf, have);
+        put(&w, NULL, size - have);
+        zip_descriptor(&w, crc, size);
+      }
+      sd_reader_release(reader, f);
+    }
+    // Closing stops the read-ahead right away when the client is gone
+    sd_reader_close(reader);
+  }
+
+  if (w.ok) {
+    if (plan->format == ARCHIVE_TAR) {
+      put(&w, NULL, 2 * TAR_BLOCK);
+    } else {
+      zip_central(&w, plan, crcs);
+    }
+  }
+  free(crcs);
+  return w.ok;
+}
@@ -0,0 +1,47 @@
+/*
+ * TAR / ZIP bulk download of recorded frames
+ *
+ * Archives are generated while they are sent: member headers are computed
+ * from the catalog and frame data comes through the SD read-ahead reader,
+ * so nothing is staged on the card and the exact archive size is known up
+ * front. ZIP members are STORED (JPEGs do not compress) with data
+ * descriptors, since each CRC is only known after its data went out.
+ *
+ * A selection is a short list of catalog index ranges. When the sink
+ * fails (the client went away) reading stops at once.
+ */
+
+#ifndef APP_ARCHIVE_H
+#define APP_ARCHIVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "FS.h"
+
+#define ARCHIVE_MAX_RANGES 16
+
+typedef enum {
+  ARCHIVE_TAR = 0,
+  ARCHIVE_ZIP,
+} archive_format_t;
+
+typedef struct {
+  archive_format_t format;
+  int count;  // ranges used
+  size_t begin[ARCHIVE_MAX_RANGES];  // catalog index ranges [begin, end)
+  size_t end[ARCHIVE_MAX_RANGES];
+  uint32_t files;
+  uint64_t total;  // archive size
+} archive_plan_t;
+
+// Receives consecutive pieces of the archive; false aborts it
+typedef bool (*archive_sink_t)(void *ctx, const uint8_t *data, size_t len);
+
+// Size the archive; fails on an empty selection or when the format cannot
+// hold it (plain ZIP: 65535 files and 4 GB). Keep the selection pinned
+// (catalog_pin()) until archive_write() is done, so the sizes hold.
+bool archive_plan(archive_plan_t *plan);
+
+bool archive_write(fs::FS &fs, const archive_plan_t *plan, archive_sink_t sink, void *ctx);
+
+#endif  // APP_ARCHIVE_H
@@ -0,0 +1,276 @@
+// Streaming AVI (MJPEG) export laid out from the catalog
+#include "Arduino.h"
+#include "app_avi.h"
+#include "app_bytes.h"
+#include "app_catalog.h"
+#include "app_jpeg.h"
+#include "app_jpeghdr.h"
+#include "app_sdreader.h"
+
+#define AVI_HEADER_LEN   224  // RIFF + hdrl list + movi list header
+#define AVI_INDEX_ENTRY  16
+#define AVIF_HASINDEX    0x10
+#define AVIIF_KEYFRAME   0x10
+#define AVI_PROBE_LEN    2048  // JPEG headers read to find the frame size
+
+typedef struct {
+  uint64_t pos;  // file offset of the next emitted byte
+  uint64_t first;
+  uint64_t last;
+  avi_sink_t sink;
+  void *ctx;
+  bool ok;
+} emitter_t;
+
+static uint64_t chunk_bytes(uint32_t size) {
+  return 8 + size + (size & 1);
+}
+
+static uint8_t *put_fourcc(uint8_t *p, const char *fourcc) {
+  memcpy(p, fourcc, 4);
+  return p + 4;
+}
+
+static bool probe_dimensions(fs::FS &fs, size_t begin, size_t end, uint32_t *width, uint32_t *height) {
+  uint8_t *buf = (uint8_t *)malloc(AVI_PROBE_LEN);
+  if (!buf) {
+    return false;
+  }
+  bool found = false;
+  // A few tries in case the first frames are unreadable
+  for (size_t i = begin; i < end && i < begin + 4 && !found; i++) {
+    catalog_entry_t entry;
+    char path[32];
+    if (!catalog_get(i, &entry)) {
+      break;
+    }
+    catalog_path(entry.seq, path, sizeof(path));
+    File file = fs.open(path, FILE_READ);
+    const uint8_t *hdr;
+    size_t hdr_len, size;
+    if (file && jpeghdr_open(file, &hdr, &hdr_len, &size)) {
+      // A deduplicated image has its SOF in the dictionary
+      size_t len = hdr ? hdr_len : file.read(buf, AVI_PROBE_LEN);
+      jpeg_info_t info;
+      found = jpeg_info(hdr ? hdr : buf, len, &info) == ESP_OK;
+      if (found) {
+        *width = info.width;
+        *height = info.height;
+      }
+    }
+    if (file) {
+      file.close();
+    }
+  }
+  free(buf);
+  return found;
+}
+
+bool avi_plan(fs::FS &fs, size_t begin, size_t end, avi_layout_t *layout) {
+  if (begin >= end) {
+    return false;
+  }
+  memset(layout, 0, sizeof(*layout));
+  layout->begin = begin;
+  layout->end = end;
+
+  catalog_entry_t entry, first_entry;
+  for (size_t i = begin; i < end; i++) {
+    if (!catalog_get(i, &entry)) {
+      return false;
+    }
+    if (i == begin) {
+      first_entry = entry;
+    }
+    layout->movi_bytes += chunk_bytes(entry.size);
+    if (entry.size > layout->max_frame) {
+      layout->max_frame = entry.size;
+    }
+  }
+  size_t frames = end - begin;
+  layout->total = AVI_HEADER_LEN + layout->movi_bytes + 8 + (uint64_t)frames * AVI_INDEX_ENTRY;
+  if (layout->total - 8 > 0xFFFFFFFFULL) {
+    log_w("AVI: %u frames need %llu bytes, over the RIFF limit", frames, layout->total);
+    return false;
+  }
+
+  // Average rate over the range; frames recorded without a clock count as 1 fps
+  layout->usec_per_frame = 1000000;
+  if (frames > 1 && first_entry.time && entry.time > first_entry.time) {
+    int64_t span_ms = (int64_t)(entry.time - first_entry.time) * 1000 + entry.msec - first_entry.msec;
+    layout->usec_per_frame = span_ms * 1000 / (frames - 1);
+  }
+
+  if (!probe_dimensions(fs, begin, end, &layout->width, &layout->height)) {
+    log_w("AVI: cannot read frame size, header will say 0x0");
+  }
+  return true;
+}
+
+static void emit(emitter_t *e, const uint8_t *data, size_t len) {
+  static const uint8_t zeros[64] = {0};
+  uint64_t start = e->pos;
+  uint64_t stop = e->pos + len;
+  e->pos = stop;
+  if (!e->ok || stop <= e->first || start > e->last) {
+    return;
+  }
+  size_t skip = e->first > start ? e->first - start : 0;
+  size_t n = (stop > e->last + 1 ? e->last + 1 : stop) - start - skip;
+  if (data) {
+    e->ok = e->sink(e->ctx, data + skip, n);
+    return;
+  }
+  while (n && e->ok) {
+    size_t part = n < sizeof(zeros) ? n : sizeof(zeros);
+    e->ok = e->sink(e->ctx, zeros, part);
+    n -= part;
+  }
+}
+
+static void emit_header(emitter_t *e, const avi_layout_t *l) {
+  uint8_t hdr[AVI_HEADER_LEN];
+  uint8_t *p = hdr;
+  uint32_t frames = l->end - l->begin;
+
+  p = put_fourcc(p, "RIFF");
+  p = put_le32(p, l->total - 8);
+  p = put_fourcc(p, "AVI ");
+
+  p = put_fourcc(p, "LIST");
+  p = put_le32(p, 200 - 8);
+  p = put_fourcc(p, "hdrl");
+
+  p = put_fourcc(p, "avih");
+  p = put_le32(p, 56);
+  p = put_le32(p, l->usec_per_frame);
+  p = put_le32(p, (uint64_t)l->max_frame * 1000000 / (l->usec_per_frame ? l->usec_per_frame : 1));
+  p = put_le32(p, 0);  // padding granularity
+  p = put_le32(p, AVIF_HASINDEX);
+  p = put_le32(p, frames);
+  p = put_le32(p, 0);  // initial frames
+  p = put_le32(p, 1);  // streams
+  p = put_le32(p, l->max_frame);
+  p = put_le32(p, l->width);
+  p = put_le32(p, l->height);
+  for (int i = 0; i < 4; i++) {
+    p = put_le32(p, 0);
+  }
+
+  p = put_fourcc(p, "LIST");
+  p = put_le32(p, 124 - 8);
+  p = put_fourcc(p, "strl");
+
+  p = put_fourcc(p, "strh");
+  p = put_le32(p, 56);
+  p = put_fourcc(p, "vids");
+  p = put_fourcc(p, "MJPG");
+  p = put_le32(p, 0);  // flags
+  p = put_le16(p, 0);  // priority
+  p = put_le16(p, 0);  // language
+  p = put_le32(p, 0);  // initial frames
+  p = put_le32(p, l->usec_per_frame);  // scale / rate = seconds per frame
+  p = put_le32(p, 1000000);
+  p = put_le32(p, 0);  // start
+  p = put_le32(p, frames);
+  p = put_le32(p, l->max_frame);
+  p = put_le32(p, 0xFFFFFFFF);  // quality: default
+  p = put_le32(p, 0);           // sample size: varies
+  p = put_le16(p, 0);
+  p = put_le16(p, 0);
+  p = put_le16(p, l->width);
+  p = put_le16(p, l->height);
+
+  p = put_fourcc(p, "strf");
+  p = put_le32(p, 40);
+  p = put_le32(p, 40);
+  p = put_le32(p, l->width);
+  p = put_le32(p, l->height);
+  p = put_le16(p, 1);   // planes
+  p = put_le16(p, 24);  // bits per pixel
+  p = put_fourcc(p, "MJPG");
+  p = put_le32(p, l->width * l->height * 3);
+  for (int i = 0; i < 4; i++) {
+    p = put_le32(p, 0);
+  }
+
+  p = put_fourcc(p, "LIST");
+  p = put_le32(p, 4 + l->movi_bytes);
+  p = put_fourcc(p, "movi");
+
+  emit(e, hdr, p - hdr);
+}
+
+static void emit_frames(emitter_t *e, fs::FS &fs, const avi_layout_t *l) {
+  // Frames that end before the requested range are not read at all
+  size_t start = l->begin;
+  catalog_entry_t entry;
+  while (start < l->end && catalog_get(start, &entry) && e->pos + chunk_bytes(entry.size) <= e->first) {
+    e->pos += chunk_bytes(entry.size);
+    start++;
+  }
+  if (start >= l->end || e->pos > e->last) {
+    e->pos = AVI_HEADER_LEN + l->movi_bytes;
+    return;
+  }
+
+  sd_reader_t *reader = sd_reader_open(fs, start, l->end);
+  if (!reader) {
+    e->ok = false;
+    return;
+  }
+  uint8_t chunk[8];
+  for (size_t i = start; i < l->end && e->ok && e->pos <= e->last; i++) {
+    sd_frame_t *f = sd_reader_next(reader, 5000 / portTICK_PERIOD_MS);
+    if (!f) {
+      log_e("AVI: reading frame %u timed out", i);
+      e->ok = false;
+      break;
+    }
+    // The catalog size is what the header promised (the range is pinned);
+    // a damaged file is cut or zero-padded to it
+    uint32_t size = f->entry.size;
+    uint32_t have = f->len < size ? f->len : size;
+    put_le32(put_fourcc(chunk, "00dc"), size);
+    emit(e, chunk, sizeof(chunk));
+    emit(e, f->buf, have);
+    emit(e, NULL, size - have + (size & 1));
+    sd_reader_release(reader, f);
+  }
+  sd_reader_close(reader);
+  e->pos = AVI_HEADER_LEN + l->movi_bytes;
+}
+
+static void emit_index(emitter_t *e, const avi_layout_t *l) {
+  uint8_t buf[8 + AVI_INDEX_ENTRY * 32];
+  uint8_t *p = put_le32(put_fourcc(buf, "idx1"), (l->end - l->begin) * AVI_INDEX_ENTRY);
+  uint32_t offset = 4;  // from the "movi" fourcc
+  catalog_entry_t entry;
+  for (size_t i = l->begin; i < l->end && e->ok && e->pos <= e->last; i++) {
+    if (!catalog_get(i, &entry)) {
+      e->ok = false;
+      break;
+    }
+    p = put_fourcc(p, "00dc");
+    p = put_le32(p, AVIIF_KEYFRAME);
+    p = put_le32(p, offset);
+    p = put_le32(p, entry.size);
+    offset += chunk_bytes(entry.size);
+    if (p + AVI_INDEX_ENTRY > buf + sizeof(buf) || i + 1 == l->end) {
+      emit(e, buf, p - buf);
+      p = buf;
+    }
+  }
+}
+
+bool avi_write(fs::FS &fs, const avi_layout_t *layout, uint64_t first, uint64_t last, avi_sink_t sink, void *ctx) {
+  emitter_t e = {0, first, last, sink, ctx, true};
+  emit_header(&e, layout);
+  if (e.ok && e.pos <= last) {
+    emit_frames(&e, fs, layout);
+  }
+  if (e.ok && e.pos <= last) {
+    emit_index(&e, layout);
+  }
+  return e.ok;
+}
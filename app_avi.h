@@ -0,0 +1,43 @@
+/*
+ * AVI (MJPEG) export of recorded frames
+ *
+ * The file is never built on the card: the whole layout (headers, movi
+ * chunk offsets, idx1) follows from the catalog sizes, so the exact length
+ * is known before the first byte is sent and any byte range can be
+ * produced in one sequential pass. Frame data is read through the SD
+ * read-ahead reader; memory use does not depend on the length of the range.
+ *
+ * Plain RIFF AVI is limited to 4 GB; longer ranges are rejected by
+ * avi_plan() and have to be exported in parts.
+ */
+
+#ifndef APP_AVI_H
+#define APP_AVI_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "FS.h"
+
+typedef struct {
+  size_t begin;  // catalog range [begin, end)
+  size_t end;
+  uint32_t width;
+  uint32_t height;
+  uint32_t usec_per_frame;
+  uint32_t max_frame;
+  uint64_t movi_bytes;  // frame chunks, padding included
+  uint64_t total;       // file size
+} avi_layout_t;
+
+// Receives consecutive pieces of the file; false aborts the export
+typedef bool (*avi_sink_t)(void *ctx, const uint8_t *data, size_t len);
+
+// Size the export of catalog entries [begin, end). Fails on an empty range
+// or when the result would not fit a RIFF file. Keep the range pinned
+// (catalog_pin()) until avi_write() is done, so the sizes hold.
+bool avi_plan(fs::FS &fs, size_t begin, size_t end, avi_layout_t *layout);
+
+// Produce bytes [first, last] of the file
+bool avi_write(fs::FS &fs, const avi_layout_t *layout, uint64_t first, uint64_t last, avi_sink_t sink, void *ctx);
+
+#endif  // APP_AVI_H
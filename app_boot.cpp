@@ -0,0 +1,149 @@
+// Staged, concurrent boot sequence with per-stage timing.
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "app_boot.h"
+
+// Event group layout: bit N = stage N finished, bit N + 8 = stage N succeeded
+#define BOOT_DONE_BIT(stage) ((EventBits_t)1 << (stage))
+#define BOOT_OK_BIT(stage)   ((EventBits_t)1 << ((stage) + 8))
+
+typedef enum {
+  STAGE_IDLE = 0,
+  STAGE_WAITING,
+  STAGE_RUNNING,
+  STAGE_OK,
+  STAGE_FAILED,
+  STAGE_SKIPPED
+} stage_state_t;
+
+static const char *stage_state_names[] = {"idle", "waiting", "running", "ok", "failed", "skipped"};
+
+typedef struct {
+  const char *name;
+  EventBits_t depends;
+  boot_stage_fn_t fn;
+  volatile stage_state_t state;
+  int64_t queued_us;
+  int64_t start_us;
+  int64_t end_us;
+} boot_stage_info_t;
+
+static boot_stage_info_t stages[BOOT_STAGE_MAX];
+static EventGroupHandle_t boot_events = NULL;
+static int64_t boot_start_us = 0;
+static int64_t first_frame_us = 0;
+
+static void boot_stage_task(void *arg) {
+  boot_stage_t stage = (boot_stage_t)(intptr_t)arg;
+  boot_stage_info_t *info = &stages[stage];
+
+  if (info->depends) {
+    EventBits_t bits = xEventGroupWaitBits(boot_events, info->depends, pdFALSE, pdTRUE, portMAX_DELAY);
+    // The OK bits sit 8 positions above the matching DONE bits
+    EventBits_t ok = (bits >> 8) & info->depends;
+    if (ok != info->depends) {
+      info->start_us = info->end_us = esp_timer_get_time();
+      info->state = STAGE_SKIPPED;
+      log_e("Boot stage '%s' skipped: dependency failed", info->name);
+      xEventGroupSetBits(boot_events, BOOT_DONE_BIT(stage));
+      vTaskDelete(NULL);
+      return;
+    }
+  }
+
+  info->state = STAGE_RUNNING;
+  info->start_us = esp_timer_get_time();
+  bool ok = info->fn();
+  info->end_us = esp_timer_get_time();
+  info->state = ok ? STAGE_OK : STAGE_FAILED;
+  log_i("Boot stage '%s' %s in %ums", info->name, ok ? "done" : "FAILED", (uint32_t)((info->end_us - info->start_us) / 1000));
+
+  xEventGroupSetBits(boot_events, BOOT_DONE_BIT(stage) | (ok ? BOOT_OK_BIT(stage) : 0));
+  vTaskDelete(NULL);
+}
+
+void boot_init() {
+  if (boot_events) {
+    return;
+  }
+  boot_events = xEventGroupCreate();
+  boot_start_us = esp_timer_get_time();
+  memset(stages, 0, sizeof(stages));
+}
+
+bool boot_start_stage(boot_stage_t stage, const char *name, EventBits_t depends, boot_stage_fn_t fn, uint32_t stack_size, UBaseType_t priority) {
+  if (stage >= BOOT_STAGE_MAX || !boot_events || stages[stage].state != STAGE_IDLE) {
+    return false;
+  }
+  boot_stage_info_t *info = &stages[stage];
+  info->name = name;
+  info->depends = depends;
+  info->fn = fn;
+  info->queued_us = esp_timer_get_time();
+  info->state = STAGE_WAITING;
+
+  if (xTaskCreate(boot_stage_task, name, stack_size, (void *)(intptr_t)stage, priority, NULL) != pdPASS) {
+    log_e("Failed to create boot task for '%s'", name);
+    info->state = STAGE_FAILED;
+    xEventGroupSetBits(boot_events, BOOT_DONE_BIT(stage));
+    return false;
+  }
+  return true;
+}
+
+bool boot_wait(EventBits_t wait_stages, TickType_t timeout) {
+  if (!boot_events) {
+    return false;
+  }
+  EventBits_t bits = xEventGroupWaitBits(boot_events, wait_stages, pdFALSE, pdTRUE, timeout);
+  return ((bits >> 8) & wait_stages) == wait_stages;
+}
+
+bool boot_stage_ok(boot_stage_t stage) {
+  return boot_events && (xEventGroupGetBits(boot_events) & BOOT_OK_BIT(stage));
+}
+
+void boot_mark_first_frame() {
+  if (!first_frame_us) {
+    first_frame_us = esp_timer_get_time();
+  }
+}
+
+static uint32_t boot_ms(int64_t t) {
+  return t ? (uint32_t)(t / 1000) : 0;
+}
+
+void boot_log_summary() {
+  log_i("Boot timing (ms since reset):");
+  for (int i = 0; i < BOOT_STAGE_MAX; i++) {
+    boot_stage_info_t *info = &stages[i];
+    if (info->state == STAGE_IDLE) {
+      continue;
+    }
+    log_i(
+      "  %-9s %-8s start %5u  run %5u  wait %5u", info->name, stage_state_names[info->state], boot_ms(info->start_us),
+      boot_ms(info->end_us - info->start_us), boot_ms(info->start_us - info->queued_us)
+    );
+  }
+  log_i("  first frame at %u", boot_ms(first_frame_us));
+}
+
+int boot_print_json(char *buf, size_t len) {
+  size_t n = snprintf(buf, len, "{\"start_ms\":%u,\"first_frame_ms\":%u", boot_ms(boot_start_us), boot_ms(first_frame_us));
+  for (int i = 0; i < BOOT_STAGE_MAX && n < len; i++) {
+    boot_stage_info_t *info = &stages[i];
+    if (info->state == STAGE_IDLE) {
+      continue;
+    }
+    int64_t end = info->end_us ? info->end_us : esp_timer_get_time();
+    n += snprintf(
+      buf + n, len - n, ",\"%s\":{\"state\":\"%s\",\"start_ms\":%u,\"ms\":%u,\"wait_ms\":%u}", info->name, stage_state_names[info->state],
+      boot_ms(info->start_us), info->start_us ? boot_ms(end - info->start_us) : 0, boot_ms((info->start_us ? info->start_us : end) - info->queued_us)
+    );
+  }
+  if (n < len) {
+    n += snprintf(buf + n, len - n, "}");
+  }
+  return n < len ? n : (len ? len - 1 : 0);
+}
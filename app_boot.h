@@ -0,0 +1,55 @@
+/*
+ * Staged boot sequence
+ *
+ * setup() registers each init step as a stage with an explicit list of the
+ * stages it depends on. Every stage runs in its own FreeRTOS task as soon as
+ * its dependencies have finished, so independent steps (camera, SD card,
+ * WiFi) overlap instead of running back to back. Start time and duration of
+ * every stage are recorded and reported in /status.
+ */
+
+#ifndef APP_BOOT_H
+#define APP_BOOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+typedef enum {
+  BOOT_STAGE_CAMERA = 0,
+  BOOT_STAGE_STORAGE,
+  BOOT_STAGE_NETWORK,
+  BOOT_STAGE_SERVER,
+  BOOT_STAGE_RECORDER,
+  BOOT_STAGE_MAX
+} boot_stage_t;
+
+// Dependency mask helper: BOOT_DEP(BOOT_STAGE_CAMERA) | BOOT_DEP(...)
+#define BOOT_DEP(stage) ((EventBits_t)1 << (stage))
+
+typedef bool (*boot_stage_fn_t)(void);
+
+// Must be called once before any stage is started.
+void boot_init();
+
+// Run fn in its own task once every stage in `depends` has completed
+// successfully. If a dependency fails, the stage is skipped and reported so.
+bool boot_start_stage(boot_stage_t stage, const char *name, EventBits_t depends, boot_stage_fn_t fn, uint32_t stack_size, UBaseType_t priority);
+
+// Block until every stage in `stages` has finished (ok, failed or skipped).
+// Returns true only if all of them succeeded.
+bool boot_wait(EventBits_t stages, TickType_t timeout);
+
+bool boot_stage_ok(boot_stage_t stage);
+
+// Called by the recorder when the first frame has been captured.
+void boot_mark_first_frame();
+
+// Log the timing breakdown to the serial console.
+void boot_log_summary();
+
+// Append the timing breakdown as a JSON object, returns bytes written.
+int boot_print_json(char *buf, size_t len);
+
+#endif  // APP_BOOT_H
@@ -0,0 +1,197 @@
+// Burst capture: camera -> reserved PSRAM area -> SD card as one group
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "app_boot.h"
+#include "app_burst.h"
+#include "app_catalog.h"
+#include "app_clock.h"
+#include "app_events.h"
+#include "app_frame.h"
+
+#define BURST_PRIO_CAPTURE 5  // same as the frame hub, ahead of SD and HTTP
+#define BURST_PRIO_FLUSH   2
+
+typedef struct {
+  size_t offset;
+  uint32_t len;
+  int64_t captured_us;
+} burst_shot_t;
+
+static uint8_t *area = NULL;
+static size_t area_size = 0;
+static burst_shot_t shots[BURST_MAX_FRAMES];
+static burst_status_t current;
+static portMUX_TYPE burst_mux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t burst_task = NULL;
+
+static void set_state(burst_state_t state) {
+  portENTER_CRITICAL(&burst_mux);
+  current.state = state;
+  portEXIT_CRITICAL(&burst_mux);
+}
+
+// *wall_offset_us is 0 while the clock is not set
+static void capture(int64_t *wall_offset_us) {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  *wall_offset_us = 0;
+  if (clock_valid(now.tv_sec)) {
+    *wall_offset_us = (int64_t)now.tv_sec * 1000000 + now.tv_usec - esp_timer_get_time();
+  }
+
+  uint32_t last_seq = frame_seq();
+  size_t used = 0;
+  TickType_t wake = xTaskGetTickCount();
+  for (int k = 0; k < current.requested; k++) {
+    if (k && current.interval_ms) {
+      vTaskDelayUntil(&wake, current.interval_ms / portTICK_PERIOD_MS);
+    }
+    frame_t *frame = frame_get(last_seq, 1000 / portTICK_PERIOD_MS);
+    if (!frame) {
+      log_e("Burst: capture timed out after %d frames", k);
+      break;
+    }
+    last_seq = frame->seq;
+    camera_fb_t *fb = frame->fb;
+    if (fb->format != PIXFORMAT_JPEG || used + fb->len > area_size) {
+      if (fb->format == PIXFORMAT_JPEG) {
+        log_w("Burst: area full after %d frames", k);
+      }
+      frame_release(frame);
+      break;
+    }
+    memcpy(area + used, fb->buf, fb->len);
+    shots[k].offset = used;
+    shots[k].len = fb->len;
+    shots[k].captured_us = frame->captured_us;
+    used += (fb->len + 3) & ~3;
+    frame_release(frame);
+
+    portENTER_CRITICAL(&burst_mux);
+    current.captured = k + 1;
+    current.span_ms = (shots[k].captured_us - shots[0].captured_us) / 1000;
+    portEXIT_CRITICAL(&burst_mux);
+  }
+}
+
+static bool flush(int64_t wall_offset_us) {
+  if (!boot_wait(BOOT_DEP(BOOT_STAGE_STORAGE), portMAX_DELAY) || !catalog_ready()) {
+    log_e("Burst: storage unavailable");
+    return false;
+  }
+  bool ok = true;
+  // One group of consecutive sequence numbers; the recorder waits meanwhile
+  catalog_store_hold();
+  for (int k = 0; k < current.captured && ok; k++) {
+    // Without a clock the frames are stored with time 0, like the recorder's
+    int64_t wall_us = wall_offset_us ? wall_offset_us + shots[k].captured_us : 0;
+    catalog_entry_t entry;
+    uint16_t flags = CATALOG_FLAG_BURST | (k == 0 ? CATALOG_FLAG_GROUP_START : 0);
+    ok = catalog_store(area + shots[k].offset, shots[k].len, wall_us / 1000000, (wall_us / 1000) % 1000, flags, &entry) == ESP_OK;
+    if (ok) {
+      portENTER_CRITICAL(&burst_mux);
+      if (k == 0) {
+        current.first_seq = entry.seq;
+      }
+      current.last_seq = entry.seq;
+      current.stored = k + 1;
+      portEXIT_CRITICAL(&burst_mux);
+    }
+  }
+  catalog_store_release();
+  return ok;
+}
+
+static void burst_task_fn(void *arg) {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    int64_t wall_offset_us;
+    capture(&wall_offset_us);
+    log_i("Burst %u: %u of %u frames in %ums", current.id, current.captured, current.requested, current.span_ms);
+
+    // Timing no longer matters; let the recorder and HTTP go first
+    set_state(BURST_FLUSHING);
+    vTaskPrioritySet(NULL, BURST_PRIO_FLUSH);
+    bool ok = current.captured && flush(wall_offset_us);
+    vTaskPrioritySet(NULL, BURST_PRIO_CAPTURE);
+    set_state(ok ? BURST_DONE : BURST_FAILED);
+
+    char json[192];
+    burst_print_json(&current, json, sizeof(json));
+    events_publish("burst", "%s", json);
+  }
+}
+
+bool burst_init() {
+  if (area) {
+    return true;
+  }
+  if (!psramFound()) {
+    log_w("Burst: no PSRAM, bursts disabled");
+    return false;
+  }
+  area_size = BURST_AREA_PSRAM;
+  area = (uint8_t *)ps_malloc(area_size);
+  if (!area) {
+    log_e("Burst: cannot reserve %u bytes", area_size);
+    return false;
+  }
+  if (xTaskCreate(burst_task_fn, "burst", 4096, NULL, BURST_PRIO_CAPTURE, &burst_task) != pdPASS) {
+    log_e("Burst: cannot create task");
+    free(area);
+    area = NULL;
+    return false;
+  }
+  return true;
+}
+
+esp_err_t burst_start(uint16_t frames, uint32_t interval_ms, uint32_t *id) {
+  if (!area) {
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+  if (frames < 1) frames = 1;
+  if (frames > BURST_MAX_FRAMES) frames = BURST_MAX_FRAMES;
+
+  portENTER_CRITICAL(&burst_mux);
+  if (current.state == BURST_CAPTURING || current.state == BURST_FLUSHING) {
+    portEXIT_CRITICAL(&burst_mux);
+    return ESP_ERR_INVALID_STATE;
+  }
+  uint32_t next_id = current.id + 1;
+  memset(&current, 0, sizeof(current));
+  current.id = next_id;
+  current.state = BURST_CAPTURING;
+  current.requested = frames;
+  current.interval_ms = interval_ms;
+  portEXIT_CRITICAL(&burst_mux);
+
+  *id = next_id;
+  xTaskNotifyGive(burst_task);
+  return ESP_OK;
+}
+
+bool burst_get(uint32_t id, burst_status_t *status) {
+  portENTER_CRITICAL(&burst_mux);
+  bool found = current.id && current.id == id;
+  if (found) {
+    *status = current;
+  }
+  portEXIT_CRITICAL(&burst_mux);
+  return found;
+}
+
+int burst_print_json(const burst_status_t *s, char *buf, size_t len) {
+  static const char *states[] = {"idle", "capturing", "flushing", "done", "failed"};
+  int n = snprintf(
+    buf, len, "{\"id\":%u,\"state\":\"%s\",\"requested\":%u,\"captured\":%u,\"stored\":%u,\"interval_ms\":%u,\"span_ms\":%u", s->id, states[s->state],
+    s->requested, s->captured, s->stored, s->interval_ms, s->span_ms
+  );
+  if (s->stored && n < (int)len) {
+    n += snprintf(buf + n, len - n, ",\"first_seq\":%u,\"last_seq\":%u", s->first_seq, s->last_seq);
+  }
+  if (n < (int)len) {
+    n += snprintf(buf + n, len - n, "}");
+  }
+  return n < (int)len ? n : (len ? len - 1 : 0);
+}
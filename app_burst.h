@@ -0,0 +1,52 @@
+/*
+ * Burst capture
+ *
+ * A burst takes N consecutive frames at sensor rate (or every interval ms)
+ * into a PSRAM area reserved at boot, so its timing does not depend on the
+ * SD card or the network. /burst returns an id right away; once the frames
+ * are in memory they are flushed to the card in the background as one
+ * group of consecutive sequence numbers (CATALOG_FLAG_BURST), and a
+ * "burst" event is published.
+ */
+
+#ifndef APP_BURST_H
+#define APP_BURST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define BURST_MAX_FRAMES 64
+#define BURST_AREA_PSRAM (1024 * 1024)
+
+typedef enum {
+  BURST_IDLE = 0,
+  BURST_CAPTURING,
+  BURST_FLUSHING,
+  BURST_DONE,
+  BURST_FAILED,
+} burst_state_t;
+
+typedef struct {
+  uint32_t id;
+  burst_state_t state;
+  uint16_t requested;
+  uint16_t captured;  // less than requested when the area filled up
+  uint16_t stored;
+  uint32_t interval_ms;
+  uint32_t first_seq;  // valid once stored > 0
+  uint32_t last_seq;
+  uint32_t span_ms;  // first to last capture
+} burst_status_t;
+
+// Reserve the capture area. Without PSRAM bursts are unavailable.
+bool burst_init();
+
+// Begin a burst; ESP_ERR_INVALID_STATE while another one is running
+esp_err_t burst_start(uint16_t frames, uint32_t interval_ms, uint32_t *id);
+
+// Status of the given (most recent) burst
+bool burst_get(uint32_t id, burst_status_t *status);
+int burst_print_json(const burst_status_t *status, char *buf, size_t len);
+
+#endif  // APP_BURST_H
@@ -0,0 +1,16 @@
+// Little-endian field writers for file headers
+#include "app_bytes.h"
+
+uint8_t *put_le16(uint8_t *p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  return p + 2;
+}
+
+uint8_t *put_le32(uint8_t *p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+  return p + 4;
+}
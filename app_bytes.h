@@ -0,0 +1,17 @@
+/*
+ * Little-endian field writers
+ *
+ * AVI (RIFF) and ZIP headers are laid out field by field into a byte
+ * buffer. Each writer stores one value and returns the position after it,
+ * so a header reads as a sequence of p = put_le32(p, ...) lines.
+ */
+
+#ifndef APP_BYTES_H
+#define APP_BYTES_H
+
+#include <stdint.h>
+
+uint8_t *put_le16(uint8_t *p, uint16_t v);
+uint8_t *put_le32(uint8_t *p, uint32_t v);
+
+#endif  // APP_BYTES_H
@@ -0,0 +1,614 @@
+// Frame catalog: in-memory index of stored images backed by /index.bin
+#include "Arduino.h"
+#include "freertos/semphr.h"
+#include "app_catalog.h"
+#include "app_clock.h"
+#include "app_jpeghdr.h"
+
+#define CATALOG_MAGIC   0x58444943  // "CIDX"
+#define CATALOG_VERSION 2
+#define CATALOG_V1_RECORD 16  // before still_until
+
+// Still markers reach the index at most this often (and before the next
+// entry); a power loss forgets at most this much of a still period
+#define CATALOG_STILL_SYNC_S 60
+
+// Entries copied per hold of the lock while catalog_sync() writes the index
+#define CATALOG_SYNC_CHUNK 32
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t record_size;
+} catalog_header_t;
+
+static fs::FS *catalog_fs = NULL;
+static catalog_entry_t *entries = NULL;
+static size_t entry_count = 0;
+static size_t entry_capacity = 0;
+static uint32_t next_seq = 0;
+static volatile uint32_t generation = 0;
+static bool still_pending = false;  // newest entry's still_until is ahead of the index
+static uint32_t still_synced = 0;   // still_until last written to the index
+static bool replaced = false;       // entries changed in place since the index was written
+static SemaphoreHandle_t catalog_lock = NULL;
+static SemaphoreHandle_t store_lock = NULL;  // recursive, see catalog_store_hold()
+
+// Seq ranges readers have pinned; taken before catalog_lock
+static SemaphoreHandle_t pin_lock = NULL;
+static struct {
+  bool used;
+  uint32_t first;
+  uint32_t last;
+} pins[CATALOG_PINS];
+static int pins_overflow = 0;  // pins that did not fit, each holds the whole catalog
+
+int catalog_path(uint32_t seq, char *buf, size_t len) {
+  return snprintf(buf, len, "/img_%03u.jpg", (unsigned)seq);
+}
+
+static bool catalog_reserve(size_t count) {
+  if (count <= entry_capacity) {
+    return true;
+  }
+  size_t capacity = entry_capacity ? entry_capacity : 256;
+  while (capacity < count) {
+    capacity *= 2;
+  }
+  catalog_entry_t *grown = NULL;
+  if (psramFound()) {
+    grown = (catalog_entry_t *)ps_realloc(entries, capacity * sizeof(catalog_entry_t));
+  } else {
+    grown = (catalog_entry_t *)realloc(entries, capacity * sizeof(catalog_entry_t));
+  }
+  if (!grown) {
+    log_e("Catalog: cannot grow to %u entries", capacity);
+    return false;
+  }
+  entries = grown;
+  entry_capacity = capacity;
+  return true;
+}
+
+static bool parse_image_name(const char *name, uint32_t *seq) {
+  const char *base = strrchr(name, '/');
+  base = base ? base + 1 : name;
+  unsigned value = 0;
+  char ext[5] = {0};
+  if (sscanf(base, "img_%u.%4s", &value, ext) != 2 || strcasecmp(ext, "jpg")) {
+    return false;
+  }
+  *seq = value;
+  return true;
+}
+
+// JPEG size of an image file, headers included
+static uint32_t image_size(File &file, uint16_t *flags) {
+  const uint8_t *hdr;
+  size_t hdr_len, size;
+  jpeghdr_open(file, &hdr, &hdr_len, &size);
+  *flags = hdr ? CATALOG_FLAG_DEDUP : 0;
+  return size;
+}
+
+// Modification time, 0 for files written before the clock was set
+static uint32_t file_time(File &file) {
+  time_t t = file.getLastWrite();
+  return clock_valid(t) ? t : 0;
+}
+
+static int compare_seq(const void *a, const void *b) {
+  uint32_t sa = ((const catalog_entry_t *)a)->seq;
+  uint32_t sb = ((const catalog_entry_t *)b)->seq;
+  return sa < sb ? -1 : (sa > sb ? 1 : 0);
+}
+
+// Put CATALOG_INDEX_TEMP in place of the index, or drop it when it was not
+// written out in full. Called with catalog_lock held.
+static bool commit_index(bool written) {
+  if (!written) {
+    // The old index stays
+    catalog_fs->remove(CATALOG_INDEX_TEMP);
+  }
+  // FAT cannot rename over an existing file; catalog_load() finishes the
+  // job if power is lost in between
+  bool ok = written;
+  if (ok) {
+    catalog_fs->remove(CATALOG_INDEX_PATH);
+    ok = catalog_fs->rename(CATALOG_INDEX_TEMP, CATALOG_INDEX_PATH);
+  }
+  if (!ok) {
+    log_e("Catalog: cannot write %s", CATALOG_INDEX_PATH);
+    return false;
+  }
+  if (entry_count) {
+    still_synced = entries[entry_count - 1].still_until;
+  }
+  still_pending = false;
+  return true;
+}
+
+static bool catalog_write_index() {
+  File index = catalog_fs->open(CATALOG_INDEX_TEMP, FILE_WRITE);
+  if (!index) {
+    log_e("Catalog: cannot create %s", CATALOG_INDEX_TEMP);
+    return false;
+  }
+  catalog_header_t header = {CATALOG_MAGIC, CATALOG_VERSION, sizeof(catalog_entry_t)};
+  bool ok = index.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+  if (ok && entry_count) {
+    size_t bytes = entry_count * sizeof(catalog_entry_t);
+    ok = index.write((const uint8_t *)entries, bytes) == bytes;
+  }
+  index.close();
+  if (!commit_index(ok)) {
+    return false;
+  }
+  replaced = false;
+  return true;
+}
+
+// Fills entries from the index. *rewrite is set when the file should be
+// written out again: an older format, or still markers to fold in.
+static bool catalog_read_index(bool *rewrite) {
+  File index = catalog_fs->open(CATALOG_INDEX_PATH, FILE_READ);
+  if (!index) {
+    return false;
+  }
+  catalog_header_t header;
+  if (index.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || header.magic != CATALOG_MAGIC
+      || !((header.version == CATALOG_VERSION && header.record_size == sizeof(catalog_entry_t))
+           || (header.version == 1 && header.record_size == CATALOG_V1_RECORD))) {
+    log_w("Catalog: %s has an unknown format", CATALOG_INDEX_PATH);
+    index.close();
+    return false;
+  }
+  bool v1 = header.version == 1;
+  // A torn final record (power loss during append) is simply dropped
+  size_t count = (index.size() - sizeof(header)) / header.record_size;
+  if (!catalog_reserve(count)) {
+    index.close();
+    return false;
+  }
+  size_t bytes = count * header.record_size;
+  bool ok = index.read((uint8_t *)entries, bytes) == bytes;
+  index.close();
+  if (!ok) {
+    return false;
+  }
+  if (v1) {
+    // Same fields minus still_until; widen in place from the back
+    for (size_t i = count; i-- > 0;) {
+      memmove(&entries[i], (uint8_t *)entries + i * CATALOG_V1_RECORD, CATALOG_V1_RECORD);
+      entries[i].still_until = 0;
+    }
+  }
+  // A record repeating the previous seq is a still marker updating it
+  size_t out = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (out && entries[i].seq == entries[out - 1].seq) {
+      entries[out - 1] = entries[i];
+    } else {
+      entries[out++] = entries[i];
+    }
+  }
+  *rewrite = v1 || out != count;
+  entry_count = out;
+  return true;
+}
+
+static bool catalog_rebuild() {
+  File root = catalog_fs->open("/");
+  if (!root) {
+    return false;
+  }
+  entry_count = 0;
+  File file = root.openNextFile();
+  while (file) {
+    uint32_t seq;
+    if (!file.isDirectory() && parse_image_name(file.name(), &seq) && catalog_reserve(entry_count + 1)) {
+      catalog_entry_t *e = &entries[entry_count++];
+      e->seq = seq;
+      e->size = image_size(file, &e->flags);
+      e->time = file_time(file);
+      e->msec = 0;
+      e->still_until = 0;
+    }
+    file = root.openNextFile();
+  }
+  root.close();
+  qsort(entries, entry_count, sizeof(catalog_entry_t), compare_seq);
+  log_i("Catalog: rebuilt from directory, %u images", entry_count);
+  return catalog_write_index();
+}
+
+esp_err_t catalog_load(fs::FS &fs) {
+  if (!catalog_lock) {
+    catalog_lock = xSemaphoreCreateMutex();
+    store_lock = xSemaphoreCreateRecursiveMutex();
+    pin_lock = xSemaphoreCreateMutex();
+  }
+  catalog_fs = &fs;
+
+  xSemaphoreTake(catalog_lock, portMAX_DELAY);
+  // A rewrite that was cut short: complete when the old index is already
+  // gone, otherwise the old index is the valid one
+  if (fs.exists(CATALOG_INDEX_TEMP)) {
+    if (fs.exists(CATALOG_INDEX_PATH)) {
+      fs.remove(CATALOG_INDEX_TEMP);
+    } else {
+      fs.rename(CATALOG_INDEX_TEMP, CATALOG_INDEX_PATH);
+    }
+  }
+  bool rewrite = false;
+  bool ok = catalog_read_index(&rewrite);
+  if (!ok) {
+    ok = catalog_rebuild();
+  } else if (rewrite) {
+    ok = catalog_write_index();
+  }
+  next_seq = entry_count ? entries[entry_count - 1].seq + 1 : 0;
+  generation++;
+  xSemaphoreGive(catalog_lock);
+
+  // Pick up frames that were written but not indexed before a power loss
+  char path[32];
+  while (ok) {
+    catalog_path(next_seq, path, sizeof(path));
+    File orphan = fs.open(path, FILE_READ);
+    if (!orphan) {
+      break;
+    }
+    catalog_entry_t e = {next_seq, 0, file_time(orphan), 0, 0};
+    e.size = image_size(orphan, &e.flags);
+    orphan.close();
+    log_w("Catalog: re-indexing %s", path);
+    if (catalog_append(&e) != ESP_OK) {
+      break;
+    }
+  }
+
+  log_i("Catalog: %u images, next sequence %u", entry_count, next_seq);
+  return ok ? ESP_OK : ESP_FAIL;
+}
+
+bool catalog_ready() {
+  return catalog_fs != NULL;
+}
+
+uint32_t catalog_next_seq() {
+  return next_seq;
+}
+
+esp_err_t catalog_append(const catalog_entry_t *entry) {
+  if (!catalog_fs) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  xSemaphoreTake(catalog_lock, portMAX_DELAY);
+  if (!catalog_reserve(entry_count + 1)) {
+    xSemaphoreGive(catalog_lock);
+    return ESP_ERR_NO_MEM;
+  }
+  File index = catalog_fs->open(CATALOG_INDEX_PATH, FILE_APPEND);
+  bool ok = index;
+  if (ok && still_pending) {
+    // The final state of the previous entry's still period
+    ok = index.write((const uint8_t *)&entries[entry_count - 1], sizeof(*entry)) == sizeof(*entry);
+    still_pending = !ok;
+  }
+  ok = ok && index.write((const uint8_t *)entry, sizeof(*entry)) == sizeof(*entry);
+  entries[entry_count++] = *entry;
+  if (entry->seq >= next_seq) {
+    next_seq = entry->seq + 1;
+  }
+  generation++;
+  if (index) {
+    index.close();
+  }
+  xSemaphoreGive(catalog_lock);
+
+  if (!ok) {
+    log_e("Catalog: failed to append seq %u to %s", entry->seq, CATALOG_INDEX_PATH);
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+esp_err_t catalog_mark_still(uint32_t seq, uint32_t time) {
+  if (!catalog_fs) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  xSemaphoreTake(catalog_lock, portMAX_DELAY);
+  catalog_entry_t *last = entry_count ? &entries[entry_count - 1] : NULL;
+  if (!last || last->seq != seq) {
+    xSemaphoreGive(catalog_lock);
+    return ESP_ERR_INVALID_STATE;
+  }
+  last->still_until = time;
+  bool ok = true;
+  if (time < still_synced || time - still_synced >= CATALOG_STILL_SYNC_S) {
+    // Appended again; catalog_load() folds it into the earlier record
+    File index = catalog_fs->open(CATALOG_INDEX_PATH, FILE_APPEND);
+    ok = index && index.write((const uint8_t *)last, sizeof(*last)) == sizeof(*last);
+    if (index) {
+      index.close();
+    }
+    still_synced = time;
+    still_pending = !ok;
+  } else {
+    still_pending = true;
+  }
+  xSemaphoreGive(catalog_lock);
+  return ok ? ESP_OK : ESP_FAIL;
+}
+
+static catalog_entry_t *find(uint32_t seq) {
+  size_t lo = 0, hi = entry_count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (entries[mid].seq < seq) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo < entry_count && entries[lo].seq == seq ? &entries[lo] : NULL;
+}
+
+esp_err_t catalog_replace(uint32_t seq, uint32_t size, uint16_t flags) {
+  if (!catalog_fs) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  xSemaphoreTake(catalog_lock, portMAX_DELAY);
+  catalog_entry_t *e = find(seq);
+  if (e) {
+    e->size = size;
+    e->flags = flags;
+    replaced = true;
+    generation++;
+  }
+  xSemaphoreGive(catalog_lock);
+  return e ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+// Writing a large index takes seconds, so it is copied out a chunk at a
+// time and only the last chunk (with whatever was appended meanwhile) and
+// the swap happen under the lock. Until then appends and still marks keep
+// going to the old index; a copied chunk never holds the newest entry, the
+// only one a still mark can change.
+esp_err_t catalog_sync() {
+  if (!catalog_fs) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  xSemaphoreTake(catalog_lock, portMAX_DELAY);
+  bool dirty = replaced;
+  replaced = false;  // changes from here on need another sync
+  xSemaphoreGive(catalog_lock);
+  if (!dirty) {
+    return ESP_OK;
+  }
+
+  File index = catalog_fs->open(CATALOG_INDEX_TEMP, FILE_WRITE);
+  catalog_header_t header = {CATALOG_MAGIC, CATALOG_VERSION, sizeof(catalog_entry_t)};
+  bool ok = index && index.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+  catalog_entry_t chunk[CATALOG_SYNC_CHUNK];
+  size_t done = 0;
+  while (true) {
+    xSemaphoreTake(catalog_lock, portMAX_DELAY);
+    size_t n = entry_count - done;
+    if (!ok || n <= CATALOG_SYNC_CHUNK) {
+      break;  // finished with the lock held
+    }
+    memcpy(chunk, &entries[done], sizeof(chunk));
+    xSemaphoreGive(catalog_lock);
+    ok = index.write((const uint8_t *)chunk, sizeof(chunk)) == sizeof(chunk);
+    done += CATALOG_SYNC_CHUNK;
+  }
+  size_t bytes = (entry_count - done) * sizeof(catalog_entry_t);
+  if (ok && bytes) {
+    ok = index.write((const uint8_t *)&entries[done], bytes) == bytes;
+  }
+  if (index) {
+    index.close();
+  }
+  ok = commit_index(ok);
+  replaced = replaced || !ok;
+  xSemaphoreGive(catalog_lock);
+  return ok ? ESP_OK : ESP_FAIL;
+}
+
+int catalog_pin(size_t begin, size_t end) {
+  if (!pin_lock || begin >= end) {
+    return -1;
+  }
+  catalog_entry_t first, last;
+  if (!catalog_get(begin, &first) || !catalog_get((end < catalog_count() ? end : catalog_count()) - 1, &last)) {
+    return -1;
+  }
+  // Waits for a replacement in progress, which may be in the range
+  xSemaphoreTake(pin_lock, portMAX_DELAY);
+  int pin = 0;
+  while (pin < CATALOG_PINS && pins[pin].used) {
+    pin++;
+  }
+  if (pin < CATALOG_PINS) {
+    pins[pin].used = true;
+    pins[pin].first = first.seq;
+    pins[pin].last = last.seq;
+  } else {
+    pins_overflow++;
+  }
+  xSemaphoreGive(pin_lock);
+  return pin;
+}
+
+int catalog_pin_seq(uint32_t seq) {
+  size_t index = catalog_lower_bound_seq(seq);
+  catalog_entry_t entry;
+  if (!catalog_get(index, &entry) || entry.seq != seq) {
+    return -1;
+  }
+  return catalog_pin(index, index + 1);
+}
+
+void catalog_unpin(int pin) {
+  if (pin < 0) {
+    return;
+  }
+  xSemaphoreTake(pin_lock, portMAX_DELAY);
+  if (pin < CATALOG_PINS) {
+    pins[pin].used = false;
+  } else {
+    pins_overflow--;
+  }
+  xSemaphoreGive(pin_lock);
+}
+
+static bool pinned(uint32_t seq) {
+  if (pins_overflow) {
+    return true;
+  }
+  for (int i = 0; i < CATALOG_PINS; i++) {
+    if (pins[i].used && seq >= pins[i].first && seq <= pins[i].last) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool catalog_pinned(uint32_t seq) {
+  if (!pin_lock) {
+    return false;
+  }
+  xSemaphoreTake(pin_lock, portMAX_DELAY);
+  bool p = pinned(seq);
+  xSemaphoreGive(pin_lock);
+  return p;
+}
+
+bool catalog_replace_begin(uint32_t seq) {
+  if (!pin_lock) {
+    return false;
+  }
+  xSemaphoreTake(pin_lock, portMAX_DELAY);
+  if (pinned(seq)) {
+    xSemaphoreGive(pin_lock);
+    return false;
+  }
+  return true;
+}
+
+void catalog_replace_end() {
+  xSemaphoreGive(pin_lock);
+}
+
+esp_err_t catalog_store(const uint8_t *jpeg, size_t len, uint32_t time, uint16_t msec, uint16_t flags, catalog_entry_t *out) {
+  if (!catalog_fs) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  xSemaphoreTakeRecursive(store_lock, portMAX_DELAY);
+  catalog_entry_t entry = {next_seq, (uint32_t)len, time, msec, flags};
+  char filename[32];
+  catalog_path(entry.seq, filename, sizeof(filename));
+
+  esp_err_t err = ESP_OK;
+  File file = catalog_fs->open(filename, FILE_WRITE);
+  if (!file) {
+    log_e("Failed to open %s in writing mode", filename);
+    err = ESP_FAIL;
+  } else {
+    bool deduped;
+    bool written = jpeghdr_store(file, jpeg, len, &deduped);
+    file.close();
+    if (!written) {
+      log_e("Short write on %s", filename);
+      err = ESP_FAIL;
+    } else if (deduped) {
+      entry.flags |= CATALOG_FLAG_DEDUP;
+    }
+  }
+  if (err == ESP_OK) {
+    err = catalog_append(&entry);
+  }
+  xSemaphoreGiveRecursive(store_lock);
+  if (err == ESP_OK && out) {
+    *out = entry;
+  }
+  return err;
+}
+
+void catalog_store_hold() {
+  if (store_lock) {
+    xSemaphoreTakeRecursive(store_lock, portMAX_DELAY);
+  }
+}
+
+void catalog_store_release() {
+  if (store_lock) {
+    xSemaphoreGiveRecursive(store_lock);
+  }
+}
+
+size_t catalog_count() {
+  return entry_count;
+}
+
+uint32_t catalog_generation() {
+  return generation;
+}
+
+bool catalog_get(size_t index, catalog_entry_t *out) {
+  if (!catalog_lock) {
+    return false;
+  }
+  bool found = false;
+  xSemaphoreTake(catalog_lock, portMAX_DELAY);
+  if (index < entry_count) {
+    *out = entries[index];
+    found = true;
+  }
+  xSemaphoreGive(catalog_lock);
+  return found;
+}
+
+size_t catalog_lower_bound_seq(uint32_t seq) {
+  if (!catalog_lock) {
+    return 0;
+  }
+  xSemaphoreTake(catalog_lock, portMAX_DELAY);
+  size_t lo = 0, hi = entry_count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (entries[mid].seq < seq) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  xSemaphoreGive(catalog_lock);
+  return lo;
+}
+
+size_t catalog_lower_bound_time(uint32_t time) {
+  if (!catalog_lock) {
+    return 0;
+  }
+  xSemaphoreTake(catalog_lock, portMAX_DELAY);
+  size_t lo = 0, hi = entry_count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    // Frames stored before the clock was set have no place in time order;
+    // compare against the next one that has
+    size_t probe = mid;
+    while (probe < hi && !clock_valid(entries[probe].time)) {
+      probe++;
+    }
+    if (probe < hi && entries[probe].time < time) {
+      lo = probe + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  xSemaphoreGive(catalog_lock);
+  return lo;
+}
@@ -0,0 +1,108 @@
+/*
+ * Catalog of recorded frames
+ *
+ * Keeps one fixed-size record per stored image, ordered by sequence number,
+ * in RAM (PSRAM when available) and mirrored to an append-only index file on
+ * the SD card, so boot does not need to walk the whole card. If the index is
+ * missing or unreadable it is rebuilt from the directory listing.
+ *
+ * When the recorder skips frames because nothing changed, the newest entry
+ * records until when the scene stayed still. Such updates are appended as
+ * another copy of the record, which loading folds back into one. Entries
+ * changed in place (recompressed frames) are saved by rewriting the index.
+ */
+
+#ifndef APP_CATALOG_H
+#define APP_CATALOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "FS.h"
+
+#define CATALOG_INDEX_PATH "/index.bin"
+#define CATALOG_INDEX_TEMP "/index.new"  // full rewrites go here first
+#define CATALOG_PINS       12  // readers tracked by range; more pin everything
+
+typedef struct {
+  uint32_t seq;    // image number, file is /img_<seq>.jpg
+  uint32_t size;   // JPEG bytes as served (less on card when CATALOG_FLAG_DEDUP)
+  uint32_t time;   // capture time, unix seconds (0 if the clock was not set)
+  uint16_t msec;   // capture time, milliseconds part
+  uint16_t flags;  // CATALOG_FLAG_*
+  uint32_t still_until;  // scene last seen unchanged since this frame, unix seconds (0 = never)
+} catalog_entry_t;
+
+#define CATALOG_FLAG_BURST       0x0001  // taken by /burst
+#define CATALOG_FLAG_GROUP_START 0x0002  // first frame of a burst
+#define CATALOG_FLAG_DEDUP       0x0004  // stored without its headers, see app_jpeghdr.h
+#define CATALOG_FLAG_RECOMPRESSED 0x0008 // rewritten smaller, see app_recompress.h
+
+// Load the index from the card (or rebuild it). Safe to call once at boot.
+esp_err_t catalog_load(fs::FS &fs);
+bool catalog_ready();
+
+// Sequence number to use for the next stored frame
+uint32_t catalog_next_seq();
+
+// Record a frame that has just been written to the card
+esp_err_t catalog_append(const catalog_entry_t *entry);
+
+// Note that the scene still looked like the newest entry (seq) at time,
+// instead of storing another frame. Only the newest entry can be marked;
+// repeated marks are batched into the index file. Does not change the
+// generation.
+esp_err_t catalog_mark_still(uint32_t seq, uint32_t time);
+
+// Record that the file of an existing entry was replaced: new size and
+// flags, effective at once. The index file catches up at catalog_sync().
+esp_err_t catalog_replace(uint32_t seq, uint32_t size, uint16_t flags);
+
+// Write the whole index out again if catalog_replace() changed it. The new
+// index is written beside the old one and renamed over it, so a power loss
+// leaves one or the other. Other callers wait for the lock only while the
+// tail is written and the files are swapped.
+esp_err_t catalog_sync();
+
+// Keep entries [begin, end) and their files as they are while they are
+// being read: sizes stay what a reader planned with. Returns a pin for
+// catalog_unpin(), -1 for an empty range.
+int catalog_pin(size_t begin, size_t end);
+// The one frame with this seq; -1 when it is not in the catalog
+int catalog_pin_seq(uint32_t seq);
+void catalog_unpin(int pin);
+bool catalog_pinned(uint32_t seq);
+
+// Bracket replacing a frame's file and calling catalog_replace(). false
+// (nothing to end) while a reader has the frame pinned; new pins wait
+// until catalog_replace_end().
+bool catalog_replace_begin(uint32_t seq);
+void catalog_replace_end();
+
+// Write a JPEG to the card as the next image and record it. Safe to call
+// from several tasks; sequence numbers stay in catalog order.
+esp_err_t catalog_store(const uint8_t *jpeg, size_t len, uint32_t time, uint16_t msec, uint16_t flags, catalog_entry_t *out);
+
+// Keep other writers out between several catalog_store() calls, so a group
+// of frames gets consecutive sequence numbers
+void catalog_store_hold();
+void catalog_store_release();
+
+size_t catalog_count();
+// Incremented on every change, used by readers to detect stale views
+uint32_t catalog_generation();
+// index 0 is the oldest entry
+bool catalog_get(size_t index, catalog_entry_t *out);
+
+// Index of the first entry with seq >= the given one (catalog_count() if none)
+size_t catalog_lower_bound_seq(uint32_t seq);
+// Same by capture time, passing over entries without a valid time (stored
+// before the clock was set), which sort as "not earlier" wherever they are.
+// Times only go up with seq while the clock is steady, so callers still
+// check each entry against their time range.
+size_t catalog_lower_bound_time(uint32_t time);
+
+// "/img_NNN.jpg" for the given sequence number
+int catalog_path(uint32_t seq, char *buf, size_t len);
+
+#endif  // APP_CATALOG_H
@@ -0,0 +1,6 @@
+// Wall clock validity
+#include "app_clock.h"
+
+bool clock_valid(time_t secs) {
+  return secs >= CLOCK_VALID_S;
+}
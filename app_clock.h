@@ -0,0 +1,22 @@
+/*
+ * Wall clock validity
+ *
+ * Until SNTP has set it, the system clock counts up from the epoch at boot,
+ * so its readings are not real dates. Anything that stores or schedules by
+ * wall-clock time checks clock_valid() first: the recorder stores 0 for
+ * frames taken before the clock was set, and the scheduler, summarizer and
+ * recompressor leave such times alone.
+ */
+
+#ifndef APP_CLOCK_H
+#define APP_CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define CLOCK_VALID_S 1600000000  // anything earlier predates SNTP
+
+// Whether secs (unix seconds) is a real date
+bool clock_valid(time_t secs);
+
+#endif  // APP_CLOCK_H
@@ -0,0 +1,186 @@
+// Server-Sent Events: shared event ring with per-subscriber read positions
+#include "Arduino.h"
+#include "esp_heap_caps.h"
+#include "esp_random.h"
+#include "freertos/task.h"
+#include "app_events.h"
+#include "app_recorder.h"
+
+typedef struct {
+  uint32_t id;
+  char type[16];
+  char data[EVENTS_DATA_MAX];
+} event_slot_t;
+
+typedef struct {
+  bool used;
+  volatile bool queued;  // a send is pending on the HTTP server task
+  httpd_handle_t hd;
+  int fd;
+  uint32_t next;  // id of the next event to send
+} subscriber_t;
+
+static event_slot_t ring[EVENTS_RING_SIZE];
+static uint32_t head = 1;  // id the next published event gets
+static uint32_t boot_epoch = 0;
+static subscriber_t subscribers[EVENTS_MAX_SUBSCRIBERS];
+static portMUX_TYPE events_mux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t events_task = NULL;
+
+void events_publish(const char *type, const char *fmt, ...) {
+  char data[EVENTS_DATA_MAX];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(data, sizeof(data), fmt, args);
+  va_end(args);
+
+  portENTER_CRITICAL(&events_mux);
+  event_slot_t *slot = &ring[head % EVENTS_RING_SIZE];
+  slot->id = head++;
+  snprintf(slot->type, sizeof(slot->type), "%s", type);
+  memcpy(slot->data, data, sizeof(data));
+  portEXIT_CRITICAL(&events_mux);
+
+  if (events_task) {
+    xTaskNotifyGive(events_task);
+  }
+}
+
+// Format the next pending event for sub into buf. Returns 0 when up to date.
+static int format_next(subscriber_t *sub, char *buf, size_t len) {
+  int n = 0;
+  portENTER_CRITICAL(&events_mux);
+  if (head - sub->next > EVENTS_RING_SIZE) {
+    // Too slow to keep up: tell the client to resynchronise from /status
+    uint32_t missed = head - EVENTS_RING_SIZE - sub->next;
+    sub->next = head - EVENTS_RING_SIZE;
+    n = snprintf(buf, len, "event: overflow\ndata: {\"missed\":%u}\n\n", missed);
+  } else if (sub->next != head) {
+    const event_slot_t *slot = &ring[sub->next % EVENTS_RING_SIZE];
+    n = snprintf(buf, len, "id: %08x.%u\nevent: %s\ndata: %s\n\n", boot_epoch, slot->id, slot->type, slot->data);
+    sub->next++;
+  }
+  portEXIT_CRITICAL(&events_mux);
+  return n < (int)len ? n : len - 1;
+}
+
+// Runs on the HTTP server task, which owns the sockets
+static void push_work(void *arg) {
+  subscriber_t *sub = (subscriber_t *)arg;
+  char buf[EVENTS_DATA_MAX + 64];
+
+  // Cleared first so events published while sending queue another pass
+  sub->queued = false;
+  while (sub->used) {
+    int len = format_next(sub, buf, sizeof(buf));
+    if (!len) {
+      break;
+    }
+    if (httpd_socket_send(sub->hd, sub->fd, buf, len, 0) < 0) {
+      log_w("Events: subscriber %d gone", sub->fd);
+      httpd_sess_trigger_close(sub->hd, sub->fd);
+      break;
+    }
+  }
+}
+
+static void publish_metrics() {
+  static recorder_stats_t last;
+  static unsigned long last_ms = 0;
+  recorder_stats_t now;
+  recorder_get_stats(&now);
+  unsigned long ms = millis();
+  float fps = last_ms ? (now.captured - last.captured) * 1000.0f / (ms - last_ms) : 0;
+  last = now;
+  last_ms = ms;
+
+  events_publish(
+    "metrics", "{\"fps\":%.2f,\"captured\":%u,\"stored\":%u,\"dropped\":%u,\"ring_used\":%u,\"heap\":%u,\"psram\":%u}", fps, now.captured, now.stored,
+    now.dropped, now.ring_used, heap_caps_get_free_size(MALLOC_CAP_INTERNAL), heap_caps_get_free_size(MALLOC_CAP_SPIRAM)
+  );
+}
+
+static void events_dispatch_task(void *arg) {
+  unsigned long last_metrics = 0;
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, EVENTS_METRICS_MS / portTICK_PERIOD_MS);
+    // Metrics double as a keep-alive, so only produce them for listeners
+    if (millis() - last_metrics >= EVENTS_METRICS_MS) {
+      last_metrics = millis();
+      if (events_subscriber_count()) {
+        publish_metrics();
+      }
+    }
+
+    for (int i = 0; i < EVENTS_MAX_SUBSCRIBERS; i++) {
+      subscriber_t *sub = &subscribers[i];
+      portENTER_CRITICAL(&events_mux);
+      bool behind = sub->used && !sub->queued && sub->next != head;
+      if (behind) {
+        sub->queued = true;
+      }
+      portEXIT_CRITICAL(&events_mux);
+      if (behind && httpd_queue_work(sub->hd, push_work, sub) != ESP_OK) {
+        sub->queued = false;
+      }
+    }
+  }
+}
+
+bool events_init() {
+  if (events_task) {
+    return true;
+  }
+  boot_epoch = esp_random();
+  if (xTaskCreate(events_dispatch_task, "events", 3072, NULL, 2, &events_task) != pdPASS) {
+    log_e("Events: cannot create task");
+    return false;
+  }
+  return true;
+}
+
+bool events_subscribe(httpd_handle_t hd, int fd, const char *last_event_id) {
+  unsigned int epoch = 0, id = 0;
+  bool resume = last_event_id && sscanf(last_event_id, "%x.%u", &epoch, &id) == 2 && epoch == boot_epoch;
+
+  portENTER_CRITICAL(&events_mux);
+  subscriber_t *sub = NULL;
+  for (int i = 0; i < EVENTS_MAX_SUBSCRIBERS && !sub; i++) {
+    if (!subscribers[i].used) {
+      sub = &subscribers[i];
+    }
+  }
+  if (sub) {
+    sub->hd = hd;
+    sub->fd = fd;
+    sub->queued = false;
+    // Resume right after the last event the client saw; format_next()
+    // reports an overflow if that has already left the ring
+    sub->next = resume && id < head ? id + 1 : head;
+    sub->used = true;
+  }
+  portEXIT_CRITICAL(&events_mux);
+
+  if (sub && events_task) {
+    xTaskNotifyGive(events_task);
+  }
+  return sub != NULL;
+}
+
+void events_forget(httpd_handle_t hd, int fd) {
+  portENTER_CRITICAL(&events_mux);
+  for (int i = 0; i < EVENTS_MAX_SUBSCRIBERS; i++) {
+    if (subscribers[i].used && subscribers[i].hd == hd && subscribers[i].fd == fd) {
+      subscribers[i].used = false;
+    }
+  }
+  portEXIT_CRITICAL(&events_mux);
+}
+
+int events_subscriber_count() {
+  int count = 0;
+  for (int i = 0; i < EVENTS_MAX_SUBSCRIBERS; i++) {
+    count += subscribers[i].used ? 1 : 0;
+  }
+  return count;
+}
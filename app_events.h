@@ -0,0 +1,40 @@
+/*
+ * Server-Sent Events push channel
+ *
+ * Every event (sensor state change, new recording, periodic metrics) is
+ * formatted once into a small shared ring. Subscribers are just a socket and
+ * a read position in that ring: a background task notices new events and
+ * queues a send on the HTTP server task for each subscriber that is behind,
+ * so an idle /events connection costs no CPU and no per-client buffering.
+ * Event ids carry a per-boot prefix so EventSource reconnects resume from
+ * Last-Event-ID without replaying events from a previous boot.
+ */
+
+#ifndef APP_EVENTS_H
+#define APP_EVENTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_http_server.h"
+
+#define EVENTS_RING_SIZE       32
+#define EVENTS_DATA_MAX        192  // JSON payload, truncated beyond this
+#define EVENTS_MAX_SUBSCRIBERS 4
+#define EVENTS_METRICS_MS      5000
+
+// Start the dispatch task. Safe to call more than once.
+bool events_init();
+
+// Queue an event for every subscriber; data is printf-formatted JSON
+void events_publish(const char *type, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// Attach an already answered connection. last_event_id is the client's
+// Last-Event-ID header or NULL. Returns false when all slots are taken.
+bool events_subscribe(httpd_handle_t hd, int fd, const char *last_event_id);
+
+// Session close hook: drops the subscriber using this socket, if any
+void events_forget(httpd_handle_t hd, int fd);
+
+int events_subscriber_count();
+
+#endif  // APP_EVENTS_H
@@ -0,0 +1,84 @@
+// Low-priority tasks that build indexes by following the catalog
+#include "Arduino.h"
+#include "app_boot.h"
+#include "app_follow.h"
+
+static void follower_task(void *arg) {
+  const follower_t *f = (const follower_t *)arg;
+  if (!boot_wait(BOOT_DEP(BOOT_STAGE_STORAGE), portMAX_DELAY) || !catalog_ready()) {
+    log_e("Follow: storage unavailable, %s disabled", f->name);
+    vTaskDelete(NULL);
+    return;
+  }
+  if (!f->load()) {
+    vTaskDelete(NULL);
+    return;
+  }
+  size_t next = f->resume();
+  while (true) {
+    size_t total = catalog_count();
+    catalog_entry_t entry;
+    for (; next < total && catalog_get(next, &entry); next++) {
+      f->visit(next, &entry);
+    }
+    if (f->caught_up) {
+      f->caught_up();
+    }
+    ulTaskNotifyTake(pdTRUE, FOLLOW_IDLE_MS / portTICK_PERIOD_MS);
+  }
+}
+
+bool follower_start(const follower_t *f, TaskHandle_t *task) {
+  // Below the recorder and the web server: only spare CPU time is used
+  if (xTaskCreate(follower_task, f->name, 4096, (void *)f, 1, task) != pdPASS) {
+    log_e("Follow: cannot create the %s task", f->name);
+    return false;
+  }
+  return true;
+}
+
+void hint_put(hint_ring_t *ring, uint32_t seq, const void *data, size_t len) {
+  len = len < FOLLOW_HINT_MAX ? len : FOLLOW_HINT_MAX;
+  portENTER_CRITICAL(&ring->mux);
+  ring->slots[ring->next].valid = true;
+  ring->slots[ring->next].seq = seq;
+  memcpy(ring->slots[ring->next].data, data, len);
+  ring->next = (ring->next + 1) % FOLLOW_HINTS;
+  portEXIT_CRITICAL(&ring->mux);
+}
+
+bool hint_take(hint_ring_t *ring, uint32_t seq, void *data, size_t len) {
+  len = len < FOLLOW_HINT_MAX ? len : FOLLOW_HINT_MAX;
+  bool found = false;
+  portENTER_CRITICAL(&ring->mux);
+  for (int i = 0; i < FOLLOW_HINTS && !found; i++) {
+    if (ring->slots[i].valid && ring->slots[i].seq == seq) {
+      memcpy(data, ring->slots[i].data, len);
+      found = true;
+    }
+  }
+  portEXIT_CRITICAL(&ring->mux);
+  return found;
+}
+
+bool follow_pad_torn(fs::FS &fs, const char *path, size_t header_size, size_t record_size) {
+  if (!fs.exists(path)) {
+    return true;
+  }
+  File file = fs.open(path, FILE_APPEND);
+  if (!file) {
+    return false;
+  }
+  size_t size = file.size();
+  size_t torn = size > header_size ? (size - header_size) % record_size : 0;
+  uint8_t pad[64];
+  memset(pad, 0xFF, sizeof(pad));
+  bool ok = true;
+  for (size_t left = torn ? record_size - torn : 0; ok && left;) {
+    size_t n = left < sizeof(pad) ? left : sizeof(pad);
+    ok = file.write(pad, n) == n;
+    left -= n;
+  }
+  file.close();
+  return ok;
+}
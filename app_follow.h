@@ -0,0 +1,65 @@
+/*
+ * Catalog followers
+ *
+ * Indexes derived from the stored frames (perceptual hashes, scene-change
+ * summaries) are built by a low-priority task that follows the catalog:
+ * once storage is up it loads what was saved, picks the catalog index to
+ * resume at, then visits every entry from there on and sleeps until the
+ * recorder notifies it or FOLLOW_IDLE_MS pass. Catalog indices never
+ * shift, so the cursor is a plain index.
+ *
+ * The recorder already decoded the frames it stores and hands the result
+ * over through a hint ring, so the follower only reads frames back from
+ * the card when the hint is gone (bursts, older recordings, a busy spell).
+ */
+
+#ifndef APP_FOLLOW_H
+#define APP_FOLLOW_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "FS.h"
+#include "app_catalog.h"
+
+#define FOLLOW_IDLE_MS  2000  // catalog poll when nobody notifies
+#define FOLLOW_HINTS    8
+#define FOLLOW_HINT_MAX 64    // bytes of data per hint
+
+typedef struct {
+  const char *name;  // task name, also used in logs
+  // After storage came up; false disables the follower
+  bool (*load)();
+  // Catalog index of the first entry to visit
+  size_t (*resume)();
+  void (*visit)(size_t index, const catalog_entry_t *entry);
+  // Every entry so far was visited (optional)
+  void (*caught_up)();
+} follower_t;
+
+// Run f on its own task; f must outlive it
+bool follower_start(const follower_t *f, TaskHandle_t *task);
+
+typedef struct {
+  portMUX_TYPE mux;
+  int next;
+  struct {
+    bool valid;
+    uint32_t seq;
+    uint8_t data[FOLLOW_HINT_MAX];
+  } slots[FOLLOW_HINTS];
+} hint_ring_t;
+
+#define HINT_RING_INITIALIZER {portMUX_INITIALIZER_UNLOCKED, 0, {}}
+
+// Remember len bytes for seq, replacing the oldest hint
+void hint_put(hint_ring_t *ring, uint32_t seq, const void *data, size_t len);
+// Copy the hint for seq into data; false when it is gone
+bool hint_take(hint_ring_t *ring, uint32_t seq, void *data, size_t len);
+
+// Complete a record torn by a power loss with bytes that fail any check,
+// so later appends stay on the record grid
+bool follow_pad_torn(fs::FS &fs, const char *path, size_t header_size, size_t record_size);
+
+#endif  // APP_FOLLOW_H
@@ -0,0 +1,202 @@
+// Shared, reference-counted camera frames
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "app_frame.h"
+#include "app_sensor.h"
+
+// More slots than the driver has buffers, so a captured frame always fits
+#define FRAME_SLOTS 6
+// A frame older than this is not handed to callers asking for "any" frame
+#define FRAME_FRESH_US (250 * 1000)
+// Let go of the last frame when nobody asked for a new one in this time
+#define FRAME_IDLE_MS 500
+// Frame interval assumed until the hub has timed a few frames
+#define FRAME_INTERVAL_DEFAULT_US (66 * 1000)
+
+static frame_t slots[FRAME_SLOTS];
+static frame_t *latest = NULL;
+static uint32_t latest_seq = 0;
+static TaskHandle_t waiters[FRAME_MAX_WAITERS];
+static int waiter_count = 0;
+static portMUX_TYPE frame_mux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t hub_task = NULL;
+static int32_t interval_us = 0;  // sensor frame interval as measured
+
+static bool add_waiter(TaskHandle_t task) {
+  for (int i = 0; i < waiter_count; i++) {
+    if (waiters[i] == task) {
+      return true;
+    }
+  }
+  if (waiter_count == FRAME_MAX_WAITERS) {
+    return false;
+  }
+  waiters[waiter_count++] = task;
+  return true;
+}
+
+static void remove_waiter(TaskHandle_t task) {
+  for (int i = 0; i < waiter_count; i++) {
+    if (waiters[i] == task) {
+      waiters[i] = waiters[--waiter_count];
+      return;
+    }
+  }
+}
+
+void frame_release(frame_t *frame) {
+  if (!frame) {
+    return;
+  }
+  portENTER_CRITICAL(&frame_mux);
+  bool last = --frame->refs == 0;
+  portEXIT_CRITICAL(&frame_mux);
+  if (last) {
+    esp_camera_fb_return(frame->fb);
+    frame->fb = NULL;
+  }
+}
+
+// Swap in a new latest frame and wake everyone waiting for it
+static void publish(frame_t *frame) {
+  TaskHandle_t wake[FRAME_MAX_WAITERS];
+  portENTER_CRITICAL(&frame_mux);
+  frame_t *old = latest;
+  latest = frame;
+  latest_seq = frame ? frame->seq : latest_seq;
+  int n = waiter_count;
+  memcpy(wake, waiters, n * sizeof(TaskHandle_t));
+  waiter_count = 0;
+  portEXIT_CRITICAL(&frame_mux);
+
+  frame_release(old);
+  for (int i = 0; i < n; i++) {
+    xTaskNotifyGive(wake[i]);
+  }
+}
+
+static frame_t *free_slot() {
+  frame_t *slot = NULL;
+  portENTER_CRITICAL(&frame_mux);
+  for (int i = 0; i < FRAME_SLOTS && !slot; i++) {
+    if (!slots[i].fb && !slots[i].refs) {
+      slot = &slots[i];
+      slot->refs = 1;  // the hub's reference, dropped when superseded
+    }
+  }
+  portEXIT_CRITICAL(&frame_mux);
+  return slot;
+}
+
+static void frame_hub_task(void *arg) {
+  uint32_t seq = 0;
+  int64_t last_us = 0;
+  while (true) {
+    portENTER_CRITICAL(&frame_mux);
+    bool demand = waiter_count > 0;
+    portEXIT_CRITICAL(&frame_mux);
+    if (!demand) {
+      // Give the driver its buffer back if nobody comes for the last frame
+      if (!ulTaskNotifyTake(pdTRUE, FRAME_IDLE_MS / portTICK_PERIOD_MS)) {
+        publish(NULL);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      }
+      continue;
+    }
+
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (!fb) {
+      log_e("Camera capture failed");
+      vTaskDelay(10 / portTICK_PERIOD_MS);
+      continue;
+    }
+    // Captured while a /control batch was being applied
+    if (sensor_frame_is_stale(fb)) {
+      esp_camera_fb_return(fb);
+      continue;
+    }
+    frame_t *frame = free_slot();
+    if (!frame) {
+      esp_camera_fb_return(fb);
+      vTaskDelay(1);
+      continue;
+    }
+    frame->fb = fb;
+    if (++seq == 0) {
+      seq = 1;  // 0 means "any frame" to frame_get()
+    }
+    frame->seq = seq;
+    frame->captured_us = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+    // Slow consumers make the hub skip frames, so the interval follows the
+    // shortest gaps at once and longer ones only slowly; idle gaps are ignored
+    int64_t delta = frame->captured_us - last_us;
+    if (last_us && delta > 0 && delta < FRAME_IDLE_MS * 1000) {
+      interval_us = !interval_us || delta < interval_us ? delta : interval_us + (delta - interval_us) / 16;
+    }
+    last_us = frame->captured_us;
+    publish(frame);
+  }
+}
+
+bool frame_hub_start() {
+  if (hub_task) {
+    return true;
+  }
+  // Same priority as the old capture loops so streaming keeps its frame rate
+  if (xTaskCreate(frame_hub_task, "frame_hub", 3072, NULL, 5, &hub_task) != pdPASS) {
+    log_e("Frame hub: cannot create task");
+    return false;
+  }
+  return true;
+}
+
+static frame_t *wait_frame(uint32_t after_seq, int64_t since_us, TickType_t timeout) {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  TickType_t start = xTaskGetTickCount();
+
+  while (true) {
+    portENTER_CRITICAL(&frame_mux);
+    frame_t *frame = latest;
+    bool usable;
+    if (since_us) {
+      usable = frame && frame->captured_us >= since_us;
+    } else {
+      usable = frame && (after_seq ? (int32_t)(frame->seq - after_seq) > 0 : esp_timer_get_time() - frame->captured_us < FRAME_FRESH_US);
+    }
+    if (usable) {
+      frame->refs++;
+      remove_waiter(self);
+      portEXIT_CRITICAL(&frame_mux);
+      return frame;
+    }
+    bool queued = add_waiter(self);
+    portEXIT_CRITICAL(&frame_mux);
+
+    TickType_t waited = xTaskGetTickCount() - start;
+    if (!queued || !hub_task || waited >= timeout) {
+      portENTER_CRITICAL(&frame_mux);
+      remove_waiter(self);
+      portEXIT_CRITICAL(&frame_mux);
+      return NULL;
+    }
+    xTaskNotifyGive(hub_task);
+    ulTaskNotifyTake(pdTRUE, timeout - waited);
+  }
+}
+
+frame_t *frame_get(uint32_t after_seq, TickType_t timeout) {
+  return wait_frame(after_seq, 0, timeout);
+}
+
+frame_t *frame_get_since(int64_t since_us, TickType_t timeout) {
+  return wait_frame(0, since_us, timeout);
+}
+
+int32_t frame_interval_us() {
+  return interval_us ? interval_us : FRAME_INTERVAL_DEFAULT_US;
+}
+
+uint32_t frame_seq() {
+  return latest_seq;
+}
@@ -0,0 +1,48 @@
+/*
+ * Shared camera frames
+ *
+ * A single hub task is the only caller of esp_camera_fb_get(). Each frame it
+ * captures is published as the "latest" frame with a sequence number and a
+ * reference count; every consumer (recorder, /stream, /capture, RTSP) takes
+ * a reference, reads fb->buf directly and releases it. The driver buffer is
+ * returned once the last reference is dropped, so one capture feeds any
+ * number of viewers without copies and without consumers stealing frames
+ * from each other. The hub only captures while someone is waiting.
+ */
+
+#ifndef APP_FRAME_H
+#define APP_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_camera.h"
+#include "freertos/FreeRTOS.h"
+
+#define FRAME_MAX_WAITERS 8
+
+typedef struct {
+  camera_fb_t *fb;
+  uint32_t seq;         // increases by one per published frame
+  int64_t captured_us;  // esp_timer time the frame started
+  uint8_t refs;         // owned by app_frame
+} frame_t;
+
+// Start the hub task. Call once the camera driver is initialised.
+bool frame_hub_start();
+
+// Newest frame with a sequence number after after_seq (0 = any recent frame),
+// waiting up to timeout for one. Release it with frame_release().
+frame_t *frame_get(uint32_t after_seq, TickType_t timeout);
+void frame_release(frame_t *frame);
+
+// First frame that started at or after since_us (esp_timer time); frames
+// already buffered from before that are passed over
+frame_t *frame_get_since(int64_t since_us, TickType_t timeout);
+
+// Time between sensor frames, measured by the hub
+int32_t frame_interval_us();
+
+// Sequence number of the last published frame
+uint32_t frame_seq();
+
+#endif  // APP_FRAME_H
@@ -13,14 +13,38 @@
 // limitations under the License.
 #include "esp_http_server.h"
 #include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "lwip/sockets.h"
 #include "esp_camera.h"
 #include "img_converters.h"
 #include "fb_gfx.h"
 #include "esp32-hal-ledc.h"
 #include "sdkconfig.h"
 #include "camera_index.h"
+#include "web_assets.h"
 #include "FS.h"
 #include "SD_MMC.h"
+#include "app_archive.h"
+#include "app_avi.h"
+#include "app_boot.h"
+#include "app_burst.h"
+#include "app_catalog.h"
+#include "app_events.h"
+#include "app_frame.h"
+#include "app_jpeg.h"
+#include "app_jpeghdr.h"
+#include "app_sensor.h"
+#include "app_pagecache.h"
+#include "app_pool.h"
+#include "app_recompress.h"
+#include "app_recorder.h"
+#include "app_rtsp.h"
+#include "app_sdreader.h"
+#include "app_similar.h"
+#include "app_summary.h"
+#include "app_storage.h"
+#include "app_transcode.h"
+#include "app_ws.h"
 
 #if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
 #include "esp32-hal-log.h"
@@ -125,13 +149,14 @@ static esp_err_t bmp_handler(httpd_req_t *req) {
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
   uint64_t fr_start = esp_timer_get_time();
 #endif
-  fb = esp_camera_fb_get();
-  if (!fb) {
+  frame_t *frame = frame_get(0, 5000 / portTICK_PERIOD_MS);
+  if (!frame) {
     log_e("Camera capture failed");
     httpd_resp_send_500(req);
     return ESP_FAIL;
   }
 
+  fb = frame->fb;
   httpd_resp_set_type(req, "image/x-windows-bmp");
   httpd_resp_set_hdr(req, "Content-Disposition", "inline; filename=capture.bmp");
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
@@ -143,7 +168,7 @@ static esp_err_t bmp_handler(httpd_req_t *req) {
   uint8_t *buf = NULL;
   size_t buf_len = 0;
   bool converted = frame2bmp(fb, &buf, &buf_len);
-  esp_camera_fb_return(fb);
+  frame_release(frame);
   if (!converted) {
     log_e("BMP Conversion failed");
     httpd_resp_send_500(req);
@@ -170,27 +195,107 @@ static size_t jpg_encode_stream(void *arg, size_t index, const void *data, size_
   return len;
 }
 
+typedef struct {
+  httpd_req_t *req;
+  size_t sent;
+} jpeg_out_t;
+
+static bool jpeg_out_sink(void *ctx, const uint8_t *data, size_t len) {
+  jpeg_out_t *out = (jpeg_out_t *)ctx;
+  out->sent += len;
+  return httpd_resp_send_chunk(out->req, (const char *)data, len) == ESP_OK;
+}
+
+// ?crop=x,y,w,h: the region widened to whole MCUs and cut out of the
+// compressed data; X-Crop tells the client which region it got
+static esp_err_t send_jpeg_crop(httpd_req_t *req, const uint8_t *jpeg, size_t len, const char *spec) {
+  unsigned x, y, w, h;
+  if (sscanf(spec, "%u,%u,%u,%u", &x, &y, &w, &h) != 4 || x > 0xFFFF || y > 0xFFFF) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected crop=x,y,w,h");
+    return ESP_FAIL;
+  }
+  jpeg_info_t info;
+  if (jpeg_info(jpeg, len, &info) != ESP_OK) {
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Not a baseline JPEG");
+    return ESP_FAIL;
+  }
+  jpeg_rect_t rect = {(uint16_t)x, (uint16_t)y, (uint16_t)(w < 0xFFFF ? w : 0xFFFF), (uint16_t)(h < 0xFFFF ? h : 0xFFFF)};
+  if (!jpeg_crop_align(&info, &rect)) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Crop region outside the image");
+    return ESP_FAIL;
+  }
+
+  char region[32];
+  snprintf(region, sizeof(region), "%u,%u,%u,%u", rect.x, rect.y, rect.w, rect.h);
+  httpd_resp_set_hdr(req, "X-Crop", region);
+  jpeg_out_t out = {req, 0};
+  int64_t start = esp_timer_get_time();
+  esp_err_t err = jpeg_crop(jpeg, len, &rect, jpeg_out_sink, &out);
+  if (err != ESP_OK && !out.sent) {
+    httpd_resp_send_500(req);
+    return ESP_FAIL;
+  }
+  log_i("Crop %s: %u of %u bytes in %ums", region, out.sent, len, (uint32_t)((esp_timer_get_time() - start) / 1000));
+  httpd_resp_send_chunk(req, NULL, 0);
+  return err == ESP_OK ? ESP_OK : ESP_FAIL;
+}
+
+// ?rotate=90|180|270&flip=h|v|hv: blocks moved and their coefficients
+// transposed or negated, so the image loses nothing
+static esp_err_t send_jpeg_transform(httpd_req_t *req, const uint8_t *jpeg, size_t len, const char *rotate, const char *flip) {
+  jpeg_orient_t orient = {(uint16_t)atoi(rotate), strchr(flip, 'h') != NULL, strchr(flip, 'v') != NULL};
+  if (orient.rotate % 90 || orient.rotate > 270 || strspn(flip, "hv") != strlen(flip)) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected rotate=90|180|270 and/or flip=h|v|hv");
+    return ESP_FAIL;
+  }
+  jpeg_info_t info;
+  uint16_t width, height;
+  if (jpeg_info(jpeg, len, &info) != ESP_OK || !jpeg_transform_size(&info, &orient, &width, &height)) {
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Not a baseline JPEG");
+    return ESP_FAIL;
+  }
+
+  jpeg_out_t out = {req, 0};
+  int64_t start = esp_timer_get_time();
+  esp_err_t err = jpeg_transform(jpeg, len, &orient, jpeg_out_sink, &out);
+  if (err != ESP_OK && !out.sent) {
+    httpd_resp_send_500(req);
+    return ESP_FAIL;
+  }
+  log_i("Rotate %u flip %s: %ux%u, %u bytes in %ums", orient.rotate, flip, width, height, out.sent, (uint32_t)((esp_timer_get_time() - start) / 1000));
+  httpd_resp_send_chunk(req, NULL, 0);
+  return err == ESP_OK ? ESP_OK : ESP_FAIL;
+}
+
 static esp_err_t capture_handler(httpd_req_t *req) {
   camera_fb_t *fb = NULL;
+  frame_t *frame = NULL;
   esp_err_t res = ESP_OK;
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
   int64_t fr_start = esp_timer_get_time();
 #endif
 
 #if CONFIG_LED_ILLUMINATOR_ENABLED
-  enable_led(true);
-  vTaskDelay(150 / portTICK_PERIOD_MS);  // The LED needs to be turned on ~150ms before the call to esp_camera_fb_get()
-  fb = esp_camera_fb_get();              // or it won't be visible in the frame. A better way to do this is needed.
-  enable_led(false);
+  if (led_enabled && led_duty > 0) {
+    enable_led(true);
+    // The sensor reads rows out while the next ones are still exposing, so a
+    // frame is fully lit only when it starts a whole frame interval after the
+    // LED came on; older frames still in the driver's buffers are skipped
+    frame = frame_get_since(esp_timer_get_time() + frame_interval_us(), 5000 / portTICK_PERIOD_MS);
+    enable_led(false);
+  } else {
+    frame = frame_get(0, 5000 / portTICK_PERIOD_MS);
+  }
 #else
-  fb = esp_camera_fb_get();
+  frame = frame_get(0, 5000 / portTICK_PERIOD_MS);
 #endif
 
-  if (!fb) {
+  if (!frame) {
     log_e("Camera capture failed");
     httpd_resp_send_500(req);
     return ESP_FAIL;
   }
+  fb = frame->fb;
 
   httpd_resp_set_type(req, "image/jpeg");
   httpd_resp_set_hdr(req, "Content-Disposition", "inline; filename=capture.jpg");
@@ -203,7 +308,12 @@ static esp_err_t capture_handler(httpd_req_t *req) {
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
   size_t fb_len = 0;
 #endif
-  if (fb->format == PIXFORMAT_JPEG) {
+  char query[48];
+  char crop[32];
+  bool cropped = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK && httpd_query_key_value(query, "crop", crop, sizeof(crop)) == ESP_OK;
+  if (fb->format == PIXFORMAT_JPEG && cropped) {
+    res = send_jpeg_crop(req, fb->buf, fb->len, crop);
+  } else if (fb->format == PIXFORMAT_JPEG) {
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
     fb_len = fb->len;
 #endif
@@ -216,7 +326,7 @@ static esp_err_t capture_handler(httpd_req_t *req) {
     fb_len = jchunk.len;
 #endif
   }
-  esp_camera_fb_return(fb);
+  frame_release(frame);
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
   int64_t fr_end = esp_timer_get_time();
 #endif
@@ -224,19 +334,136 @@ static esp_err_t capture_handler(httpd_req_t *req) {
   return res;
 }
 
+// /burst?n=&interval= starts a burst and answers at once with its id;
+// /burst?id= reports how far capture and flushing got
+static esp_err_t burst_handler(httpd_req_t *req) {
+  char query[64];
+  char value[12];
+  int frames = 10;
+  uint32_t interval_ms = 0;
+  bool has_query = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK;
+  char json[192];
+  burst_status_t status;
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+  if (has_query && httpd_query_key_value(query, "id", value, sizeof(value)) == ESP_OK) {
+    if (!burst_get(strtoul(value, NULL, 10), &status)) {
+      httpd_resp_send_404(req);
+      return ESP_FAIL;
+    }
+    return httpd_resp_send(req, json, burst_print_json(&status, json, sizeof(json)));
+  }
+
+  if (has_query && httpd_query_key_value(query, "n", value, sizeof(value)) == ESP_OK) {
+    frames = atoi(value);
+  }
+  if (has_query && httpd_query_key_value(query, "interval", value, sizeof(value)) == ESP_OK) {
+    interval_ms = strtoul(value, NULL, 10);
+  }
+  uint32_t id = 0;
+  esp_err_t err = burst_start(frames, interval_ms, &id);
+  if (err == ESP_ERR_INVALID_STATE) {
+    httpd_resp_set_status(req, "409 Conflict");
+    return httpd_resp_send(req, "{\"error\":\"burst in progress\"}", HTTPD_RESP_USE_STRLEN);
+  }
+  if (err != ESP_OK || !burst_get(id, &status)) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    return httpd_resp_send(req, "{\"error\":\"bursts need PSRAM\"}", HTTPD_RESP_USE_STRLEN);
+  }
+  httpd_resp_set_status(req, "202 Accepted");
+  return httpd_resp_send(req, json, burst_print_json(&status, json, sizeof(json)));
+}
+
+#define ASYNC_MAX_WORKERS 4
+#define ASYNC_STACK       8192
+#define ASYNC_PRIORITY    5  // same as the servers
+
+typedef struct {
+  httpd_req_t *req;
+  esp_err_t (*handler)(httpd_req_t *req);
+} async_job_t;
+
+static int async_workers = 0;
+#if CONFIG_LED_ILLUMINATOR_ENABLED
+static int stream_viewers = 0;
+#endif
+static portMUX_TYPE async_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void async_worker(void *arg) {
+  async_job_t *job = (async_job_t *)arg;
+  job->handler(job->req);
+  httpd_req_async_handler_complete(job->req);
+  free(job);
+  portENTER_CRITICAL(&async_mux);
+  async_workers--;
+  portEXIT_CRITICAL(&async_mux);
+  vTaskDelete(NULL);
+}
+
+// A server runs all its handlers on one task, so a handler that streams for
+// minutes would hold up every other request on that server. Those handlers
+// run on a task of their own instead and the server moves on at once.
+static esp_err_t run_async(httpd_req_t *req, esp_err_t (*handler)(httpd_req_t *req)) {
+  portENTER_CRITICAL(&async_mux);
+  bool room = async_workers < ASYNC_MAX_WORKERS;
+  if (room) {
+    async_workers++;
+  }
+  portEXIT_CRITICAL(&async_mux);
+  if (!room) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", "5");
+    return httpd_resp_send(req, "Too many streams and downloads open", HTTPD_RESP_USE_STRLEN);
+  }
+  async_job_t *job = (async_job_t *)malloc(sizeof(async_job_t));
+  httpd_req_t *copy = NULL;
+  bool ok = job && httpd_req_async_handler_begin(req, &copy) == ESP_OK;
+  if (ok) {
+    job->req = copy;
+    job->handler = handler;
+    ok = xTaskCreate(async_worker, "httpd_async", ASYNC_STACK, job, ASYNC_PRIORITY, NULL) == pdPASS;
+    if (!ok) {
+      httpd_req_async_handler_complete(copy);
+    }
+  }
+  if (!ok) {
+    log_e("Cannot start a worker for %s", req->uri);
+    free(job);
+    portENTER_CRITICAL(&async_mux);
+    async_workers--;
+    portEXIT_CRITICAL(&async_mux);
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
 static esp_err_t stream_handler(httpd_req_t *req) {
   camera_fb_t *fb = NULL;
+  frame_t *frame = NULL;
+  uint32_t last_seq = 0;
   struct timeval _timestamp;
   esp_err_t res = ESP_OK;
   size_t _jpg_buf_len = 0;
   uint8_t *_jpg_buf = NULL;
   char *part_buf[128];
-
-  static int64_t last_frame = 0;
-  if (!last_frame) {
-    last_frame = esp_timer_get_time();
+  transcode_t *small = NULL;
+  uint8_t scale = 1;
+
+  char query[32];
+  char value[8];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK && httpd_query_key_value(query, "scale", value, sizeof(value)) == ESP_OK) {
+    scale = atoi(value);
+    if (scale != 1 && scale != 2 && scale != 4 && scale != 8) {
+      httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "scale must be 1, 2, 4 or 8");
+      return ESP_FAIL;
+    }
   }
 
+  int64_t last_frame = esp_timer_get_time();
+
   res = httpd_resp_set_type(req, _STREAM_CONTENT_TYPE);
   if (res != ESP_OK) {
     return res;
@@ -246,26 +473,48 @@ static esp_err_t stream_handler(httpd_req_t *req) {
   httpd_resp_set_hdr(req, "X-Framerate", "60");
 
 #if CONFIG_LED_ILLUMINATOR_ENABLED
-  isStreaming = true;
-  enable_led(true);
+  // Viewers stream side by side; the LED stays on until the last one leaves
+  portENTER_CRITICAL(&async_mux);
+  bool first_viewer = stream_viewers++ == 0;
+  portEXIT_CRITICAL(&async_mux);
+  if (first_viewer) {
+    isStreaming = true;
+    enable_led(true);
+  }
 #endif
 
   while (true) {
-    fb = esp_camera_fb_get();
-    if (!fb) {
+    frame = frame_get(last_seq, 5000 / portTICK_PERIOD_MS);
+    if (!frame) {
       log_e("Camera capture failed");
       res = ESP_FAIL;
     } else {
+      fb = frame->fb;
+      last_seq = frame->seq;
       _timestamp.tv_sec = fb->timestamp.tv_sec;
       _timestamp.tv_usec = fb->timestamp.tv_usec;
       if (fb->format != PIXFORMAT_JPEG) {
         bool jpeg_converted = frame2jpg(fb, 80, &_jpg_buf, &_jpg_buf_len);
-        esp_camera_fb_return(fb);
+        frame_release(frame);
+        frame = NULL;
         fb = NULL;
         if (!jpeg_converted) {
           log_e("JPEG compression failed");
           res = ESP_FAIL;
         }
+      } else if (scale > 1) {
+        // Shared with the other viewers at this scale; the frame itself is
+        // no longer needed
+        small = transcode_get(frame, scale);
+        frame_release(frame);
+        frame = NULL;
+        fb = NULL;
+        if (small) {
+          _jpg_buf_len = small->len;
+          _jpg_buf = small->buf;
+        } else {
+          res = ESP_FAIL;
+        }
       } else {
         _jpg_buf_len = fb->len;
         _jpg_buf = fb->buf;
@@ -281,10 +530,15 @@ static esp_err_t stream_handler(httpd_req_t *req) {
     if (res == ESP_OK) {
       res = httpd_resp_send_chunk(req, (const char *)_jpg_buf, _jpg_buf_len);
     }
-    if (fb) {
-      esp_camera_fb_return(fb);
+    if (frame) {
+      frame_release(frame);
+      frame = NULL;
       fb = NULL;
       _jpg_buf = NULL;
+    } else if (small) {
+      transcode_release(small);
+      small = NULL;
+      _jpg_buf = NULL;
     } else if (_jpg_buf) {
       free(_jpg_buf);
       _jpg_buf = NULL;
@@ -309,20 +563,354 @@ static esp_err_t stream_handler(httpd_req_t *req) {
   }
 
 #if CONFIG_LED_ILLUMINATOR_ENABLED
-  isStreaming = false;
-  enable_led(false);
+  portENTER_CRITICAL(&async_mux);
+  bool last_viewer = --stream_viewers == 0;
+  portEXIT_CRITICAL(&async_mux);
+  if (last_viewer) {
+    isStreaming = false;
+    enable_led(false);
+  }
 #endif
 
   return res;
 }
 
+// Each viewer gets its own task, so viewers at the same scale really share
+// one transcode per frame instead of taking turns on the server task
+static esp_err_t stream_async(httpd_req_t *req) {
+  return run_async(req, stream_handler);
+}
+
+#define PLAYBACK_LATE_US 1000000  // further behind than this, skip ahead
+
+// Milliseconds on the recording's clock; frames stored before the clock was
+// set have no time, they are paced one second apart like the recorder
+static int64_t recorded_ms(const catalog_entry_t *entry, int64_t previous) {
+  if (!entry->time) {
+    return previous + 1000;
+  }
+  return (int64_t)entry->time * 1000 + entry->msec;
+}
+
+// Replays stored frames with the /stream framing, paced by their capture
+// times. Reading runs ahead in its own task; when the client cannot keep up
+// the reader is moved forward to where playback should be by now.
+static esp_err_t playback_handler(httpd_req_t *req) {
+  uint32_t from = 0;
+  uint32_t to = 0;
+  float speed = 1.0f;
+  char query[96];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+    char value[16];
+    if (httpd_query_key_value(query, "from", value, sizeof(value)) == ESP_OK) {
+      from = strtoul(value, NULL, 10);
+    }
+    if (httpd_query_key_value(query, "to", value, sizeof(value)) == ESP_OK) {
+      to = strtoul(value, NULL, 10);
+    }
+    if (httpd_query_key_value(query, "speed", value, sizeof(value)) == ESP_OK) {
+      speed = atof(value);
+      if (speed < 0.1f) speed = 0.1f;
+      if (speed > 64.0f) speed = 64.0f;
+    }
+  }
+  size_t begin = from ? catalog_lower_bound_time(from) : 0;
+  size_t end = to ? catalog_lower_bound_time(to) : catalog_count();
+  if (!catalog_ready() || begin >= end) {
+    httpd_resp_send_404(req);
+    return ESP_FAIL;
+  }
+
+  sd_reader_t *reader = sd_reader_open(SD_MMC, begin, end);
+  if (!reader) {
+    httpd_resp_send_500(req);
+    return ESP_FAIL;
+  }
+  httpd_resp_set_type(req, _STREAM_CONTENT_TYPE);
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+  esp_err_t res = ESP_OK;
+  char part_buf[128];
+  int64_t start_us = 0;
+  int64_t start_ms = 0;
+  int64_t frame_ms = 0;
+  bool timed = false;
+  uint32_t sent = 0;
+  uint32_t skipped = 0;
+  sd_frame_t *f;
+  while (res == ESP_OK && (f = sd_reader_next(reader, 5000 / portTICK_PERIOD_MS)) != NULL) {
+    frame_ms = recorded_ms(&f->entry, frame_ms);
+    // Frames without a clock are paced at 1 fps; where the clock comes in
+    // (or goes), timing starts over instead of waiting out the jump
+    if (!start_us || timed != (f->entry.time != 0)) {
+      timed = f->entry.time != 0;
+      start_us = esp_timer_get_time();
+      start_ms = frame_ms;
+    }
+    int64_t due_us = start_us + (int64_t)((frame_ms - start_ms) * 1000 / speed);
+    int64_t now = esp_timer_get_time();
+    if (now < due_us) {
+      vTaskDelay((due_us - now) / 1000 / portTICK_PERIOD_MS);
+    } else if (timed && now - due_us > PLAYBACK_LATE_US) {
+      // Behind: jump to the frame that should be on screen now
+      int64_t target_ms = start_ms + (int64_t)((now - start_us) * speed / 1000);
+      size_t target = catalog_lower_bound_time(target_ms / 1000);
+      if (target > f->index + 1) {
+        skipped += target - f->index - 1;
+        sd_reader_skip_to(reader, target);
+      }
+    }
+    if (f->len) {
+      res = httpd_resp_send_chunk(req, _STREAM_BOUNDARY, strlen(_STREAM_BOUNDARY));
+      if (res == ESP_OK) {
+        size_t hlen = snprintf(part_buf, sizeof(part_buf), _STREAM_PART, f->len, f->entry.time, f->entry.msec * 1000);
+        res = httpd_resp_send_chunk(req, part_buf, hlen);
+      }
+      if (res == ESP_OK) {
+        res = httpd_resp_send_chunk(req, (const char *)f->buf, f->len);
+      }
+      sent++;
+    }
+    sd_reader_release(reader, f);
+  }
+  bool finished = sd_reader_done(reader);
+  sd_reader_close(reader);
+  log_i("Playback: %u frames sent, %u skipped%s", sent, skipped, finished ? "" : ", stopped early");
+  if (res == ESP_OK) {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
+static esp_err_t playback_async(httpd_req_t *req) {
+  return run_async(req, playback_handler);
+}
+
+static bool export_sink(void *ctx, const uint8_t *data, size_t len) {
+  httpd_req_t *req = (httpd_req_t *)ctx;
+  while (len) {
+    int n = httpd_send(req, (const char *)data, len);
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+// The AVI is generated while it is sent, so the response is written by hand:
+// an exact Content-Length instead of chunked encoding, and 206 for Range
+// requests so interrupted downloads can resume.
+static esp_err_t export_send(httpd_req_t *req, size_t begin, size_t end) {
+  avi_layout_t layout;
+  if (!avi_plan(SD_MMC, begin, end, &layout)) {
+    httpd_resp_set_status(req, "413 Payload Too Large");
+    return httpd_resp_send(req, "Range too long for one AVI, export it in parts", HTTPD_RESP_USE_STRLEN);
+  }
+
+  // The first and last frame plus the size identify the file for If-Range
+  catalog_entry_t first_entry, last_entry;
+  catalog_get(begin, &first_entry);
+  catalog_get(end - 1, &last_entry);
+  char etag[48];
+  snprintf(etag, sizeof(etag), "\"%u-%u-%llx\"", first_entry.seq, last_entry.seq, layout.total);
+
+  uint64_t first = 0;
+  uint64_t last = layout.total - 1;
+  bool partial = false;
+  char range[48];
+  char if_range[48];
+  bool fresh = httpd_req_get_hdr_value_str(req, "If-Range", if_range, sizeof(if_range)) != ESP_OK || strcmp(if_range, etag) == 0;
+  if (fresh && httpd_req_get_hdr_value_str(req, "Range", range, sizeof(range)) == ESP_OK) {
+    unsigned long long a = 0, b = last, suffix = 0;
+    int fields;
+    if (sscanf(range, "bytes=-%llu", &suffix) == 1) {
+      // The last N bytes
+      fields = suffix ? 2 : 0;
+      a = suffix < layout.total ? layout.total - suffix : 0;
+    } else {
+      fields = sscanf(range, "bytes=%llu-%llu", &a, &b);
+    }
+    if (fields < 1 || a > b || a >= layout.total) {
+      char unsat[48];
+      snprintf(unsat, sizeof(unsat), "bytes */%llu", layout.total);
+      httpd_resp_set_status(req, "416 Range Not Satisfiable");
+      httpd_resp_set_hdr(req, "Content-Range", unsat);
+      return httpd_resp_send(req, NULL, 0);
+    }
+    first = a;
+    last = b < layout.total ? b : layout.total - 1;
+    partial = true;
+  }
+
+  char header[448];
+  int len = snprintf(header, sizeof(header),
+    "HTTP/1.1 %s\r\n"
+    "Content-Type: video/x-msvideo\r\n"
+    "Content-Length: %llu\r\n"
+    "Accept-Ranges: bytes\r\n"
+    "ETag: %s\r\n"
+    "Content-Disposition: attachment; filename=\"img_%03u-%03u.avi\"\r\n"
+    "Access-Control-Allow-Origin: *\r\n",
+    partial ? "206 Partial Content" : "200 OK", last - first + 1, etag, first_entry.seq, last_entry.seq);
+  if (partial) {
+    len += snprintf(header + len, sizeof(header) - len, "Content-Range: bytes %llu-%llu/%llu\r\n", first, last, layout.total);
+  }
+  len += snprintf(header + len, sizeof(header) - len, "\r\n");
+  if (!export_sink(req, (const uint8_t *)header, len)) {
+    return ESP_FAIL;
+  }
+
+  int64_t start = esp_timer_get_time();
+  bool ok = avi_write(SD_MMC, &layout, first, last, export_sink, req);
+  int64_t ms = (esp_timer_get_time() - start) / 1000;
+  log_i("Export: %u frames, %llu bytes in %lldms%s", end - begin, last - first + 1, ms, ok ? "" : " (aborted)");
+  return ok ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t export_handler(httpd_req_t *req) {
+  uint32_t from = 0;
+  uint32_t to = 0;
+  char query[64];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+    char value[16];
+    if (httpd_query_key_value(query, "from", value, sizeof(value)) == ESP_OK) {
+      from = strtoul(value, NULL, 10);
+    }
+    if (httpd_query_key_value(query, "to", value, sizeof(value)) == ESP_OK) {
+      to = strtoul(value, NULL, 10);
+    }
+  }
+  size_t begin = from ? catalog_lower_bound_time(from) : 0;
+  size_t end = to ? catalog_lower_bound_time(to) : catalog_count();
+  if (!catalog_ready() || begin >= end) {
+    httpd_resp_send_404(req);
+    return ESP_FAIL;
+  }
+  // Frames keep the sizes the layout was planned with until the last byte
+  int pin = catalog_pin(begin, end);
+  esp_err_t res = export_send(req, begin, end);
+  catalog_unpin(pin);
+  return res;
+}
+
+static esp_err_t export_async(httpd_req_t *req) {
+  return run_async(req, export_handler);
+}
+
+static esp_err_t download_send(httpd_req_t *req, archive_plan_t *plan) {
+  if (!archive_plan(plan)) {
+    if (!plan->files) {
+      httpd_resp_send_404(req);
+      return ESP_FAIL;
+    }
+    httpd_resp_set_status(req, "413 Payload Too Large");
+    return httpd_resp_send(req, "Too many images for one ZIP, use .tar or a smaller range", HTTPD_RESP_USE_STRLEN);
+  }
+
+  // Sizes are known up front, so the response has an exact Content-Length
+  char header[320];
+  bool zip = plan->format == ARCHIVE_ZIP;
+  int len = snprintf(header, sizeof(header),
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: %s\r\n"
+    "Content-Length: %llu\r\n"
+    "Content-Disposition: attachment; filename=\"images.%s\"\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "\r\n",
+    zip ? "application/zip" : "application/x-tar", plan->total, zip ? "zip" : "tar");
+  if (!export_sink(req, (const uint8_t *)header, len)) {
+    return ESP_FAIL;
+  }
+
+  int64_t start = esp_timer_get_time();
+  bool ok = archive_write(SD_MMC, plan, export_sink, req);
+  int64_t ms = (esp_timer_get_time() - start) / 1000;
+  log_i("Download: %u files, %llu bytes in %lldms%s", plan->files, plan->total, ms, ok ? "" : " (aborted)");
+  return ok ? ESP_OK : ESP_FAIL;
+}
+
+// Selection: ?from=&to= (unix seconds) or ?seqs=10-20,25,31-40
+static esp_err_t download_handler(httpd_req_t *req) {
+  archive_plan_t plan;
+  memset(&plan, 0, sizeof(plan));
+  plan.format = (archive_format_t)(intptr_t)req->user_ctx;
+
+  char query[256];
+  char value[192];
+  // A cut-off selection must not turn into "everything" or a partial archive
+  esp_err_t got = httpd_req_get_url_query_str(req, query, sizeof(query));
+  bool has_query = got == ESP_OK;
+  if (has_query) {
+    got = httpd_query_key_value(query, "seqs", value, sizeof(value));
+  }
+  if (got == ESP_ERR_HTTPD_RESULT_TRUNC) {
+    httpd_resp_set_status(req, "414 URI Too Long");
+    return httpd_resp_send(req, "Selection too long, download it in parts", HTTPD_RESP_USE_STRLEN);
+  }
+  if (has_query && got == ESP_OK) {
+    char *save = NULL;
+    for (char *tok = strtok_r(value, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+      if (plan.count == ARCHIVE_MAX_RANGES) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Too many ranges in seqs");
+        return ESP_FAIL;
+      }
+      unsigned first = 0, last = 0;
+      int fields = sscanf(tok, "%u-%u", &first, &last);
+      if (fields < 1) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected seqs=a-b,c,...");
+        return ESP_FAIL;
+      }
+      if (fields == 1) {
+        last = first;
+      }
+      plan.begin[plan.count] = catalog_lower_bound_seq(first);
+      plan.end[plan.count] = catalog_lower_bound_seq(last + 1);
+      plan.count++;
+    }
+  } else {
+    uint32_t from = 0;
+    uint32_t to = 0;
+    if (has_query && httpd_query_key_value(query, "from", value, sizeof(value)) == ESP_OK) {
+      from = strtoul(value, NULL, 10);
+    }
+    if (has_query && httpd_query_key_value(query, "to", value, sizeof(value)) == ESP_OK) {
+      to = strtoul(value, NULL, 10);
+    }
+    plan.begin[0] = from ? catalog_lower_bound_time(from) : 0;
+    plan.end[0] = to ? catalog_lower_bound_time(to) : catalog_count();
+    plan.count = 1;
+  }
+  if (!catalog_ready()) {
+    httpd_resp_send_404(req);
+    return ESP_FAIL;
+  }
+  // Every selected frame keeps its planned size until the last byte
+  size_t lo = plan.begin[0], hi = plan.end[0];
+  for (int r = 1; r < plan.count; r++) {
+    lo = plan.begin[r] < lo ? plan.begin[r] : lo;
+    hi = plan.end[r] > hi ? plan.end[r] : hi;
+  }
+  int pin = catalog_pin(lo, hi);
+  esp_err_t res = download_send(req, &plan);
+  catalog_unpin(pin);
+  return res;
+}
+
+// The archive format rides along in user_ctx, which the worker's copy of
+// the request keeps
+static esp_err_t download_async(httpd_req_t *req) {
+  return run_async(req, download_handler);
+}
+
 static esp_err_t parse_get(httpd_req_t *req, char **obuf) {
   char *buf = NULL;
   size_t buf_len = 0;
 
   buf_len = httpd_req_get_url_query_len(req) + 1;
   if (buf_len > 1) {
-    buf = (char *)malloc(buf_len);
+    buf = (char *)pool_alloc(buf_len, POOL_INTERNAL);
     if (!buf) {
       httpd_resp_send_500(req);
       return ESP_FAIL;
@@ -331,194 +919,323 @@ static esp_err_t parse_get(httpd_req_t *req, char **obuf) {
       *obuf = buf;
       return ESP_OK;
     }
-    free(buf);
+    pool_free(buf);
   }
   httpd_resp_send_404(req);
   return ESP_FAIL;
 }
 
+#if CONFIG_LED_ILLUMINATOR_ENABLED
+static int set_led_intensity(sensor_t *s, int val) {
+  led_duty = val;
+  if (isStreaming) {
+    enable_led(true);
+  }
+  return 0;
+}
+
+static int get_led_intensity(sensor_t *s) {
+  return led_duty;
+}
+
+static int set_led_enabled(sensor_t *s, int val) {
+  led_enabled = (val == 1);
+  log_i("Flash LED globally %s", led_enabled ? "enabled" : "disabled");
+  if (!led_enabled) {
+    // Force turn off LED when disabled
+    ledcWrite(LED_LEDC_GPIO, 0);
+  }
+  return 0;
+}
+
+static int get_led_enabled(sensor_t *s) {
+  return led_enabled ? 1 : 0;
+}
+#else
+static int get_led_intensity(sensor_t *s) {
+  return -1;
+}
+
+static int get_led_enabled(sensor_t *s) {
+  return 0;
+}
+#endif
+
+static int set_status_led(sensor_t *s, int val) {
+  control_status_led(val == 1);
+  return 0;
+}
+
+static int get_status_led(sensor_t *s) {
+  return status_led_enabled ? 1 : 0;
+}
+
+static const sensor_ctrl_t led_controls[] = {
+#if CONFIG_LED_ILLUMINATOR_ENABLED
+  {"led_intensity", CTRL_STAGE_LOCAL, set_led_intensity, get_led_intensity},
+  {"led_enabled", CTRL_STAGE_LOCAL, set_led_enabled, get_led_enabled},
+#else
+  // Keep the fields the UI expects when there is no flash LED
+  {"led_intensity", CTRL_STAGE_LOCAL, NULL, get_led_intensity},
+  {"led_enabled", CTRL_STAGE_LOCAL, NULL, get_led_enabled},
+#endif
+  {"status_led", CTRL_STAGE_LOCAL, set_status_led, get_status_led},
+};
+
+typedef struct {
+  char *p;
+  char *end;
+  sensor_t *s;
+  bool first;
+} json_out_t;
+
+static void print_control(const sensor_ctrl_t *ctrl, void *arg) {
+  static const char *stages[] = {"clock", "frame", "tuning", "local"};
+  json_out_t *o = (json_out_t *)arg;
+  if (o->end - o->p < 96) {
+    return;
+  }
+  o->p += snprintf(
+    o->p, o->end - o->p, "%s{\"name\":\"%s\",\"stage\":\"%s\",\"writable\":%d,\"value\":%d}", o->first ? "" : ",", ctrl->name, stages[ctrl->stage],
+    ctrl->set ? 1 : 0, ctrl->get && o->s ? ctrl->get(o->s) : 0
+  );
+  o->first = false;
+}
+
+static esp_err_t send_controls(httpd_req_t *req) {
+  // GET /control without a query: list every control with its current value
+  char json[1536];
+  json_out_t out = {json, json + sizeof(json), esp_camera_sensor_get(), true};
+
+  out.p += snprintf(out.p, out.end - out.p, "{\"controls\":[");
+  sensor_ctrl_foreach(print_control, &out);
+  out.p += snprintf(out.p, out.end - out.p, "]}");
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  return httpd_resp_send(req, json, out.p - json);
+}
+
 static esp_err_t cmd_handler(httpd_req_t *req) {
   char *buf = NULL;
   char variable[32];
   char value[32];
+  sensor_write_t writes[SENSOR_BATCH_MAX];
+  int count = 0;
+  bool batch = true;
+
+  if (req->method == HTTP_POST) {
+    // Batch: form-encoded "name=value&name=value" body
+    if (req->content_len == 0 || req->content_len > 1024) {
+      httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected name=value pairs");
+      return ESP_FAIL;
+    }
+    buf = (char *)pool_alloc(req->content_len + 1, POOL_INTERNAL);
+    if (!buf) {
+      httpd_resp_send_500(req);
+      return ESP_FAIL;
+    }
+    size_t received = 0;
+    while (received < req->content_len) {
+      int ret = httpd_req_recv(req, buf + received, req->content_len - received);
+      if (ret <= 0) {
+        pool_free(buf);
+        return ESP_FAIL;
+      }
+      received += ret;
+    }
+    buf[received] = 0;
+  } else {
+    if (httpd_req_get_url_query_len(req) == 0) {
+      return send_controls(req);
+    }
+    if (parse_get(req, &buf) != ESP_OK) {
+      return ESP_FAIL;
+    }
+  }
 
-  if (parse_get(req, &buf) != ESP_OK) {
-    return ESP_FAIL;
+  // Legacy single-parameter form used by the camera UI: ?var=name&val=value
+  if (httpd_query_key_value(buf, "var", variable, sizeof(variable)) == ESP_OK && httpd_query_key_value(buf, "val", value, sizeof(value)) == ESP_OK) {
+    batch = false;
+    writes[0].ctrl = sensor_ctrl_find(variable);
+    writes[0].value = atoi(value);
+    if (!writes[0].ctrl || !writes[0].ctrl->set) {
+      log_i("Unknown command: %s", variable);
+      pool_free(buf);
+      return httpd_resp_send_500(req);
+    }
+    count = 1;
+  } else {
+    count = sensor_ctrl_parse(buf, writes, SENSOR_BATCH_MAX, variable, sizeof(variable));
   }
-  if (httpd_query_key_value(buf, "var", variable, sizeof(variable)) != ESP_OK || httpd_query_key_value(buf, "val", value, sizeof(value)) != ESP_OK) {
-    free(buf);
-    httpd_resp_send_404(req);
+  pool_free(buf);
+
+  if (count <= 0) {
+    char msg[64];
+    snprintf(msg, sizeof(msg), "Unknown control: %s", count < 0 ? variable : "(none)");
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, msg);
     return ESP_FAIL;
   }
-  free(buf);
 
-  int val = atoi(value);
-  log_i("%s = %d", variable, val);
-  sensor_t *s = esp_camera_sensor_get();
-  int res = 0;
-
-  if (!strcmp(variable, "framesize")) {
-    if (s->pixformat == PIXFORMAT_JPEG) {
-      res = s->set_framesize(s, (framesize_t)val);
-    }
-  } else if (!strcmp(variable, "quality")) {
-    res = s->set_quality(s, val);
-  } else if (!strcmp(variable, "contrast")) {
-    res = s->set_contrast(s, val);
-  } else if (!strcmp(variable, "brightness")) {
-    res = s->set_brightness(s, val);
-  } else if (!strcmp(variable, "saturation")) {
-    res = s->set_saturation(s, val);
-  } else if (!strcmp(variable, "gainceiling")) {
-    res = s->set_gainceiling(s, (gainceiling_t)val);
-  } else if (!strcmp(variable, "colorbar")) {
-    res = s->set_colorbar(s, val);
-  } else if (!strcmp(variable, "awb")) {
-    res = s->set_whitebal(s, val);
-  } else if (!strcmp(variable, "agc")) {
-    res = s->set_gain_ctrl(s, val);
-  } else if (!strcmp(variable, "aec")) {
-    res = s->set_exposure_ctrl(s, val);
-  } else if (!strcmp(variable, "hmirror")) {
-    res = s->set_hmirror(s, val);
-  } else if (!strcmp(variable, "vflip")) {
-    res = s->set_vflip(s, val);
-  } else if (!strcmp(variable, "awb_gain")) {
-    res = s->set_awb_gain(s, val);
-  } else if (!strcmp(variable, "agc_gain")) {
-    res = s->set_agc_gain(s, val);
-  } else if (!strcmp(variable, "aec_value")) {
-    res = s->set_aec_value(s, val);
-  } else if (!strcmp(variable, "aec2")) {
-    res = s->set_aec2(s, val);
-  } else if (!strcmp(variable, "dcw")) {
-    res = s->set_dcw(s, val);
-  } else if (!strcmp(variable, "bpc")) {
-    res = s->set_bpc(s, val);
-  } else if (!strcmp(variable, "wpc")) {
-    res = s->set_wpc(s, val);
-  } else if (!strcmp(variable, "raw_gma")) {
-    res = s->set_raw_gma(s, val);
-  } else if (!strcmp(variable, "lenc")) {
-    res = s->set_lenc(s, val);
-  } else if (!strcmp(variable, "special_effect")) {
-    res = s->set_special_effect(s, val);
-  } else if (!strcmp(variable, "wb_mode")) {
-    res = s->set_wb_mode(s, val);
-  } else if (!strcmp(variable, "ae_level")) {
-    res = s->set_ae_level(s, val);
-  }
-#if CONFIG_LED_ILLUMINATOR_ENABLED
-  else if (!strcmp(variable, "led_intensity")) {
-    led_duty = val;
-    if (isStreaming) {
-      enable_led(true);
+  int failed = sensor_ctrl_apply(writes, count);
+
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  if (!batch) {
+    if (failed) {
+      return httpd_resp_send_500(req);
     }
+    return httpd_resp_send(req, NULL, 0);
   }
-  else if (!strcmp(variable, "led_enabled")) {
-    led_enabled = (val == 1);
-    log_i("Flash LED globally %s", led_enabled ? "enabled" : "disabled");
-    if (!led_enabled) {
-      // Force turn off LED when disabled
-      ledcWrite(LED_LEDC_GPIO, 0);
+
+  char json[512];
+  char *p = json;
+  p += snprintf(p, sizeof(json), "{\"applied\":%d,\"failed\":[", count - failed);
+  for (int i = 0, n = 0; i < count; i++) {
+    if (writes[i].result < 0 && json + sizeof(json) - p > 40) {
+      p += snprintf(p, json + sizeof(json) - p, "%s\"%s\"", n++ ? "," : "", writes[i].ctrl->name);
     }
   }
-#endif
-  else if (!strcmp(variable, "status_led")) {
-    control_status_led(val == 1);
+  p += snprintf(p, json + sizeof(json) - p, "]}");
+  httpd_resp_set_type(req, "application/json");
+  if (failed) {
+    httpd_resp_set_status(req, HTTPD_500);
   }
-  else {
-    log_i("Unknown command: %s", variable);
-    res = -1;
+  return httpd_resp_send(req, json, p - json);
+}
+
+static esp_err_t status_handler(httpd_req_t *req) {
+  char buf[64];
+  char value[16];
+  uint32_t since = 0;
+
+  // Clients that already hold the current version get an empty 304
+  if (httpd_req_get_hdr_value_str(req, "If-None-Match", buf, sizeof(buf)) == ESP_OK) {
+    since = strtoul(buf[0] == '"' ? buf + 1 : buf, NULL, 10);
+  } else if (httpd_req_get_url_query_str(req, buf, sizeof(buf)) == ESP_OK && httpd_query_key_value(buf, "since", value, sizeof(value)) == ESP_OK) {
+    since = strtoul(value, NULL, 10);
   }
 
-  if (res < 0) {
+  size_t len = 0;
+  uint32_t version = 0;
+  const char *json = sensor_state_acquire(&len, &version);
+  if (!json) {
     return httpd_resp_send_500(req);
   }
 
+  char etag[16];
+  snprintf(etag, sizeof(etag), "\"%u\"", version);
+  httpd_resp_set_type(req, "application/json");
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-  return httpd_resp_send(req, NULL, 0);
-}
+  httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+  httpd_resp_set_hdr(req, "ETag", etag);
 
-static int print_reg(char *p, sensor_t *s, uint16_t reg, uint32_t mask) {
-  return sprintf(p, "\"0x%x\":%u,", reg, s->get_reg(s, reg, mask));
+  esp_err_t res;
+  if (since && since == version) {
+    httpd_resp_set_status(req, "304 Not Modified");
+    res = httpd_resp_send(req, NULL, 0);
+  } else {
+    res = httpd_resp_send(req, json, len);
+  }
+  sensor_state_release(json);
+  return res;
 }
 
-static esp_err_t status_handler(httpd_req_t *req) {
-  static char json_response[1024];
+// Counters that change every frame, kept out of the cached /status snapshot
+static esp_err_t metrics_handler(httpd_req_t *req) {
+  char json[2048];
+  char *p = json;
+  char *end = json + sizeof(json) - 2;
 
-  sensor_t *s = esp_camera_sensor_get();
-  char *p = json_response;
-  *p++ = '{';
-
-  if (s->id.PID == OV5640_PID || s->id.PID == OV3660_PID) {
-    for (int reg = 0x3400; reg < 0x3406; reg += 2) {
-      p += print_reg(p, s, reg, 0xFFF);  //12 bit
-    }
-    p += print_reg(p, s, 0x3406, 0xFF);
-
-    p += print_reg(p, s, 0x3500, 0xFFFF0);  //16 bit
-    p += print_reg(p, s, 0x3503, 0xFF);
-    p += print_reg(p, s, 0x350a, 0x3FF);   //10 bit
-    p += print_reg(p, s, 0x350c, 0xFFFF);  //16 bit
-
-    for (int reg = 0x5480; reg <= 0x5490; reg++) {
-      p += print_reg(p, s, reg, 0xFF);
-    }
-
-    for (int reg = 0x5380; reg <= 0x538b; reg++) {
-      p += print_reg(p, s, reg, 0xFF);
-    }
-
-    for (int reg = 0x5580; reg < 0x558a; reg++) {
-      p += print_reg(p, s, reg, 0xFF);
-    }
-    p += print_reg(p, s, 0x558a, 0x1FF);  //9 bit
-  } else if (s->id.PID == OV2640_PID) {
-    p += print_reg(p, s, 0xd3, 0xFF);
-    p += print_reg(p, s, 0x111, 0xFF);
-    p += print_reg(p, s, 0x132, 0xFF);
-  }
-
-  p += sprintf(p, "\"xclk\":%u,", s->xclk_freq_hz / 1000000);
-  p += sprintf(p, "\"pixformat\":%u,", s->pixformat);
-  p += sprintf(p, "\"framesize\":%u,", s->status.framesize);
-  p += sprintf(p, "\"quality\":%u,", s->status.quality);
-  p += sprintf(p, "\"brightness\":%d,", s->status.brightness);
-  p += sprintf(p, "\"contrast\":%d,", s->status.contrast);
-  p += sprintf(p, "\"saturation\":%d,", s->status.saturation);
-  p += sprintf(p, "\"sharpness\":%d,", s->status.sharpness);
-  p += sprintf(p, "\"special_effect\":%u,", s->status.special_effect);
-  p += sprintf(p, "\"wb_mode\":%u,", s->status.wb_mode);
-  p += sprintf(p, "\"awb\":%u,", s->status.awb);
-  p += sprintf(p, "\"awb_gain\":%u,", s->status.awb_gain);
-  p += sprintf(p, "\"aec\":%u,", s->status.aec);
-  p += sprintf(p, "\"aec2\":%u,", s->status.aec2);
-  p += sprintf(p, "\"ae_level\":%d,", s->status.ae_level);
-  p += sprintf(p, "\"aec_value\":%u,", s->status.aec_value);
-  p += sprintf(p, "\"agc\":%u,", s->status.agc);
-  p += sprintf(p, "\"agc_gain\":%u,", s->status.agc_gain);
-  p += sprintf(p, "\"gainceiling\":%u,", s->status.gainceiling);
-  p += sprintf(p, "\"bpc\":%u,", s->status.bpc);
-  p += sprintf(p, "\"wpc\":%u,", s->status.wpc);
-  p += sprintf(p, "\"raw_gma\":%u,", s->status.raw_gma);
-  p += sprintf(p, "\"lenc\":%u,", s->status.lenc);
-  p += sprintf(p, "\"hmirror\":%u,", s->status.hmirror);
-  p += sprintf(p, "\"dcw\":%u,", s->status.dcw);
-  p += sprintf(p, "\"colorbar\":%u", s->status.colorbar);
-#if CONFIG_LED_ILLUMINATOR_ENABLED
-  p += sprintf(p, ",\"led_intensity\":%u", led_duty);
-  p += sprintf(p, ",\"led_enabled\":%d", led_enabled ? 1 : 0);
-#else
-  p += sprintf(p, ",\"led_intensity\":%d", -1);
-  p += sprintf(p, ",\"led_enabled\":0");
-#endif
-  p += sprintf(p, ",\"status_led\":%d", status_led_enabled ? 1 : 0);
+  p += snprintf(
+    p, end - p, "{\"uptime_ms\":%lu,\"heap\":%u,\"psram\":%u,\"status_version\":%u,\"rtsp_sessions\":%d,\"recorder\":", millis(),
+    heap_caps_get_free_size(MALLOC_CAP_INTERNAL), heap_caps_get_free_size(MALLOC_CAP_SPIRAM), sensor_state_version(), rtsp_session_count()
+  );
+  p += recorder_print_json(p, end - p);
+  p += snprintf(p, end - p, ",\"pool\":");
+  p += pool_print_json(p, end - p);
+  p += snprintf(p, end - p, ",\"pages\":");
+  p += page_cache_print_json(p, end - p);
+  p += snprintf(p, end - p, ",\"transcode\":");
+  p += transcode_print_json(p, end - p);
+  p += snprintf(p, end - p, ",\"headers\":");
+  p += jpeghdr_print_json(p, end - p);
+  p += snprintf(p, end - p, ",\"similar\":");
+  p += similar_print_json(p, end - p);
+  p += snprintf(p, end - p, ",\"summary\":");
+  p += summary_print_json(p, end - p);
+  p += snprintf(p, end - p, ",\"recompress\":");
+  p += recompress_print_json(p, end - p);
   *p++ = '}';
-  *p++ = 0;
+  *p = 0;
   httpd_resp_set_type(req, "application/json");
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-  return httpd_resp_send(req, json_response, strlen(json_response));
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+  return httpd_resp_send(req, json, p - json);
+}
+
+static esp_err_t events_handler(httpd_req_t *req) {
+  static const char header[] = "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: text/event-stream\r\n"
+                               "Cache-Control: no-cache\r\n"
+                               "Access-Control-Allow-Origin: *\r\n"
+                               "Connection: keep-alive\r\n"
+                               "\r\n"
+                               "retry: 3000\n\n";
+  char last_id[24];
+  bool has_id = httpd_req_get_hdr_value_str(req, "Last-Event-ID", last_id, sizeof(last_id)) == ESP_OK;
+
+  int fd = httpd_req_to_sockfd(req);
+  if (!events_subscribe(req->handle, fd, has_id ? last_id : NULL)) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", "10");
+    return httpd_resp_send(req, NULL, 0);
+  }
+  // The response never ends: write the header by hand and leave the socket
+  // open. Events are pushed to it from app_events until the client leaves.
+  if (httpd_send(req, header, sizeof(header) - 1) < 0) {
+    events_forget(req->handle, fd);
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+static esp_err_t ws_stream_handler(httpd_req_t *req) {
+  int fd = httpd_req_to_sockfd(req);
+  if (req->method == HTTP_GET) {
+    // Handshake complete; frames are sent from app_ws as credits arrive
+    if (!ws_stream_add(req->handle, fd)) {
+      log_w("WS: too many clients");
+      return ESP_FAIL;
+    }
+    return ESP_OK;
+  }
+
+  uint8_t buf[16];
+  httpd_ws_frame_t frame;
+  memset(&frame, 0, sizeof(frame));
+  if (httpd_ws_recv_frame(req, &frame, 0) != ESP_OK || frame.len >= sizeof(buf)) {
+    return ESP_FAIL;
+  }
+  frame.payload = buf;
+  if (frame.len && httpd_ws_recv_frame(req, &frame, frame.len) != ESP_OK) {
+    return ESP_FAIL;
+  }
+  buf[frame.len] = 0;
+  int credits = atoi((const char *)buf);
+  if (frame.type == HTTPD_WS_TYPE_TEXT && credits > 0) {
+    ws_stream_credit(req->handle, fd, credits);
+  }
+  return ESP_OK;
+}
+#endif
+
+static void session_closed(httpd_handle_t hd, int fd) {
+  events_forget(hd, fd);
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+  ws_stream_forget(hd, fd);
+#endif
+  close(fd);
 }
 
 static esp_err_t xclk_handler(httpd_req_t *req) {
@@ -529,18 +1246,17 @@ static esp_err_t xclk_handler(httpd_req_t *req) {
     return ESP_FAIL;
   }
   if (httpd_query_key_value(buf, "xclk", _xclk, sizeof(_xclk)) != ESP_OK) {
-    free(buf);
+    pool_free(buf);
     httpd_resp_send_404(req);
     return ESP_FAIL;
   }
-  free(buf);
+  pool_free(buf);
 
   int xclk = atoi(_xclk);
   log_i("Set XCLK: %d MHz", xclk);
 
-  sensor_t *s = esp_camera_sensor_get();
-  int res = s->set_xclk(s, LEDC_TIMER_0, xclk);
-  if (res) {
+  sensor_write_t write = {sensor_ctrl_find("xclk"), xclk, 0};
+  if (sensor_ctrl_apply(&write, 1) || write.result) {
     return httpd_resp_send_500(req);
   }
 
@@ -559,11 +1275,11 @@ static esp_err_t reg_handler(httpd_req_t *req) {
   }
   if (httpd_query_key_value(buf, "reg", _reg, sizeof(_reg)) != ESP_OK || httpd_query_key_value(buf, "mask", _mask, sizeof(_mask)) != ESP_OK
       || httpd_query_key_value(buf, "val", _val, sizeof(_val)) != ESP_OK) {
-    free(buf);
+    pool_free(buf);
     httpd_resp_send_404(req);
     return ESP_FAIL;
   }
-  free(buf);
+  pool_free(buf);
 
   int reg = atoi(_reg);
   int mask = atoi(_mask);
@@ -571,7 +1287,11 @@ static esp_err_t reg_handler(httpd_req_t *req) {
   log_i("Set Register: reg: 0x%02x, mask: 0x%02x, value: 0x%02x", reg, mask, val);
 
   sensor_t *s = esp_camera_sensor_get();
+  sensor_lock();
   int res = s->set_reg(s, reg, mask, val);
+  sensor_mark_reconfigured();
+  sensor_unlock();
+  sensor_state_reg_written(reg);
   if (res) {
     return httpd_resp_send_500(req);
   }
@@ -589,16 +1309,18 @@ static esp_err_t greg_handler(httpd_req_t *req) {
     return ESP_FAIL;
   }
   if (httpd_query_key_value(buf, "reg", _reg, sizeof(_reg)) != ESP_OK || httpd_query_key_value(buf, "mask", _mask, sizeof(_mask)) != ESP_OK) {
-    free(buf);
+    pool_free(buf);
     httpd_resp_send_404(req);
     return ESP_FAIL;
   }
-  free(buf);
+  pool_free(buf);
 
   int reg = atoi(_reg);
   int mask = atoi(_mask);
   sensor_t *s = esp_camera_sensor_get();
+  sensor_lock();
   int res = s->get_reg(s, reg, mask);
+  sensor_unlock();
   if (res < 0) {
     return httpd_resp_send_500(req);
   }
@@ -633,11 +1355,15 @@ static esp_err_t pll_handler(httpd_req_t *req) {
   int seld5 = parse_get_var(buf, "seld5", 0);
   int pclken = parse_get_var(buf, "pclken", 0);
   int pclk = parse_get_var(buf, "pclk", 0);
-  free(buf);
+  pool_free(buf);
 
   log_i("Set Pll: bypass: %d, mul: %d, sys: %d, root: %d, pre: %d, seld5: %d, pclken: %d, pclk: %d", bypass, mul, sys, root, pre, seld5, pclken, pclk);
   sensor_t *s = esp_camera_sensor_get();
+  sensor_lock();
   int res = s->set_pll(s, bypass, mul, sys, root, pre, seld5, pclken, pclk);
+  sensor_mark_reconfigured();
+  sensor_unlock();
+  sensor_state_publish(true);
   if (res) {
     return httpd_resp_send_500(req);
   }
@@ -665,14 +1391,18 @@ static esp_err_t win_handler(httpd_req_t *req) {
   int outputY = parse_get_var(buf, "oy", 0);
   bool scale = parse_get_var(buf, "scale", 0) == 1;
   bool binning = parse_get_var(buf, "binning", 0) == 1;
-  free(buf);
+  pool_free(buf);
 
   log_i(
     "Set Window: Start: %d %d, End: %d %d, Offset: %d %d, Total: %d %d, Output: %d %d, Scale: %u, Binning: %u", startX, startY, endX, endY, offsetX, offsetY,
     totalX, totalY, outputX, outputY, scale, binning  // codespell:ignore totaly
   );
   sensor_t *s = esp_camera_sensor_get();
+  sensor_lock();
   int res = s->set_res_raw(s, startX, startY, endX, endY, offsetX, offsetY, totalX, totalY, outputX, outputY, scale, binning);  // codespell:ignore totaly
+  sensor_mark_reconfigured();
+  sensor_unlock();
+  sensor_state_publish(true);
   if (res) {
     return httpd_resp_send_500(req);
   }
@@ -681,6 +1411,133 @@ static esp_err_t win_handler(httpd_req_t *req) {
   return httpd_resp_send(req, NULL, 0);
 }
 
+static const char gallery_head[] =
+  "<!DOCTYPE html><html><head>"
+  "<title>ESP32-CAM Gallery</title>"
+  "<meta name='viewport' content='width=device-width, initial-scale=1'>"
+  "<link rel='stylesheet' href='" ASSET_GALLERY_CSS "'>"
+  "</head><body>"
+  "<div class='container'>"
+  "<div class='header'>"
+  "<h1>📷 ESP32-CAM Gallery</h1>"
+  "<button class='refresh-btn' onclick='location.reload()'>🔄 Refresh</button>"
+  "<button class='refresh-btn' onclick='location.href=\"/camera\"'>📹 Camera Controls</button>"
+  "<button class='refresh-btn' onclick='location.href=\"/browse\"'>📜 Browse All</button>"
+  "</div>";
+
+static const char gallery_footer[] =
+  "</div>"
+  "<div style='text-align:center;margin-top:30px;color:#666;'>"
+  "<p>📷 Gallery with pagination for fast browsing. Newest images shown first. Click any image to view full size.</p>"
+  "<p style='font-size:12px;'>💡 Tip: Use ?per=10 or ?per=30 in URL to change images per page</p>"
+  "</div>"
+  "</div>"
+  "<script src='" ASSET_GALLERY_JS "'></script>"
+  "</body></html>";
+
+static void gallery_pagination(page_buf_t *out, int page, int totalPages, int perPage) {
+  if (totalPages < 2) {
+    return;
+  }
+  page_buf_append(out, "<div class='pagination'>");
+
+  // Previous button
+  if (page > 1) {
+    page_buf_printf(out, "<a href='/gallery?page=%d&per=%d' class='page-btn'>« Previous</a>", page - 1, perPage);
+  }
+
+  // Page numbers
+  int startPage = (page > 3) ? page - 2 : 1;
+  int endPage = (page + 2 < totalPages) ? page + 2 : totalPages;
+
+  if (startPage > 1) {
+    page_buf_printf(out, "<a href='/gallery?page=1&per=%d' class='page-btn'>1</a>", perPage);
+    if (startPage > 2) {
+      page_buf_append(out, "<span class='page-btn' style='border:none;'>...</span>");
+    }
+  }
+
+  for (int p = startPage; p <= endPage; p++) {
+    page_buf_printf(out, "<a href='/gallery?page=%d&per=%d' class='page-btn%s'>%d</a>", p, perPage, (p == page) ? " active" : "", p);
+  }
+
+  if (endPage < totalPages) {
+    if (endPage < totalPages - 1) {
+      page_buf_append(out, "<span class='page-btn' style='border:none;'>...</span>");
+    }
+    page_buf_printf(out, "<a href='/gallery?page=%d&per=%d' class='page-btn'>%d</a>", totalPages, perPage, totalPages);
+  }
+
+  // Next button
+  if (page < totalPages) {
+    page_buf_printf(out, "<a href='/gallery?page=%d&per=%d' class='page-btn'>Next »</a>", page + 1, perPage);
+  }
+
+  page_buf_append(out, "</div>");  // Close pagination
+}
+
+// Pages are aligned to the oldest image: page 1 holds the newest 1..per
+// images and every other page is a full, fixed block. Appending a frame
+// only changes page 1, so the other pages stay cached.
+static void gallery_render(page_buf_t *out, int page, int perPage, int totalImages) {
+  page_buf_append(out, gallery_head);
+
+  if (totalImages < 0) {
+    page_buf_append(out, "<div class='no-images'>❌ Cannot access SD card</div>");
+  } else if (totalImages == 0) {
+    page_buf_append(out, "<div class='no-images'>📷 No images found on SD card</div>");
+  } else {
+    int totalPages = (totalImages + perPage - 1) / perPage;
+    int block = totalPages - page;
+    int startIndex = block * perPage;
+    int endIndex = startIndex + perPage;
+    if (endIndex > totalImages) endIndex = totalImages;
+
+    // Display page info; only page 1 mentions the total, which changes with every frame
+    catalog_entry_t first, last;
+    catalog_get(endIndex - 1, &first);
+    catalog_get(startIndex, &last);
+    page_buf_printf(out, "<div class='page-info' style='text-align:center;margin-bottom:20px;'>📷 Page %d of %d: img_%03u - img_%03u", page, totalPages,
+      (unsigned)last.seq, (unsigned)first.seq);
+    if (page == 1) {
+      page_buf_printf(out, " (%d images total)", totalImages);
+    }
+    page_buf_append(out, " - Newest first</div>");
+
+    page_buf_append(out, "<div class='gallery'>");
+
+    // Display images for current page, newest first
+    for (int i = endIndex - 1; i >= startIndex; i--) {
+      catalog_entry_t entry;
+      if (!catalog_get(i, &entry)) {
+        break;
+      }
+      char fullPath[32];
+      catalog_path(entry.seq, fullPath, sizeof(fullPath));
+      const char *fileName = fullPath + 1;
+
+      // The 10 newest images get a badge; they are only ever on page 1
+      bool isNew = (page == 1 && i >= totalImages - 10);
+
+      page_buf_printf(out,
+        "<div class='image-card'>"
+        "%s"
+        "<img src='/image%s?thumb=1' alt='%s' data-full='/image%s' loading='lazy'>"
+        "<div class='image-info'>%s<br>%.1f KB</div>"
+        "</div>",
+        isNew ? "<div class='new-badge'>NEW</div>" : "",
+        fullPath, fileName, fullPath,
+        fileName, entry.size / 1024.0);
+    }
+
+    page_buf_append(out, "</div>");  // Close gallery
+
+    gallery_pagination(out, page, totalPages, perPage);
+  }
+
+  page_buf_append(out, gallery_footer);
+}
+
 static esp_err_t gallery_handler(httpd_req_t *req) {
   httpd_resp_set_type(req, "text/html");
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
@@ -689,11 +1546,10 @@ static esp_err_t gallery_handler(httpd_req_t *req) {
   int page = 1;
   int perPage = 40; // Images per page (increased for smaller thumbnails)
   
-  char *buf = NULL;
   size_t buf_len = httpd_req_get_url_query_len(req) + 1;
-  if (buf_len > 1) {
-    buf = (char *)malloc(buf_len);
-    if (buf && httpd_req_get_url_query_str(req, buf, buf_len) == ESP_OK) {
+  char *buf = buf_len > 1 ? (char *)pool_alloc(buf_len, POOL_INTERNAL) : NULL;
+  if (buf) {
+    if (httpd_req_get_url_query_str(req, buf, buf_len) == ESP_OK) {
       char pageStr[10];
       if (httpd_query_key_value(buf, "page", pageStr, sizeof(pageStr)) == ESP_OK) {
         page = atoi(pageStr);
@@ -706,248 +1562,353 @@ static esp_err_t gallery_handler(httpd_req_t *req) {
         if (perPage > 50) perPage = 50;
       }
     }
-    if (buf) free(buf);
+    pool_free(buf);
+  }
+
+  // Read the generation first: if a frame lands while rendering, the page is
+  // stored under the older generation and re-rendered on the next hit
+  uint32_t generation = catalog_generation();
+  int totalImages = catalog_ready() ? catalog_count() : -1;
+  if (totalImages > 0) {
+    int totalPages = (totalImages + perPage - 1) / perPage;
+    if (page > totalPages) page = totalPages;
+  } else {
+    page = 1;
+  }
+
+  size_t len = 0;
+  const char *html = page_cache_find(page, perPage, generation, totalImages, &len);
+  if (html) {
+    return httpd_resp_send(req, html, len);
+  }
+
+  page_buf_t out;
+  page_buf_init(&out, sizeof(gallery_head) + sizeof(gallery_footer) + perPage * 320);
+  gallery_render(&out, page, perPage, totalImages);
+  if (out.failed) {
+    page_buf_free(&out);
+    httpd_resp_send_500(req);
+    return ESP_FAIL;
+  }
+  esp_err_t res = httpd_resp_send(req, out.buf, out.len);
+  if (totalImages >= 0) {
+    page_cache_store(page, perPage, generation, totalImages, &out);
+  }
+  page_buf_free(&out);
+  return res;
+}
+
+#define API_IMAGES_DEFAULT 50
+#define API_IMAGES_MAX     200
+
+// Listing cursors are "d<seq hex>" (newest first, entries below seq) or
+// "a<seq hex>" (oldest first, entries from seq up). They are built from
+// sequence numbers, so a listing is not disturbed by frames written while a
+// client pages through it. Clients treat them as opaque.
+static esp_err_t api_images_handler(httpd_req_t *req) {
+  int limit = API_IMAGES_DEFAULT;
+  bool desc = true;
+  bool has_cursor = false;
+  uint32_t cursor = 0;
+  uint32_t from = 0;
+  uint32_t to = 0;  // 0 = no upper bound
+  size_t skip = 0;
+
+  char query[160];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+    char value[16];
+    if (httpd_query_key_value(query, "limit", value, sizeof(value)) == ESP_OK) {
+      limit = atoi(value);
+      if (limit < 1) limit = 1;
+      if (limit > API_IMAGES_MAX) limit = API_IMAGES_MAX;
+    }
+    if (httpd_query_key_value(query, "order", value, sizeof(value)) == ESP_OK) {
+      desc = strcmp(value, "asc") != 0;
+    }
+    if (httpd_query_key_value(query, "cursor", value, sizeof(value)) == ESP_OK) {
+      char *end = NULL;
+      if ((value[0] == 'a' || value[0] == 'd') && value[1]) {
+        cursor = strtoul(value + 1, &end, 16);
+      }
+      if (!end || *end) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad cursor");
+        return ESP_FAIL;
+      }
+      desc = value[0] == 'd';
+      has_cursor = true;
+    }
+    if (httpd_query_key_value(query, "from", value, sizeof(value)) == ESP_OK) {
+      from = strtoul(value, NULL, 10);
+    }
+    if (httpd_query_key_value(query, "to", value, sizeof(value)) == ESP_OK) {
+      to = strtoul(value, NULL, 10);
+    }
+    if (httpd_query_key_value(query, "skip", value, sizeof(value)) == ESP_OK && atoi(value) > 0) {
+      skip = atoi(value);
+    }
+  }
+  if (!catalog_ready()) {
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Catalog not loaded");
+    return ESP_FAIL;
+  }
+
+  // Index range [begin, end) the listing covers, from the cursor and time range
+  uint32_t generation = catalog_generation();
+  size_t begin = from ? catalog_lower_bound_time(from) : 0;
+  size_t end = to ? catalog_lower_bound_time(to) : catalog_count();
+  uint32_t anchor;
+  if (desc) {
+    anchor = has_cursor ? cursor : catalog_next_seq();
+    size_t limit_end = catalog_lower_bound_seq(anchor);
+    if (limit_end < end) end = limit_end;
+  } else {
+    anchor = has_cursor ? cursor : 0;
+    size_t limit_begin = catalog_lower_bound_seq(anchor);
+    if (limit_begin > begin) begin = limit_begin;
+  }
+  size_t total = end > begin ? end - begin : 0;
+
+  char *buf = (char *)pool_alloc(1024, POOL_INTERNAL);
+  if (!buf) {
+    httpd_resp_send_500(req);
+    return ESP_FAIL;
+  }
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+  int len = snprintf(buf, 1024, "{\"generation\":%u,\"total\":%u,\"anchor\":\"%c%x\",\"images\":[", generation, total, desc ? 'd' : 'a', anchor);
+  int sent = 0;
+  size_t pos = skip;
+  catalog_entry_t entry;
+  while (sent < limit && pos < total) {
+    size_t index = desc ? end - 1 - pos : begin + pos;
+    pos++;
+    if (!catalog_get(index, &entry)) {
+      break;
+    }
+    // Capture times are only mostly ordered, so check each entry
+    if (entry.time < from || (to && entry.time >= to)) {
+      continue;
+    }
+    char name[32];
+    catalog_path(entry.seq, name, sizeof(name));
+    len += snprintf(buf + len, 1024 - len, "%s{\"seq\":%u,\"name\":\"%s\",\"size\":%u,\"time\":%u,\"ms\":%u,\"flags\":%u,\"still_until\":%u,\"thumb\":\"/image%s?thumb=1\"}",
+      sent ? "," : "", entry.seq, name + 1, entry.size, entry.time, entry.msec, entry.flags, entry.still_until, name);
+    sent++;
+    if (len > 1024 - 192) {
+      if (httpd_resp_send_chunk(req, buf, len) != ESP_OK) {
+        pool_free(buf);
+        return ESP_FAIL;
+      }
+      len = 0;
+    }
+  }
+  if (sent && pos < total) {
+    uint32_t next = desc ? entry.seq : entry.seq + 1;
+    len += snprintf(buf + len, 1024 - len, "],\"next\":\"%c%x\"}", desc ? 'd' : 'a', next);
+  } else {
+    len += snprintf(buf + len, 1024 - len, "],\"next\":null}");
+  }
+  esp_err_t res = httpd_resp_send_chunk(req, buf, len);
+  pool_free(buf);
+  if (res == ESP_OK) {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
+#define API_SIMILAR_DEFAULT 10
+
+// Frames that look like ?image=img_N.jpg (or just N), nearest first
+static esp_err_t api_similar_handler(httpd_req_t *req) {
+  int k = API_SIMILAR_DEFAULT;
+  int max_distance = 64;
+  char query[96];
+  char image[40];
+  char value[8];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK || httpd_query_key_value(query, "image", image, sizeof(image)) != ESP_OK) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "image= required");
+    return ESP_FAIL;
+  }
+  const char *name = image[0] == '/' ? image + 1 : image;
+  name = strncmp(name, "img_", 4) ? name : name + 4;
+  char *end = NULL;
+  uint32_t seq = strtoul(name, &end, 10);
+  if (end == name || (*end && strcmp(end, ".jpg"))) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad image name");
+    return ESP_FAIL;
+  }
+  if (httpd_query_key_value(query, "k", value, sizeof(value)) == ESP_OK) {
+    k = atoi(value);
+    if (k < 1) k = 1;
+    if (k > SIMILAR_MAX_RESULTS) k = SIMILAR_MAX_RESULTS;
+  }
+  if (httpd_query_key_value(query, "max", value, sizeof(value)) == ESP_OK) {
+    max_distance = atoi(value);
+    if (max_distance < 0) max_distance = 0;
+  }
+
+  if (!similar_ready()) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, "{\"error\":\"similarity search needs PSRAM\"}", HTTPD_RESP_USE_STRLEN);
+  }
+  uint64_t hash;
+  if (!similar_hash_of(seq, &hash)) {
+    httpd_resp_send_404(req);
+    return ESP_FAIL;
+  }
+  similar_match_t *matches = (similar_match_t *)malloc(k * sizeof(similar_match_t));
+  char *buf = (char *)pool_alloc(1024, POOL_INTERNAL);
+  if (!matches || !buf) {
+    free(matches);
+    if (buf) {
+      pool_free(buf);
+    }
+    httpd_resp_send_500(req);
+    return ESP_FAIL;
+  }
+  uint32_t visited;
+  int64_t start = esp_timer_get_time();
+  int n = similar_search(hash, k, max_distance, matches, &visited);
+  uint32_t took_us = esp_timer_get_time() - start;
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+  int len = snprintf(buf, 1024, "{\"seq\":%u,\"hash\":\"%016llx\",\"visited\":%u,\"us\":%u,\"results\":[", seq, (unsigned long long)hash, visited, took_us);
+  esp_err_t res = ESP_OK;
+  for (int i = 0; i < n && res == ESP_OK; i++) {
+    catalog_entry_t entry = {};
+    size_t index = catalog_lower_bound_seq(matches[i].seq);
+    catalog_get(index, &entry);
+    char path[32];
+    catalog_path(matches[i].seq, path, sizeof(path));
+    len += snprintf(buf + len, 1024 - len, "%s{\"seq\":%u,\"name\":\"%s\",\"distance\":%u,\"time\":%u}", i ? "," : "", matches[i].seq, path + 1,
+      matches[i].distance, entry.seq == matches[i].seq ? entry.time : 0);
+    if (len > 1024 - 128) {
+      res = httpd_resp_send_chunk(req, buf, len);
+      len = 0;
+    }
+  }
+  if (res == ESP_OK) {
+    len += snprintf(buf + len, 1024 - len, "]}");
+    res = httpd_resp_send_chunk(req, buf, len);
+  }
+  free(matches);
+  pool_free(buf);
+  if (res == ESP_OK) {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
+#define API_SUMMARY_DEFAULT 12
+
+// Keyframes of ?day=YYYY-MM-DD (local time, default today), at most ?n=.
+// Summaries are kept per whole hour of unix time, so a day whose local
+// midnight is not on such an hour (e.g. UTC+05:30) cannot be told apart
+// from its neighbours and is refused.
+static esp_err_t api_summary_handler(httpd_req_t *req) {
+  int n = API_SUMMARY_DEFAULT;
+  char query[64];
+  char value[16];
+  time_t now = time(NULL);
+  struct tm tm;
+  localtime_r(&now, &tm);
+  bool have_query = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK;
+  if (have_query && httpd_query_key_value(query, "day", value, sizeof(value)) == ESP_OK) {
+    int y, m, d;
+    if (sscanf(value, "%d-%d-%d", &y, &m, &d) != 3 || m < 1 || m > 12 || d < 1 || d > 31) {
+      httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "day=YYYY-MM-DD");
+      return ESP_FAIL;
+    }
+    tm.tm_year = y - 1900;
+    tm.tm_mon = m - 1;
+    tm.tm_mday = d;
   }
-  
-  // Send HTML header in chunks to reduce stack usage
-  httpd_resp_send_chunk(req, 
-    "<!DOCTYPE html><html><head>"
-    "<title>ESP32-CAM Gallery</title>"
-    "<meta name='viewport' content='width=device-width, initial-scale=1'>"
-    "<style>"
-    "body{font-family:Arial;margin:20px;background:#f0f0f0;}"
-    ".container{max-width:1200px;margin:0 auto;}"
-    ".header{text-align:center;margin-bottom:30px;}", -1);
-    
-  httpd_resp_send_chunk(req,
-    ".gallery{display:grid;grid-template-columns:repeat(auto-fill,minmax(100px,1fr));gap:8px;margin-bottom:20px;}"
-    ".image-card{background:white;border-radius:6px;padding:6px;box-shadow:0 2px 4px rgba(0,0,0,0.1);transition:transform 0.2s;position:relative;}"
-    ".image-card:hover{transform:scale(1.05);}"
-    ".image-card img{width:100%;height:70px;object-fit:cover;border-radius:3px;cursor:pointer;background:#f0f0f0;transition:all 0.3s;filter:brightness(0.9);}"
-    ".image-card img:hover{filter:brightness(1);}"
-    ".image-card img.loading{opacity:0.5;background:linear-gradient(90deg,#f0f0f0 25%,#e0e0e0 50%,#f0f0f0 75%);background-size:200% 100%;animation:loading 1.5s infinite;}"
-    ".image-info{margin-top:4px;font-size:10px;color:#666;text-align:center;}"
-    ".new-badge{position:absolute;top:2px;right:2px;background:#ff4444;color:white;padding:1px 4px;border-radius:8px;font-size:8px;font-weight:bold;}"
-    "@keyframes loading{0%{background-position:200% 0;}100%{background-position:-200% 0;}}", -1);
-    
-  httpd_resp_send_chunk(req,
-    ".pagination{display:flex;justify-content:center;align-items:center;margin:30px 0;gap:10px;flex-wrap:wrap;}"
-    ".page-btn{padding:8px 12px;margin:2px;background:white;border:1px solid #ddd;border-radius:4px;text-decoration:none;color:#333;transition:all 0.3s;}"
-    ".page-btn:hover{background:#4CAF50;color:white;border-color:#4CAF50;}"
-    ".page-btn.active{background:#4CAF50;color:white;border-color:#4CAF50;font-weight:bold;}"
-    ".page-info{color:#666;margin:0 15px;font-size:14px;}"
-    ".no-images{text-align:center;color:#666;margin-top:50px;}"
-    ".refresh-btn{background:#4CAF50;color:white;padding:10px 20px;border:none;border-radius:4px;cursor:pointer;margin:10px;}"
-    ".refresh-btn:hover{background:#45a049;}"
-    "</style>"
-    "</head><body>"
-    "<div class='container'>", -1);
-    
-  httpd_resp_send_chunk(req,
-    "<div class='header'>"
-    "<h1>📷 ESP32-CAM Gallery</h1>"
-    "<button class='refresh-btn' onclick='location.reload()'>🔄 Refresh</button>"
-    "<button class='refresh-btn' onclick='location.href=\"/camera\"'>📹 Camera Controls</button>"
-    "</div>", -1);
-  
-  // Collect all image files first for sorting and pagination
-  String* imageFiles = nullptr;
-  size_t* imageSizes = nullptr;
-  int totalImages = 0;
-  
-  File root = SD_MMC.open("/");
-  if (!root) {
-    httpd_resp_send_chunk(req, "<div class='no-images'>❌ Cannot access SD card</div>", -1);
-  } else {
-    // First pass: count images
-    File file = root.openNextFile();
-    while (file) {
-      String fileName = file.name();
-      if (!file.isDirectory() && (fileName.endsWith(".jpg") || fileName.endsWith(".JPG"))) {
-        totalImages++;
-      }
-      file = root.openNextFile();
+  if (have_query && httpd_query_key_value(query, "n", value, sizeof(value)) == ESP_OK) {
+    n = atoi(value);
+    if (n < 1) n = 1;
+    if (n > SUMMARY_MAX_KEYS) n = SUMMARY_MAX_KEYS;
+  }
+  tm.tm_hour = tm.tm_min = tm.tm_sec = 0;
+  tm.tm_isdst = -1;
+  uint32_t from = mktime(&tm);
+  char day[16];
+  strftime(day, sizeof(day), "%Y-%m-%d", &tm);
+  tm.tm_mday++;
+  tm.tm_isdst = -1;
+  uint32_t to = mktime(&tm);
+  if (from % 3600 || to % 3600) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Local days do not start on a whole hour in this time zone");
+    return ESP_FAIL;
+  }
+
+  summary_key_t *keys = (summary_key_t *)malloc(n * sizeof(summary_key_t));
+  char *buf = (char *)pool_alloc(1024, POOL_INTERNAL);
+  if (!keys || !buf) {
+    free(keys);
+    if (buf) {
+      pool_free(buf);
     }
-    root.close();
-    
-    if (totalImages == 0) {
-      httpd_resp_send_chunk(req, "<div class='no-images'>📷 No images found on SD card</div>", -1);
-    } else {
-      // Allocate arrays for image data
-      imageFiles = new String[totalImages];
-      imageSizes = new size_t[totalImages];
-      
-      // Second pass: collect image data
-      root = SD_MMC.open("/");
-      file = root.openNextFile();
-      int index = 0;
-      while (file && index < totalImages) {
-        String fileName = file.name();
-        if (!file.isDirectory() && (fileName.endsWith(".jpg") || fileName.endsWith(".JPG"))) {
-          imageFiles[index] = fileName;
-          imageSizes[index] = file.size();
-          index++;
-        }
-        file = root.openNextFile();
-      }
-      root.close();
-      
-      // Sort images by filename (newest first - assuming img_xxx.jpg format)
-      for (int i = 0; i < totalImages - 1; i++) {
-        for (int j = i + 1; j < totalImages; j++) {
-          if (imageFiles[i] < imageFiles[j]) { // Reverse order for newest first
-            String tempFile = imageFiles[i];
-            size_t tempSize = imageSizes[i];
-            imageFiles[i] = imageFiles[j];
-            imageSizes[i] = imageSizes[j];
-            imageFiles[j] = tempFile;
-            imageSizes[j] = tempSize;
-          }
-        }
-      }
-      
-      // Calculate pagination
-      int totalPages = (totalImages + perPage - 1) / perPage;
-      if (page > totalPages) page = totalPages;
-      
-      int startIndex = (page - 1) * perPage;
-      int endIndex = startIndex + perPage;
-      if (endIndex > totalImages) endIndex = totalImages;
-      
-      // Display page info
-      char pageInfo[200];
-      snprintf(pageInfo, sizeof(pageInfo),
-        "<div class='page-info' style='text-align:center;margin-bottom:20px;'>"
-        "📷 Showing %d-%d of %d images (Page %d of %d) - Newest first"
-        "</div>",
-        startIndex + 1, endIndex, totalImages, page, totalPages);
-      httpd_resp_send_chunk(req, pageInfo, strlen(pageInfo));
-      
-      // Start gallery
-      httpd_resp_send_chunk(req, "<div class='gallery'>", -1);
-      
-      // Display images for current page
-      for (int i = startIndex; i < endIndex; i++) {
-        String fileName = imageFiles[i];
-        size_t fileSize = imageSizes[i];
-        
-        // Ensure filename starts with /
-        String fullPath = fileName;
-        if (!fullPath.startsWith("/")) {
-          fullPath = "/" + fullPath;
-        }
-        
-        // Check if this is a new image (last 10 images are considered "new")
-        bool isNew = (i < 10);
-        
-        char imageCard[550];
-        snprintf(imageCard, sizeof(imageCard),
-          "<div class='image-card'>"
-          "%s"
-          "<img src='/image%s?thumb=1' alt='%s' onclick='window.open(\"/image%s\", \"_blank\")' loading='lazy'>"
-          "<div class='image-info'>%s<br>%.1f KB</div>"
-          "</div>",
-          isNew ? "<div class='new-badge'>NEW</div>" : "",
-          fullPath.c_str(), fileName.c_str(), fullPath.c_str(), 
-          fileName.c_str(), fileSize / 1024.0);
-        
-        httpd_resp_send_chunk(req, imageCard, strlen(imageCard));
-      }
-      
-      httpd_resp_send_chunk(req, "</div>", -1); // Close gallery
-      
-      // Generate pagination controls
-      if (totalPages > 1) {
-        httpd_resp_send_chunk(req, "<div class='pagination'>", -1);
-        
-        // Previous button
-        if (page > 1) {
-          char prevBtn[100];
-          snprintf(prevBtn, sizeof(prevBtn), 
-            "<a href='/gallery?page=%d&per=%d' class='page-btn'>« Previous</a>", 
-            page - 1, perPage);
-          httpd_resp_send_chunk(req, prevBtn, strlen(prevBtn));
-        }
-        
-        // Page numbers
-        int startPage = (page > 3) ? page - 2 : 1;
-        int endPage = (page + 2 < totalPages) ? page + 2 : totalPages;
-        
-        if (startPage > 1) {
-          char firstBtn[80];
-          snprintf(firstBtn, sizeof(firstBtn), 
-            "<a href='/gallery?page=1&per=%d' class='page-btn'>1</a>", perPage);
-          httpd_resp_send_chunk(req, firstBtn, strlen(firstBtn));
-          if (startPage > 2) {
-            httpd_resp_send_chunk(req, "<span class='page-btn' style='border:none;'>...</span>", -1);
-          }
-        }
-        
-        for (int p = startPage; p <= endPage; p++) {
-          char pageBtn[100];
-          snprintf(pageBtn, sizeof(pageBtn), 
-            "<a href='/gallery?page=%d&per=%d' class='page-btn%s'>%d</a>", 
-            p, perPage, (p == page) ? " active" : "", p);
-          httpd_resp_send_chunk(req, pageBtn, strlen(pageBtn));
-        }
-        
-        if (endPage < totalPages) {
-          if (endPage < totalPages - 1) {
-            httpd_resp_send_chunk(req, "<span class='page-btn' style='border:none;'>...</span>", -1);
-          }
-          char lastBtn[80];
-          snprintf(lastBtn, sizeof(lastBtn), 
-            "<a href='/gallery?page=%d&per=%d' class='page-btn'>%d</a>", 
-            totalPages, perPage, totalPages);
-          httpd_resp_send_chunk(req, lastBtn, strlen(lastBtn));
-        }
-        
-        // Next button
-        if (page < totalPages) {
-          char nextBtn[100];
-          snprintf(nextBtn, sizeof(nextBtn), 
-            "<a href='/gallery?page=%d&per=%d' class='page-btn'>Next »</a>", 
-            page + 1, perPage);
-          httpd_resp_send_chunk(req, nextBtn, strlen(nextBtn));
-        }
-        
-        httpd_resp_send_chunk(req, "</div>", -1); // Close pagination
-      }
-      
-      // Cleanup
-      delete[] imageFiles;
-      delete[] imageSizes;
+    httpd_resp_send_500(req);
+    return ESP_FAIL;
+  }
+  int count = summary_get(from, to, keys, n);
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+  int len = snprintf(buf, 1024, "{\"day\":\"%s\",\"from\":%u,\"to\":%u,\"keys\":[", day, from, to);
+  esp_err_t res = ESP_OK;
+  for (int i = 0; i < count && res == ESP_OK; i++) {
+    char path[32];
+    catalog_path(keys[i].seq, path, sizeof(path));
+    len += snprintf(buf + len, 1024 - len, "%s{\"seq\":%u,\"name\":\"%s\",\"start\":%u,\"end\":%u,\"frames\":%u,\"score\":%u}", i ? "," : "",
+      keys[i].seq, path + 1, keys[i].start, keys[i].end, keys[i].frames, keys[i].score);
+    if (len > 1024 - 128) {
+      res = httpd_resp_send_chunk(req, buf, len);
+      len = 0;
     }
   }
-  
-  // HTML footer with JavaScript
-  httpd_resp_send_chunk(req,
-    "</div>"
-    "<div style='text-align:center;margin-top:30px;color:#666;'>"
-    "<p>📷 Gallery with pagination for fast browsing. Newest images shown first. Click any image to view full size.</p>"
-    "<p style='font-size:12px;'>💡 Tip: Use ?per=10 or ?per=30 in URL to change images per page</p>"
-    "</div>"
+  if (res == ESP_OK) {
+    len += snprintf(buf + len, 1024 - len, "]}");
+    res = httpd_resp_send_chunk(req, buf, len);
+  }
+  free(keys);
+  pool_free(buf);
+  if (res == ESP_OK) {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
+static esp_err_t browse_handler(httpd_req_t *req) {
+  static const char page[] =
+    "<!DOCTYPE html><html><head>"
+    "<title>ESP32-CAM Browse</title>"
+    "<meta name='viewport' content='width=device-width, initial-scale=1'>"
+    "<link rel='stylesheet' href='" ASSET_BROWSE_CSS "'>"
+    "</head><body>"
+    "<div class='bar'>"
+    "<a href='/gallery'>🖼️ Gallery</a>"
+    "<label>From <input type='datetime-local' id='from'></label>"
+    "<label>To <input type='datetime-local' id='to'></label>"
+    "<span id='info'></span>"
+    "<button id='fresh' hidden></button>"
     "</div>"
-    "<script>"
-    "document.querySelectorAll('img').forEach(img=>{"
-    "img.classList.add('loading');"
-    "img.onload=()=>{img.classList.remove('loading');img.style.opacity='1';};"
-    "img.onerror=()=>{img.classList.remove('loading');img.style.opacity='0.3';};"
-    "});"
-    "let loaded=0,total=document.querySelectorAll('img').length;"
-    "document.querySelectorAll('img').forEach(img=>{"
-    "img.addEventListener('load',()=>{"
-    "loaded++;if(loaded===total)console.log('Page images loaded: '+loaded+'/'+total);"
-    "});"
-    "});"
-    "</script>"
-    "</body></html>", -1);
-  
-  httpd_resp_send_chunk(req, NULL, 0);
-  return ESP_OK;
+    "<div id='list'><div id='spacer'></div><div id='window'></div></div>"
+    "<script src='" ASSET_BROWSE_JS "'></script>"
+    "</body></html>";
+
+  httpd_resp_set_type(req, "text/html");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  return httpd_resp_send(req, page, sizeof(page) - 1);
 }
 
-static esp_err_t image_handler(httpd_req_t *req) {
+static esp_err_t image_send(httpd_req_t *req) {
   // Extract filename from URI (e.g., /image/img_001.jpg -> /img_001.jpg)
   const char* uri = req->uri;
   
@@ -970,12 +1931,28 @@ static esp_err_t image_handler(httpd_req_t *req) {
   
   // Remove query parameters from filename
   char cleanFilename[32];
+  char crop[32];
+  char rotate[8] = "0";
+  char flip[4] = "";
+  bool cropped = false;
+  bool transformed = false;
   const char* queryStart = strchr(filename, '?');
   if (queryStart) {
     size_t nameLen = queryStart - filename;
+    if (nameLen >= sizeof(cleanFilename)) {
+      httpd_resp_send_404(req);
+      return ESP_FAIL;
+    }
     strncpy(cleanFilename, filename, nameLen);
     cleanFilename[nameLen] = '\0';
     filename = cleanFilename;
+    cropped = httpd_query_key_value(queryStart + 1, "crop", crop, sizeof(crop)) == ESP_OK;
+    transformed = httpd_query_key_value(queryStart + 1, "rotate", rotate, sizeof(rotate)) == ESP_OK;
+    transformed |= httpd_query_key_value(queryStart + 1, "flip", flip, sizeof(flip)) == ESP_OK;
+    if (cropped && transformed) {
+      httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "crop cannot be combined with rotate/flip");
+      return ESP_FAIL;
+    }
   }
   
   log_i("Extracted filename: %s, thumbnail: %s", filename, isThumbnail ? "yes" : "no");
@@ -998,13 +1975,41 @@ static esp_err_t image_handler(httpd_req_t *req) {
     return ESP_FAIL;
   }
   
-  size_t fileSize = file.size();
+  // Deduplicated images get their header back from the dictionary
+  const uint8_t *header;
+  size_t headerLen, fileSize;
+  if (!jpeghdr_open(file, &header, &headerLen, &fileSize)) {
+    file.close();
+    httpd_resp_send_500(req);
+    return ESP_FAIL;
+  }
   log_i("File opened successfully: %s, size: %d", fullPath, fileSize);
   
   httpd_resp_set_type(req, "image/jpeg");
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
   httpd_resp_set_hdr(req, "Cache-Control", "public, max-age=31536000");
   
+  if (cropped || transformed) {
+    uint8_t *jpeg = (uint8_t *)(psramFound() ? ps_malloc(fileSize) : malloc(fileSize));
+    size_t got = 0;
+    if (jpeg) {
+      if (header) {
+        memcpy(jpeg, header, headerLen);
+      }
+      got = headerLen + file.read(jpeg + headerLen, fileSize - headerLen);
+    }
+    file.close();
+    esp_err_t res;
+    if (got != fileSize) {
+      httpd_resp_send_500(req);
+      res = ESP_FAIL;
+    } else {
+      res = cropped ? send_jpeg_crop(req, jpeg, fileSize, crop) : send_jpeg_transform(req, jpeg, fileSize, rotate, flip);
+    }
+    free(jpeg);
+    return res;
+  }
+
   // For thumbnails, we need to send the complete JPEG file but with reduced quality
   // The approach of cutting off bytes doesn't work for JPEG format
   
@@ -1015,7 +2020,7 @@ static esp_err_t image_handler(httpd_req_t *req) {
   
   // Use appropriate buffer size based on request type
   const size_t bufferSize = isThumbnail ? 1024 : 4096; // Smaller buffer for thumbs to reduce memory
-  uint8_t* buffer = (uint8_t*)malloc(bufferSize);
+  uint8_t* buffer = (uint8_t*)pool_alloc(bufferSize, POOL_INTERNAL);
   if (!buffer) {
     log_e("Failed to allocate buffer");
     file.close();
@@ -1025,19 +2030,30 @@ static esp_err_t image_handler(httpd_req_t *req) {
   
   size_t bytesRead;
   size_t totalSent = 0;
+
+  // Straight from the dictionary, no copy
+  if (header) {
+    if (httpd_resp_send_chunk(req, (const char*)header, headerLen) != ESP_OK) {
+      log_e("Failed to send chunk");
+      pool_free(buffer);
+      file.close();
+      return ESP_FAIL;
+    }
+    totalSent += headerLen;
+  }
   
   // Send the complete file (JPEG needs to be complete to display properly)
   while ((bytesRead = file.read(buffer, bufferSize)) > 0) {
     if (httpd_resp_send_chunk(req, (const char*)buffer, bytesRead) != ESP_OK) {
       log_e("Failed to send chunk");
-      free(buffer);
+      pool_free(buffer);
       file.close();
       return ESP_FAIL;
     }
     totalSent += bytesRead;
   }
   
-  free(buffer);
+  pool_free(buffer);
   file.close();
   httpd_resp_send_chunk(req, NULL, 0);
   
@@ -1045,12 +2061,43 @@ static esp_err_t image_handler(httpd_req_t *req) {
   return ESP_OK;
 }
 
+// A recorded frame is pinned from the open to the last read, so the
+// recompressor cannot swap the file under the Content-Length already sent
+static esp_err_t image_handler(httpd_req_t *req) {
+  const char *name = req->uri + 6;  // past "/image"
+  if (*name == '/') {
+    name++;
+  }
+  unsigned seq;
+  int pin = sscanf(name, "img_%u.jpg", &seq) == 1 ? catalog_pin_seq(seq) : -1;
+  esp_err_t res = image_send(req);
+  catalog_unpin(pin);
+  return res;
+}
+
 static esp_err_t debug_handler(httpd_req_t *req) {
   httpd_resp_set_type(req, "text/plain");
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
   
   // Send header first
   httpd_resp_send_chunk(req, "=== SD CARD DEBUG INFO ===\n", -1);
+
+  // /debug?sdtune=1 re-runs the SD bus calibration on the next boot
+  char query[32];
+  char sdtune[4];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK
+      && httpd_query_key_value(query, "sdtune", sdtune, sizeof(sdtune)) == ESP_OK && atoi(sdtune) == 1) {
+    storage_request_calibration();
+    httpd_resp_send_chunk(req, "SD bus calibration scheduled for next boot\n", -1);
+  }
+
+  sd_bench_t bus;
+  if (storage_get_setting(&bus)) {
+    char busLine[160];
+    snprintf(busLine, sizeof(busLine), "Bus: %u-bit @ %u kHz, write %.2f MB/s, read %.2f MB/s%s\n",
+      bus.width, bus.freq_khz, bus.write_mbps, bus.read_mbps, bus.verified ? "" : " (unverified)");
+    httpd_resp_send_chunk(req, busLine, strlen(busLine));
+  }
   
   File root = SD_MMC.open("/");
   if (!root) {
@@ -1063,9 +2110,8 @@ static esp_err_t debug_handler(httpd_req_t *req) {
     char line[128];
     
     while (file && fileCount < 50) { // Limit to prevent overflow
-      String fileName = file.name();
       snprintf(line, sizeof(line), "%d. '%s' (%d bytes)\n", 
-        ++fileCount, fileName.c_str(), file.size());
+        ++fileCount, file.name(), file.size());
       httpd_resp_send_chunk(req, line, strlen(line));
       file = root.openNextFile();
     }
@@ -1084,38 +2130,19 @@ static esp_err_t debug_handler(httpd_req_t *req) {
 }
 
 static esp_err_t home_handler(httpd_req_t *req) {
-  httpd_resp_set_type(req, "text/html");
-  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-  
-  // Send HTML in chunks to reduce stack usage
-  httpd_resp_send_chunk(req, 
+  static const char page[] =
     "<!DOCTYPE html><html><head>"
     "<title>ESP32-CAM Control</title>"
     "<meta name='viewport' content='width=device-width, initial-scale=1'>"
-    "<style>"
-    "body{font-family:Arial;text-align:center;margin:50px;background:#f0f0f0;}"
-    ".container{max-width:600px;margin:0 auto;background:white;padding:30px;border-radius:10px;box-shadow:0 4px 6px rgba(0,0,0,0.1);}"
-    "h1{color:#333;margin-bottom:30px;}", -1);
-    
-  httpd_resp_send_chunk(req,
-    ".btn{display:inline-block;padding:15px 30px;margin:10px;background:#4CAF50;color:white;text-decoration:none;border-radius:5px;font-size:16px;transition:background 0.3s;}"
-    ".btn:hover{background:#45a049;}"
-    ".btn-secondary{background:#2196F3;}"
-    ".btn-secondary:hover{background:#0b7dda;}"
-    ".btn-danger{background:#f44336;}"
-    ".btn-danger:hover{background:#da190b;}", -1);
-    
-  httpd_resp_send_chunk(req,
-    ".info{background:#e7f3ff;padding:15px;border-radius:5px;margin:20px 0;}"
-    "</style>"
+    "<link rel='stylesheet' href='" ASSET_HOME_CSS "'>"
     "</head><body>"
     "<div class='container'>"
     "<h1>📷 ESP32-CAM Control Panel</h1>"
     "<div class='info'>"
     "<p>🔴 Camera is automatically capturing images every second and saving to SD card</p>"
-    "</div>", -1);
-    
-  httpd_resp_send_chunk(req,
+    "<p id='lastShot' style='font-size:13px;color:#555;'></p>"
+    "<p id='metrics' style='font-size:13px;color:#555;'></p>"
+    "</div>"
     "<a href='/stream' class='btn btn-secondary' target='_blank'>📹 Live Stream</a>"
     "<a href='/capture' class='btn' target='_blank'>📸 Take Photo</a>"
     "<a href='/gallery' class='btn btn-secondary'>🖼️ View Gallery</a>"
@@ -1125,38 +2152,41 @@ static esp_err_t home_handler(httpd_req_t *req) {
     "<button id='statusToggle' class='btn' onclick='toggleStatusLED()' style='background:#ff6b35;'>🔴 Status: Loading...</button>"
     "<br><br>"
     "<p style='color:#666;font-size:14px;'>Use the buttons above to access camera functions</p>"
-    "<script>"
-    "let flashEnabled = false, statusEnabled = false;"
-    "function toggleFlashLED() {"
-    "  flashEnabled = !flashEnabled;"
-    "  fetch('/control?var=led_enabled&val=' + (flashEnabled ? 1 : 0))"
-    "    .then(r => {"
-    "      document.getElementById('flashToggle').textContent = '🔦 Flash: ' + (flashEnabled ? 'ON' : 'OFF');"
-    "      document.getElementById('flashToggle').style.background = flashEnabled ? '#4CAF50' : '#666';"
-    "    }).catch(e => console.error('Flash LED failed:', e));"
-    "}"
-    "function toggleStatusLED() {"
-    "  statusEnabled = !statusEnabled;"
-    "  fetch('/control?var=status_led&val=' + (statusEnabled ? 1 : 0))"
-    "    .then(r => {"
-    "      document.getElementById('statusToggle').textContent = '🔴 Status: ' + (statusEnabled ? 'ON' : 'OFF');"
-    "      document.getElementById('statusToggle').style.background = statusEnabled ? '#4CAF50' : '#666';"
-    "    }).catch(e => console.error('Status LED failed:', e));"
-    "}"
-    "fetch('/status').then(r=>r.json()).then(d=>{"
-    "  flashEnabled = d.led_enabled === 1;"
-    "  statusEnabled = d.status_led === 1;"
-    "  document.getElementById('flashToggle').textContent = '🔦 Flash: ' + (flashEnabled ? 'ON' : 'OFF');"
-    "  document.getElementById('flashToggle').style.background = flashEnabled ? '#4CAF50' : '#666';"
-    "  document.getElementById('statusToggle').textContent = '🔴 Status: ' + (statusEnabled ? 'ON' : 'OFF');"
-    "  document.getElementById('statusToggle').style.background = statusEnabled ? '#4CAF50' : '#666';"
-    "}).catch(e=>console.error('Status load failed:', e));"
-    "</script>"
+    "<script src='" ASSET_HOME_JS "'></script>"
     "</div>"
-    "</body></html>", -1);
-  
-  httpd_resp_send_chunk(req, NULL, 0); // End response
-  return ESP_OK;
+    "</body></html>";
+
+  httpd_resp_set_type(req, "text/html");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  return httpd_resp_send(req, page, sizeof(page) - 1);
+}
+
+// CSS/JS from web_assets.h. The URL carries the content hash, so a response
+// never changes and can be cached for good.
+static esp_err_t asset_handler(httpd_req_t *req) {
+  const char *uri = req->uri;
+  size_t uri_len = strcspn(uri, "?");
+  const web_asset_t *asset = NULL;
+  for (size_t i = 0; i < WEB_ASSET_COUNT && !asset; i++) {
+    if (strlen(web_assets[i].uri) == uri_len && strncmp(web_assets[i].uri, uri, uri_len) == 0) {
+      asset = &web_assets[i];
+    }
+  }
+  if (!asset) {
+    httpd_resp_send_404(req);
+    return ESP_FAIL;
+  }
+
+  httpd_resp_set_hdr(req, "ETag", asset->etag);
+  httpd_resp_set_hdr(req, "Cache-Control", "public, max-age=31536000, immutable");
+  char inm[16];
+  if (httpd_req_get_hdr_value_str(req, "If-None-Match", inm, sizeof(inm)) == ESP_OK && strcmp(inm, asset->etag) == 0) {
+    httpd_resp_set_status(req, "304 Not Modified");
+    return httpd_resp_send(req, NULL, 0);
+  }
+  httpd_resp_set_type(req, asset->type);
+  httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+  return httpd_resp_send(req, (const char *)asset->data, asset->len);
 }
 
 static esp_err_t index_handler(httpd_req_t *req) {
@@ -1195,6 +2225,10 @@ esp_err_t custom_404_handler(httpd_req_t *req, httpd_err_code_t err) {
     log_i("Handling image request in 404 handler: %s", uri);
     return image_handler(req);
   }
+
+  if (strncmp(uri, "/assets/", 8) == 0) {
+    return asset_handler(req);
+  }
   
   // Default 404 response
   httpd_resp_send_404(req);
@@ -1203,9 +2237,13 @@ esp_err_t custom_404_handler(httpd_req_t *req, httpd_err_code_t err) {
 
 void startCameraServer() {
   httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-  config.max_uri_handlers = 20;
+  config.max_uri_handlers = 26;
   config.stack_size = 8192; // Increase stack size to prevent overflow
   config.task_priority = 5;
+  // /events connections stay open; when sockets run out the oldest idle one
+  // is recycled and EventSource reconnects with Last-Event-ID
+  config.lru_purge_enable = true;
+  config.close_fn = session_closed;
 
   httpd_uri_t index_uri = {
     .uri = "/",
@@ -1214,7 +2252,7 @@ void startCameraServer() {
     .user_ctx = NULL
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     ,
-    .is_websocket = true,
+    .is_websocket = false,
     .handle_ws_control_frames = false,
     .supported_subprotocol = NULL
 #endif
@@ -1227,12 +2265,50 @@ void startCameraServer() {
     .user_ctx = NULL
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     ,
-    .is_websocket = true,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t metrics_uri = {
+    .uri = "/metrics",
+    .method = HTTP_GET,
+    .handler = metrics_handler,
+    .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t events_uri = {
+    .uri = "/events",
+    .method = HTTP_GET,
+    .handler = events_handler,
+    .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = false,
     .handle_ws_control_frames = false,
     .supported_subprotocol = NULL
 #endif
   };
 
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+  httpd_uri_t ws_stream_uri = {
+    .uri = "/ws/stream",
+    .method = HTTP_GET,
+    .handler = ws_stream_handler,
+    .user_ctx = NULL,
+    .is_websocket = true,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+  };
+#endif
+
   httpd_uri_t cmd_uri = {
     .uri = "/control",
     .method = HTTP_GET,
@@ -1240,7 +2316,20 @@ void startCameraServer() {
     .user_ctx = NULL
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     ,
-    .is_websocket = true,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t cmd_batch_uri = {
+    .uri = "/control",
+    .method = HTTP_POST,
+    .handler = cmd_handler,
+    .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = false,
     .handle_ws_control_frames = false,
     .supported_subprotocol = NULL
 #endif
@@ -1253,7 +2342,20 @@ void startCameraServer() {
     .user_ctx = NULL
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     ,
-    .is_websocket = true,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t burst_uri = {
+    .uri = "/burst",
+    .method = HTTP_GET,
+    .handler = burst_handler,
+    .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = false,
     .handle_ws_control_frames = false,
     .supported_subprotocol = NULL
 #endif
@@ -1262,11 +2364,63 @@ void startCameraServer() {
   httpd_uri_t stream_uri = {
     .uri = "/stream",
     .method = HTTP_GET,
-    .handler = stream_handler,
+    .handler = stream_async,
     .user_ctx = NULL
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     ,
-    .is_websocket = true,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t playback_uri = {
+    .uri = "/playback",
+    .method = HTTP_GET,
+    .handler = playback_async,
+    .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t export_uri = {
+    .uri = "/export.avi",
+    .method = HTTP_GET,
+    .handler = export_async,
+    .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t download_tar_uri = {
+    .uri = "/download.tar",
+    .method = HTTP_GET,
+    .handler = download_async,
+    .user_ctx = (void *)ARCHIVE_TAR
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t download_zip_uri = {
+    .uri = "/download.zip",
+    .method = HTTP_GET,
+    .handler = download_async,
+    .user_ctx = (void *)ARCHIVE_ZIP
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = false,
     .handle_ws_control_frames = false,
     .supported_subprotocol = NULL
 #endif
@@ -1279,7 +2433,7 @@ void startCameraServer() {
     .user_ctx = NULL
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     ,
-    .is_websocket = true,
+    .is_websocket = false,
     .handle_ws_control_frames = false,
     .supported_subprotocol = NULL
 #endif
@@ -1292,7 +2446,7 @@ void startCameraServer() {
     .user_ctx = NULL
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     ,
-    .is_websocket = true,
+    .is_websocket = false,
     .handle_ws_control_frames = false,
     .supported_subprotocol = NULL
 #endif
@@ -1305,7 +2459,7 @@ void startCameraServer() {
     .user_ctx = NULL
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     ,
-    .is_websocket = true,
+    .is_websocket = false,
     .handle_ws_control_frames = false,
     .supported_subprotocol = NULL
 #endif
@@ -1318,7 +2472,7 @@ void startCameraServer() {
     .user_ctx = NULL
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     ,
-    .is_websocket = true,
+    .is_websocket = false,
     .handle_ws_control_frames = false,
     .supported_subprotocol = NULL
 #endif
@@ -1331,7 +2485,7 @@ void startCameraServer() {
     .user_ctx = NULL
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     ,
-    .is_websocket = true,
+    .is_websocket = false,
     .handle_ws_control_frames = false,
     .supported_subprotocol = NULL
 #endif
@@ -1344,7 +2498,59 @@ void startCameraServer() {
     .user_ctx = NULL
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     ,
-    .is_websocket = true,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t api_images_uri = {
+    .uri = "/api/images",
+    .method = HTTP_GET,
+    .handler = api_images_handler,
+    .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t api_similar_uri = {
+    .uri = "/api/similar",
+    .method = HTTP_GET,
+    .handler = api_similar_handler,
+    .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t api_summary_uri = {
+    .uri = "/api/summary",
+    .method = HTTP_GET,
+    .handler = api_summary_handler,
+    .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t browse_uri = {
+    .uri = "/browse",
+    .method = HTTP_GET,
+    .handler = browse_handler,
+    .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = false,
     .handle_ws_control_frames = false,
     .supported_subprotocol = NULL
 #endif
@@ -1357,7 +2563,7 @@ void startCameraServer() {
     .user_ctx = NULL
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     ,
-    .is_websocket = true,
+    .is_websocket = false,
     .handle_ws_control_frames = false,
     .supported_subprotocol = NULL
 #endif
@@ -1370,7 +2576,7 @@ void startCameraServer() {
     .user_ctx = NULL
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     ,
-    .is_websocket = true,
+    .is_websocket = false,
     .handle_ws_control_frames = false,
     .supported_subprotocol = NULL
 #endif
@@ -1383,7 +2589,7 @@ void startCameraServer() {
     .user_ctx = NULL
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     ,
-    .is_websocket = true,
+    .is_websocket = false,
     .handle_ws_control_frames = false,
     .supported_subprotocol = NULL
 #endif
@@ -1396,7 +2602,7 @@ void startCameraServer() {
     .user_ctx = NULL
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     ,
-    .is_websocket = true,
+    .is_websocket = false,
     .handle_ws_control_frames = false,
     .supported_subprotocol = NULL
 #endif
@@ -1409,7 +2615,7 @@ void startCameraServer() {
     .user_ctx = NULL
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     ,
-    .is_websocket = true,
+    .is_websocket = false,
     .handle_ws_control_frames = false,
     .supported_subprotocol = NULL
 #endif
@@ -1417,6 +2623,16 @@ void startCameraServer() {
 
 
   ra_filter_init(&ra_filter, 20);
+  pool_init();
+  transcode_init();
+  sensor_ctrl_register(led_controls, sizeof(led_controls) / sizeof(led_controls[0]));
+  sensor_state_add_section("boot", boot_print_json);
+  sensor_state_add_section("sd", storage_print_json);
+  events_init();
+  sensor_state_init();
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+  ws_stream_init();
+#endif
 
   log_i("Starting web server on port: '%d'", config.server_port);
   if (httpd_start(&camera_httpd, &config) == ESP_OK) {
@@ -1425,10 +2641,21 @@ void startCameraServer() {
     httpd_register_uri_handler(camera_httpd, &camera_uri);
     httpd_register_uri_handler(camera_httpd, &debug_uri);
     httpd_register_uri_handler(camera_httpd, &cmd_uri);
+    httpd_register_uri_handler(camera_httpd, &cmd_batch_uri);
     httpd_register_uri_handler(camera_httpd, &status_uri);
+    httpd_register_uri_handler(camera_httpd, &metrics_uri);
+    httpd_register_uri_handler(camera_httpd, &events_uri);
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    httpd_register_uri_handler(camera_httpd, &ws_stream_uri);
+#endif
     httpd_register_uri_handler(camera_httpd, &capture_uri);
+    httpd_register_uri_handler(camera_httpd, &burst_uri);
     httpd_register_uri_handler(camera_httpd, &bmp_uri);
     httpd_register_uri_handler(camera_httpd, &gallery_uri);
+    httpd_register_uri_handler(camera_httpd, &api_images_uri);
+    httpd_register_uri_handler(camera_httpd, &api_similar_uri);
+    httpd_register_uri_handler(camera_httpd, &api_summary_uri);
+    httpd_register_uri_handler(camera_httpd, &browse_uri);
     httpd_register_uri_handler(camera_httpd, &image_uri);
 
     httpd_register_uri_handler(camera_httpd, &xclk_uri);
@@ -1446,7 +2673,13 @@ void startCameraServer() {
   log_i("Starting stream server on port: '%d'", config.server_port);
   if (httpd_start(&stream_httpd, &config) == ESP_OK) {
     httpd_register_uri_handler(stream_httpd, &stream_uri);
+    httpd_register_uri_handler(stream_httpd, &playback_uri);
+    httpd_register_uri_handler(stream_httpd, &export_uri);
+    httpd_register_uri_handler(stream_httpd, &download_tar_uri);
+    httpd_register_uri_handler(stream_httpd, &download_zip_uri);
   }
+
+  rtsp_start(RTSP_PORT);
 }
 
 void setupLedFlash(int pin) {
@@ -0,0 +1,955 @@
+// Lossless JPEG transforms on quantised DCT coefficients
+#include "Arduino.h"
+#include "app_jpeg.h"
+
+#define JPEG_OUT_BUF   1024
+#define HUFF_LOOKAHEAD 8
+
+typedef struct {
+  uint8_t id;
+  uint8_t h;
+  uint8_t v;
+  uint8_t tq;
+  uint8_t td;  // Huffman tables selected by the scan
+  uint8_t ta;
+} comp_t;
+
+typedef struct {
+  bool present;
+  uint8_t bits[17];  // codes of each length 1..16
+  uint8_t vals[256];
+  int32_t maxcode[18];
+  int32_t valoffset[17];
+  uint16_t look[1 << HUFF_LOOKAHEAD];  // (length << 8) | symbol, 0 = longer code
+} huff_dec_t;
+
+typedef struct {
+  uint16_t code[256];
+  uint8_t size[256];
+} huff_enc_t;
+
+typedef struct {
+  const uint8_t *src;
+  size_t len;
+  jpeg_info_t info;
+  int ncomp;
+  comp_t comp[JPEG_MAX_COMPS];
+  int hmax;
+  int vmax;
+  int mcus_x;
+  int mcus_y;
+  size_t scan;  // first byte of entropy-coded data
+  uint16_t qdc[4];  // DC quantiser of each table
+  // Point into jpeg_tables_t; NULL when only the headers are read
+  huff_dec_t *dc;  // [4]
+  huff_dec_t *ac;  // [4]
+  huff_enc_t *enc_dc;  // [2] luminance, chrominance
+  huff_enc_t *enc_ac;  // [2]
+} jpeg_t;
+
+typedef struct {
+  huff_dec_t dc[4];
+  huff_dec_t ac[4];
+  huff_enc_t enc_dc[2];
+  huff_enc_t enc_ac[2];
+} jpeg_tables_t;
+
+typedef struct {
+  const uint8_t *p;
+  const uint8_t *end;
+  uint32_t acc;  // left aligned
+  int bits;
+  bool marker;   // reached a marker, only zeros follow
+  uint8_t fake;  // zero bytes fed since then
+} bit_reader_t;
+
+typedef struct {
+  jpeg_sink_t sink;
+  void *ctx;
+  bool ok;
+  uint32_t acc;
+  int bits;
+  size_t n;
+  uint8_t buf[JPEG_OUT_BUF];
+} bit_writer_t;
+
+// Zigzag position -> natural (row-major) position
+static const uint8_t zigzag[64] = {
+  0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,  12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6,  7,  14, 21, 28,
+  35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+// Annex K tables: bits for code lengths 1..16, then the symbols
+static const uint8_t std_dc_bits[2][16] = {
+  {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0},
+  {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0},
+};
+static const uint8_t std_dc_vals[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+static const uint8_t std_ac_bits[2][16] = {
+  {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d},
+  {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77},
+};
+static const uint8_t std_ac_vals[2][162] = {
+  {0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1,
+   0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26,
+   0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56,
+   0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85,
+   0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa,
+   0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6,
+   0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9,
+   0xfa},
+  {0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42,
+   0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19,
+   0x1a, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55,
+   0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83,
+   0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8,
+   0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4,
+   0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9,
+   0xfa},
+};
+
+static uint16_t be16(const uint8_t *p) {
+  return (p[0] << 8) | p[1];
+}
+
+// Canonical code assignment (Annex C); returns the number of codes
+static int huff_codes(const uint8_t *bits, uint8_t *sizes, uint16_t *codes) {
+  int n = 0;
+  for (int l = 1; l <= 16; l++) {
+    for (int i = 0; i < bits[l - 1]; i++) {
+      sizes[n++] = l;
+    }
+  }
+  uint16_t code = 0;
+  for (int p = 0, l = 1; p < n; l++) {
+    while (p < n && sizes[p] == l) {
+      codes[p++] = code++;
+    }
+    code <<= 1;
+  }
+  return n;
+}
+
+static void huff_dec_build(huff_dec_t *t) {
+  uint8_t sizes[256];
+  uint16_t codes[256];
+  huff_codes(t->bits + 1, sizes, codes);
+  int p = 0;
+  for (int l = 1; l <= 16; l++) {
+    if (t->bits[l]) {
+      t->valoffset[l] = p - codes[p];
+      p += t->bits[l];
+      t->maxcode[l] = codes[p - 1];
+    } else {
+      t->maxcode[l] = -1;
+    }
+  }
+  t->maxcode[17] = 0xFFFFF;  // ends the slow path on bad data
+
+  memset(t->look, 0, sizeof(t->look));
+  p = 0;
+  for (int l = 1; l <= HUFF_LOOKAHEAD; l++) {
+    for (int i = 0; i < t->bits[l]; i++, p++) {
+      int first = codes[p] << (HUFF_LOOKAHEAD - l);
+      for (int k = 0; k < 1 << (HUFF_LOOKAHEAD - l); k++) {
+        t->look[first + k] = (l << 8) | t->vals[p];
+      }
+    }
+  }
+  t->present = true;
+}
+
+static void huff_enc_build(huff_enc_t *t, const uint8_t *bits, const uint8_t *vals) {
+  uint8_t sizes[256];
+  uint16_t codes[256];
+  int n = huff_codes(bits, sizes, codes);
+  memset(t->size, 0, sizeof(t->size));
+  for (int p = 0; p < n; p++) {
+    t->code[vals[p]] = codes[p];
+    t->size[vals[p]] = sizes[p];
+  }
+}
+
+static esp_err_t parse(jpeg_t *j, const uint8_t *src, size_t len) {
+  j->src = src;
+  j->len = len;
+  j->ncomp = 0;
+  j->scan = 0;
+  memset(&j->info, 0, sizeof(j->info));
+  for (int i = 0; i < 4; i++) {
+    if (j->dc) {
+      j->dc[i].present = j->ac[i].present = false;
+    }
+    j->qdc[i] = 1;
+  }
+  if (len < 4 || src[0] != 0xFF || src[1] != 0xD8) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  size_t pos = 2;
+  bool frame = false;
+  while (pos + 4 <= len) {
+    if (src[pos] != 0xFF) {
+      return ESP_ERR_INVALID_SIZE;
+    }
+    uint8_t marker = src[pos + 1];
+    if (marker == 0xFF) {
+      pos++;
+      continue;
+    }
+    size_t seg_len = be16(src + pos + 2);
+    const uint8_t *seg = src + pos + 4;
+    if (seg_len < 2 || pos + 2 + seg_len > len) {
+      return ESP_ERR_INVALID_SIZE;
+    }
+    size_t n = seg_len - 2;
+
+    if (marker == 0xC0 || marker == 0xC1) {
+      if (n < 6 || seg[0] != 8 || seg[5] < 1 || seg[5] > JPEG_MAX_COMPS || n < 6 + 3 * (size_t)seg[5]) {
+        return ESP_ERR_NOT_SUPPORTED;
+      }
+      j->info.height = be16(seg + 1);
+      j->info.width = be16(seg + 3);
+      j->ncomp = seg[5];
+      j->hmax = j->vmax = 1;
+      for (int c = 0; c < j->ncomp; c++) {
+        comp_t *k = &j->comp[c];
+        k->id = seg[6 + 3 * c];
+        k->h = seg[7 + 3 * c] >> 4;
+        k->v = seg[7 + 3 * c] & 15;
+        k->tq = seg[8 + 3 * c];
+        j->info.sampling[c] = seg[7 + 3 * c];
+        if (k->h < 1 || k->h > 2 || k->v < 1 || k->v > 2) {
+          return ESP_ERR_NOT_SUPPORTED;
+        }
+        j->hmax = k->h > j->hmax ? k->h : j->hmax;
+        j->vmax = k->v > j->vmax ? k->v : j->vmax;
+      }
+      // A single-component scan is coded in plain 8x8 blocks
+      if (j->ncomp == 1) {
+        j->comp[0].h = j->comp[0].v = j->hmax = j->vmax = 1;
+      }
+      frame = true;
+    } else if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+      return ESP_ERR_NOT_SUPPORTED;  // progressive, lossless, arithmetic
+    } else if (marker == 0xC4) {
+      const uint8_t *p = seg;
+      const uint8_t *end = seg + n;
+      while (p + 17 <= end) {
+        uint8_t tc = p[0] >> 4, th = p[0] & 15;
+        if (tc > 1 || th > 3) {
+          return ESP_ERR_NOT_SUPPORTED;
+        }
+        int count = 0;
+        for (int l = 1; l <= 16; l++) {
+          count += p[l];
+        }
+        if (count > 256 || p + 17 + count > end) {
+          return ESP_ERR_INVALID_SIZE;
+        }
+        if (j->dc) {
+          huff_dec_t *t = tc ? &j->ac[th] : &j->dc[th];
+          t->bits[0] = 0;
+          memcpy(t->bits + 1, p + 1, 16);
+          memcpy(t->vals, p + 17, count);
+          huff_dec_build(t);
+        }
+        p += 17 + count;
+      }
+    } else if (marker == 0xDB) {
+      const uint8_t *p = seg;
+      const uint8_t *end = seg + n;
+      while (p < end) {
+        uint8_t pq = p[0] >> 4, tq = p[0] & 15;
+        size_t size = 1 + (pq ? 128 : 64);
+        if (pq > 1 || tq > 3 || p + size > end) {
+          return ESP_ERR_INVALID_SIZE;
+        }
+        j->qdc[tq] = pq ? be16(p + 1) : p[1];
+        j->info.qtables[tq] = pq ? NULL : p + 1;
+        p += size;
+      }
+    } else if (marker == 0xDD) {
+      j->info.restart_interval = n >= 2 ? be16(seg) : 0;
+    } else if (marker == 0xDA) {
+      if (!frame || n < 1 || seg[0] != j->ncomp || n < 4 + 2 * (size_t)seg[0]) {
+        return ESP_ERR_NOT_SUPPORTED;  // components in separate scans
+      }
+      for (int c = 0; c < j->ncomp; c++) {
+        if (seg[1 + 2 * c] != j->comp[c].id) {
+          return ESP_ERR_NOT_SUPPORTED;
+        }
+        j->comp[c].td = seg[2 + 2 * c] >> 4;
+        j->comp[c].ta = seg[2 + 2 * c] & 15;
+        if (j->comp[c].td > 3 || j->comp[c].ta > 3) {
+          return ESP_ERR_INVALID_SIZE;
+        }
+        if (j->dc && (!j->dc[j->comp[c].td].present || !j->ac[j->comp[c].ta].present)) {
+          return ESP_ERR_INVALID_SIZE;
+        }
+      }
+      j->scan = pos + 2 + seg_len;
+      break;
+    }
+    pos += 2 + seg_len;
+  }
+  if (!j->scan) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  j->info.components = j->ncomp;
+  j->info.scan = j->scan;
+  j->info.mcu_width = 8 * j->hmax;
+  j->info.mcu_height = 8 * j->vmax;
+  j->mcus_x = (j->info.width + j->info.mcu_width - 1) / j->info.mcu_width;
+  j->mcus_y = (j->info.height + j->info.mcu_height - 1) / j->info.mcu_height;
+  return j->info.width && j->info.height ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+static void br_init(bit_reader_t *br, const uint8_t *p, const uint8_t *end) {
+  br->p = p;
+  br->end = end;
+  br->acc = 0;
+  br->bits = 0;
+  br->marker = false;
+  br->fake = 0;
+}
+
+static void br_fill(bit_reader_t *br) {
+  while (br->bits <= 24) {
+    uint32_t byte = 0;
+    if (!br->marker && br->p < br->end) {
+      if (br->p[0] != 0xFF) {
+        byte = *br->p++;
+      } else if (br->p + 1 < br->end && br->p[1] == 0) {
+        byte = 0xFF;
+        br->p += 2;
+      } else {
+        br->marker = true;
+      }
+    }
+    if (br->marker && br->fake < 4) {
+      br->fake++;
+    }
+    br->acc |= byte << (24 - br->bits);
+    br->bits += 8;
+  }
+}
+
+static uint32_t br_get(bit_reader_t *br, int n) {
+  if (br->bits < n) {
+    br_fill(br);
+  }
+  uint32_t v = br->acc >> (32 - n);
+  br->acc <<= n;
+  br->bits -= n;
+  return v;
+}
+
+// Position of the next unread bit: byte offset from base << 3 | bits of
+// that byte already used. Bytes buffered in acc are walked back over,
+// undoing the 0xFF 0x00 stuffing.
+static uint32_t br_tell(const bit_reader_t *br, const uint8_t *base) {
+  int bytes = (br->bits + 7) / 8;
+  bytes -= br->fake < bytes ? br->fake : bytes;
+  const uint8_t *p = br->p;
+  for (; bytes > 0 && p > base; bytes--) {
+    p -= p - 1 > base && p[-1] == 0x00 && p[-2] == 0xFF ? 2 : 1;
+  }
+  return ((uint32_t)(p - base) << 3) | ((8 - br->bits % 8) % 8);
+}
+
+static void br_seek(bit_reader_t *br, const uint8_t *base, const uint8_t *end, uint32_t pos) {
+  br_init(br, base + (pos >> 3), end);
+  if (pos & 7) {
+    br_get(br, pos & 7);
+  }
+}
+
+// Step over the next RSTn marker and start on a byte boundary
+static void br_restart(bit_reader_t *br) {
+  const uint8_t *p = br->p;
+  while (p + 1 < br->end && !(p[0] == 0xFF && p[1] >= 0xD0 && p[1] <= 0xD7)) {
+    p++;
+  }
+  br_init(br, p + 2 < br->end ? p + 2 : br->end, br->end);
+}
+
+static int huff_decode(bit_reader_t *br, const huff_dec_t *t) {
+  if (br->bits < 16) {
+    br_fill(br);
+  }
+  uint16_t look = t->look[br->acc >> (32 - HUFF_LOOKAHEAD)];
+  if (look) {
+    br->acc <<= look >> 8;
+    br->bits -= look >> 8;
+    return look & 0xFF;
+  }
+  int l = HUFF_LOOKAHEAD + 1;
+  int32_t code = br_get(br, l);
+  while (code > t->maxcode[l]) {
+    code = (code << 1) | br_get(br, 1);
+    if (++l > 16) {
+      return -1;
+    }
+  }
+  return t->vals[(code + t->valoffset[l]) & 0xFF];
+}
+
+static int extend(uint32_t v, int s) {
+  return v < (1U << (s - 1)) ? (int)v - (1 << s) + 1 : (int)v;
+}
+
+// One block into zigzag-ordered coefficients; pred is the component's DC
+static bool decode_block(bit_reader_t *br, const huff_dec_t *dc, const huff_dec_t *ac, int *pred, int16_t *zz) {
+  memset(zz, 0, 64 * sizeof(int16_t));
+  int s = huff_decode(br, dc);
+  if (s < 0 || s > 11) {
+    return false;
+  }
+  *pred += s ? extend(br_get(br, s), s) : 0;
+  zz[0] = *pred;
+  for (int k = 1; k < 64;) {
+    int rs = huff_decode(br, ac);
+    if (rs < 0) {
+      return false;
+    }
+    int r = rs >> 4;
+    s = rs & 15;
+    if (!s) {
+      if (r != 15) {
+        break;  // end of block
+      }
+      k += 16;
+      continue;
+    }
+    k += r;
+    if (k > 63) {
+      return false;
+    }
+    zz[k++] = extend(br_get(br, s), s);
+  }
+  return true;
+}
+
+static bit_writer_t *bw_create(jpeg_sink_t sink, void *ctx) {
+  bit_writer_t *w = (bit_writer_t *)malloc(sizeof(bit_writer_t));
+  if (w) {
+    w->sink = sink;
+    w->ctx = ctx;
+    w->ok = true;
+    w->acc = 0;
+    w->bits = 0;
+    w->n = 0;
+  }
+  return w;
+}
+
+static void bw_byte(bit_writer_t *w, uint8_t byte) {
+  w->buf[w->n++] = byte;
+  if (w->n == sizeof(w->buf)) {
+    w->ok = w->ok && w->sink(w->ctx, w->buf, w->n);
+    w->n = 0;
+  }
+}
+
+static void bw_bytes(bit_writer_t *w, const uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    bw_byte(w, data[i]);
+  }
+}
+
+static void bw_put(bit_writer_t *w, uint32_t code, int size) {
+  w->acc = (w->acc << size) | (code & ((1U << size) - 1));
+  w->bits += size;
+  while (w->bits >= 8) {
+    uint8_t byte = w->acc >> (w->bits - 8);
+    bw_byte(w, byte);
+    if (byte == 0xFF) {
+      bw_byte(w, 0);  // stuffing
+    }
+    w->bits -= 8;
+  }
+}
+
+static bool bw_finish(bit_writer_t *w) {
+  if (w->bits) {
+    bw_put(w, 0x7F, 8 - w->bits);  // pad with ones
+  }
+  bw_byte(w, 0xFF);
+  bw_byte(w, 0xD9);
+  if (w->n) {
+    w->ok = w->ok && w->sink(w->ctx, w->buf, w->n);
+    w->n = 0;
+  }
+  return w->ok;
+}
+
+static int magnitude(int v) {
+  int n = 0;
+  for (v = v < 0 ? -v : v; v; v >>= 1) {
+    n++;
+  }
+  return n;
+}
+
+static void encode_block(bit_writer_t *w, const int16_t *zz, int *pred, const huff_enc_t *dc, const huff_enc_t *ac) {
+  int diff = zz[0] - *pred;
+  *pred = zz[0];
+  int n = magnitude(diff);
+  bw_put(w, dc->code[n], dc->size[n]);
+  if (n) {
+    bw_put(w, diff < 0 ? diff - 1 : diff, n);
+  }
+  int run = 0;
+  for (int k = 1; k < 64; k++) {
+    int v = zz[k];
+    if (!v) {
+      run++;
+      continue;
+    }
+    for (; run > 15; run -= 16) {
+      bw_put(w, ac->code[0xF0], ac->size[0xF0]);
+    }
+    n = magnitude(v);
+    int rs = (run << 4) | n;
+    bw_put(w, ac->code[rs], ac->size[rs]);
+    bw_put(w, v < 0 ? v - 1 : v, n);
+    run = 0;
+  }
+  if (run) {
+    bw_put(w, ac->code[0x00], ac->size[0x00]);
+  }
+}
+
+// A quantisation segment with every table transposed, to go with
+// transposed coefficient blocks
+static void write_dqt_transposed(bit_writer_t *w, const uint8_t *seg, size_t len) {
+  uint8_t unzig[64];
+  for (int i = 0; i < 64; i++) {
+    unzig[zigzag[i]] = i;
+  }
+  bw_bytes(w, seg, 4);
+  for (size_t pos = 4; pos < len;) {
+    int width = (seg[pos] >> 4) ? 2 : 1;
+    const uint8_t *table = seg + pos + 1;
+    if (pos + 1 + 64 * width > len) {
+      bw_bytes(w, seg + pos, len - pos);
+      return;
+    }
+    bw_byte(w, seg[pos]);
+    for (int i = 0; i < 64; i++) {
+      int n = zigzag[i];
+      int src = unzig[(n % 8) * 8 + n / 8];
+      bw_bytes(w, table + src * width, width);
+    }
+    pos += 1 + 64 * width;
+  }
+}
+
+// Headers of the output: the input's tables and metadata, a new frame size,
+// the standard Huffman tables and no restart interval
+static void write_headers(jpeg_t *j, bit_writer_t *w, uint16_t width, uint16_t height, bool transpose) {
+  static const uint8_t soi[] = {0xFF, 0xD8};
+  bw_bytes(w, soi, sizeof(soi));
+  for (size_t pos = 2; pos < j->scan;) {
+    if (j->src[pos + 1] == 0xFF) {
+      pos++;
+      continue;
+    }
+    uint8_t marker = j->src[pos + 1];
+    size_t seg_len = be16(j->src + pos + 2);
+    if (marker == 0xDB && transpose) {
+      write_dqt_transposed(w, j->src + pos, 2 + seg_len);
+    } else if (marker != 0xC0 && marker != 0xC1 && marker != 0xC4 && marker != 0xDD && marker != 0xDA) {
+      bw_bytes(w, j->src + pos, 2 + seg_len);
+    }
+    pos += 2 + seg_len;
+  }
+
+  uint8_t seg[20];
+  uint8_t *p = seg;
+  *p++ = 0xFF;
+  *p++ = 0xC0;
+  *p++ = 0;
+  *p++ = 8 + 3 * j->ncomp;
+  *p++ = 8;
+  *p++ = height >> 8;
+  *p++ = height;
+  *p++ = width >> 8;
+  *p++ = width;
+  *p++ = j->ncomp;
+  for (int c = 0; c < j->ncomp; c++) {
+    *p++ = j->comp[c].id;
+    *p++ = transpose ? (j->comp[c].v << 4) | j->comp[c].h : (j->comp[c].h << 4) | j->comp[c].v;
+    *p++ = j->comp[c].tq;
+  }
+  bw_bytes(w, seg, p - seg);
+
+  for (int t = 0; t < (j->ncomp > 1 ? 2 : 1); t++) {
+    uint16_t len = 2 + 2 * 17 + sizeof(std_dc_vals) + sizeof(std_ac_vals[t]);
+    uint8_t hdr[] = {0xFF, 0xC4, (uint8_t)(len >> 8), (uint8_t)len};
+    bw_bytes(w, hdr, sizeof(hdr));
+    bw_byte(w, 0x00 | t);
+    bw_bytes(w, std_dc_bits[t], 16);
+    bw_bytes(w, std_dc_vals, sizeof(std_dc_vals));
+    bw_byte(w, 0x10 | t);
+    bw_bytes(w, std_ac_bits[t], 16);
+    bw_bytes(w, std_ac_vals[t], sizeof(std_ac_vals[t]));
+  }
+
+  p = seg;
+  *p++ = 0xFF;
+  *p++ = 0xDA;
+  *p++ = 0;
+  *p++ = 6 + 2 * j->ncomp;
+  *p++ = j->ncomp;
+  for (int c = 0; c < j->ncomp; c++) {
+    *p++ = j->comp[c].id;
+    *p++ = c ? 0x11 : 0x00;
+  }
+  *p++ = 0;
+  *p++ = 63;
+  *p++ = 0;
+  bw_bytes(w, seg, p - seg);
+}
+
+static jpeg_t *jpeg_open(const uint8_t *src, size_t len, esp_err_t *err) {
+  // One block: the headers, then the tables they point to
+  jpeg_t *j = (jpeg_t *)malloc(sizeof(jpeg_t) + sizeof(jpeg_tables_t));
+  if (!j) {
+    *err = ESP_ERR_NO_MEM;
+    return NULL;
+  }
+  jpeg_tables_t *tables = (jpeg_tables_t *)(j + 1);
+  j->dc = tables->dc;
+  j->ac = tables->ac;
+  j->enc_dc = tables->enc_dc;
+  j->enc_ac = tables->enc_ac;
+  *err = parse(j, src, len);
+  if (*err != ESP_OK) {
+    free(j);
+    return NULL;
+  }
+  for (int t = 0; t < 2; t++) {
+    huff_enc_build(&j->enc_dc[t], std_dc_bits[t], std_dc_vals);
+    huff_enc_build(&j->enc_ac[t], std_ac_bits[t], std_ac_vals[t]);
+  }
+  return j;
+}
+
+esp_err_t jpeg_info(const uint8_t *src, size_t len, jpeg_info_t *info) {
+  jpeg_t j;
+  j.dc = j.ac = NULL;
+  j.enc_dc = j.enc_ac = NULL;
+  esp_err_t err = parse(&j, src, len);
+  if (err == ESP_OK) {
+    *info = j.info;
+  }
+  return err;
+}
+
+bool jpeg_crop_align(const jpeg_info_t *info, jpeg_rect_t *rect) {
+  if (!rect->w || !rect->h || rect->x >= info->width || rect->y >= info->height) {
+    return false;
+  }
+  uint32_t x1 = (uint32_t)rect->x + rect->w;
+  uint32_t y1 = (uint32_t)rect->y + rect->h;
+  x1 = (x1 + info->mcu_width - 1) / info->mcu_width * info->mcu_width;
+  y1 = (y1 + info->mcu_height - 1) / info->mcu_height * info->mcu_height;
+  rect->x = rect->x / info->mcu_width * info->mcu_width;
+  rect->y = rect->y / info->mcu_height * info->mcu_height;
+  rect->w = (x1 < info->width ? x1 : info->width) - rect->x;
+  rect->h = (y1 < info->height ? y1 : info->height) - rect->y;
+  return true;
+}
+
+esp_err_t jpeg_crop(const uint8_t *src, size_t len, const jpeg_rect_t *rect, jpeg_sink_t sink, void *ctx) {
+  esp_err_t err;
+  jpeg_t *j = jpeg_open(src, len, &err);
+  if (!j) {
+    return err;
+  }
+  bit_writer_t *w = bw_create(sink, ctx);
+  if (!w) {
+    free(j);
+    return ESP_ERR_NO_MEM;
+  }
+
+  int mx0 = rect->x / j->info.mcu_width;
+  int my0 = rect->y / j->info.mcu_height;
+  int mx1 = (rect->x + rect->w + j->info.mcu_width - 1) / j->info.mcu_width;
+  int my1 = (rect->y + rect->h + j->info.mcu_height - 1) / j->info.mcu_height;
+  mx1 = mx1 < j->mcus_x ? mx1 : j->mcus_x;
+  my1 = my1 < j->mcus_y ? my1 : j->mcus_y;
+  write_headers(j, w, rect->w, rect->h, false);
+
+  bit_reader_t br;
+  br_init(&br, src + j->scan, src + len);
+  int pred[JPEG_MAX_COMPS] = {0};
+  int out_pred[JPEG_MAX_COMPS] = {0};
+  int16_t zz[64];
+  uint32_t restart = j->info.restart_interval;
+  uint32_t mcu = 0;
+  uint32_t first = (uint32_t)my0 * j->mcus_x;
+
+  // Whole restart intervals before the region are found by their markers
+  bool ok = true;
+  if (restart && first >= restart) {
+    uint32_t skip = first / restart;
+    for (const uint8_t *p = br.p; skip && p + 1 < br.end; p++) {
+      if (p[0] == 0xFF && p[1] >= 0xD0 && p[1] <= 0xD7 && !--skip) {
+        br_init(&br, p + 2, br.end);
+      }
+    }
+    ok = !skip;
+    mcu = first / restart * restart;
+  }
+  uint32_t start = mcu;
+
+  uint32_t last = (uint32_t)my1 * j->mcus_x;
+  for (; mcu < last && ok && w->ok; mcu++) {
+    if (restart && mcu != start && mcu % restart == 0) {
+      br_restart(&br);
+      memset(pred, 0, sizeof(pred));
+    }
+    int mx = mcu % j->mcus_x;
+    int my = mcu / j->mcus_x;
+    bool inside = mx >= mx0 && mx < mx1 && my >= my0;
+    for (int c = 0; c < j->ncomp && ok; c++) {
+      comp_t *k = &j->comp[c];
+      int t = c ? 1 : 0;
+      for (int b = 0; b < k->h * k->v && ok; b++) {
+        ok = decode_block(&br, &j->dc[k->td], &j->ac[k->ta], &pred[c], zz);
+        if (ok && inside) {
+          encode_block(w, zz, &out_pred[c], &j->enc_dc[t], &j->enc_ac[t]);
+        }
+      }
+    }
+  }
+  if (!ok) {
+    log_w("JPEG: bad entropy data at MCU %u", mcu);
+  }
+  ok = ok && bw_finish(w);
+  err = ok ? ESP_OK : (w->ok ? ESP_ERR_INVALID_SIZE : ESP_FAIL);
+  free(w);
+  free(j);
+  return err;
+}
+
+bool jpeg_transform_size(const jpeg_info_t *info, const jpeg_orient_t *orient, uint16_t *width, uint16_t *height) {
+  uint16_t w = info->width / info->mcu_width * info->mcu_width;
+  uint16_t h = info->height / info->mcu_height * info->mcu_height;
+  bool transpose = orient->rotate == 90 || orient->rotate == 270;
+  *width = transpose ? h : w;
+  *height = transpose ? w : h;
+  return w && h;
+}
+
+esp_err_t jpeg_transform(const uint8_t *src, size_t len, const jpeg_orient_t *orient, jpeg_sink_t sink, void *ctx) {
+  // Output block (x, y) comes from source block (u, v): swapped when
+  // transposing, then mirrored within the source
+  bool transpose = orient->rotate == 90 || orient->rotate == 270;
+  bool mirror_x = (orient->rotate == 180 || orient->rotate == 270) ^ orient->flip_h;
+  bool mirror_y = (orient->rotate == 90 || orient->rotate == 180) ^ orient->flip_v;
+
+  esp_err_t err;
+  jpeg_t *j = jpeg_open(src, len, &err);
+  if (!j) {
+    return err;
+  }
+  uint16_t out_w, out_h;
+  if (!jpeg_transform_size(&j->info, orient, &out_w, &out_h)) {
+    free(j);
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  // Where each block starts in the scan, and its DC value
+  size_t first[JPEG_MAX_COMPS];
+  int stride[JPEG_MAX_COMPS];
+  size_t blocks = 0;
+  for (int c = 0; c < j->ncomp; c++) {
+    first[c] = blocks;
+    stride[c] = j->mcus_x * j->comp[c].h;
+    blocks += (size_t)stride[c] * j->mcus_y * j->comp[c].v;
+  }
+  size_t bytes = blocks * (sizeof(uint32_t) + sizeof(int16_t));
+  uint32_t *pos = (uint32_t *)(psramFound() ? ps_malloc(bytes) : malloc(bytes));
+  bit_writer_t *w = bw_create(sink, ctx);
+  if (!pos || !w) {
+    log_e("JPEG: no memory to index %u blocks", blocks);
+    free(pos);
+    free(w);
+    free(j);
+    return ESP_ERR_NO_MEM;
+  }
+  int16_t *dc = (int16_t *)(pos + blocks);
+
+  const uint8_t *base = src + j->scan;
+  bit_reader_t br;
+  br_init(&br, base, src + len);
+  int pred[JPEG_MAX_COMPS] = {0};
+  int16_t zz[64];
+  bool ok = true;
+  uint32_t restart = j->info.restart_interval;
+  for (uint32_t mcu = 0; mcu < (uint32_t)j->mcus_x * j->mcus_y && ok; mcu++) {
+    if (restart && mcu && mcu % restart == 0) {
+      br_restart(&br);
+      memset(pred, 0, sizeof(pred));
+    }
+    int mx = mcu % j->mcus_x;
+    int my = mcu / j->mcus_x;
+    for (int c = 0; c < j->ncomp && ok; c++) {
+      comp_t *k = &j->comp[c];
+      for (int by = 0; by < k->v && ok; by++) {
+        for (int bx = 0; bx < k->h && ok; bx++) {
+          size_t i = first[c] + (size_t)(my * k->v + by) * stride[c] + mx * k->h + bx;
+          pos[i] = br_tell(&br, base);
+          ok = decode_block(&br, &j->dc[k->td], &j->ac[k->ta], &pred[c], zz);
+          dc[i] = zz[0];
+        }
+      }
+    }
+  }
+
+  // Coefficient (row, column) moves to (column, row) when transposing;
+  // mirroring negates the odd frequencies along that axis
+  uint8_t from[64];
+  bool negate[64];
+  uint8_t unzig[64];
+  for (int i = 0; i < 64; i++) {
+    unzig[zigzag[i]] = i;
+  }
+  for (int i = 0; i < 64; i++) {
+    int row = zigzag[i] / 8, col = zigzag[i] % 8;
+    int src_row = transpose ? col : row, src_col = transpose ? row : col;
+    from[i] = unzig[src_row * 8 + src_col];
+    negate[i] = (mirror_x && (src_col & 1)) ^ (mirror_y && (src_row & 1));
+  }
+
+  if (ok) {
+    write_headers(j, w, out_w, out_h, transpose);
+  }
+  int out_pred[JPEG_MAX_COMPS] = {0};
+  int16_t out[64];
+  int out_mcu_w = transpose ? j->info.mcu_height : j->info.mcu_width;
+  int out_mcu_h = transpose ? j->info.mcu_width : j->info.mcu_height;
+  int out_mcus_x = out_w / out_mcu_w;
+  int out_mcus_y = out_h / out_mcu_h;
+  for (int my = 0; my < out_mcus_y && ok && w->ok; my++) {
+    for (int mx = 0; mx < out_mcus_x && ok; mx++) {
+      for (int c = 0; c < j->ncomp && ok; c++) {
+        comp_t *k = &j->comp[c];
+        int out_hs = transpose ? k->v : k->h;  // sampling factors after the transform
+        int out_vs = transpose ? k->h : k->v;
+        // Source blocks of this component inside the trimmed image
+        int cols = j->info.width / j->info.mcu_width * k->h;
+        int rows = j->info.height / j->info.mcu_height * k->v;
+        int t = c ? 1 : 0;
+        for (int by = 0; by < out_vs && ok; by++) {
+          for (int bx = 0; bx < out_hs && ok; bx++) {
+            int x = mx * out_hs + bx, y = my * out_vs + by;
+            int u = transpose ? y : x, v = transpose ? x : y;
+            u = mirror_x ? cols - 1 - u : u;
+            v = mirror_y ? rows - 1 - v : v;
+            size_t i = first[c] + (size_t)v * stride[c] + u;
+            int ignored = 0;
+            br_seek(&br, base, src + len, pos[i]);
+            ok = decode_block(&br, &j->dc[k->td], &j->ac[k->ta], &ignored, zz);
+            zz[0] = dc[i];
+            for (int n = 0; n < 64; n++) {
+              out[n] = negate[n] ? -zz[from[n]] : zz[from[n]];
+            }
+            encode_block(w, out, &out_pred[c], &j->enc_dc[t], &j->enc_ac[t]);
+          }
+        }
+      }
+    }
+  }
+  if (!ok) {
+    log_w("JPEG: bad entropy data");
+  }
+  ok = ok && bw_finish(w);
+  err = ok ? ESP_OK : (w->ok ? ESP_ERR_INVALID_SIZE : ESP_FAIL);
+  free(pos);
+  free(w);
+  free(j);
+  return err;
+}
+
+esp_err_t jpeg_dc_grid(const uint8_t *src, size_t len, uint8_t *grid) {
+  esp_err_t err;
+  jpeg_t *j = jpeg_open(src, len, &err);
+  if (!j) {
+    return err;
+  }
+  int32_t sum[64] = {0};
+  uint32_t count[64] = {0};
+  comp_t *y = &j->comp[0];
+  int cols = j->mcus_x * y->h;
+  int rows = j->mcus_y * y->v;
+  int q = j->qdc[y->tq & 3];
+
+  bit_reader_t br;
+  br_init(&br, src + j->scan, src + len);
+  int pred[JPEG_MAX_COMPS] = {0};
+  int16_t zz[64];
+  bool ok = true;
+  uint32_t restart = j->info.restart_interval;
+  for (uint32_t mcu = 0; mcu < (uint32_t)j->mcus_x * j->mcus_y && ok; mcu++) {
+    if (restart && mcu && mcu % restart == 0) {
+      br_restart(&br);
+      memset(pred, 0, sizeof(pred));
+    }
+    int mx = mcu % j->mcus_x;
+    int my = mcu / j->mcus_x;
+    for (int c = 0; c < j->ncomp && ok; c++) {
+      comp_t *k = &j->comp[c];
+      for (int by = 0; by < k->v && ok; by++) {
+        for (int bx = 0; bx < k->h && ok; bx++) {
+          ok = decode_block(&br, &j->dc[k->td], &j->ac[k->ta], &pred[c], zz);
+          if (c == 0) {
+            int cell = (my * k->v + by) * 8 / rows * 8 + (mx * k->h + bx) * 8 / cols;
+            sum[cell] += zz[0];
+            count[cell]++;
+          }
+        }
+      }
+    }
+  }
+  free(j);
+  if (!ok) {
+    log_w("JPEG: bad entropy data");
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  // A block's DC is 8x its mean level shifted by -128
+  for (int i = 0; i < 64; i++) {
+    int level = count[i] ? 128 + sum[i] * q / 8 / (int32_t)count[i] : 0;
+    grid[i] = level < 0 ? 0 : (level > 255 ? 255 : level);
+  }
+  return ESP_OK;
+}
+
+uint64_t jpeg_grid_hash(const uint8_t *grid) {
+  uint32_t total = 0;
+  for (int i = 0; i < 64; i++) {
+    total += grid[i];
+  }
+  uint64_t h = 0;
+  for (int i = 0; i < 64; i++) {
+    if ((uint32_t)grid[i] * 64 > total) {
+      h |= 1ULL << i;
+    }
+  }
+  return h;
+}
+
+esp_err_t jpeg_dc_hash(const uint8_t *src, size_t len, uint64_t *hash) {
+  uint8_t grid[64];
+  esp_err_t err = jpeg_dc_grid(src, len, grid);
+  if (err == ESP_OK) {
+    *hash = jpeg_grid_hash(grid);
+  }
+  return err;
+}
@@ -0,0 +1,96 @@
+/*
+ * Compressed-domain JPEG transforms
+ *
+ * Baseline JPEGs (what the camera produces) are entropy-decoded into DCT
+ * coefficient blocks and Huffman-coded again, with no IDCT or DCT in
+ * between, so the coefficients, and with them the decoded pixels, stay
+ * exactly as they were. The output carries the standard Huffman tables
+ * (JPEG Annex K), the same ones the camera uses.
+ *
+ * Cropping works on whole MCUs (16x8 pixels for the camera's 4:2:2), so a
+ * region is widened to MCU edges first. MCUs below the region are never
+ * decoded, and when the image has restart markers neither are the
+ * intervals above it; time and output size follow the region, not the
+ * frame.
+ *
+ * Rotation and flips move whole blocks and transpose or negate the
+ * coefficients inside them (the jpegtran approach). Blocks are needed out
+ * of scan order, so a first pass records where each one starts and its DC
+ * value (6 bytes per block in PSRAM, under 600 KB for QXGA), and the
+ * second re-decodes them one at a time in output order. Partial MCUs at the
+ * right and bottom edges are trimmed, as jpegtran -trim does.
+ *
+ * The same decoder gives a coarse brightness map and a perceptual hash
+ * from the DC coefficients.
+ */
+
+#ifndef APP_JPEG_H
+#define APP_JPEG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define JPEG_MAX_COMPS  3
+#define JPEG_MAX_QTABLES 4
+
+typedef struct {
+  uint16_t width;
+  uint16_t height;
+  uint8_t components;
+  uint8_t sampling[JPEG_MAX_COMPS];  // (h << 4) | v of each component
+  uint8_t mcu_width;  // pixels
+  uint8_t mcu_height;
+  uint16_t restart_interval;  // MCUs, 0 = none
+  const uint8_t *qtables[JPEG_MAX_QTABLES];  // 8-bit tables, zig-zag order; NULL if absent or 16-bit
+  size_t scan;  // offset of the entropy-coded data
+} jpeg_info_t;
+
+typedef struct {
+  uint16_t x;
+  uint16_t y;
+  uint16_t w;
+  uint16_t h;
+} jpeg_rect_t;
+
+typedef struct {
+  uint16_t rotate;  // clockwise: 0, 90, 180 or 270
+  bool flip_h;      // applied before rotating
+  bool flip_v;
+} jpeg_orient_t;
+
+// Receives consecutive pieces of the output; false aborts
+typedef bool (*jpeg_sink_t)(void *ctx, const uint8_t *data, size_t len);
+
+// Size and layout of a baseline JPEG from its headers alone (src may end
+// at the start of scan); ESP_ERR_NOT_SUPPORTED for progressive or other
+// non-baseline files. Nothing is allocated, so it is cheap enough per frame.
+esp_err_t jpeg_info(const uint8_t *src, size_t len, jpeg_info_t *info);
+
+// Widen rect to MCU edges and clip it to the image; false when it misses
+// the image entirely
+bool jpeg_crop_align(const jpeg_info_t *info, jpeg_rect_t *rect);
+
+// Write the part of src covered by rect (aligned with jpeg_crop_align()
+// first) as a new JPEG
+esp_err_t jpeg_crop(const uint8_t *src, size_t len, const jpeg_rect_t *rect, jpeg_sink_t sink, void *ctx);
+
+// Output size of jpeg_transform(); false when nothing is left after trimming
+bool jpeg_transform_size(const jpeg_info_t *info, const jpeg_orient_t *orient, uint16_t *width, uint16_t *height);
+
+// Write src rotated and/or flipped as a new JPEG
+esp_err_t jpeg_transform(const uint8_t *src, size_t len, const jpeg_orient_t *orient, jpeg_sink_t sink, void *ctx);
+
+// Mean luminance (0-255) of each cell of an 8x8 grid over the image, row
+// by row, from the DC coefficients of the Y blocks alone: entropy decoding
+// only, no IDCT
+esp_err_t jpeg_dc_grid(const uint8_t *src, size_t len, uint8_t *grid);
+
+// 64-bit average hash of a grid: bit i is set when cell i is brighter than
+// the mean of all cells. Similar images have hashes a few bits apart.
+uint64_t jpeg_grid_hash(const uint8_t *grid);
+
+// jpeg_dc_grid() followed by jpeg_grid_hash()
+esp_err_t jpeg_dc_hash(const uint8_t *src, size_t len, uint64_t *hash);
+
+#endif  // APP_JPEG_H
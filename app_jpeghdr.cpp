@@ -0,0 +1,268 @@
+// JPEG header dictionary: one copy of each header set in /headers.bin
+#include "Arduino.h"
+#include "freertos/semphr.h"
+#include "app_jpeg.h"
+#include "app_jpeghdr.h"
+
+#define JPEGHDR_MAGIC   0x5244484A  // "JHDR"
+#define JPEGHDR_VERSION 1
+
+static const uint8_t stub_magic[4] = {'J', 'H', 'D', '1'};
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+} dict_header_t;
+
+typedef struct {
+  uint32_t hash;
+  uint16_t len;
+  const uint8_t *data;
+} header_set_t;
+
+static fs::FS *dict_fs = NULL;
+static header_set_t sets[JPEGHDR_MAX];
+static volatile size_t set_count = 0;  // sets[] below this are complete and never change
+static bool enabled = false;
+static SemaphoreHandle_t dict_lock = NULL;
+static uint32_t stubs = 0;  // images stored deduplicated since boot
+static uint64_t saved = 0;
+
+static uint32_t fnv1a(const uint8_t *data, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h = (h ^ data[i]) * 16777619u;
+  }
+  return h;
+}
+
+static uint8_t *dict_alloc(size_t len) {
+  return (uint8_t *)(psramFound() ? ps_malloc(len) : malloc(len));
+}
+
+static bool write_record(File &file, const uint8_t *data, uint16_t len) {
+  return file.write((const uint8_t *)&len, sizeof(len)) == sizeof(len) && file.write(data, len) == len;
+}
+
+// Replace the file with what is in memory, after a torn append. Written
+// beside the old file and renamed over it: every deduplicated image needs
+// the dictionary, so there is never a moment without a complete one.
+static bool rewrite_dict() {
+  File file = dict_fs->open(JPEGHDR_TEMP, FILE_WRITE);
+  if (!file) {
+    return false;
+  }
+  dict_header_t header = {JPEGHDR_MAGIC, JPEGHDR_VERSION, 0};
+  bool ok = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+  for (size_t i = 0; i < set_count && ok; i++) {
+    ok = write_record(file, sets[i].data, sets[i].len);
+  }
+  file.close();
+  // FAT cannot rename over a file; jpeghdr_load() finishes the job if
+  // power is lost in between
+  ok = ok && dict_fs->remove(JPEGHDR_PATH) && dict_fs->rename(JPEGHDR_TEMP, JPEGHDR_PATH);
+  if (!ok) {
+    log_e("Headers: cannot rewrite %s", JPEGHDR_PATH);
+  }
+  return ok;
+}
+
+static bool read_dict(bool *torn) {
+  *torn = false;
+  File file = dict_fs->open(JPEGHDR_PATH, FILE_READ);
+  if (!file) {
+    return true;  // nothing stored yet
+  }
+  dict_header_t header;
+  if (file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || header.magic != JPEGHDR_MAGIC || header.version != JPEGHDR_VERSION) {
+    log_e("Headers: %s has an unknown format", JPEGHDR_PATH);
+    file.close();
+    return false;
+  }
+  uint16_t len;
+  while (set_count < JPEGHDR_MAX && file.read((uint8_t *)&len, sizeof(len)) == sizeof(len)) {
+    uint8_t *data = len && len <= JPEGHDR_MAX_LEN ? dict_alloc(len) : NULL;
+    if (!data || file.read(data, len) != len) {
+      // Power loss in the middle of an append
+      free(data);
+      *torn = true;
+      break;
+    }
+    sets[set_count].hash = fnv1a(data, len);
+    sets[set_count].len = len;
+    sets[set_count].data = data;
+    set_count++;
+  }
+  *torn |= file.available() > 0;
+  file.close();
+  return true;
+}
+
+esp_err_t jpeghdr_load(fs::FS &fs, bool enable) {
+  if (!dict_lock) {
+    dict_lock = xSemaphoreCreateMutex();
+  }
+  dict_fs = &fs;
+  xSemaphoreTake(dict_lock, portMAX_DELAY);
+  // A repair that was cut short: complete when the old file is already gone,
+  // otherwise the old file is the one to trust
+  if (fs.exists(JPEGHDR_TEMP)) {
+    if (fs.exists(JPEGHDR_PATH)) {
+      fs.remove(JPEGHDR_TEMP);
+    } else {
+      fs.rename(JPEGHDR_TEMP, JPEGHDR_PATH);
+    }
+  }
+  bool torn;
+  bool ok = read_dict(&torn);
+  if (ok && torn) {
+    log_w("Headers: dropping a torn record from %s", JPEGHDR_PATH);
+    ok = rewrite_dict();
+  }
+  xSemaphoreGive(dict_lock);
+  // An unreadable dictionary must not be appended to, or ids would shift
+  enabled = enable && ok;
+  log_i("Headers: %u sets, deduplication %s", set_count, enabled ? "on" : "off");
+  return ok ? ESP_OK : ESP_FAIL;
+}
+
+bool jpeghdr_enabled() {
+  return enabled;
+}
+
+size_t jpeghdr_split(const uint8_t *jpeg, size_t len) {
+  jpeg_info_t info;
+  return jpeg_info(jpeg, len, &info) == ESP_OK ? info.scan : 0;
+}
+
+int jpeghdr_intern(const uint8_t *hdr, size_t len) {
+  if (!dict_lock || !len || len > JPEGHDR_MAX_LEN) {
+    return -1;
+  }
+  uint32_t hash = fnv1a(hdr, len);
+  xSemaphoreTake(dict_lock, portMAX_DELAY);
+  for (size_t i = 0; i < set_count; i++) {
+    if (sets[i].hash == hash && sets[i].len == len && !memcmp(sets[i].data, hdr, len)) {
+      xSemaphoreGive(dict_lock);
+      return i;
+    }
+  }
+  int id = -1;
+  uint8_t *data = set_count < JPEGHDR_MAX ? dict_alloc(len) : NULL;
+  if (data) {
+    memcpy(data, hdr, len);
+    // On the card before any image refers to it
+    File file = dict_fs->open(JPEGHDR_PATH, FILE_APPEND);
+    bool ok = file;
+    if (ok && file.size() == 0) {
+      dict_header_t header = {JPEGHDR_MAGIC, JPEGHDR_VERSION, 0};
+      ok = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+    }
+    ok = ok && write_record(file, data, len);
+    if (file) {
+      file.close();
+    }
+    if (ok) {
+      sets[set_count].hash = hash;
+      sets[set_count].len = len;
+      sets[set_count].data = data;
+      id = set_count++;
+      log_i("Headers: new set %d, %u bytes", id, len);
+    } else {
+      log_e("Headers: cannot append to %s", JPEGHDR_PATH);
+      free(data);
+    }
+  }
+  xSemaphoreGive(dict_lock);
+  return id;
+}
+
+const uint8_t *jpeghdr_get(uint16_t id, size_t *len) {
+  if (id >= set_count) {
+    return NULL;
+  }
+  *len = sets[id].len;
+  return sets[id].data;
+}
+
+bool jpeghdr_store(File &file, const uint8_t *jpeg, size_t len, bool *deduped) {
+  *deduped = false;
+  size_t hdr_len = enabled ? jpeghdr_split(jpeg, len) : 0;
+  int id = hdr_len ? jpeghdr_intern(jpeg, hdr_len) : -1;
+  if (id < 0) {
+    return file.write(jpeg, len) == len;
+  }
+  uint8_t stub[JPEGHDR_STUB_LEN];
+  memcpy(stub, stub_magic, sizeof(stub_magic));
+  stub[4] = id & 0xFF;
+  stub[5] = id >> 8;
+  stub[6] = hdr_len & 0xFF;
+  stub[7] = hdr_len >> 8;
+  size_t rest = len - hdr_len;
+  if (file.write(stub, sizeof(stub)) != sizeof(stub) || file.write(jpeg + hdr_len, rest) != rest) {
+    return false;
+  }
+  *deduped = true;
+  stubs++;
+  saved += hdr_len - JPEGHDR_STUB_LEN;
+  return true;
+}
+
+bool jpeghdr_parse_stub(const uint8_t *data, size_t len, uint16_t *id, size_t *hdr_len) {
+  if (len < JPEGHDR_STUB_LEN || memcmp(data, stub_magic, sizeof(stub_magic))) {
+    return false;
+  }
+  *id = data[4] | (data[5] << 8);
+  *hdr_len = data[6] | (data[7] << 8);
+  return true;
+}
+
+bool jpeghdr_open(File &file, const uint8_t **hdr, size_t *hdr_len, size_t *size) {
+  uint8_t stub[JPEGHDR_STUB_LEN];
+  uint16_t id;
+  size_t stub_hdr_len;
+  *hdr = NULL;
+  *hdr_len = 0;
+  *size = file.size();
+  size_t got = file.read(stub, sizeof(stub));
+  if (!jpeghdr_parse_stub(stub, got, &id, &stub_hdr_len)) {
+    return file.seek(0);
+  }
+  *hdr = jpeghdr_get(id, hdr_len);
+  if (!*hdr || *hdr_len != stub_hdr_len) {
+    log_e("Headers: %s needs unknown header set %u", file.name(), id);
+    *hdr = NULL;
+    return false;
+  }
+  *size = *size - JPEGHDR_STUB_LEN + *hdr_len;
+  return true;
+}
+
+uint8_t *jpeghdr_read_all(File &file, size_t *len) {
+  const uint8_t *hdr;
+  size_t hdr_len, size;
+  if (!jpeghdr_open(file, &hdr, &hdr_len, &size)) {
+    return NULL;
+  }
+  uint8_t *jpeg = (uint8_t *)(psramFound() ? ps_malloc(size) : malloc(size));
+  if (!jpeg) {
+    return NULL;
+  }
+  if (hdr) {
+    memcpy(jpeg, hdr, hdr_len);
+  }
+  if (file.read(jpeg + hdr_len, size - hdr_len) != size - hdr_len) {
+    free(jpeg);
+    return NULL;
+  }
+  *len = size;
+  return jpeg;
+}
+
+int jpeghdr_print_json(char *buf, size_t len) {
+  int n = snprintf(
+    buf, len, "{\"enabled\":%s,\"sets\":%u,\"deduped\":%u,\"saved\":%llu}", enabled ? "true" : "false", set_count, stubs, (unsigned long long)saved
+  );
+  return n < (int)len ? n : (len ? len - 1 : 0);
+}
@@ -0,0 +1,69 @@
+/*
+ * Shared JPEG header dictionary
+ *
+ * Every frame from the sensor starts with the same few hundred bytes of
+ * headers (SOI, APP0, DQT, SOF, DHT, SOS) until a setting such as the frame
+ * size or quality changes. With deduplication on, each distinct header set
+ * is written once to JPEGHDR_PATH and an image file holds an 8-byte stub
+ * naming its header set, followed by the scan data only. Readers splice the
+ * header back in front, so clients always receive standard JPEGs; the
+ * catalog keeps recording the size of that full JPEG.
+ *
+ * Header sets stay in PSRAM for good and are never moved, so they can be
+ * sent straight from the dictionary. Files written without deduplication
+ * remain readable alongside deduplicated ones. An image file with a stub
+ * cannot be viewed without the dictionary, so /headers.bin must be kept
+ * with the images when copying the card.
+ */
+
+#ifndef APP_JPEGHDR_H
+#define APP_JPEGHDR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "FS.h"
+
+#define JPEGHDR_PATH     "/headers.bin"
+#define JPEGHDR_TEMP     "/headers.new"  // repairs are written here first
+#define JPEGHDR_MAX      32    // distinct header sets; once full, frames are stored whole
+#define JPEGHDR_MAX_LEN  2048  // longer headers are not deduplicated
+#define JPEGHDR_STUB_LEN 8     // "JHD1", u16 header id, u16 header length (little endian)
+
+// Read the dictionary from the card. With enable, later jpeghdr_store()
+// calls write stubs; without, existing stubs are still understood.
+esp_err_t jpeghdr_load(fs::FS &fs, bool enable);
+bool jpeghdr_enabled();
+
+// Length of the headers at the front of jpeg, up to and including the SOS
+// segment; 0 when it is not a baseline JPEG (those are stored whole)
+size_t jpeghdr_split(const uint8_t *jpeg, size_t len);
+
+// Id of a header set, adding it to the dictionary when new; -1 when the
+// dictionary is full or cannot be written
+int jpeghdr_intern(const uint8_t *hdr, size_t len);
+
+// Header set by id, NULL if unknown
+const uint8_t *jpeghdr_get(uint16_t id, size_t *len);
+
+// Write jpeg to file, as stub + scan data when possible; false on a short
+// write
+bool jpeghdr_store(File &file, const uint8_t *jpeg, size_t len, bool *deduped);
+
+// Whether data (the first bytes of a file, at least JPEGHDR_STUB_LEN) is a
+// stub; fills in the header id and length
+bool jpeghdr_parse_stub(const uint8_t *data, size_t len, uint16_t *id, size_t *hdr_len);
+
+// Prepare an image file for reading: *size is the full JPEG size. For a
+// stub, *hdr and *hdr_len are the header to put in front and the file is
+// left after the stub; otherwise *hdr is NULL and the file is at its start.
+// false when the stub names a header set the dictionary does not have.
+bool jpeghdr_open(File &file, const uint8_t **hdr, size_t *hdr_len, size_t *size);
+
+// Whole JPEG in a new buffer (PSRAM when available), header included;
+// NULL on a read error or no memory. Free it with free().
+uint8_t *jpeghdr_read_all(File &file, size_t *len);
+
+int jpeghdr_print_json(char *buf, size_t len);
+
+#endif  // APP_JPEGHDR_H
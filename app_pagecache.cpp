@@ -0,0 +1,183 @@
+// LRU cache of rendered gallery pages in PSRAM
+#include <stdarg.h>
+#include "Arduino.h"
+#include "esp_heap_caps.h"
+#include "app_pagecache.h"
+
+typedef struct {
+  char *html;  // NULL when the slot is free
+  size_t len;
+  uint16_t page;
+  uint16_t per;
+  uint32_t generation;
+  size_t count;  // catalog entries when rendered
+  uint32_t last_used;
+} page_entry_t;
+
+static page_entry_t entries[PAGECACHE_MAX_ENTRIES];
+static size_t cached_bytes = 0;
+static uint32_t use_clock = 0;
+static uint32_t hits = 0;
+static uint32_t rekeys = 0;
+static uint32_t misses = 0;
+static uint32_t evictions = 0;
+
+static void *page_realloc(void *ptr, size_t size) {
+  if (psramFound()) {
+    return heap_caps_realloc(ptr, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  }
+  return realloc(ptr, size);
+}
+
+static bool page_buf_reserve(page_buf_t *out, size_t extra) {
+  if (out->failed) {
+    return false;
+  }
+  if (out->len + extra + 1 <= out->cap) {
+    return true;
+  }
+  size_t cap = out->cap ? out->cap : 1024;
+  while (cap < out->len + extra + 1) {
+    cap *= 2;
+  }
+  char *grown = (char *)page_realloc(out->buf, cap);
+  if (!grown) {
+    log_e("Page cache: cannot grow page to %u bytes", cap);
+    out->failed = true;
+    return false;
+  }
+  out->buf = grown;
+  out->cap = cap;
+  return true;
+}
+
+bool page_buf_init(page_buf_t *out, size_t initial) {
+  out->buf = NULL;
+  out->len = 0;
+  out->cap = 0;
+  out->failed = false;
+  return page_buf_reserve(out, initial);
+}
+
+void page_buf_append(page_buf_t *out, const char *str) {
+  size_t n = strlen(str);
+  if (page_buf_reserve(out, n)) {
+    memcpy(out->buf + out->len, str, n + 1);
+    out->len += n;
+  }
+}
+
+void page_buf_printf(page_buf_t *out, const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(NULL, 0, fmt, args);
+  va_end(args);
+  if (n < 0 || !page_buf_reserve(out, n)) {
+    return;
+  }
+  va_start(args, fmt);
+  vsnprintf(out->buf + out->len, out->cap - out->len, fmt, args);
+  va_end(args);
+  out->len += n;
+}
+
+void page_buf_free(page_buf_t *out) {
+  free(out->buf);
+  out->buf = NULL;
+  out->len = 0;
+  out->cap = 0;
+}
+
+static void drop(page_entry_t *e) {
+  cached_bytes -= e->len;
+  free(e->html);
+  e->html = NULL;
+  e->len = 0;
+}
+
+static uint32_t page_count(size_t count, uint16_t per) {
+  return (count + per - 1) / per;
+}
+
+const char *page_cache_find(uint16_t page, uint16_t per, uint32_t generation, size_t count, size_t *len) {
+  for (int i = 0; i < PAGECACHE_MAX_ENTRIES; i++) {
+    page_entry_t *e = &entries[i];
+    if (!e->html || e->page != page || e->per != per) {
+      continue;
+    }
+    if (e->generation != generation) {
+      // Every append bumps the generation and the count by one; anything
+      // else (a reload) means the entry cannot be trusted
+      bool appended_only = generation - e->generation == count - e->count;
+      if (page == 1 || !appended_only || page_count(e->count, per) != page_count(count, per)) {
+        drop(e);
+        break;
+      }
+      e->generation = generation;
+      e->count = count;
+      rekeys++;
+    }
+    hits++;
+    e->last_used = ++use_clock;
+    *len = e->len;
+    return e->html;
+  }
+  misses++;
+  return NULL;
+}
+
+void page_cache_store(uint16_t page, uint16_t per, uint32_t generation, size_t count, page_buf_t *out) {
+  if (out->failed || !out->buf || out->len > PAGECACHE_MAX_BYTES) {
+    page_buf_free(out);
+    return;
+  }
+  page_entry_t *slot = NULL;
+  for (int i = 0; i < PAGECACHE_MAX_ENTRIES; i++) {
+    if (entries[i].html && entries[i].page == page && entries[i].per == per) {
+      drop(&entries[i]);
+    }
+  }
+  while (true) {
+    page_entry_t *lru = NULL;
+    slot = NULL;
+    for (int i = 0; i < PAGECACHE_MAX_ENTRIES; i++) {
+      page_entry_t *e = &entries[i];
+      if (!e->html) {
+        slot = slot ? slot : e;
+      } else if (!lru || e->last_used < lru->last_used) {
+        lru = e;
+      }
+    }
+    if (slot && cached_bytes + out->len <= PAGECACHE_MAX_BYTES) {
+      break;
+    }
+    drop(lru);
+    evictions++;
+  }
+
+  // Give back the unused tail of the render buffer
+  char *html = (char *)page_realloc(out->buf, out->len + 1);
+  slot->html = html ? html : out->buf;
+  slot->len = out->len;
+  slot->page = page;
+  slot->per = per;
+  slot->generation = generation;
+  slot->count = count;
+  slot->last_used = ++use_clock;
+  cached_bytes += out->len;
+  out->buf = NULL;
+  out->len = 0;
+  out->cap = 0;
+}
+
+int page_cache_print_json(char *buf, size_t len) {
+  int used = 0;
+  for (int i = 0; i < PAGECACHE_MAX_ENTRIES; i++) {
+    used += entries[i].html ? 1 : 0;
+  }
+  int n = snprintf(
+    buf, len, "{\"entries\":%d,\"bytes\":%u,\"hits\":%u,\"rekeys\":%u,\"misses\":%u,\"evictions\":%u}", used, cached_bytes, hits, rekeys, misses,
+    evictions
+  );
+  return n < (int)len ? n : (len ? len - 1 : 0);
+}
@@ -0,0 +1,50 @@
+/*
+ * Rendered gallery page cache
+ *
+ * /gallery pages are rendered once into a PSRAM buffer and then served with
+ * a single send until the catalog changes under them. Entries are keyed by
+ * (page, per, catalog generation) and bounded by an LRU on both entry count
+ * and total bytes.
+ *
+ * Gallery pages are aligned to the oldest image, so appending a frame only
+ * changes page 1 (and adds a page whenever page 1 fills up). A lookup that
+ * misses on the generation therefore re-keys an older entry instead of
+ * dropping it, as long as the catalog only grew by appends since it was
+ * rendered and the page count is unchanged.
+ *
+ * Only the camera_httpd task renders and serves pages, so the cache has no
+ * locking.
+ */
+
+#ifndef APP_PAGECACHE_H
+#define APP_PAGECACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PAGECACHE_MAX_ENTRIES 8
+#define PAGECACHE_MAX_BYTES   (192 * 1024)
+
+// Growable output buffer a page is rendered into
+typedef struct {
+  char *buf;
+  size_t len;
+  size_t cap;
+  bool failed;  // an allocation failed, the page is incomplete
+} page_buf_t;
+
+bool page_buf_init(page_buf_t *out, size_t initial);
+void page_buf_append(page_buf_t *out, const char *str);
+void page_buf_printf(page_buf_t *out, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void page_buf_free(page_buf_t *out);
+
+// Cached page for the current catalog state, or NULL. The returned buffer
+// stays valid until the next page_cache_store().
+const char *page_cache_find(uint16_t page, uint16_t per, uint32_t generation, size_t count, size_t *len);
+
+// Hand a rendered page to the cache; out is emptied either way
+void page_cache_store(uint16_t page, uint16_t per, uint32_t generation, size_t count, page_buf_t *out);
+
+int page_cache_print_json(char *buf, size_t len);
+
+#endif  // APP_PAGECACHE_H
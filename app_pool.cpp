@@ -0,0 +1,115 @@
+// Fixed-size block pools
+#include "Arduino.h"
+#include "esp_heap_caps.h"
+#include "app_pool.h"
+
+typedef struct {
+  uint32_t block_size;
+  uint8_t count;  // at most 32, one bit each in used
+  pool_mem_t mem;
+  uint8_t *base;
+  uint32_t used;
+  uint8_t in_use;
+  uint8_t peak;
+  uint32_t allocs;
+} pool_class_t;
+
+// Smallest first within each memory type
+static pool_class_t classes[] = {
+  {256, 16, POOL_INTERNAL}, {1024, 6, POOL_INTERNAL}, {4096, 3, POOL_INTERNAL}, {4096, 16, POOL_PSRAM}, {32768, 4, POOL_PSRAM},
+};
+#define CLASS_COUNT (sizeof(classes) / sizeof(classes[0]))
+
+static portMUX_TYPE pool_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t fallbacks = 0;
+static uint32_t fallback_bytes_peak = 0;
+
+static uint32_t mem_caps(pool_mem_t mem) {
+  if (mem == POOL_PSRAM && psramFound()) {
+    return MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+  }
+  return MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT | MALLOC_CAP_DMA;
+}
+
+bool pool_init() {
+  bool ok = true;
+  for (size_t i = 0; i < CLASS_COUNT; i++) {
+    pool_class_t *c = &classes[i];
+    if (c->base) {
+      continue;
+    }
+    // Without PSRAM the PSRAM classes stay empty and requests use the heap
+    if (c->mem == POOL_PSRAM && !psramFound()) {
+      c->count = 0;
+      continue;
+    }
+    c->base = (uint8_t *)heap_caps_malloc(c->block_size * c->count, mem_caps(c->mem));
+    if (!c->base) {
+      log_e("Pool: cannot reserve %u x %u bytes", c->count, c->block_size);
+      c->count = 0;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+void *pool_alloc(size_t size, pool_mem_t mem) {
+  if (mem == POOL_PSRAM && !psramFound()) {
+    mem = POOL_INTERNAL;
+  }
+  portENTER_CRITICAL(&pool_mux);
+  for (size_t i = 0; i < CLASS_COUNT; i++) {
+    pool_class_t *c = &classes[i];
+    if (!c->base || c->mem != mem || c->block_size < size || c->in_use == c->count) {
+      continue;
+    }
+    int bit = __builtin_ctz(~c->used);
+    c->used |= 1UL << bit;
+    c->allocs++;
+    if (++c->in_use > c->peak) {
+      c->peak = c->in_use;
+    }
+    portEXIT_CRITICAL(&pool_mux);
+    return c->base + bit * c->block_size;
+  }
+  fallbacks++;
+  if (size > fallback_bytes_peak) {
+    fallback_bytes_peak = size;
+  }
+  portEXIT_CRITICAL(&pool_mux);
+  return heap_caps_malloc(size, mem_caps(mem));
+}
+
+void pool_free(void *p) {
+  if (!p) {
+    return;
+  }
+  uint8_t *ptr = (uint8_t *)p;
+  portENTER_CRITICAL(&pool_mux);
+  for (size_t i = 0; i < CLASS_COUNT; i++) {
+    pool_class_t *c = &classes[i];
+    if (c->base && ptr >= c->base && ptr < c->base + c->block_size * c->count) {
+      c->used &= ~(1UL << ((ptr - c->base) / c->block_size));
+      c->in_use--;
+      portEXIT_CRITICAL(&pool_mux);
+      return;
+    }
+  }
+  portEXIT_CRITICAL(&pool_mux);
+  heap_caps_free(p);
+}
+
+int pool_print_json(char *buf, size_t len) {
+  size_t n = snprintf(buf, len, "{\"fallbacks\":%u,\"fallback_peak\":%u,\"classes\":[", fallbacks, fallback_bytes_peak);
+  for (size_t i = 0; i < CLASS_COUNT && n < len; i++) {
+    const pool_class_t *c = &classes[i];
+    n += snprintf(
+      buf + n, len - n, "%s{\"size\":%u,\"mem\":\"%s\",\"count\":%u,\"used\":%u,\"peak\":%u,\"allocs\":%u}", i ? "," : "", c->block_size,
+      c->mem == POOL_PSRAM ? "psram" : "internal", c->count, c->in_use, c->peak, c->allocs
+    );
+  }
+  if (n < len) {
+    n += snprintf(buf + n, len - n, "]}");
+  }
+  return n < len ? n : (len ? len - 1 : 0);
+}
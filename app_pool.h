@@ -0,0 +1,32 @@
+/*
+ * Fixed-size block pools
+ *
+ * Request handlers used to malloc()/free() query strings, read buffers and
+ * page state on every hit, which fragments the internal heap over days of
+ * uptime until large allocations (camera, WiFi, TLS) start failing. The
+ * pools carve a few size classes out of internal RAM and PSRAM once at
+ * boot; blocks are handed out from a bitmap and never return to the heap.
+ * When a class is exhausted the allocation falls back to the heap and is
+ * counted, so /metrics shows whether the classes are sized right.
+ */
+
+#ifndef APP_POOL_H
+#define APP_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  POOL_INTERNAL = 0,  // DMA-capable, for SD and socket buffers
+  POOL_PSRAM,         // large or long-lived data; internal RAM without PSRAM
+} pool_mem_t;
+
+// Reserve the pool memory. Called once at boot, before the web server.
+bool pool_init();
+
+void *pool_alloc(size_t size, pool_mem_t mem);
+void pool_free(void *p);
+
+int pool_print_json(char *buf, size_t len);
+
+#endif  // APP_POOL_H
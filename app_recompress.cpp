@@ -0,0 +1,351 @@
+// Idle-time recompression of frames past a configurable age
+#include "Arduino.h"
+#include "freertos/task.h"
+#include "img_converters.h"
+#include "app_boot.h"
+#include "app_catalog.h"
+#include "app_clock.h"
+#include "app_jpeg.h"
+#include "app_jpeghdr.h"
+#include "app_recompress.h"
+#include "app_recorder.h"
+#include "app_sensor.h"
+#include "app_transcode.h"
+
+#define RECOMPRESS_MAGIC       0x504D4352  // "RCMP"
+#define RECOMPRESS_VERSION     1
+#define RECOMPRESS_IDLE_MS     60000       // between looks for frames that have come of age
+#define RECOMPRESS_BUSY_MS     1000        // wait while the recorder has frames queued
+#define RECOMPRESS_PAUSE_MS    50          // after each frame, so idle tasks get to run
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t cursor;  // next seq to look at
+  uint32_t frames;  // frames replaced, all time
+  uint64_t reclaimed;  // card bytes, all time
+} recompress_state_t;
+
+static fs::FS *recompress_fs = NULL;
+static TaskHandle_t recompressor = NULL;
+static recompress_state_t state = {RECOMPRESS_MAGIC, RECOMPRESS_VERSION, 0, 0, 0, 0};
+static uint32_t kept = 0;      // not smaller when recompressed, left as they were
+static uint32_t failures = 0;
+static portMUX_TYPE recompress_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t *scratch = NULL;  // RGB565 at the reduced size
+static size_t scratch_size = 0;
+static size_t too_big = 0;  // smallest scratch ps_malloc refused since the last idle spell
+
+static volatile int age_hours = RECOMPRESS_AGE_H;
+static volatile int quality = RECOMPRESS_QUALITY;
+static volatile int scale = RECOMPRESS_SCALE;
+
+static void load_state() {
+  File file = recompress_fs->open(RECOMPRESS_STATE_PATH, FILE_READ);
+  if (!file) {
+    return;
+  }
+  recompress_state_t saved;
+  if (file.read((uint8_t *)&saved, sizeof(saved)) == sizeof(saved) && saved.magic == RECOMPRESS_MAGIC && saved.version == RECOMPRESS_VERSION) {
+    state = saved;
+  } else {
+    // Starting over only costs a pass over the catalog: done frames are flagged
+    log_w("Recompress: ignoring unreadable %s", RECOMPRESS_STATE_PATH);
+  }
+  file.close();
+}
+
+// Index first, so a saved position never runs ahead of the catalog
+static void checkpoint() {
+  if (catalog_sync() != ESP_OK) {
+    return;
+  }
+  portENTER_CRITICAL(&recompress_mux);
+  recompress_state_t copy = state;
+  portEXIT_CRITICAL(&recompress_mux);
+  File file = recompress_fs->open(RECOMPRESS_STATE_PATH, FILE_WRITE);
+  bool ok = file && file.write((const uint8_t *)&copy, sizeof(copy)) == sizeof(copy);
+  if (file) {
+    file.close();
+  }
+  if (!ok) {
+    log_e("Recompress: cannot write %s", RECOMPRESS_STATE_PATH);
+  }
+}
+
+static bool encode(const uint8_t *jpeg, size_t len, uint8_t s, int q, uint8_t **out, size_t *out_len) {
+  jpeg_info_t info;
+  if (jpeg_info(jpeg, len, &info) != ESP_OK) {
+    return false;
+  }
+  uint16_t w, h;
+  size_t need;
+  while (true) {
+    transcode_scaled_size(info.width, info.height, s, &w, &h);
+    need = (size_t)w * h * 2;
+    if (need <= scratch_size) {
+      break;
+    }
+    if (!too_big || need < too_big) {
+      free(scratch);
+      scratch = (uint8_t *)ps_malloc(need);
+      scratch_size = scratch ? need : 0;
+      if (scratch) {
+        break;
+      }
+      too_big = need;
+      log_w("Recompress: cannot allocate %u bytes for 1/%u size", need, s);
+    }
+    if (s >= 8) {
+      return false;
+    }
+    // rc_scale 1 at QXGA wants 6 MB; reduce further rather than fail every frame
+    s *= 2;
+  }
+  return jpg2rgb565(jpeg, len, scratch, transcode_jpg_scale(s)) && fmt2jpg(scratch, need, w, h, PIXFORMAT_RGB565, q, out, out_len);
+}
+
+static void count(uint32_t *counter) {
+  portENTER_CRITICAL(&recompress_mux);
+  (*counter)++;
+  portEXIT_CRITICAL(&recompress_mux);
+}
+
+// Replace one frame: 1 when the catalog changed, 0 when not, -1 when a
+// reader pinned the frame meanwhile and it has to wait
+static int recompress(const catalog_entry_t *entry) {
+  char path[32], temp[32];
+  catalog_path(entry->seq, path, sizeof(path));
+  strcpy(temp, path);
+  strcpy(strrchr(temp, '.'), ".new");
+
+  File file = recompress_fs->open(path, FILE_READ);
+  if (!file && recompress_fs->exists(temp)) {
+    // Power was lost between removing the old file and renaming the new one
+    log_w("Recompress: completing %s", path);
+    recompress_fs->rename(temp, path);
+    file = recompress_fs->open(path, FILE_READ);
+  }
+  if (!file) {
+    count(&failures);
+    return 0;
+  }
+  size_t card_size = file.size();
+  size_t len;
+  uint8_t *jpeg = jpeghdr_read_all(file, &len);
+  file.close();
+  if (!jpeg) {
+    count(&failures);
+    return 0;
+  }
+  uint16_t flags = (entry->flags & ~CATALOG_FLAG_DEDUP) | CATALOG_FLAG_RECOMPRESSED;
+  if (len != entry->size) {
+    // Replaced before a power loss, the index had not caught up; a file
+    // shorter on the card than the JPEG is a header stub
+    free(jpeg);
+    if (!catalog_replace_begin(entry->seq)) {
+      return -1;
+    }
+    catalog_replace(entry->seq, len, flags | (card_size != len ? CATALOG_FLAG_DEDUP : 0));
+    catalog_replace_end();
+    return 1;
+  }
+
+  uint8_t *out = NULL;
+  size_t out_len = 0;
+  bool ok = encode(jpeg, len, scale, quality, &out, &out_len);
+  free(jpeg);
+  if (!ok) {
+    log_e("Recompress: cannot transcode %s", path);
+    count(&failures);
+    return 0;
+  }
+  if (out_len >= len) {
+    // Already small (a dark or plain scene); flag it so it is not tried again
+    free(out);
+    catalog_replace(entry->seq, entry->size, flags | (entry->flags & CATALOG_FLAG_DEDUP));
+    count(&kept);
+    return 1;
+  }
+
+  File dst = recompress_fs->open(temp, FILE_WRITE);
+  bool deduped = false;
+  ok = dst && jpeghdr_store(dst, out, out_len, &deduped);
+  size_t new_size = dst ? dst.size() : 0;
+  if (dst) {
+    dst.close();
+  }
+  free(out);
+  // Readers of the frame keep it as it was; the encode is done again later
+  if (ok && !catalog_replace_begin(entry->seq)) {
+    recompress_fs->remove(temp);
+    return -1;
+  }
+  // FAT cannot rename over the old file, it has to go first
+  bool removed = ok && recompress_fs->remove(path);
+  if (!removed) {
+    if (ok) {
+      catalog_replace_end();
+    }
+    recompress_fs->remove(temp);
+    log_e("Recompress: cannot replace %s", path);
+    count(&failures);
+    return 0;
+  }
+  if (!recompress_fs->rename(temp, path)) {
+    // Retried from the .new file on the next pass over this frame
+    catalog_replace_end();
+    log_e("Recompress: cannot rename %s", temp);
+    count(&failures);
+    return 0;
+  }
+  catalog_replace(entry->seq, out_len, flags | (deduped ? CATALOG_FLAG_DEDUP : 0));
+  catalog_replace_end();
+  portENTER_CRITICAL(&recompress_mux);
+  state.frames++;
+  state.reclaimed += card_size > new_size ? card_size - new_size : 0;
+  portEXIT_CRITICAL(&recompress_mux);
+  log_d("Recompress: %s %u -> %u bytes", path, card_size, new_size);
+  return 1;
+}
+
+static void recompress_task(void *arg) {
+  if (!boot_wait(BOOT_DEP(BOOT_STAGE_STORAGE), portMAX_DELAY) || !catalog_ready()) {
+    log_e("Recompress: storage unavailable, recompression disabled");
+    vTaskDelete(NULL);
+    return;
+  }
+  load_state();
+  log_i("Recompress: resuming at seq %u", state.cursor);
+
+  int changed = 0;
+  uint32_t saved_cursor = state.cursor;
+  while (true) {
+    uint32_t now = time(NULL);
+    int age = age_hours;
+    catalog_entry_t entry;
+    bool due = age > 0 && clock_valid(now) && catalog_get(catalog_lower_bound_seq(state.cursor), &entry)
+               && entry.time + (uint32_t)age * 3600 <= now;
+    if (!due) {
+      // Caught up: save progress and give the decode buffer back
+      if (changed || saved_cursor != state.cursor) {
+        checkpoint();
+        changed = 0;
+        saved_cursor = state.cursor;
+      }
+      free(scratch);
+      scratch = NULL;
+      scratch_size = 0;
+      too_big = 0;
+      ulTaskNotifyTake(pdTRUE, RECOMPRESS_IDLE_MS / portTICK_PERIOD_MS);
+      continue;
+    }
+    recorder_stats_t rec;
+    recorder_get_stats(&rec);
+    // Also wait while the frame is being played back or exported
+    if (rec.ring_used || catalog_pinned(entry.seq)) {
+      vTaskDelay(RECOMPRESS_BUSY_MS / portTICK_PERIOD_MS);
+      continue;
+    }
+
+    // Frames from before the clock was set have no age to go by
+    bool worked = clock_valid(entry.time) && !(entry.flags & CATALOG_FLAG_RECOMPRESSED);
+    int result = worked ? recompress(&entry) : 0;
+    if (result < 0) {
+      vTaskDelay(RECOMPRESS_BUSY_MS / portTICK_PERIOD_MS);
+      continue;
+    }
+    changed += result;
+    portENTER_CRITICAL(&recompress_mux);
+    state.cursor = entry.seq + 1;
+    portEXIT_CRITICAL(&recompress_mux);
+    if (changed >= RECOMPRESS_SYNC_FRAMES) {
+      checkpoint();
+      changed = 0;
+      saved_cursor = state.cursor;
+    }
+    if (worked) {
+      vTaskDelay(RECOMPRESS_PAUSE_MS / portTICK_PERIOD_MS);
+    }
+  }
+}
+
+static void wake() {
+  if (recompressor) {
+    xTaskNotifyGive(recompressor);
+  }
+}
+
+static int set_rc_age(sensor_t *s, int val) {
+  if (val < 0 || val > 24 * 366) {
+    return -1;
+  }
+  age_hours = val;
+  wake();
+  return 0;
+}
+
+static int get_rc_age(sensor_t *s) {
+  return age_hours;
+}
+
+static int set_rc_quality(sensor_t *s, int val) {
+  if (val < 1 || val > 100) {
+    return -1;
+  }
+  quality = val;
+  return 0;
+}
+
+static int get_rc_quality(sensor_t *s) {
+  return quality;
+}
+
+static int set_rc_scale(sensor_t *s, int val) {
+  if (val != 1 && val != 2 && val != 4 && val != 8) {
+    return -1;
+  }
+  scale = val;
+  return 0;
+}
+
+static int get_rc_scale(sensor_t *s) {
+  return scale;
+}
+
+static const sensor_ctrl_t recompress_controls[] = {
+  {"rc_age", CTRL_STAGE_LOCAL, set_rc_age, get_rc_age},              // hours, 0 = off
+  {"rc_quality", CTRL_STAGE_LOCAL, set_rc_quality, get_rc_quality},  // 1-100
+  {"rc_scale", CTRL_STAGE_LOCAL, set_rc_scale, get_rc_scale},        // 1, 2, 4 or 8
+};
+
+bool recompress_start(fs::FS &fs) {
+  if (recompressor) {
+    return true;
+  }
+  if (!psramFound()) {
+    log_w("Recompress: no PSRAM, old footage is kept as recorded");
+    return false;
+  }
+  recompress_fs = &fs;
+  sensor_ctrl_register(recompress_controls, sizeof(recompress_controls) / sizeof(recompress_controls[0]));
+  // Below the recorder and the web server: only spare CPU time is used
+  if (xTaskCreate(recompress_task, "recompress", 4096, NULL, 1, &recompressor) != pdPASS) {
+    log_e("Recompress: cannot create task");
+    return false;
+  }
+  return true;
+}
+
+int recompress_print_json(char *buf, size_t len) {
+  portENTER_CRITICAL(&recompress_mux);
+  recompress_state_t s = state;
+  uint32_t k = kept, f = failures;
+  portEXIT_CRITICAL(&recompress_mux);
+  int n = snprintf(
+    buf, len, "{\"enabled\":%s,\"age_h\":%d,\"quality\":%d,\"scale\":%d,\"cursor\":%u,\"frames\":%u,\"kept\":%u,\"failures\":%u,\"reclaimed\":%llu}",
+    recompressor ? "true" : "false", age_hours, quality, scale, s.cursor, s.frames, k, f, (unsigned long long)s.reclaimed
+  );
+  return n < (int)len ? n : (len ? len - 1 : 0);
+}
@@ -0,0 +1,44 @@
+/*
+ * Background recompression of aging footage
+ *
+ * Fresh frames are stored as the sensor delivers them. Once a frame is
+ * older than rc_age hours, a low-priority task decodes it at 1/rc_scale of
+ * its size and encodes it again at rc_quality (fmt2jpg's 1-100 scale,
+ * unrelated to the sensor's jpeg_quality), so the card holds weeks of old
+ * footage in the space days took. The task runs below the recorder and the
+ * web server and pauses while the recorder has frames waiting for the card.
+ *
+ * A frame is replaced by writing /img_N.new, removing /img_N.jpg and
+ * renaming the new file into place; the catalog entry changes at the same
+ * moment and gets CATALOG_FLAG_RECOMPRESSED, so it is never done twice.
+ * Frames pinned by a playback or export wait until it is over, so sizes
+ * never change under a response that announced them.
+ * Every RECOMPRESS_SYNC_FRAMES the catalog index is rewritten and the
+ * position saved to RECOMPRESS_STATE_PATH. After a power loss the task
+ * resumes there: a frame whose file no longer matches its catalog size was
+ * already replaced and only its entry is updated, and a frame caught
+ * between remove and rename gets its /img_N.new renamed.
+ *
+ * Needs PSRAM for the decoded frame (1.5 MB for QXGA at rc_scale 2).
+ */
+
+#ifndef APP_RECOMPRESS_H
+#define APP_RECOMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "FS.h"
+
+#define RECOMPRESS_STATE_PATH  "/recompress.bin"
+#define RECOMPRESS_AGE_H       48   // rc_age default, 0 = off
+#define RECOMPRESS_QUALITY     30   // rc_quality default
+#define RECOMPRESS_SCALE       2    // rc_scale default: 1, 2, 4 or 8
+#define RECOMPRESS_SYNC_FRAMES 100  // index rewrite and checkpoint interval
+
+// Start the recompression task (storage may still be coming up). false
+// without PSRAM.
+bool recompress_start(fs::FS &fs);
+
+int recompress_print_json(char *buf, size_t len);
+
+#endif  // APP_RECOMPRESS_H
@@ -0,0 +1,364 @@
+// Background recorder: camera -> PSRAM ring -> SD card
+#include "Arduino.h"
+#include "esp_camera.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "app_boot.h"
+#include "app_catalog.h"
+#include "app_clock.h"
+#include "app_events.h"
+#include "app_frame.h"
+#include "app_jpeg.h"
+#include "app_recorder.h"
+#include "app_schedule.h"
+#include "app_sensor.h"
+#include "app_similar.h"
+#include "app_summary.h"
+
+// Ring buffer that holds captured frames until they are written out.
+// Sized for a handful of QXGA frames, which covers the time it takes to
+// mount the card at boot and the occasional slow SD write later on.
+#define RECORDER_RING_PSRAM (1024 * 1024)
+#define RECORDER_RING_DRAM  (96 * 1024)
+
+#define RING_WRAP 0xFFFFFFFF
+
+// Frames whose hash is at most this many bits from the last stored frame's
+// are not stored (rec_still, -1 = store everything)
+#define RECORDER_STILL_DISTANCE 2
+
+typedef struct {
+  uint32_t len;   // JPEG bytes following the header, RING_WRAP = jump to start
+  uint32_t time;  // unix seconds
+  uint16_t msec;
+  uint16_t reserved;
+} ring_frame_t;
+
+static uint8_t *ring = NULL;
+static size_t ring_size = 0;
+static size_t ring_head = 0;  // next write position
+static size_t ring_tail = 0;  // next read position
+static size_t ring_used = 0;  // includes bytes skipped at the end on wrap
+static portMUX_TYPE ring_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t writer_task = NULL;
+static schedule_t *schedule = NULL;
+static volatile bool storage_down = false;
+static recorder_stats_t stats;
+static volatile int still_distance = RECORDER_STILL_DISTANCE;
+static bool kept_valid = false;  // kept_hash/kept_seq describe the last stored frame
+static uint64_t kept_hash = 0;
+static uint32_t kept_seq = 0;
+
+static size_t ring_align(size_t n) {
+  return (n + 3) & ~3;
+}
+
+// Copy one frame into the ring. Called from the capture task only.
+static bool ring_push(const camera_fb_t *fb, uint32_t time, uint16_t msec) {
+  size_t need = ring_align(sizeof(ring_frame_t) + fb->len);
+  size_t pos, wasted = 0;
+
+  portENTER_CRITICAL(&ring_mux);
+  pos = ring_head;
+  if (pos + need > ring_size) {
+    wasted = ring_size - pos;
+    pos = 0;
+  }
+  bool fits = ring_used + wasted + need <= ring_size;
+  portEXIT_CRITICAL(&ring_mux);
+
+  if (!fits) {
+    return false;
+  }
+
+  if (wasted >= sizeof(ring_frame_t)) {
+    ((ring_frame_t *)(ring + ring_head))->len = RING_WRAP;
+  }
+  ring_frame_t *hdr = (ring_frame_t *)(ring + pos);
+  hdr->len = fb->len;
+  hdr->time = time;
+  hdr->msec = msec;
+  hdr->reserved = 0;
+  memcpy(ring + pos + sizeof(ring_frame_t), fb->buf, fb->len);
+
+  portENTER_CRITICAL(&ring_mux);
+  ring_head = pos + need;
+  ring_used += wasted + need;
+  if (ring_used > stats.ring_peak) {
+    stats.ring_peak = ring_used;
+  }
+  portEXIT_CRITICAL(&ring_mux);
+  return true;
+}
+
+// Oldest frame in the ring, or NULL if it is empty. Called from the writer only.
+static ring_frame_t *ring_peek() {
+  portENTER_CRITICAL(&ring_mux);
+  if (!ring_used) {
+    portEXIT_CRITICAL(&ring_mux);
+    return NULL;
+  }
+  size_t skip = ring_size - ring_tail;
+  if (skip < sizeof(ring_frame_t) || ((ring_frame_t *)(ring + ring_tail))->len == RING_WRAP) {
+    ring_tail = 0;
+    ring_used -= skip;
+  }
+  ring_frame_t *hdr = (ring_frame_t *)(ring + ring_tail);
+  portEXIT_CRITICAL(&ring_mux);
+  return hdr;
+}
+
+static void ring_pop(ring_frame_t *hdr) {
+  size_t len = ring_align(sizeof(ring_frame_t) + hdr->len);
+  portENTER_CRITICAL(&ring_mux);
+  // ring_head belongs to the capture task, which may be copying a frame to
+  // it right now; an empty ring just carries on from where it is
+  ring_tail += len;
+  ring_used -= len;
+  portEXIT_CRITICAL(&ring_mux);
+}
+
+// Whether the frame looks like the last stored one; grid and hash are set
+// either way
+static bool still(const ring_frame_t *hdr, uint8_t *grid, uint64_t *hash, bool *hashed) {
+  int distance = still_distance;
+  *hashed = distance >= 0 && jpeg_dc_grid((const uint8_t *)(hdr + 1), hdr->len, grid) == ESP_OK;
+  if (*hashed) {
+    *hash = jpeg_grid_hash(grid);
+  }
+  return *hashed && kept_valid && __builtin_popcountll(*hash ^ kept_hash) <= distance;
+}
+
+static bool write_frame(const ring_frame_t *hdr) {
+  uint8_t grid[64];
+  uint64_t hash;
+  bool hashed;
+  if (still(hdr, grid, &hash, &hashed) && catalog_mark_still(kept_seq, hdr->time) == ESP_OK) {
+    stats.suppressed++;
+    return true;
+  }
+  catalog_entry_t entry;
+  if (catalog_store((const uint8_t *)(hdr + 1), hdr->len, hdr->time, hdr->msec, 0, &entry) != ESP_OK) {
+    return false;
+  }
+  // Compared against the stored frame, not the previous one, so a slow
+  // drift still ends a still period
+  kept_valid = hashed;
+  kept_hash = hash;
+  kept_seq = entry.seq;
+  if (hashed) {
+    similar_hint(entry.seq, hash);
+    summary_hint(entry.seq, grid);
+  }
+  stats.stored++;
+  char filename[32];
+  catalog_path(entry.seq, filename, sizeof(filename));
+  log_i("Saved %s (%u bytes)", filename, hdr->len);
+  events_publish(
+    "recording", "{\"seq\":%u,\"name\":\"%s\",\"size\":%u,\"time\":%u,\"msec\":%u}", entry.seq, filename + 1, entry.size, entry.time, entry.msec
+  );
+  return true;
+}
+
+static void recorder_writer_task(void *arg) {
+  // Frames pile up in the ring until the card is mounted and indexed
+  if (!boot_wait(BOOT_DEP(BOOT_STAGE_STORAGE), portMAX_DELAY)) {
+    log_e("Recorder: storage unavailable, recording disabled");
+    storage_down = true;
+    vTaskDelete(NULL);
+    return;
+  }
+
+  while (true) {
+    ring_frame_t *hdr = ring_peek();
+    if (!hdr) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      continue;
+    }
+    if (!write_frame(hdr)) {
+      stats.failed++;
+    }
+    ring_pop(hdr);
+  }
+}
+
+static void recorder_capture_task(void *arg) {
+  while (!storage_down) {
+    int64_t deadline = schedule_wait(schedule);
+
+    // The frame that started nearest the deadline, not whatever is buffered
+    frame_t *frame = frame_get_since(deadline - frame_interval_us() / 2, 5000 / portTICK_PERIOD_MS);
+    if (!frame) {
+      log_e("Camera capture failed");
+      stats.failed++;
+      continue;
+    }
+    camera_fb_t *fb = frame->fb;
+    boot_mark_first_frame();
+
+    // Before SNTP the clock reads time since boot; the catalog wants 0 then
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    int64_t wall_us = 0;
+    if (clock_valid(now.tv_sec)) {
+      wall_us = (int64_t)now.tv_sec * 1000000 + now.tv_usec - (esp_timer_get_time() - frame->captured_us);
+    }
+    if (ring_push(fb, wall_us / 1000000, (wall_us / 1000) % 1000)) {
+      stats.captured++;
+      xTaskNotifyGive(writer_task);
+    } else {
+      stats.dropped++;
+      log_w("Recorder ring full, dropped %ux%u frame (%u bytes)", fb->width, fb->height, fb->len);
+    }
+    frame_release(frame);
+  }
+  vTaskDelete(NULL);
+}
+
+static void reconfigure(void (*change)(schedule_config_t *c, int val), int val) {
+  schedule_config_t c;
+  schedule_get_config(schedule, &c);
+  change(&c, val);
+  schedule_configure(schedule, &c);
+}
+
+static void change_interval(schedule_config_t *c, int val) {
+  c->interval_ms = val;
+}
+
+static void change_policy(schedule_config_t *c, int val) {
+  c->policy = val ? SCHEDULE_CATCH_UP : SCHEDULE_SKIP;
+}
+
+static void change_align(schedule_config_t *c, int val) {
+  c->align = val;
+}
+
+static void change_hours(schedule_config_t *c, int val) {
+  c->hours = val;
+}
+
+static int set_rec_interval(sensor_t *s, int val) {
+  if (val < SCHEDULE_MIN_INTERVAL_MS) {
+    return -1;
+  }
+  reconfigure(change_interval, val);
+  return 0;
+}
+
+static int get_rec_interval(sensor_t *s) {
+  schedule_config_t c;
+  schedule_get_config(schedule, &c);
+  return c.interval_ms;
+}
+
+static int set_rec_policy(sensor_t *s, int val) {
+  reconfigure(change_policy, val);
+  return 0;
+}
+
+static int get_rec_policy(sensor_t *s) {
+  schedule_config_t c;
+  schedule_get_config(schedule, &c);
+  return c.policy;
+}
+
+static int set_rec_align(sensor_t *s, int val) {
+  reconfigure(change_align, val != 0);
+  return 0;
+}
+
+static int get_rec_align(sensor_t *s) {
+  schedule_config_t c;
+  schedule_get_config(schedule, &c);
+  return c.align;
+}
+
+static int set_rec_hours(sensor_t *s, int val) {
+  if (val < 0 || val > SCHEDULE_ALL_HOURS) {
+    return -1;
+  }
+  reconfigure(change_hours, val);
+  return 0;
+}
+
+static int get_rec_hours(sensor_t *s) {
+  schedule_config_t c;
+  schedule_get_config(schedule, &c);
+  return c.hours;
+}
+
+static int set_rec_still(sensor_t *s, int val) {
+  if (val < -1 || val > 64) {
+    return -1;
+  }
+  still_distance = val;
+  return 0;
+}
+
+static int get_rec_still(sensor_t *s) {
+  return still_distance;
+}
+
+static const sensor_ctrl_t recorder_controls[] = {
+  {"rec_interval", CTRL_STAGE_LOCAL, set_rec_interval, get_rec_interval},  // ms
+  {"rec_policy", CTRL_STAGE_LOCAL, set_rec_policy, get_rec_policy},        // 0 = skip, 1 = catch up
+  {"rec_align", CTRL_STAGE_LOCAL, set_rec_align, get_rec_align},           // on wall-clock multiples
+  {"rec_hours", CTRL_STAGE_LOCAL, set_rec_hours, get_rec_hours},           // bit n = local hour n
+  {"rec_still", CTRL_STAGE_LOCAL, set_rec_still, get_rec_still},           // hash bits, -1 = off
+};
+
+bool recorder_start(uint32_t interval_ms) {
+  if (ring) {
+    return true;
+  }
+  ring_size = psramFound() ? RECORDER_RING_PSRAM : RECORDER_RING_DRAM;
+  ring = (uint8_t *)(psramFound() ? ps_malloc(ring_size) : malloc(ring_size));
+  if (!ring) {
+    log_e("Recorder: cannot allocate %u byte ring", ring_size);
+    return false;
+  }
+  stats.ring_size = ring_size;
+  schedule_config_t config = {interval_ms, SCHEDULE_SKIP, false, SCHEDULE_ALL_HOURS};
+  schedule = schedule_create(&config);
+  if (!schedule) {
+    return false;
+  }
+  sensor_ctrl_register(recorder_controls, sizeof(recorder_controls) / sizeof(recorder_controls[0]));
+
+  if (xTaskCreate(recorder_writer_task, "rec_write", 4096, NULL, 3, &writer_task) != pdPASS
+      || xTaskCreate(recorder_capture_task, "rec_capture", 4096, NULL, 4, NULL) != pdPASS) {
+    log_e("Recorder: cannot create tasks");
+    return false;
+  }
+  return true;
+}
+
+void recorder_get_stats(recorder_stats_t *out) {
+  portENTER_CRITICAL(&ring_mux);
+  *out = stats;
+  out->ring_used = ring_used;
+  portEXIT_CRITICAL(&ring_mux);
+}
+
+int recorder_print_json(char *buf, size_t len) {
+  recorder_stats_t s;
+  recorder_get_stats(&s);
+  uint32_t seen = s.stored + s.suppressed;
+  int n = snprintf(
+    buf, len,
+    "{\"captured\":%u,\"stored\":%u,\"suppressed\":%u,\"suppressed_pct\":%u,\"dropped\":%u,\"failed\":%u,\"ring_size\":%u,\"ring_used\":%u,\"ring_peak\":%u",
+    s.captured, s.stored, s.suppressed, seen ? s.suppressed * 100 / seen : 0, s.dropped, s.failed, s.ring_size, s.ring_used, s.ring_peak
+  );
+  if (schedule && n < (int)len) {
+    n += snprintf(buf + n, len - n, ",\"schedule\":");
+  }
+  if (schedule && n < (int)len) {
+    n += schedule_print_json(schedule, buf + n, len - n);
+  }
+  if (n < (int)len) {
+    n += snprintf(buf + n, len - n, "}");
+  }
+  return n < (int)len ? n : (len ? len - 1 : 0);
+}
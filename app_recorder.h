@@ -0,0 +1,36 @@
+/*
+ * Background recorder
+ *
+ * A capture task copies frames into a PSRAM ring as soon as the camera is up;
+ * a separate writer task drains the ring to the SD card once storage is
+ * ready. Frames captured while the card is still mounting are kept, not lost.
+ * Captures follow an app_schedule deadline grid, tunable at run time through
+ * the rec_* controls. Frames that look the same as the last stored one (by
+ * a 64-bit DC hash) are not stored; the catalog notes until when the scene
+ * stayed still instead.
+ */
+
+#ifndef APP_RECORDER_H
+#define APP_RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  uint32_t captured;  // frames taken from the camera
+  uint32_t stored;    // frames written to the card
+  uint32_t suppressed;  // frames not written because the scene had not changed
+  uint32_t dropped;   // frames lost because the ring was full
+  uint32_t failed;    // capture or write errors
+  size_t ring_size;
+  size_t ring_used;
+  size_t ring_peak;
+} recorder_stats_t;
+
+// Start capturing every interval_ms. Storage may still be coming up.
+bool recorder_start(uint32_t interval_ms);
+
+void recorder_get_stats(recorder_stats_t *stats);
+int recorder_print_json(char *buf, size_t len);
+
+#endif  // APP_RECORDER_H
@@ -0,0 +1,555 @@
+// RTSP server, RTP/JPEG packetization per RFC 2435
+#include "Arduino.h"
+#include "esp_random.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "app_frame.h"
+#include "app_jpeg.h"
+#include "app_rtsp.h"
+
+#define RTSP_RX_MAX      1024
+#define RTSP_TIMEOUT_S   60    // advertised session timeout
+#define RTP_MAX_PACKET   1400  // RTP header + JPEG headers + payload
+#define RTP_PT_JPEG      26
+#define RTP_CLOCK_HZ     90000
+
+typedef struct {
+  jpeg_info_t info;
+  uint8_t type;  // RFC 2435 type, +64 when restart markers are present
+  uint8_t qtable_count;
+  const uint8_t *scan;  // entropy-coded data, up to but excluding EOI
+  size_t scan_len;
+} rtp_jpeg_t;
+
+typedef struct {
+  int sock;  // RTSP connection, -1 = free slot
+  uint32_t id;
+  bool playing;
+  bool tcp;         // RTP interleaved on the RTSP connection
+  uint8_t channel;  // interleaved RTP channel
+  int udp;          // RTP socket for UDP transport
+  struct sockaddr_in peer;
+  uint16_t rtp_seq;
+  uint32_t ssrc;
+  uint32_t ts_offset;
+  unsigned long last_seen;
+  size_t rx_len;
+  char rx[RTSP_RX_MAX];
+} rtsp_session_t;
+
+static rtsp_session_t sessions[RTSP_MAX_SESSIONS];
+static int listen_sock = -1;
+
+static uint16_t be16(const uint8_t *p) {
+  return (p[0] << 8) | p[1];
+}
+
+static void put16(uint8_t *p, uint16_t v) {
+  p[0] = v >> 8;
+  p[1] = v;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+// Only baseline 4:2:2 and 4:2:0 frames with 8-bit tables can be described
+// by an RFC 2435 header
+static bool describe_jpeg(const uint8_t *buf, size_t len, rtp_jpeg_t *j) {
+  memset(j, 0, sizeof(*j));
+  const jpeg_info_t *info = &j->info;
+  if (jpeg_info(buf, len, &j->info) != ESP_OK || info->components != 3) {
+    return false;
+  }
+  // Y, Cb, Cr with both chroma planes subsampled
+  if (info->sampling[1] != 0x11 || info->sampling[2] != 0x11) {
+    return false;
+  }
+  if (info->sampling[0] == 0x21) {
+    j->type = 0;
+  } else if (info->sampling[0] == 0x22) {
+    j->type = 1;
+  } else {
+    return false;
+  }
+  for (int t = 0; t < JPEG_MAX_QTABLES; t++) {
+    if (info->qtables[t]) {
+      j->qtable_count = t + 1;
+    }
+  }
+  if (!info->qtables[0] || !info->qtables[1]) {
+    return false;
+  }
+  j->scan = buf + info->scan;
+  j->scan_len = len - info->scan;
+  // The sensor pads frames; stop at the last EOI
+  while (j->scan_len >= 2 && !(j->scan[j->scan_len - 2] == 0xFF && j->scan[j->scan_len - 1] == 0xD9)) {
+    j->scan_len--;
+  }
+  if (j->scan_len >= 2) {
+    j->scan_len -= 2;
+  }
+  if (info->restart_interval) {
+    j->type += 64;
+  }
+  return j->scan_len > 0;
+}
+
+static void close_session(rtsp_session_t *ss) {
+  if (ss->sock >= 0) {
+    close(ss->sock);
+  }
+  if (ss->udp >= 0) {
+    close(ss->udp);
+  }
+  log_i("RTSP: session %08X closed", ss->id);
+  ss->sock = -1;
+  ss->udp = -1;
+  ss->playing = false;
+}
+
+// One RTP packet: headers from hdr, payload straight from the frame buffer
+static bool send_packet(rtsp_session_t *ss, uint8_t *hdr, size_t hdr_len, const uint8_t *payload, size_t payload_len) {
+  struct iovec iov[2];
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  iov[0].iov_base = hdr;
+  iov[0].iov_len = hdr_len;
+  iov[1].iov_base = (void *)payload;
+  iov[1].iov_len = payload_len;
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+
+  if (ss->tcp) {
+    put16(hdr + 2, hdr_len - 4 + payload_len);
+    return sendmsg(ss->sock, &msg, 0) == (ssize_t)(hdr_len + payload_len);
+  }
+  msg.msg_name = &ss->peer;
+  msg.msg_namelen = sizeof(ss->peer);
+  // A lost UDP packet (or an ICMP error from a closed port) is not fatal
+  sendmsg(ss->udp, &msg, 0);
+  return true;
+}
+
+static bool send_frame(rtsp_session_t *ss, const rtp_jpeg_t *j, uint32_t timestamp) {
+  uint8_t hdr[4 + 12 + 8 + 4 + 4 + 64 * JPEG_MAX_QTABLES];
+  size_t offset = 0;
+
+  while (offset < j->scan_len) {
+    uint8_t *p = hdr;
+    if (ss->tcp) {
+      p[0] = '$';
+      p[1] = ss->channel;
+      p += 4;  // length filled in by send_packet()
+    }
+
+    uint8_t *rtp = p;
+    rtp[0] = 0x80;  // version 2
+    rtp[1] = RTP_PT_JPEG;
+    put16(rtp + 2, ss->rtp_seq++);
+    put32(rtp + 4, timestamp);
+    put32(rtp + 8, ss->ssrc);
+    p += 12;
+
+    p[0] = 0;  // type-specific
+    p[1] = offset >> 16;
+    p[2] = offset >> 8;
+    p[3] = offset;
+    p[4] = j->type;
+    p[5] = 255;  // tables in-band
+    p[6] = j->info.width > 2040 || j->info.height > 2040 ? 0 : j->info.width / 8;
+    p[7] = j->info.width > 2040 || j->info.height > 2040 ? 0 : j->info.height / 8;
+    p += 8;
+
+    if (j->info.restart_interval) {
+      put16(p, j->info.restart_interval);
+      put16(p + 2, 0xFFFF);  // F = L = 1, count 0x3FFF: whole intervals are not tracked
+      p += 4;
+    }
+    if (offset == 0) {
+      p[0] = 0;  // MBZ
+      p[1] = 0;  // all tables 8-bit
+      put16(p + 2, 64 * j->qtable_count);
+      p += 4;
+      for (int t = 0; t < j->qtable_count; t++) {
+        if (j->info.qtables[t]) {
+          memcpy(p, j->info.qtables[t], 64);
+        } else {
+          memset(p, 1, 64);
+        }
+        p += 64;
+      }
+    }
+
+    size_t hdr_len = p - hdr;
+    size_t room = RTP_MAX_PACKET - (hdr_len - (ss->tcp ? 4 : 0));
+    size_t chunk = j->scan_len - offset < room ? j->scan_len - offset : room;
+    if (offset + chunk == j->scan_len) {
+      rtp[1] |= 0x80;  // marker: last packet of the frame
+    }
+    if (!send_packet(ss, hdr, hdr_len, j->scan + offset, chunk)) {
+      return false;
+    }
+    offset += chunk;
+  }
+  return true;
+}
+
+static void stream_frame(const frame_t *frame) {
+  static bool warned = false;
+  rtp_jpeg_t j;
+  if (frame->fb->format != PIXFORMAT_JPEG || !describe_jpeg(frame->fb->buf, frame->fb->len, &j)) {
+    if (!warned) {
+      log_w("RTSP: frame cannot be sent as RTP/JPEG (format %u)", frame->fb->format);
+      warned = true;
+    }
+    return;
+  }
+  uint32_t timestamp = (uint32_t)(frame->captured_us * (RTP_CLOCK_HZ / 1000) / 1000);
+  for (int i = 0; i < RTSP_MAX_SESSIONS; i++) {
+    rtsp_session_t *ss = &sessions[i];
+    if (ss->sock >= 0 && ss->playing && !send_frame(ss, &j, timestamp + ss->ts_offset)) {
+      log_w("RTSP: send failed, dropping session %08X", ss->id);
+      close_session(ss);
+    }
+  }
+}
+
+// Value of header name in a NUL-terminated request, or NULL
+static const char *header_value(const char *req, const char *name, char *out, size_t len) {
+  size_t name_len = strlen(name);
+  for (const char *line = strstr(req, "\r\n"); line; line = strstr(line, "\r\n")) {
+    line += 2;
+    if (!strncasecmp(line, name, name_len) && line[name_len] == ':') {
+      const char *v = line + name_len + 1;
+      while (*v == ' ') {
+        v++;
+      }
+      size_t n = strcspn(v, "\r\n");
+      if (n >= len) {
+        n = len - 1;
+      }
+      memcpy(out, v, n);
+      out[n] = 0;
+      return out;
+    }
+  }
+  return NULL;
+}
+
+static void reply(rtsp_session_t *ss, int cseq, const char *status, const char *headers, const char *body) {
+  char buf[1024];
+  int n = snprintf(buf, sizeof(buf), "RTSP/1.0 %s\r\nCSeq: %d\r\nServer: esp32-cam\r\n%s", status, cseq, headers ? headers : "");
+  if (body) {
+    n += snprintf(buf + n, sizeof(buf) - n, "Content-Length: %u\r\n\r\n%s", strlen(body), body);
+  } else {
+    n += snprintf(buf + n, sizeof(buf) - n, "\r\n");
+  }
+  if (n >= (int)sizeof(buf)) {
+    n = sizeof(buf) - 1;
+  }
+  send(ss->sock, buf, n, 0);
+}
+
+static void describe(rtsp_session_t *ss, int cseq, const char *url) {
+  char ip[16] = "0.0.0.0";
+  struct sockaddr_in local;
+  socklen_t local_len = sizeof(local);
+  if (getsockname(ss->sock, (struct sockaddr *)&local, &local_len) == 0) {
+    inet_ntop(AF_INET, &local.sin_addr, ip, sizeof(ip));
+  }
+
+  char dims[48] = "";
+  sensor_t *s = esp_camera_sensor_get();
+  if (s && s->status.framesize < FRAMESIZE_INVALID) {
+    const resolution_info_t *r = &resolution[s->status.framesize];
+    if (r->width > 2040 || r->height > 2040) {
+      snprintf(dims, sizeof(dims), "a=x-dimensions:%u,%u\r\n", r->width, r->height);
+    }
+  }
+
+  char sdp[384];
+  snprintf(
+    sdp, sizeof(sdp),
+    "v=0\r\n"
+    "o=- %u 1 IN IP4 %s\r\n"
+    "s=ESP32-CAM\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "t=0 0\r\n"
+    "a=control:*\r\n"
+    "m=video 0 RTP/AVP %u\r\n"
+    "a=control:track1\r\n"
+    "%s",
+    ss->id, ip, RTP_PT_JPEG, dims
+  );
+  char headers[192];
+  snprintf(headers, sizeof(headers), "Content-Type: application/sdp\r\nContent-Base: %s/\r\n", url);
+  reply(ss, cseq, "200 OK", headers, sdp);
+}
+
+static void setup(rtsp_session_t *ss, int cseq, const char *req) {
+  char transport[128];
+  char headers[192];
+  if (!header_value(req, "Transport", transport, sizeof(transport))) {
+    reply(ss, cseq, "461 Unsupported Transport", NULL, NULL);
+    return;
+  }
+
+  const char *interleaved = strstr(transport, "interleaved=");
+  const char *client_port = strstr(transport, "client_port=");
+  if (strstr(transport, "RTP/AVP/TCP")) {
+    ss->tcp = true;
+    ss->channel = interleaved ? atoi(interleaved + 12) : 0;
+    snprintf(
+      headers, sizeof(headers), "Transport: RTP/AVP/TCP;unicast;interleaved=%u-%u;ssrc=%08X\r\nSession: %08X;timeout=%u\r\n", ss->channel, ss->channel + 1,
+      ss->ssrc, ss->id, RTSP_TIMEOUT_S
+    );
+  } else if (client_port) {
+    int rtp_port = atoi(client_port + 12);
+    uint16_t server_port = RTSP_RTP_PORT + 2 * (ss - sessions);
+    socklen_t peer_len = sizeof(ss->peer);
+    getpeername(ss->sock, (struct sockaddr *)&ss->peer, &peer_len);
+    ss->peer.sin_port = htons(rtp_port);
+
+    if (ss->udp < 0) {
+      ss->udp = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+      struct sockaddr_in addr;
+      memset(&addr, 0, sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_port = htons(server_port);
+      addr.sin_addr.s_addr = htonl(INADDR_ANY);
+      if (ss->udp < 0 || bind(ss->udp, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        log_e("RTSP: cannot bind UDP port %u", server_port);
+        reply(ss, cseq, "500 Internal Server Error", NULL, NULL);
+        return;
+      }
+    }
+    ss->tcp = false;
+    snprintf(
+      headers, sizeof(headers), "Transport: RTP/AVP;unicast;client_port=%u-%u;server_port=%u-%u;ssrc=%08X\r\nSession: %08X;timeout=%u\r\n", rtp_port,
+      rtp_port + 1, server_port, server_port + 1, ss->ssrc, ss->id, RTSP_TIMEOUT_S
+    );
+  } else {
+    reply(ss, cseq, "461 Unsupported Transport", NULL, NULL);
+    return;
+  }
+  reply(ss, cseq, "200 OK", headers, NULL);
+}
+
+// Returns false when the connection should be closed
+static bool handle_request(rtsp_session_t *ss, const char *req) {
+  char method[16] = "";
+  char url[128] = "";
+  char value[24];
+  char headers[160];
+  sscanf(req, "%15s %127s", method, url);
+  int cseq = header_value(req, "CSeq", value, sizeof(value)) ? atoi(value) : 0;
+  snprintf(headers, sizeof(headers), "Session: %08X;timeout=%u\r\n", ss->id, RTSP_TIMEOUT_S);
+  log_i("RTSP: %s %s", method, url);
+
+  if (!strcmp(method, "OPTIONS")) {
+    reply(ss, cseq, "200 OK", "Public: OPTIONS, DESCRIBE, SETUP, PLAY, PAUSE, TEARDOWN, GET_PARAMETER, SET_PARAMETER\r\n", NULL);
+  } else if (!strcmp(method, "DESCRIBE")) {
+    describe(ss, cseq, url);
+  } else if (!strcmp(method, "SETUP")) {
+    setup(ss, cseq, req);
+  } else if (!strcmp(method, "PLAY")) {
+    if (!ss->tcp && ss->udp < 0) {
+      reply(ss, cseq, "455 Method Not Valid in This State", NULL, NULL);
+      return true;
+    }
+    strncat(headers, "Range: npt=0.000-\r\n", sizeof(headers) - strlen(headers) - 1);
+    reply(ss, cseq, "200 OK", headers, NULL);
+    ss->playing = true;
+  } else if (!strcmp(method, "PAUSE")) {
+    ss->playing = false;
+    reply(ss, cseq, "200 OK", headers, NULL);
+  } else if (!strcmp(method, "TEARDOWN")) {
+    reply(ss, cseq, "200 OK", headers, NULL);
+    return false;
+  } else if (!strcmp(method, "GET_PARAMETER") || !strcmp(method, "SET_PARAMETER")) {
+    reply(ss, cseq, "200 OK", headers, NULL);  // keep-alive
+  } else {
+    reply(ss, cseq, "501 Not Implemented", NULL, NULL);
+  }
+  return true;
+}
+
+// Returns false when the connection should be closed
+static bool handle_input(rtsp_session_t *ss) {
+  int n = recv(ss->sock, ss->rx + ss->rx_len, sizeof(ss->rx) - 1 - ss->rx_len, 0);
+  if (n <= 0) {
+    return false;
+  }
+  ss->rx_len += n;
+  ss->last_seen = millis();
+
+  while (ss->rx_len) {
+    size_t used;
+    if (ss->rx[0] == '$') {
+      // Interleaved RTCP receiver report from the client; not needed
+      if (ss->rx_len < 4) {
+        break;
+      }
+      used = 4 + be16((uint8_t *)ss->rx + 2);
+      if (used > sizeof(ss->rx) - 1) {
+        return false;
+      }
+      if (ss->rx_len < used) {
+        break;
+      }
+    } else {
+      ss->rx[ss->rx_len] = 0;
+      char *end = strstr(ss->rx, "\r\n\r\n");
+      if (!end) {
+        return ss->rx_len < sizeof(ss->rx) - 1;
+      }
+      char value[16];
+      *(end + 2) = 0;  // keep the last header's CRLF for header_value()
+      size_t body = header_value(ss->rx, "Content-Length", value, sizeof(value)) ? atoi(value) : 0;
+      used = end + 4 - ss->rx + body;
+      if (used > sizeof(ss->rx) - 1) {
+        return false;
+      }
+      if (ss->rx_len < used) {
+        *(end + 2) = '\r';
+        break;
+      }
+      if (!handle_request(ss, ss->rx)) {
+        return false;
+      }
+    }
+    memmove(ss->rx, ss->rx + used, ss->rx_len - used);
+    ss->rx_len -= used;
+  }
+  return true;
+}
+
+static void accept_client() {
+  struct sockaddr_in addr;
+  socklen_t addr_len = sizeof(addr);
+  int sock = accept(listen_sock, (struct sockaddr *)&addr, &addr_len);
+  if (sock < 0) {
+    return;
+  }
+  rtsp_session_t *ss = NULL;
+  for (int i = 0; i < RTSP_MAX_SESSIONS && !ss; i++) {
+    if (sessions[i].sock < 0) {
+      ss = &sessions[i];
+    }
+  }
+  if (!ss) {
+    log_w("RTSP: too many clients");
+    close(sock);
+    return;
+  }
+
+  // A stalled TCP client must not hold up the other session
+  struct timeval tv = {2, 0};
+  setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  int one = 1;
+  setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  ss->sock = sock;
+  ss->udp = -1;
+  ss->id = esp_random();
+  ss->ssrc = esp_random();
+  ss->ts_offset = esp_random();
+  ss->rtp_seq = esp_random();
+  ss->playing = false;
+  ss->tcp = false;
+  ss->rx_len = 0;
+  ss->last_seen = millis();
+  log_i("RTSP: client %s connected", inet_ntoa(addr.sin_addr));
+}
+
+static void rtsp_task(void *arg) {
+  uint32_t last_seq = 0;
+  while (true) {
+    fd_set rd;
+    FD_ZERO(&rd);
+    FD_SET(listen_sock, &rd);
+    int max_fd = listen_sock;
+    bool playing = false;
+    for (int i = 0; i < RTSP_MAX_SESSIONS; i++) {
+      if (sessions[i].sock >= 0) {
+        FD_SET(sessions[i].sock, &rd);
+        max_fd = sessions[i].sock > max_fd ? sessions[i].sock : max_fd;
+        playing |= sessions[i].playing;
+      }
+    }
+
+    struct timeval tv = {0, playing ? 0 : 500000};
+    if (select(max_fd + 1, &rd, NULL, NULL, &tv) > 0) {
+      if (FD_ISSET(listen_sock, &rd)) {
+        accept_client();
+      }
+      for (int i = 0; i < RTSP_MAX_SESSIONS; i++) {
+        if (sessions[i].sock >= 0 && FD_ISSET(sessions[i].sock, &rd) && !handle_input(&sessions[i])) {
+          close_session(&sessions[i]);
+        }
+      }
+    }
+
+    for (int i = 0; i < RTSP_MAX_SESSIONS; i++) {
+      // UDP clients that vanished without TEARDOWN stop sending keep-alives
+      if (sessions[i].sock >= 0 && millis() - sessions[i].last_seen > RTSP_TIMEOUT_S * 1500UL) {
+        close_session(&sessions[i]);
+      }
+    }
+
+    if (playing) {
+      frame_t *frame = frame_get(last_seq, 200 / portTICK_PERIOD_MS);
+      if (frame) {
+        last_seq = frame->seq;
+        stream_frame(frame);
+        frame_release(frame);
+      }
+    }
+  }
+}
+
+bool rtsp_start(uint16_t port) {
+  if (listen_sock >= 0) {
+    return true;
+  }
+  for (int i = 0; i < RTSP_MAX_SESSIONS; i++) {
+    sessions[i].sock = -1;
+    sessions[i].udp = -1;
+  }
+
+  listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  int one = 1;
+  setsockopt(listen_sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (listen_sock < 0 || bind(listen_sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(listen_sock, 2) < 0) {
+    log_e("RTSP: cannot listen on port %u", port);
+    if (listen_sock >= 0) {
+      close(listen_sock);
+      listen_sock = -1;
+    }
+    return false;
+  }
+
+  if (xTaskCreate(rtsp_task, "rtsp", 4096, NULL, 4, NULL) != pdPASS) {
+    log_e("RTSP: cannot create task");
+    return false;
+  }
+  log_i("Starting RTSP server on port: '%d'", port);
+  return true;
+}
+
+int rtsp_session_count() {
+  int count = 0;
+  for (int i = 0; i < RTSP_MAX_SESSIONS; i++) {
+    count += sessions[i].sock >= 0 ? 1 : 0;
+  }
+  return count;
+}
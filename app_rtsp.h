@@ -0,0 +1,31 @@
+/*
+ * RTSP server with RTP/JPEG (RFC 2435) packetization
+ *
+ * Serves the live camera as rtsp://<ip>/mjpeg/1 to NVRs and players such as
+ * ffplay or VLC, over UDP or TCP-interleaved transport. Frames come from the
+ * shared frame hub; each packet is sent with an iovec that points straight
+ * into the driver's JPEG buffer, so nothing but the 20-odd header bytes is
+ * ever copied. Quantization tables are taken from the frame's own DQT
+ * segments and sent in-band (Q = 255) with the first packet of every frame.
+ *
+ * RFC 2435 encodes width and height in units of 8 pixels in one byte each,
+ * so frames wider or taller than 2040 pixels (QXGA and up) are sent with
+ * zero dimensions and announced with an "a=x-dimensions" SDP attribute,
+ * which live555-based clients understand.
+ */
+
+#ifndef APP_RTSP_H
+#define APP_RTSP_H
+
+#include <stdint.h>
+
+#define RTSP_PORT         554
+#define RTSP_RTP_PORT     6970  // first UDP server port, two per session
+#define RTSP_MAX_SESSIONS 2
+
+// Start the RTSP server task
+bool rtsp_start(uint16_t port);
+
+int rtsp_session_count();
+
+#endif  // APP_RTSP_H
@@ -0,0 +1,230 @@
+// Absolute-deadline capture scheduling on esp_timer
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "app_clock.h"
+#include "app_schedule.h"
+
+static const uint16_t bucket_ms[SCHEDULE_BUCKETS - 1] = {1, 2, 5, 10, 20, 50, 100, 200, 500};
+
+struct schedule {
+  esp_timer_handle_t timer;
+  SemaphoreHandle_t wake;
+  portMUX_TYPE mux;
+  schedule_config_t config;
+  bool reset;         // config changed, plan again from now
+  int64_t deadline;   // next deadline, 0 = not planned yet
+  bool clocked;       // planned with the wall clock set
+  int64_t last_fire;  // when the previous deadline was served
+  bool contiguous;    // deadline is exactly one interval after the previous one
+  schedule_stats_t stats;
+};
+
+static void on_timer(void *arg) {
+  xSemaphoreGive(((schedule_t *)arg)->wake);
+}
+
+// Wall clock minus esp_timer time, or 0 while the clock is unset (alignment
+// and the hour mask are ignored until then)
+static int64_t wall_offset_us() {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  if (!clock_valid(now.tv_sec)) {
+    return 0;
+  }
+  return (int64_t)now.tv_sec * 1000000 + now.tv_usec - esp_timer_get_time();
+}
+
+static int64_t align_up(int64_t t, int64_t offset, int64_t interval) {
+  int64_t wall = t + offset;
+  return (wall + interval - 1) / interval * interval - offset;
+}
+
+// Move t forward to the first active hour
+static int64_t next_active(const schedule_config_t *c, int64_t t, int64_t offset) {
+  if (!offset || !(c->hours & SCHEDULE_ALL_HOURS) || (c->hours & SCHEDULE_ALL_HOURS) == SCHEDULE_ALL_HOURS) {
+    return t;
+  }
+  for (int i = 0; i < 25; i++) {
+    time_t secs = (t + offset) / 1000000;
+    struct tm tm;
+    localtime_r(&secs, &tm);
+    if (c->hours & (1UL << tm.tm_hour)) {
+      return t;
+    }
+    t = ((int64_t)(secs - tm.tm_min * 60 - tm.tm_sec) + 3600) * 1000000 - offset;
+    if (c->align) {
+      t = align_up(t, offset, (int64_t)c->interval_ms * 1000);
+    }
+  }
+  return t;
+}
+
+static int64_t plan_first(const schedule_config_t *c, int64_t now) {
+  int64_t offset = wall_offset_us();
+  int64_t t = now;
+  if (c->align && offset) {
+    t = align_up(now, offset, (int64_t)c->interval_ms * 1000);
+  }
+  return next_active(c, t, offset);
+}
+
+static int bucket(int64_t us) {
+  int64_t ms = us / 1000;
+  int i = 0;
+  while (i < SCHEDULE_BUCKETS - 1 && ms >= bucket_ms[i]) {
+    i++;
+  }
+  return i;
+}
+
+static void set_config(schedule_t *s, const schedule_config_t *config) {
+  s->config = *config;
+  if (s->config.interval_ms < SCHEDULE_MIN_INTERVAL_MS) {
+    s->config.interval_ms = SCHEDULE_MIN_INTERVAL_MS;
+  }
+}
+
+schedule_t *schedule_create(const schedule_config_t *config) {
+  schedule_t *s = (schedule_t *)calloc(1, sizeof(schedule_t));
+  if (!s) {
+    return NULL;
+  }
+  s->mux = portMUX_INITIALIZER_UNLOCKED;
+  set_config(s, config);
+  s->wake = xSemaphoreCreateBinary();
+  esp_timer_create_args_t args = {};
+  args.callback = on_timer;
+  args.arg = s;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "schedule";
+  if (!s->wake || esp_timer_create(&args, &s->timer) != ESP_OK) {
+    log_e("Schedule: cannot create timer");
+    if (s->wake) {
+      vSemaphoreDelete(s->wake);
+    }
+    free(s);
+    return NULL;
+  }
+  return s;
+}
+
+void schedule_configure(schedule_t *s, const schedule_config_t *config) {
+  portENTER_CRITICAL(&s->mux);
+  set_config(s, config);
+  s->reset = true;
+  portEXIT_CRITICAL(&s->mux);
+  xSemaphoreGive(s->wake);
+}
+
+void schedule_get_config(schedule_t *s, schedule_config_t *config) {
+  portENTER_CRITICAL(&s->mux);
+  *config = s->config;
+  portEXIT_CRITICAL(&s->mux);
+}
+
+int64_t schedule_wait(schedule_t *s) {
+  while (true) {
+    portENTER_CRITICAL(&s->mux);
+    schedule_config_t c = s->config;
+    bool reset = s->reset;
+    s->reset = false;
+    portEXIT_CRITICAL(&s->mux);
+
+    int64_t interval = (int64_t)c.interval_ms * 1000;
+    int64_t now = esp_timer_get_time();
+    // Alignment is worked out when planning, so plan again once SNTP has
+    // set the clock; until then deadlines run from boot time
+    bool clock_came = !s->clocked && wall_offset_us() != 0;
+    if (reset || !s->deadline || (clock_came && c.align)) {
+      s->deadline = plan_first(&c, now);
+      s->contiguous = false;
+    }
+    s->clocked = s->clocked || clock_came;
+
+    if (s->deadline > now) {
+      esp_timer_stop(s->timer);
+      esp_timer_start_once(s->timer, s->deadline - now);
+      // A reconfiguration wakes us early as well; either way look again
+      xSemaphoreTake(s->wake, portMAX_DELAY);
+      continue;
+    }
+
+    // The previous deadline's work ran past this one (and maybe more)
+    int64_t overdue = (now - s->deadline) / interval;
+    uint32_t dropped = 0;
+    if (c.policy == SCHEDULE_SKIP && overdue > 0) {
+      dropped = overdue;
+    } else if (c.policy == SCHEDULE_CATCH_UP && overdue > SCHEDULE_CATCH_UP_MAX) {
+      dropped = overdue - SCHEDULE_CATCH_UP_MAX;
+    }
+    if (dropped) {
+      s->deadline += dropped * interval;
+      s->contiguous = false;
+    }
+
+    int64_t deadline = s->deadline;
+    int64_t late = now - deadline;
+    portENTER_CRITICAL(&s->mux);
+    s->stats.fired++;
+    s->stats.skipped += dropped;
+    s->stats.late[bucket(late)]++;
+    if (late / 1000 > s->stats.late_max_ms) {
+      s->stats.late_max_ms = late / 1000;
+    }
+    if (s->contiguous) {
+      int64_t jitter = now - s->last_fire - interval;
+      s->stats.jitter[bucket(jitter < 0 ? -jitter : jitter)]++;
+    }
+    portEXIT_CRITICAL(&s->mux);
+
+    s->last_fire = now;
+    s->deadline = next_active(&c, deadline + interval, wall_offset_us());
+    s->contiguous = s->deadline == deadline + interval;
+    return deadline;
+  }
+}
+
+void schedule_get_stats(schedule_t *s, schedule_stats_t *stats) {
+  portENTER_CRITICAL(&s->mux);
+  *stats = s->stats;
+  portEXIT_CRITICAL(&s->mux);
+}
+
+static int print_buckets(char *buf, size_t len, const char *name, const uint32_t *counts) {
+  int n = snprintf(buf, len, ",\"%s\":[", name);
+  for (int i = 0; i < SCHEDULE_BUCKETS && n < (int)len; i++) {
+    n += snprintf(buf + n, len - n, "%s%u", i ? "," : "", counts[i]);
+  }
+  if (n < (int)len) {
+    n += snprintf(buf + n, len - n, "]");
+  }
+  return n;
+}
+
+int schedule_print_json(schedule_t *s, char *buf, size_t len) {
+  schedule_config_t c;
+  schedule_stats_t st;
+  schedule_get_config(s, &c);
+  schedule_get_stats(s, &st);
+  int n = snprintf(
+    buf, len, "{\"interval_ms\":%u,\"policy\":\"%s\",\"align\":%s,\"hours\":%u,\"fired\":%u,\"skipped\":%u,\"late_max_ms\":%u,\"buckets_ms\":[",
+    c.interval_ms, c.policy == SCHEDULE_CATCH_UP ? "catch_up" : "skip", c.align ? "true" : "false", c.hours, st.fired, st.skipped, st.late_max_ms
+  );
+  for (int i = 0; i < SCHEDULE_BUCKETS - 1 && n < (int)len; i++) {
+    n += snprintf(buf + n, len - n, "%s%u", i ? "," : "", bucket_ms[i]);
+  }
+  if (n < (int)len) {
+    n += snprintf(buf + n, len - n, "]");
+  }
+  if (n < (int)len) {
+    n += print_buckets(buf + n, len - n, "jitter", st.jitter);
+  }
+  if (n < (int)len) {
+    n += print_buckets(buf + n, len - n, "late", st.late);
+  }
+  if (n < (int)len) {
+    n += snprintf(buf + n, len - n, "}");
+  }
+  return n < (int)len ? n : (len ? len - 1 : 0);
+}
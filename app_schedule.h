@@ -0,0 +1,65 @@
+/*
+ * Capture scheduler
+ *
+ * Deadlines are absolute esp_timer times, one interval apart, so the time
+ * spent capturing and storing a frame never pushes the following ones back.
+ * A one-shot esp_timer wakes the waiting task right at each deadline.
+ * Optionally deadlines sit on whole multiples of the interval on the wall
+ * clock (every 5 s at :00, :05, ...), and an hour mask limits capturing to
+ * some hours of the day, like the hour field of a crontab entry.
+ *
+ * When the work for a deadline overruns into the next ones, the skip policy
+ * drops the missed deadlines and continues on the grid, while catch-up
+ * serves them back to back (at most SCHEDULE_CATCH_UP_MAX).
+ *
+ * Histograms count how far each achieved interval was from the configured
+ * one, and how late each deadline was served.
+ */
+
+#ifndef APP_SCHEDULE_H
+#define APP_SCHEDULE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SCHEDULE_ALL_HOURS       0xFFFFFF  // an empty mask counts as all hours too
+#define SCHEDULE_MIN_INTERVAL_MS 50
+#define SCHEDULE_CATCH_UP_MAX    3
+#define SCHEDULE_BUCKETS         10  // <1, <2, <5, <10, <20, <50, <100, <200, <500, more ms
+
+typedef enum {
+  SCHEDULE_SKIP = 0,
+  SCHEDULE_CATCH_UP,
+} schedule_policy_t;
+
+typedef struct {
+  uint32_t interval_ms;
+  schedule_policy_t policy;
+  bool align;      // deadlines on multiples of the interval on the wall clock
+  uint32_t hours;  // bit n: active during local hour n
+} schedule_config_t;
+
+typedef struct {
+  uint32_t fired;
+  uint32_t skipped;  // deadlines dropped after an overrun
+  uint32_t late_max_ms;
+  uint32_t jitter[SCHEDULE_BUCKETS];  // |achieved - configured interval|
+  uint32_t late[SCHEDULE_BUCKETS];    // deadline to wake-up
+} schedule_stats_t;
+
+typedef struct schedule schedule_t;
+
+schedule_t *schedule_create(const schedule_config_t *config);
+
+// Takes effect right away; the waiting task starts over from the new config
+void schedule_configure(schedule_t *schedule, const schedule_config_t *config);
+void schedule_get_config(schedule_t *schedule, schedule_config_t *config);
+
+// Block until the next deadline and return it (esp_timer time). Only one
+// task may wait on a schedule.
+int64_t schedule_wait(schedule_t *schedule);
+
+void schedule_get_stats(schedule_t *schedule, schedule_stats_t *stats);
+int schedule_print_json(schedule_t *schedule, char *buf, size_t len);
+
+#endif  // APP_SCHEDULE_H
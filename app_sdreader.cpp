@@ -0,0 +1,181 @@
+// Read-ahead reader for recorded frames
+#include "Arduino.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "app_jpeghdr.h"
+#include "app_sdreader.h"
+
+struct sd_reader {
+  fs::FS *fs;
+  size_t end;
+  size_t next;   // next index the task reads
+  size_t floor;  // frames below this index are dropped unseen
+  int pin;       // keeps the recompressor off the range
+  volatile bool stop;
+  bool done;
+  sd_frame_t slots[SD_READER_DEPTH];
+  QueueHandle_t free_q;  // sd_frame_t *
+  QueueHandle_t full_q;  // sd_frame_t *, in index order
+  SemaphoreHandle_t exited;
+  portMUX_TYPE mux;
+};
+
+static bool load_frame(sd_reader_t *r, sd_frame_t *f) {
+  char path[32];
+  f->len = 0;
+  if (!catalog_get(f->index, &f->entry)) {
+    return false;
+  }
+  catalog_path(f->entry.seq, path, sizeof(path));
+  File file = r->fs->open(path, FILE_READ);
+  if (!file) {
+    log_w("SD reader: %s missing", path);
+    return false;
+  }
+  const uint8_t *hdr;
+  size_t hdr_len, size;
+  if (!jpeghdr_open(file, &hdr, &hdr_len, &size)) {
+    file.close();
+    return false;
+  }
+  if (size > f->cap) {
+    uint8_t *grown = (uint8_t *)(psramFound() ? ps_realloc(f->buf, size) : realloc(f->buf, size));
+    if (!grown) {
+      log_e("SD reader: no memory for %u bytes", size);
+      file.close();
+      return false;
+    }
+    f->buf = grown;
+    f->cap = size;
+  }
+  if (hdr) {
+    memcpy(f->buf, hdr, hdr_len);
+  }
+  f->len = hdr_len + file.read(f->buf + hdr_len, size - hdr_len);
+  file.close();
+  return f->len == size;
+}
+
+static void sd_reader_task(void *arg) {
+  sd_reader_t *r = (sd_reader_t *)arg;
+  while (!r->stop) {
+    sd_frame_t *f = NULL;
+    if (xQueueReceive(r->free_q, &f, 100 / portTICK_PERIOD_MS) != pdTRUE) {
+      continue;
+    }
+    portENTER_CRITICAL(&r->mux);
+    f->index = r->next < r->end ? r->next++ : r->end;
+    portEXIT_CRITICAL(&r->mux);
+    if (f->index < r->end) {
+      load_frame(r, f);
+    } else {
+      f->len = 0;  // end marker
+    }
+    // There are only as many slots as the queue holds, so this never blocks
+    xQueueSend(r->full_q, &f, portMAX_DELAY);
+    if (f->index >= r->end) {
+      break;
+    }
+  }
+  xSemaphoreGive(r->exited);
+  vTaskDelete(NULL);
+}
+
+sd_reader_t *sd_reader_open(fs::FS &fs, size_t begin, size_t end) {
+  sd_reader_t *r = (sd_reader_t *)calloc(1, sizeof(sd_reader_t));
+  if (!r) {
+    return NULL;
+  }
+  r->pin = catalog_pin(begin, end);
+  r->fs = &fs;
+  r->end = end;
+  r->next = begin;
+  r->floor = begin;
+  r->mux = portMUX_INITIALIZER_UNLOCKED;
+  r->free_q = xQueueCreate(SD_READER_DEPTH, sizeof(sd_frame_t *));
+  r->full_q = xQueueCreate(SD_READER_DEPTH, sizeof(sd_frame_t *));
+  r->exited = xSemaphoreCreateBinary();
+  if (!r->free_q || !r->full_q || !r->exited) {
+    log_e("SD reader: cannot create queues");
+    if (r->exited) {
+      xSemaphoreGive(r->exited);
+    }
+    sd_reader_close(r);
+    return NULL;
+  }
+  for (int i = 0; i < SD_READER_DEPTH; i++) {
+    sd_frame_t *f = &r->slots[i];
+    xQueueSend(r->free_q, &f, 0);
+  }
+  if (xTaskCreate(sd_reader_task, "sd_reader", 4096, r, 3, NULL) != pdPASS) {
+    log_e("SD reader: cannot create task");
+    xSemaphoreGive(r->exited);
+    sd_reader_close(r);
+    return NULL;
+  }
+  return r;
+}
+
+sd_frame_t *sd_reader_next(sd_reader_t *r, TickType_t timeout) {
+  while (!r->done) {
+    sd_frame_t *f = NULL;
+    if (xQueueReceive(r->full_q, &f, timeout) != pdTRUE) {
+      return NULL;
+    }
+    if (f->index >= r->end) {
+      r->done = true;
+      xQueueSend(r->free_q, &f, 0);
+      break;
+    }
+    if (f->index < r->floor) {
+      xQueueSend(r->free_q, &f, 0);
+      continue;
+    }
+    return f;
+  }
+  return NULL;
+}
+
+void sd_reader_release(sd_reader_t *r, sd_frame_t *frame) {
+  if (frame) {
+    xQueueSend(r->free_q, &frame, 0);
+  }
+}
+
+void sd_reader_skip_to(sd_reader_t *r, size_t index) {
+  portENTER_CRITICAL(&r->mux);
+  if (index > r->floor) {
+    r->floor = index;
+  }
+  if (index > r->next) {
+    r->next = index < r->end ? index : r->end;
+  }
+  portEXIT_CRITICAL(&r->mux);
+}
+
+bool sd_reader_done(sd_reader_t *r) {
+  return r->done;
+}
+
+void sd_reader_close(sd_reader_t *r) {
+  if (!r) {
+    return;
+  }
+  r->stop = true;
+  if (r->exited) {
+    xSemaphoreTake(r->exited, portMAX_DELAY);
+    vSemaphoreDelete(r->exited);
+  }
+  if (r->free_q) {
+    vQueueDelete(r->free_q);
+  }
+  if (r->full_q) {
+    vQueueDelete(r->full_q);
+  }
+  for (int i = 0; i < SD_READER_DEPTH; i++) {
+    free(r->slots[i].buf);
+  }
+  catalog_unpin(r->pin);
+  free(r);
+}
@@ -0,0 +1,51 @@
+/*
+ * Read-ahead reader for recorded frames
+ *
+ * Replays a range of catalog entries in order. A reader task keeps a few
+ * frames loaded into PSRAM slots ahead of the consumer, so the consumer
+ * sees an even stream even though single SD reads stall now and then. The
+ * consumer can jump forward with sd_reader_skip_to(); frames already read
+ * below the new position are dropped unseen.
+ *
+ * The range is pinned in the catalog while the reader is open, so frames
+ * are not recompressed under it. Memory is bounded by depth x the largest
+ * frame in the range.
+ */
+
+#ifndef APP_SDREADER_H
+#define APP_SDREADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "FS.h"
+#include "app_catalog.h"
+
+#define SD_READER_DEPTH 4
+
+typedef struct {
+  size_t index;  // catalog index
+  catalog_entry_t entry;
+  uint8_t *buf;
+  size_t len;  // 0 when the file could not be read
+  size_t cap;
+} sd_frame_t;
+
+typedef struct sd_reader sd_reader_t;
+
+// Start reading catalog entries [begin, end)
+sd_reader_t *sd_reader_open(fs::FS &fs, size_t begin, size_t end);
+
+// Next frame in order; NULL at the end of the range or on timeout
+sd_frame_t *sd_reader_next(sd_reader_t *reader, TickType_t timeout);
+void sd_reader_release(sd_reader_t *reader, sd_frame_t *frame);
+
+// Continue from a later catalog index
+void sd_reader_skip_to(sd_reader_t *reader, size_t index);
+
+// Whether sd_reader_next() returned NULL because the range is exhausted
+bool sd_reader_done(sd_reader_t *reader);
+
+void sd_reader_close(sd_reader_t *reader);
+
+#endif  // APP_SDREADER_H
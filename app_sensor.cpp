@@ -0,0 +1,546 @@
+// Table-driven sensor controls with ordered, frame-aligned batch apply
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "app_events.h"
+#include "app_sensor.h"
+
+#define CTRL_MAX_TABLES 8
+
+// Setter/getter adapters so every control has the same signature
+#define CTRL_SETTER(field)                           \
+  static int set_##field(sensor_t *s, int val) {    \
+    return s->set_##field(s, val);                  \
+  }
+#define CTRL_GETTER(field)                           \
+  static int get_##field(sensor_t *s) {             \
+    return s->status.field;                         \
+  }
+#define CTRL_SENSOR(field) \
+  CTRL_SETTER(field)       \
+  CTRL_GETTER(field)
+
+CTRL_SENSOR(quality)
+CTRL_SENSOR(contrast)
+CTRL_SENSOR(brightness)
+CTRL_SENSOR(saturation)
+CTRL_SENSOR(colorbar)
+CTRL_SENSOR(hmirror)
+CTRL_SENSOR(vflip)
+CTRL_SENSOR(awb_gain)
+CTRL_SENSOR(agc_gain)
+CTRL_SENSOR(aec_value)
+CTRL_SENSOR(aec2)
+CTRL_SENSOR(dcw)
+CTRL_SENSOR(bpc)
+CTRL_SENSOR(wpc)
+CTRL_SENSOR(raw_gma)
+CTRL_SENSOR(lenc)
+CTRL_SENSOR(special_effect)
+CTRL_SENSOR(wb_mode)
+CTRL_SENSOR(ae_level)
+CTRL_GETTER(sharpness)
+CTRL_GETTER(framesize)
+CTRL_GETTER(gainceiling)
+CTRL_GETTER(awb)
+CTRL_GETTER(agc)
+CTRL_GETTER(aec)
+
+static int set_framesize(sensor_t *s, int val) {
+  // Only the JPEG pipeline can change size without reallocating buffers
+  if (s->pixformat != PIXFORMAT_JPEG) {
+    return 0;
+  }
+  return s->set_framesize(s, (framesize_t)val);
+}
+
+static int set_gainceiling(sensor_t *s, int val) {
+  return s->set_gainceiling(s, (gainceiling_t)val);
+}
+
+static int set_awb(sensor_t *s, int val) {
+  return s->set_whitebal(s, val);
+}
+
+static int set_agc(sensor_t *s, int val) {
+  return s->set_gain_ctrl(s, val);
+}
+
+static int set_aec(sensor_t *s, int val) {
+  return s->set_exposure_ctrl(s, val);
+}
+
+static int set_xclk(sensor_t *s, int val) {
+  return s->set_xclk(s, LEDC_TIMER_0, val);
+}
+
+static int get_xclk(sensor_t *s) {
+  return s->xclk_freq_hz / 1000000;
+}
+
+static int set_state_refresh(sensor_t *s, int val);
+static int get_state_refresh(sensor_t *s);
+
+// Order matches the historical /status layout
+static const sensor_ctrl_t sensor_controls[] = {
+  {"xclk", CTRL_STAGE_CLOCK, set_xclk, get_xclk},
+  {"framesize", CTRL_STAGE_FRAME, set_framesize, get_framesize},
+  {"quality", CTRL_STAGE_TUNING, set_quality, get_quality},
+  {"brightness", CTRL_STAGE_TUNING, set_brightness, get_brightness},
+  {"contrast", CTRL_STAGE_TUNING, set_contrast, get_contrast},
+  {"saturation", CTRL_STAGE_TUNING, set_saturation, get_saturation},
+  {"sharpness", CTRL_STAGE_TUNING, NULL, get_sharpness},
+  {"special_effect", CTRL_STAGE_TUNING, set_special_effect, get_special_effect},
+  {"wb_mode", CTRL_STAGE_TUNING, set_wb_mode, get_wb_mode},
+  {"awb", CTRL_STAGE_TUNING, set_awb, get_awb},
+  {"awb_gain", CTRL_STAGE_TUNING, set_awb_gain, get_awb_gain},
+  {"aec", CTRL_STAGE_TUNING, set_aec, get_aec},
+  {"aec2", CTRL_STAGE_TUNING, set_aec2, get_aec2},
+  {"ae_level", CTRL_STAGE_TUNING, set_ae_level, get_ae_level},
+  {"aec_value", CTRL_STAGE_TUNING, set_aec_value, get_aec_value},
+  {"agc", CTRL_STAGE_TUNING, set_agc, get_agc},
+  {"agc_gain", CTRL_STAGE_TUNING, set_agc_gain, get_agc_gain},
+  {"gainceiling", CTRL_STAGE_TUNING, set_gainceiling, get_gainceiling},
+  {"bpc", CTRL_STAGE_TUNING, set_bpc, get_bpc},
+  {"wpc", CTRL_STAGE_TUNING, set_wpc, get_wpc},
+  {"raw_gma", CTRL_STAGE_TUNING, set_raw_gma, get_raw_gma},
+  {"lenc", CTRL_STAGE_TUNING, set_lenc, get_lenc},
+  {"hmirror", CTRL_STAGE_TUNING, set_hmirror, get_hmirror},
+  {"vflip", CTRL_STAGE_TUNING, set_vflip, get_vflip},
+  {"dcw", CTRL_STAGE_TUNING, set_dcw, get_dcw},
+  {"colorbar", CTRL_STAGE_TUNING, set_colorbar, get_colorbar},
+  {"state_refresh", CTRL_STAGE_LOCAL, set_state_refresh, get_state_refresh},
+};
+
+typedef struct {
+  const sensor_ctrl_t *table;
+  size_t count;
+} ctrl_table_t;
+
+static ctrl_table_t tables[CTRL_MAX_TABLES] = {{sensor_controls, sizeof(sensor_controls) / sizeof(sensor_controls[0])}};
+static size_t table_count = 1;
+// Boot stages register from their own tasks; a table is filled in before
+// the count that publishes it goes up, so readers only need the count
+static portMUX_TYPE tables_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static SemaphoreHandle_t sccb_lock = NULL;
+static volatile int64_t settled_us = 0;
+
+void sensor_ctrl_init() {
+  if (!sccb_lock) {
+    sccb_lock = xSemaphoreCreateMutex();
+  }
+}
+
+bool sensor_ctrl_register(const sensor_ctrl_t *table, size_t count) {
+  portENTER_CRITICAL(&tables_mux);
+  bool ok = table_count < CTRL_MAX_TABLES;
+  if (ok) {
+    tables[table_count].table = table;
+    tables[table_count].count = count;
+    table_count++;
+  }
+  portEXIT_CRITICAL(&tables_mux);
+  if (!ok) {
+    log_e("Sensor: no room for the table starting with \"%s\", raise CTRL_MAX_TABLES", count ? table[0].name : "");
+  }
+  return ok;
+}
+
+static size_t registered() {
+  portENTER_CRITICAL(&tables_mux);
+  size_t n = table_count;
+  portEXIT_CRITICAL(&tables_mux);
+  return n;
+}
+
+const sensor_ctrl_t *sensor_ctrl_find(const char *name) {
+  size_t n = registered();
+  for (size_t t = 0; t < n; t++) {
+    for (size_t i = 0; i < tables[t].count; i++) {
+      if (!strcmp(tables[t].table[i].name, name)) {
+        return &tables[t].table[i];
+      }
+    }
+  }
+  return NULL;
+}
+
+void sensor_ctrl_foreach(sensor_ctrl_visit_fn fn, void *arg) {
+  size_t n = registered();
+  for (size_t t = 0; t < n; t++) {
+    for (size_t i = 0; i < tables[t].count; i++) {
+      fn(&tables[t].table[i], arg);
+    }
+  }
+}
+
+int sensor_ctrl_parse(const char *query, sensor_write_t *writes, size_t max, char *bad_name, size_t bad_len) {
+  size_t count = 0;
+  const char *p = query;
+
+  while (p && *p) {
+    const char *end = strchr(p, '&');
+    size_t len = end ? (size_t)(end - p) : strlen(p);
+    const char *eq = (const char *)memchr(p, '=', len);
+    if (eq && eq > p) {
+      char name[32];
+      size_t name_len = eq - p;
+      if (name_len >= sizeof(name)) {
+        name_len = sizeof(name) - 1;
+      }
+      memcpy(name, p, name_len);
+      name[name_len] = 0;
+
+      const sensor_ctrl_t *ctrl = sensor_ctrl_find(name);
+      if (!ctrl || !ctrl->set) {
+        snprintf(bad_name, bad_len, "%s", name);
+        return -1;
+      }
+      int value = atoi(eq + 1);
+
+      size_t i = 0;
+      while (i < count && writes[i].ctrl != ctrl) {
+        i++;
+      }
+      if (i == count) {
+        if (count == max) {
+          snprintf(bad_name, bad_len, "too many parameters");
+          return -1;
+        }
+        count++;
+      }
+      writes[i].ctrl = ctrl;
+      writes[i].value = value;
+      writes[i].result = 0;
+    }
+    p = end ? end + 1 : NULL;
+  }
+  return count;
+}
+
+void sensor_lock() {
+  xSemaphoreTake(sccb_lock, portMAX_DELAY);
+}
+
+void sensor_unlock() {
+  xSemaphoreGive(sccb_lock);
+}
+
+void sensor_mark_reconfigured() {
+  settled_us = esp_timer_get_time();
+}
+
+bool sensor_frame_is_stale(const camera_fb_t *fb) {
+  // fb->timestamp is taken from esp_timer at the start of the frame
+  int64_t started = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+  return started < settled_us;
+}
+
+int sensor_ctrl_apply(sensor_write_t *writes, size_t count) {
+  sensor_t *s = esp_camera_sensor_get();
+  if (!s) {
+    return count;
+  }
+
+  // Stable sort by stage: clock, then frame size, then tuning, then local
+  for (size_t i = 1; i < count; i++) {
+    sensor_write_t w = writes[i];
+    size_t j = i;
+    while (j > 0 && writes[j - 1].ctrl->stage > w.ctrl->stage) {
+      writes[j] = writes[j - 1];
+      j--;
+    }
+    writes[j] = w;
+  }
+
+  int failed = 0;
+  bool touched_sensor = false;
+  sensor_lock();
+  for (size_t i = 0; i < count; i++) {
+    writes[i].result = writes[i].ctrl->set(s, writes[i].value);
+    if (writes[i].result < 0) {
+      failed++;
+    }
+    if (writes[i].ctrl->stage != CTRL_STAGE_LOCAL) {
+      touched_sensor = true;
+    }
+    log_i("%s = %d%s", writes[i].ctrl->name, writes[i].value, writes[i].result < 0 ? " (failed)" : "");
+  }
+  // Whatever the sensor was exposing while the writes went out is suspect
+  if (touched_sensor) {
+    sensor_mark_reconfigured();
+  }
+  sensor_unlock();
+
+  sensor_state_publish(touched_sensor);
+  return failed;
+}
+
+/*
+ * Cached state and /status snapshots
+ */
+
+#define STATE_SNAPSHOT_SIZE 3072
+#define STATE_MAX_REGS      64
+#define STATE_MAX_SECTIONS  4
+
+typedef struct {
+  uint16_t reg;
+  uint32_t mask;
+  int value;
+} cached_reg_t;
+
+typedef struct {
+  const char *name;
+  sensor_state_section_fn fn;
+} state_section_t;
+
+static cached_reg_t cached_regs[STATE_MAX_REGS];
+static size_t cached_reg_count = 0;
+static state_section_t sections[STATE_MAX_SECTIONS];
+static size_t section_count = 0;
+
+static char *snapshots[2] = {NULL, NULL};
+static size_t snapshot_len[2] = {0, 0};
+static uint8_t snapshot_readers[2] = {0, 0};
+static volatile int snapshot_current = 0;
+static volatile uint32_t snapshot_version = 0;
+static portMUX_TYPE snapshot_mux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t publish_lock = NULL;
+
+static volatile int state_refresh_s = 0;
+static TaskHandle_t refresh_task = NULL;
+
+static void add_reg(uint16_t reg, uint32_t mask) {
+  if (cached_reg_count < STATE_MAX_REGS) {
+    cached_regs[cached_reg_count].reg = reg;
+    cached_regs[cached_reg_count].mask = mask;
+    cached_regs[cached_reg_count].value = 0;
+    cached_reg_count++;
+  }
+}
+
+// Registers the camera UI reads from /status, per sensor
+static void build_reg_list(sensor_t *s) {
+  cached_reg_count = 0;
+  if (s->id.PID == OV5640_PID || s->id.PID == OV3660_PID) {
+    for (int reg = 0x3400; reg < 0x3406; reg += 2) {
+      add_reg(reg, 0xFFF);  //12 bit
+    }
+    add_reg(0x3406, 0xFF);
+
+    add_reg(0x3500, 0xFFFF0);  //16 bit
+    add_reg(0x3503, 0xFF);
+    add_reg(0x350a, 0x3FF);   //10 bit
+    add_reg(0x350c, 0xFFFF);  //16 bit
+
+    for (int reg = 0x5480; reg <= 0x5490; reg++) {
+      add_reg(reg, 0xFF);
+    }
+
+    for (int reg = 0x5380; reg <= 0x538b; reg++) {
+      add_reg(reg, 0xFF);
+    }
+
+    for (int reg = 0x5580; reg < 0x558a; reg++) {
+      add_reg(reg, 0xFF);
+    }
+    add_reg(0x558a, 0x1FF);  //9 bit
+  } else if (s->id.PID == OV2640_PID) {
+    add_reg(0xd3, 0xFF);
+    add_reg(0x111, 0xFF);
+    add_reg(0x132, 0xFF);
+  }
+}
+
+// Returns true if any cached value changed
+static bool read_regs(sensor_t *s) {
+  bool changed = false;
+  sensor_lock();
+  for (size_t i = 0; i < cached_reg_count; i++) {
+    int value = s->get_reg(s, cached_regs[i].reg, cached_regs[i].mask);
+    if (value != cached_regs[i].value) {
+      cached_regs[i].value = value;
+      changed = true;
+    }
+  }
+  sensor_unlock();
+  return changed;
+}
+
+typedef struct {
+  char *p;
+  char *end;
+  sensor_t *s;
+} state_out_t;
+
+static void print_state_field(const sensor_ctrl_t *ctrl, void *arg) {
+  state_out_t *o = (state_out_t *)arg;
+  if (ctrl->get && o->end - o->p > 48) {
+    o->p += snprintf(o->p, o->end - o->p, ",\"%s\":%d", ctrl->name, ctrl->get(o->s));
+  }
+}
+
+// Render the snapshot into buf; returns its length
+static size_t render_state(sensor_t *s, char *buf, size_t size, uint32_t version) {
+  char *p = buf;
+  char *end = buf + size - 2;  // room for the closing brace and NUL
+
+  p += snprintf(p, end - p, "{\"version\":%u", version);
+  for (size_t i = 0; i < cached_reg_count && end - p > 24; i++) {
+    p += snprintf(p, end - p, ",\"0x%x\":%u", cached_regs[i].reg, (unsigned)cached_regs[i].value);
+  }
+  p += snprintf(p, end - p, ",\"pixformat\":%u", s->pixformat);
+
+  state_out_t out = {p, end, s};
+  sensor_ctrl_foreach(print_state_field, &out);
+  p = out.p;
+
+  for (size_t i = 0; i < section_count && end - p > 32; i++) {
+    p += snprintf(p, end - p, ",\"%s\":", sections[i].name);
+    int n = sections[i].fn(p, end - p);
+    p += n;
+    if (!n) {
+      p += snprintf(p, end - p, "null");
+    }
+  }
+  *p++ = '}';
+  *p = 0;
+  return p - buf;
+}
+
+void sensor_state_publish(bool reread_regs) {
+  sensor_t *s = esp_camera_sensor_get();
+  if (!s || !publish_lock) {
+    return;
+  }
+  xSemaphoreTake(publish_lock, portMAX_DELAY);
+  if (reread_regs) {
+    read_regs(s);
+  }
+
+  // Build into the buffer nobody is reading, then swap it in
+  int next = snapshot_current ^ 1;
+  while (true) {
+    portENTER_CRITICAL(&snapshot_mux);
+    bool busy = snapshot_readers[next] != 0;
+    portEXIT_CRITICAL(&snapshot_mux);
+    if (!busy) {
+      break;
+    }
+    vTaskDelay(1);
+  }
+  uint32_t version = snapshot_version + 1;
+  snapshot_len[next] = render_state(s, snapshots[next], STATE_SNAPSHOT_SIZE, version);
+
+  portENTER_CRITICAL(&snapshot_mux);
+  snapshot_current = next;
+  snapshot_version = version;
+  portEXIT_CRITICAL(&snapshot_mux);
+  xSemaphoreGive(publish_lock);
+
+  // Subscribers re-fetch /status with If-None-Match
+  events_publish("state", "{\"version\":%u}", version);
+}
+
+static void state_refresh_task(void *arg) {
+  while (true) {
+    int period = state_refresh_s;
+    if (period <= 0) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      continue;
+    }
+    ulTaskNotifyTake(pdTRUE, (period * 1000) / portTICK_PERIOD_MS);
+    sensor_t *s = esp_camera_sensor_get();
+    // Auto exposure / white balance move these registers on their own
+    if (state_refresh_s > 0 && s && read_regs(s)) {
+      sensor_state_publish(false);
+    }
+  }
+}
+
+static int set_state_refresh(sensor_t *s, int val) {
+  state_refresh_s = val < 0 ? 0 : val;
+  if (refresh_task) {
+    xTaskNotifyGive(refresh_task);
+  }
+  return 0;
+}
+
+static int get_state_refresh(sensor_t *s) {
+  return state_refresh_s;
+}
+
+void sensor_state_init() {
+  sensor_t *s = esp_camera_sensor_get();
+  if (publish_lock || !s) {
+    return;
+  }
+  for (int i = 0; i < 2; i++) {
+    snapshots[i] = (char *)(psramFound() ? ps_malloc(STATE_SNAPSHOT_SIZE) : malloc(STATE_SNAPSHOT_SIZE));
+    if (!snapshots[i]) {
+      log_e("Sensor state: cannot allocate snapshot buffers");
+      return;
+    }
+    snapshots[i][0] = 0;
+  }
+  build_reg_list(s);
+  publish_lock = xSemaphoreCreateMutex();
+  sensor_state_publish(true);
+  xTaskCreate(state_refresh_task, "state_refresh", 3072, NULL, 1, &refresh_task);
+}
+
+bool sensor_state_add_section(const char *name, sensor_state_section_fn fn) {
+  if (section_count >= STATE_MAX_SECTIONS) {
+    return false;
+  }
+  sections[section_count].name = name;
+  sections[section_count].fn = fn;
+  section_count++;
+  return true;
+}
+
+void sensor_state_reg_written(int reg) {
+  sensor_t *s = esp_camera_sensor_get();
+  if (!s || !publish_lock) {
+    return;
+  }
+  sensor_lock();
+  for (size_t i = 0; i < cached_reg_count; i++) {
+    // Multi-byte cached registers start at reg and span the next one or two
+    if (reg >= cached_regs[i].reg && reg <= cached_regs[i].reg + 2) {
+      cached_regs[i].value = s->get_reg(s, cached_regs[i].reg, cached_regs[i].mask);
+    }
+  }
+  sensor_unlock();
+  sensor_state_publish(false);
+}
+
+uint32_t sensor_state_version() {
+  return snapshot_version;
+}
+
+const char *sensor_state_acquire(size_t *len, uint32_t *version) {
+  if (!publish_lock) {
+    return NULL;
+  }
+  portENTER_CRITICAL(&snapshot_mux);
+  int idx = snapshot_current;
+  snapshot_readers[idx]++;
+  *len = snapshot_len[idx];
+  *version = snapshot_version;
+  portEXIT_CRITICAL(&snapshot_mux);
+  return snapshots[idx];
+}
+
+void sensor_state_release(const char *snapshot) {
+  portENTER_CRITICAL(&snapshot_mux);
+  for (int i = 0; i < 2; i++) {
+    if (snapshots[i] == snapshot && snapshot_readers[i]) {
+      snapshot_readers[i]--;
+    }
+  }
+  portEXIT_CRITICAL(&snapshot_mux);
+}
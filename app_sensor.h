@@ -0,0 +1,106 @@
+/*
+ * Sensor control registry
+ *
+ * One table describes every parameter that /control accepts: its name, how
+ * to set it, how to read it back for /status, and the stage it belongs to.
+ * Batches are applied in stage order (clock, frame size, tuning, local) so a
+ * request reconfigures XCLK and frame size at most once, right after a frame
+ * boundary, and frames captured while the writes were in flight can be
+ * recognised and dropped by the consumers.
+ */
+
+#ifndef APP_SENSOR_H
+#define APP_SENSOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_camera.h"
+
+typedef enum {
+  CTRL_STAGE_CLOCK = 0,  // XCLK: retimes the whole sensor
+  CTRL_STAGE_FRAME,      // framesize: window/scaler/PLL reprogramming
+  CTRL_STAGE_TUNING,     // image pipeline registers
+  CTRL_STAGE_LOCAL,      // no SCCB traffic (LEDs)
+  CTRL_STAGE_MAX
+} ctrl_stage_t;
+
+typedef struct {
+  const char *name;
+  ctrl_stage_t stage;
+  int (*set)(sensor_t *s, int val);  // NULL = read-only
+  int (*get)(sensor_t *s);           // NULL = write-only
+} sensor_ctrl_t;
+
+typedef struct {
+  const sensor_ctrl_t *ctrl;
+  int value;
+  int result;  // setter return code after sensor_ctrl_apply()
+} sensor_write_t;
+
+#define SENSOR_BATCH_MAX 48
+
+// Create the SCCB lock. Call once from setup(), before any task that may
+// touch the sensor starts.
+void sensor_ctrl_init();
+
+// Add a table of controls owned by another module (e.g. LED handling).
+// Safe from several tasks; false (and logged) when the registry is full.
+bool sensor_ctrl_register(const sensor_ctrl_t *table, size_t count);
+
+const sensor_ctrl_t *sensor_ctrl_find(const char *name);
+
+// Visit every registered control in table order
+typedef void (*sensor_ctrl_visit_fn)(const sensor_ctrl_t *ctrl, void *arg);
+void sensor_ctrl_foreach(sensor_ctrl_visit_fn fn, void *arg);
+
+// Parse "name=value&name=value" into writes. Later duplicates replace earlier
+// ones. Returns the number of writes, or -1 if a name is unknown (copied to
+// bad_name) or the batch is too large.
+int sensor_ctrl_parse(const char *query, sensor_write_t *writes, size_t max, char *bad_name, size_t bad_len);
+
+// Apply a batch atomically with respect to frames. Returns the number of
+// failed writes; each write's result is filled in.
+int sensor_ctrl_apply(sensor_write_t *writes, size_t count);
+
+// Serialises every SCCB access made on behalf of HTTP handlers
+void sensor_lock();
+void sensor_unlock();
+
+// Frames whose capture started before the last reconfiguration finished
+// may mix old and new settings
+bool sensor_frame_is_stale(const camera_fb_t *fb);
+// Mark the end of a raw register change made outside sensor_ctrl_apply()
+void sensor_mark_reconfigured();
+
+/*
+ * Cached sensor state for /status
+ *
+ * Register values are read over SCCB once at start-up, after every change
+ * made through /control, /reg, /pll or /resolution, and optionally by a slow
+ * background refresh (control "state_refresh", seconds, 0 = off). /status is
+ * served from an immutable JSON snapshot; a new snapshot is built into the
+ * second buffer and swapped in with a bumped version number, so readers
+ * never see a half-written document and clients can skip unchanged state.
+ */
+
+typedef int (*sensor_state_section_fn)(char *buf, size_t len);
+
+// Read every cached register and publish the first snapshot
+void sensor_state_init();
+
+// Extra JSON object included in the snapshot as "name":{...}
+bool sensor_state_add_section(const char *name, sensor_state_section_fn fn);
+
+// Rebuild the snapshot; reread_regs re-reads the cached registers first
+void sensor_state_publish(bool reread_regs);
+
+// A raw register was written: refresh its cached copy and republish
+void sensor_state_reg_written(int reg);
+
+uint32_t sensor_state_version();
+
+// Borrow the current snapshot. It stays valid until released.
+const char *sensor_state_acquire(size_t *len, uint32_t *version);
+void sensor_state_release(const char *snapshot);
+
+#endif  // APP_SENSOR_H
@@ -0,0 +1,361 @@
+// Perceptual-hash index of stored frames with multi-index Hamming search
+#include "Arduino.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "app_catalog.h"
+#include "app_follow.h"
+#include "app_jpeg.h"
+#include "app_jpeghdr.h"
+#include "app_similar.h"
+
+#define SIMILAR_MAGIC   0x584D4953  // "SIMX"
+#define SIMILAR_VERSION 1
+#define SIMILAR_CHECK   0x9E3779B9
+#define SIMILAR_TABLES  4
+#define SIMILAR_BUCKETS 4096  // top 12 bits of each 16-bit quarter
+#define SIMILAR_NONE    0xFFFFFFFF
+#define SIMILAR_BATCH   64    // records written to the file at once
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t record_size;
+} similar_header_t;
+
+typedef struct {
+  uint32_t seq;
+  uint32_t lo;
+  uint32_t hi;
+  uint32_t check;  // catches records torn by a power loss
+} similar_record_t;
+
+static uint64_t *hashes = NULL;  // oldest first
+static uint32_t *seqs = NULL;
+static uint32_t *chain[SIMILAR_TABLES];  // next older record in the same bucket
+static uint32_t head[SIMILAR_TABLES][SIMILAR_BUCKETS];
+static size_t count = 0;
+static size_t capacity = 0;
+static SemaphoreHandle_t index_lock = NULL;
+static TaskHandle_t indexer = NULL;
+static fs::FS *index_fs = NULL;
+
+static hint_ring_t hints = HINT_RING_INITIALIZER;
+static similar_record_t batch[SIMILAR_BATCH];  // waiting to be appended
+static size_t batched = 0;
+
+static uint32_t queries = 0;
+static uint32_t last_visited = 0;
+static uint32_t last_us = 0;
+
+static inline uint32_t bucket(uint64_t hash, int t) {
+  return (hash >> (16 * t + 4)) & (SIMILAR_BUCKETS - 1);
+}
+
+static inline int distance(uint64_t a, uint64_t b) {
+  return __builtin_popcountll(a ^ b);
+}
+
+static uint32_t record_check(const similar_record_t *r) {
+  return r->seq ^ r->lo ^ r->hi ^ SIMILAR_CHECK;
+}
+
+static void link_record(size_t i) {
+  for (int t = 0; t < SIMILAR_TABLES; t++) {
+    uint32_t b = bucket(hashes[i], t);
+    chain[t][i] = head[t][b];
+    head[t][b] = i;
+  }
+}
+
+// Forget the oldest quarter to make room; indices shift, so relink all
+static void drop_oldest() {
+  size_t drop = capacity / 4;
+  count -= drop;
+  memmove(hashes, hashes + drop, count * sizeof(uint64_t));
+  memmove(seqs, seqs + drop, count * sizeof(uint32_t));
+  memset(head, 0xFF, sizeof(head));
+  for (size_t i = 0; i < count; i++) {
+    link_record(i);
+  }
+  log_i("Similar: index full, dropped %u oldest frames", drop);
+}
+
+// Caller holds index_lock
+static void add(uint32_t seq, uint64_t hash) {
+  if (count && seq <= seqs[count - 1]) {
+    return;
+  }
+  if (count == capacity) {
+    drop_oldest();
+  }
+  hashes[count] = hash;
+  seqs[count] = seq;
+  link_record(count);
+  count++;
+}
+
+static bool load_file(fs::FS &fs) {
+  File file = fs.open(SIMILAR_INDEX_PATH, FILE_READ);
+  if (!file) {
+    return true;
+  }
+  similar_header_t header;
+  if (file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || header.magic != SIMILAR_MAGIC || header.version != SIMILAR_VERSION
+      || header.record_size != sizeof(similar_record_t)) {
+    log_e("Similar: %s has an unknown format", SIMILAR_INDEX_PATH);
+    file.close();
+    return false;
+  }
+  size_t records = (file.size() - sizeof(header)) / sizeof(similar_record_t);
+  // Only the newest ones fit in memory
+  size_t first = records > capacity ? records - capacity : 0;
+  file.seek(sizeof(header) + first * sizeof(similar_record_t));
+  similar_record_t batch[SIMILAR_BATCH];
+  size_t got;
+  xSemaphoreTake(index_lock, portMAX_DELAY);
+  while ((got = file.read((uint8_t *)batch, sizeof(batch)) / sizeof(similar_record_t)) > 0) {
+    for (size_t i = 0; i < got; i++) {
+      if (batch[i].check == record_check(&batch[i])) {
+        add(batch[i].seq, ((uint64_t)batch[i].hi << 32) | batch[i].lo);
+      }
+    }
+  }
+  xSemaphoreGive(index_lock);
+  file.close();
+  return follow_pad_torn(fs, SIMILAR_INDEX_PATH, sizeof(header), sizeof(similar_record_t));
+}
+
+static bool append(fs::FS &fs, const similar_record_t *records, size_t n) {
+  File file = fs.open(SIMILAR_INDEX_PATH, FILE_APPEND);
+  if (!file) {
+    return false;
+  }
+  bool ok = true;
+  if (file.size() == 0) {
+    similar_header_t header = {SIMILAR_MAGIC, SIMILAR_VERSION, sizeof(similar_record_t)};
+    ok = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+  }
+  ok = ok && file.write((const uint8_t *)records, n * sizeof(similar_record_t)) == n * sizeof(similar_record_t);
+  file.close();
+  return ok;
+}
+
+static bool hash_file(fs::FS &fs, uint32_t seq, uint64_t *hash) {
+  char path[32];
+  catalog_path(seq, path, sizeof(path));
+  // Not swapped for a recompressed copy halfway through the read
+  int pin = catalog_pin_seq(seq);
+  File file = fs.open(path, FILE_READ);
+  if (!file) {
+    catalog_unpin(pin);
+    return false;
+  }
+  size_t len;
+  uint8_t *jpeg = jpeghdr_read_all(file, &len);
+  file.close();
+  catalog_unpin(pin);
+  bool ok = jpeg && jpeg_dc_hash(jpeg, len, hash) == ESP_OK;
+  free(jpeg);
+  return ok;
+}
+
+static bool load() {
+  if (!load_file(*index_fs)) {
+    log_e("Similar: cannot use %s, index disabled", SIMILAR_INDEX_PATH);
+    return false;
+  }
+  log_i("Similar: %u frames indexed, room for %u", count, capacity);
+  return true;
+}
+
+// After the newest indexed frame; the first time, as far back as fits
+static size_t resume() {
+  if (count) {
+    return catalog_lower_bound_seq(seqs[count - 1] + 1);
+  }
+  size_t total = catalog_count();
+  return total > capacity ? total - capacity : 0;
+}
+
+static void flush() {
+  if (batched && !append(*index_fs, batch, batched)) {
+    log_e("Similar: cannot append to %s", SIMILAR_INDEX_PATH);
+  }
+  batched = 0;
+}
+
+// Frames that cannot be hashed are passed over
+static void visit(size_t index, const catalog_entry_t *entry) {
+  uint64_t hash;
+  if (!hint_take(&hints, entry->seq, &hash, sizeof(hash)) && !hash_file(*index_fs, entry->seq, &hash)) {
+    log_w("Similar: cannot hash frame %u", entry->seq);
+    return;
+  }
+  xSemaphoreTake(index_lock, portMAX_DELAY);
+  add(entry->seq, hash);
+  xSemaphoreGive(index_lock);
+  similar_record_t *r = &batch[batched];
+  r->seq = entry->seq;
+  r->lo = (uint32_t)hash;
+  r->hi = hash >> 32;
+  r->check = record_check(r);
+  if (++batched == SIMILAR_BATCH) {
+    flush();
+  }
+}
+
+static const follower_t follower = {"similar", load, resume, visit, flush};
+
+bool similar_start(fs::FS &fs) {
+  if (indexer) {
+    return true;
+  }
+  if (!psramFound()) {
+    log_w("Similar: no PSRAM, similarity search disabled");
+    return false;
+  }
+  index_fs = &fs;
+  const size_t per_frame = sizeof(uint64_t) + sizeof(uint32_t) * (1 + SIMILAR_TABLES);
+  capacity = heap_caps_get_free_size(MALLOC_CAP_SPIRAM) / SIMILAR_PSRAM_SHARE / per_frame;
+  if (capacity > SIMILAR_MAX_FRAMES) {
+    capacity = SIMILAR_MAX_FRAMES;
+  }
+  hashes = (uint64_t *)ps_malloc(capacity * per_frame);
+  if (!hashes || capacity < 4) {
+    log_e("Similar: cannot allocate the index");
+    free(hashes);
+    hashes = NULL;
+    return false;
+  }
+  seqs = (uint32_t *)(hashes + capacity);
+  for (int t = 0; t < SIMILAR_TABLES; t++) {
+    chain[t] = seqs + capacity * (1 + t);
+  }
+  memset(head, 0xFF, sizeof(head));
+  index_lock = xSemaphoreCreateMutex();
+  if (!index_lock || !follower_start(&follower, &indexer)) {
+    log_e("Similar: cannot start");
+    free(hashes);
+    hashes = NULL;
+    return false;
+  }
+  return true;
+}
+
+bool similar_ready() {
+  return indexer != NULL;
+}
+
+void similar_hint(uint32_t seq, uint64_t hash) {
+  hint_put(&hints, seq, &hash, sizeof(hash));
+  if (indexer) {
+    xTaskNotifyGive(indexer);
+  }
+}
+
+bool similar_hash_of(uint32_t seq, uint64_t *hash) {
+  if (index_lock) {
+    xSemaphoreTake(index_lock, portMAX_DELAY);
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (seqs[mid] < seq) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    bool found = lo < count && seqs[lo] == seq;
+    if (found) {
+      *hash = hashes[lo];
+    }
+    xSemaphoreGive(index_lock);
+    if (found) {
+      return true;
+    }
+  }
+  return index_fs && catalog_ready() && hash_file(*index_fs, seq, hash);
+}
+
+// Insert into out[], kept sorted by distance; n results so far
+static int offer(similar_match_t *out, int n, int k, uint32_t seq, int d) {
+  if (n == k && d >= out[k - 1].distance) {
+    return n;
+  }
+  int i = n < k ? n++ : k - 1;
+  while (i > 0 && out[i - 1].distance > d) {
+    out[i] = out[i - 1];
+    i--;
+  }
+  out[i].seq = seq;
+  out[i].distance = d;
+  return n;
+}
+
+int similar_search(uint64_t hash, int k, int max_distance, similar_match_t *out, uint32_t *visited) {
+  *visited = 0;
+  if (!index_lock || k < 1) {
+    return 0;
+  }
+  int64_t start = esp_timer_get_time();
+  xSemaphoreTake(index_lock, portMAX_DELAY);
+  uint32_t *seen = (uint32_t *)calloc((count + 31) / 32, sizeof(uint32_t));
+  if (!seen) {
+    xSemaphoreGive(index_lock);
+    return 0;
+  }
+  int n = 0;
+  bool done = false;
+  for (int r = 0; r <= SIMILAR_PROBE_RADIUS && !done; r++) {
+    for (int t = 0; t < SIMILAR_TABLES; t++) {
+      uint32_t q = bucket(hash, t);
+      // Buckets whose 12 bits differ from the query's in exactly r places
+      for (uint32_t mask = 0; mask < SIMILAR_BUCKETS; mask++) {
+        if (__builtin_popcount(mask) != r) {
+          continue;
+        }
+        for (uint32_t i = head[t][q ^ mask]; i != SIMILAR_NONE; i = chain[t][i]) {
+          if (seen[i / 32] & (1UL << (i % 32))) {
+            continue;
+          }
+          seen[i / 32] |= 1UL << (i % 32);
+          (*visited)++;
+          int d = distance(hashes[i], hash);
+          if (d <= max_distance) {
+            n = offer(out, n, k, seqs[i], d);
+          }
+        }
+      }
+    }
+    // Every hash within 4r+3 bits shares a bucket ring <= r in some table
+    int bound = 4 * r + 3;
+    done = max_distance <= bound || (n == k && out[k - 1].distance <= bound);
+  }
+  if (!done) {
+    for (size_t i = 0; i < count; i++) {
+      if (seen[i / 32] & (1UL << (i % 32))) {
+        continue;
+      }
+      (*visited)++;
+      int d = distance(hashes[i], hash);
+      if (d <= max_distance) {
+        n = offer(out, n, k, seqs[i], d);
+      }
+    }
+  }
+  free(seen);
+  queries++;
+  last_visited = *visited;
+  last_us = esp_timer_get_time() - start;
+  xSemaphoreGive(index_lock);
+  return n;
+}
+
+int similar_print_json(char *buf, size_t len) {
+  int n = snprintf(
+    buf, len, "{\"indexed\":%u,\"capacity\":%u,\"queries\":%u,\"last_visited\":%u,\"last_ms\":%u}", count, capacity, queries, last_visited, last_us / 1000
+  );
+  return n < (int)len ? n : (len ? len - 1 : 0);
+}
@@ -0,0 +1,60 @@
+/*
+ * Similarity search over stored frames
+ *
+ * Every stored frame gets the 64-bit DC hash from jpeg_dc_hash(), appended
+ * to SIMILAR_INDEX_PATH (16 bytes per frame) by a low-priority task that
+ * follows the catalog, so burst frames and recordings made before the index
+ * existed are covered too. The recorder hands over the hashes it already
+ * computed; other frames are read back from the card.
+ *
+ * In PSRAM the hashes are searched with multi-index hashing: each 16-bit
+ * quarter of a hash selects a bucket (by its top 12 bits) in one of four
+ * tables. Two hashes at most 4r+3 bits apart agree within r bits in the
+ * bucket of at least one quarter, so a k-nearest query visits buckets in
+ * rings of growing r and stops as soon as its k-th result is closer than
+ * that bound, touching only a small part of the index. Queries that need
+ * to look further fall back to a linear scan.
+ *
+ * PSRAM use is 28 bytes per frame, capped at SIMILAR_PSRAM_SHARE of what
+ * is free at start; past that, the oldest frames leave the in-memory index
+ * (they stay in the file).
+ */
+
+#ifndef APP_SIMILAR_H
+#define APP_SIMILAR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "FS.h"
+
+#define SIMILAR_INDEX_PATH   "/hashes.bin"
+#define SIMILAR_MAX_FRAMES   100000
+#define SIMILAR_PSRAM_SHARE  4    // at most 1/4 of free PSRAM
+#define SIMILAR_MAX_RESULTS  100
+#define SIMILAR_PROBE_RADIUS 3    // bucket rings visited before scanning everything
+
+typedef struct {
+  uint32_t seq;
+  uint8_t distance;  // Hamming distance to the query
+} similar_match_t;
+
+// Allocate the index and start the indexing task (storage may still be
+// coming up). false without PSRAM.
+bool similar_start(fs::FS &fs);
+
+// Whether similar_start() succeeded
+bool similar_ready();
+
+// Hash of a frame about to be stored, saves reading it back
+void similar_hint(uint32_t seq, uint64_t hash);
+
+// Hash of a stored frame: from the index, else computed from the file
+bool similar_hash_of(uint32_t seq, uint64_t *hash);
+
+// Up to k indexed frames nearest to hash, at most max_distance bits away,
+// closest first. *visited counts the hashes compared.
+int similar_search(uint64_t hash, int k, int max_distance, similar_match_t *out, uint32_t *visited);
+
+int similar_print_json(char *buf, size_t len);
+
+#endif  // APP_SIMILAR_H
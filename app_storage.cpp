@@ -0,0 +1,237 @@
+// SD card mount with bus width / clock calibration
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "FS.h"
+#include "SD_MMC.h"
+#include "Preferences.h"
+#include "app_storage.h"
+
+#define SDTUNE_NVS_NAMESPACE "sdtune"
+#define SDTUNE_TEST_FILE     "/.sdtune.bin"
+#define SDTUNE_TEST_BYTES    (512 * 1024)  // per benchmark pass
+#define SDTUNE_CHECK_BYTES   (64 * 1024)   // quick re-check of a stored setting
+#define SDTUNE_CHUNK         (16 * 1024)
+#define SDTUNE_MAX_RESULTS   8
+
+// Candidate clocks in kHz, fastest first. SD_MMC.begin() takes kHz, so the
+// old hard-coded 4000000 was never 4 MHz; the driver just clamped it.
+static const uint32_t candidate_freqs[] = {SDMMC_FREQ_HIGHSPEED, SDMMC_FREQ_26M, SDMMC_FREQ_DEFAULT, 10000};
+
+static sd_bench_t active = {0, 0, 0, 0, false};
+static sd_bench_t results[SDTUNE_MAX_RESULTS];
+static int result_count = 0;
+static bool calibrated_this_boot = false;
+
+// Deterministic per-offset pattern so a shifted or stale block is detected
+static void fill_pattern(uint8_t *buf, size_t len, uint32_t offset) {
+  uint32_t *words = (uint32_t *)buf;
+  for (size_t i = 0; i < len / 4; i++) {
+    uint32_t x = offset + i * 4 + 0x9E3779B9;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    words[i] = x;
+  }
+}
+
+static uint32_t card_signature() {
+  return (uint32_t)(SD_MMC.cardSize() >> 20) ^ ((uint32_t)SD_MMC.cardType() << 28);
+}
+
+static bool mount(uint8_t width, uint32_t freq_khz) {
+  SD_MMC.end();
+  if (!SD_MMC.begin(STORAGE_MOUNT_POINT, width == 1, false, freq_khz)) {
+    return false;
+  }
+  return SD_MMC.cardType() != CARD_NONE;
+}
+
+// Sequential write, then read back and compare. Throughput in MB/s.
+static bool benchmark(sd_bench_t *b, size_t total) {
+  uint8_t *buf = (uint8_t *)heap_caps_malloc(SDTUNE_CHUNK, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+  uint8_t *expect = (uint8_t *)malloc(SDTUNE_CHUNK);
+  if (!buf || !expect) {
+    free(expect);
+    heap_caps_free(buf);
+    return false;
+  }
+
+  b->verified = false;
+  b->write_mbps = b->read_mbps = 0;
+  bool ok = true;
+
+  File file = SD_MMC.open(SDTUNE_TEST_FILE, FILE_WRITE);
+  if (!file) {
+    ok = false;
+  }
+  int64_t t0 = esp_timer_get_time();
+  for (size_t off = 0; ok && off < total; off += SDTUNE_CHUNK) {
+    fill_pattern(buf, SDTUNE_CHUNK, off);
+    ok = file.write(buf, SDTUNE_CHUNK) == SDTUNE_CHUNK;
+  }
+  if (file) {
+    file.close();  // includes the final flush
+  }
+  int64_t t1 = esp_timer_get_time();
+
+  if (ok) {
+    file = SD_MMC.open(SDTUNE_TEST_FILE, FILE_READ);
+    ok = file && file.size() == total;
+  }
+  int64_t read_us = 0;
+  for (size_t off = 0; ok && off < total; off += SDTUNE_CHUNK) {
+    int64_t r0 = esp_timer_get_time();
+    ok = file.read(buf, SDTUNE_CHUNK) == SDTUNE_CHUNK;
+    read_us += esp_timer_get_time() - r0;
+    if (ok) {
+      fill_pattern(expect, SDTUNE_CHUNK, off);
+      ok = memcmp(buf, expect, SDTUNE_CHUNK) == 0;
+      if (!ok) {
+        log_w("SD tune: pattern mismatch at offset %u", off);
+      }
+    }
+  }
+  if (file) {
+    file.close();
+  }
+  SD_MMC.remove(SDTUNE_TEST_FILE);
+
+  if (ok) {
+    b->verified = true;
+    b->write_mbps = (float)total / (float)(t1 - t0);  // bytes per us == MB/s
+    b->read_mbps = read_us ? (float)total / (float)read_us : 0;
+  }
+  free(expect);
+  heap_caps_free(buf);
+  return ok;
+}
+
+static void save_setting(const sd_bench_t *b, uint32_t signature) {
+  Preferences prefs;
+  if (!prefs.begin(SDTUNE_NVS_NAMESPACE, false)) {
+    return;
+  }
+  prefs.putUInt("card", signature);
+  prefs.putUInt("width", b->width);
+  prefs.putUInt("freq", b->freq_khz);
+  prefs.putFloat("wr", b->write_mbps);
+  prefs.putFloat("rd", b->read_mbps);
+  prefs.putBool("force", false);
+  prefs.end();
+}
+
+static bool calibrate(bool allow_4bit) {
+  const uint8_t widths[] = {4, 1};
+  sd_bench_t best = {0, 0, 0, 0, false};
+  result_count = 0;
+
+  for (size_t w = 0; w < sizeof(widths); w++) {
+    if (widths[w] == 4 && !allow_4bit) {
+      continue;
+    }
+    for (size_t f = 0; f < sizeof(candidate_freqs) / sizeof(candidate_freqs[0]); f++) {
+      sd_bench_t b = {widths[w], candidate_freqs[f], 0, 0, false};
+      // Two passes: a setting that verifies once but not twice is not stable
+      bool ok = mount(b.width, b.freq_khz) && benchmark(&b, SDTUNE_TEST_BYTES);
+      if (ok) {
+        sd_bench_t again = b;
+        ok = benchmark(&again, SDTUNE_TEST_BYTES);
+        b.verified = ok;
+        if (ok) {
+          b.write_mbps = (b.write_mbps + again.write_mbps) / 2;
+          b.read_mbps = (b.read_mbps + again.read_mbps) / 2;
+        }
+      }
+      log_i(
+        "SD tune: %u-bit %5ukHz  %s  write %.2f MB/s  read %.2f MB/s", b.width, b.freq_khz, b.verified ? "ok  " : "FAIL", b.write_mbps, b.read_mbps
+      );
+      if (result_count < SDTUNE_MAX_RESULTS) {
+        results[result_count++] = b;
+      }
+      if (b.verified && b.write_mbps + b.read_mbps > best.write_mbps + best.read_mbps) {
+        best = b;
+      }
+    }
+  }
+
+  calibrated_this_boot = true;
+  if (!best.verified || !mount(best.width, best.freq_khz)) {
+    return false;
+  }
+  active = best;
+  save_setting(&best, card_signature());
+  log_i("SD tune: selected %u-bit at %ukHz", best.width, best.freq_khz);
+  return true;
+}
+
+bool storage_mount(bool allow_4bit) {
+  Preferences prefs;
+  uint32_t saved_card = 0, saved_width = 0, saved_freq = 0;
+  float saved_wr = 0, saved_rd = 0;
+  bool force = false;
+  if (prefs.begin(SDTUNE_NVS_NAMESPACE, true)) {
+    saved_card = prefs.getUInt("card", 0);
+    saved_width = prefs.getUInt("width", 0);
+    saved_freq = prefs.getUInt("freq", 0);
+    saved_wr = prefs.getFloat("wr", 0);
+    saved_rd = prefs.getFloat("rd", 0);
+    force = prefs.getBool("force", false);
+    prefs.end();
+  }
+
+  if (!force && saved_width && (saved_width == 1 || allow_4bit) && mount(saved_width, saved_freq) && saved_card == card_signature()) {
+    // Same card as last time: a short verified pass is enough
+    sd_bench_t check = {(uint8_t)saved_width, saved_freq, 0, 0, false};
+    if (benchmark(&check, SDTUNE_CHECK_BYTES)) {
+      active = check;
+      active.write_mbps = saved_wr;
+      active.read_mbps = saved_rd;
+      log_i("SD: %u-bit at %ukHz (stored setting, %.2f/%.2f MB/s)", active.width, active.freq_khz, saved_wr, saved_rd);
+      return true;
+    }
+    log_w("SD: stored setting failed its check, recalibrating");
+  }
+
+  // Probe at the most conservative setting first so a missing card fails fast
+  if (!mount(1, SDMMC_FREQ_DEFAULT)) {
+    return false;
+  }
+  if (calibrate(allow_4bit)) {
+    return true;
+  }
+
+  log_w("SD tune: no setting verified, falling back to 1-bit default clock");
+  active = {1, SDMMC_FREQ_DEFAULT, 0, 0, false};
+  return mount(active.width, active.freq_khz);
+}
+
+void storage_request_calibration() {
+  Preferences prefs;
+  if (prefs.begin(SDTUNE_NVS_NAMESPACE, false)) {
+    prefs.putBool("force", true);
+    prefs.end();
+  }
+}
+
+bool storage_get_setting(sd_bench_t *out) {
+  *out = active;
+  return active.width != 0;
+}
+
+int storage_print_json(char *buf, size_t len) {
+  size_t n = snprintf(
+    buf, len, "{\"width\":%u,\"freq_khz\":%u,\"write_mbps\":%.2f,\"read_mbps\":%.2f,\"verified\":%u,\"calibrated\":%u,\"results\":[", active.width,
+    active.freq_khz, active.write_mbps, active.read_mbps, active.verified ? 1 : 0, calibrated_this_boot ? 1 : 0
+  );
+  for (int i = 0; i < result_count && n < len; i++) {
+    n += snprintf(
+      buf + n, len - n, "%s{\"width\":%u,\"freq_khz\":%u,\"ok\":%u,\"write_mbps\":%.2f,\"read_mbps\":%.2f}", i ? "," : "", results[i].width,
+      results[i].freq_khz, results[i].verified ? 1 : 0, results[i].write_mbps, results[i].read_mbps
+    );
+  }
+  if (n < len) {
+    n += snprintf(buf + n, len - n, "]}");
+  }
+  return n < len ? n : (len ? len - 1 : 0);
+}
@@ -0,0 +1,39 @@
+/*
+ * SD card mount with bus auto-tuning
+ *
+ * On first boot with a given card, every bus width / clock combination the
+ * board allows is mounted in turn and benchmarked with a sequential write
+ * and read-back of a known test pattern. The fastest setting that verified
+ * cleanly is stored in NVS and reused on later boots after a short
+ * re-check. Results are exposed in /status and /debug.
+ */
+
+#ifndef APP_STORAGE_H
+#define APP_STORAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define STORAGE_MOUNT_POINT "/sdcard"
+
+typedef struct {
+  uint8_t width;      // 1 or 4 data lines
+  uint32_t freq_khz;  // SDMMC clock
+  float write_mbps;
+  float read_mbps;
+  bool verified;      // test pattern read back intact
+} sd_bench_t;
+
+// Mount the card, calibrating the bus first if needed. allow_4bit comes from
+// SD_MMC_4BIT_CAPABLE in camera_pins.h.
+bool storage_mount(bool allow_4bit);
+
+// Re-run the full calibration on the next boot
+void storage_request_calibration();
+
+// Active setting and its measured throughput
+bool storage_get_setting(sd_bench_t *out);
+
+int storage_print_json(char *buf, size_t len);
+
+#endif  // APP_STORAGE_H
@@ -0,0 +1,275 @@
+// Incremental scene-change summaries per hour and day
+#include "Arduino.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "app_catalog.h"
+#include "app_clock.h"
+#include "app_follow.h"
+#include "app_jpeg.h"
+#include "app_jpeghdr.h"
+#include "app_summary.h"
+
+#define SUMMARY_MAGIC       0x4D4D5553  // "SUMM"
+#define SUMMARY_VERSION     1
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t block_size;
+} summary_header_t;
+
+typedef struct {
+  uint32_t hour;  // unix seconds / 3600, 0 = unused
+  uint32_t count;
+  summary_key_t keys[SUMMARY_HOUR_KEYS + 1];  // one spare until the next merge
+  uint32_t check;
+} hour_t;
+
+static hour_t *hours = NULL;
+static size_t hour_slots = 0;
+static fs::FS *summary_fs = NULL;
+static SemaphoreHandle_t summary_lock = NULL;
+static TaskHandle_t summarizer = NULL;
+
+static hint_ring_t hints = HINT_RING_INITIALIZER;
+static uint32_t last_hour = 0;  // newest hour found in the file
+static uint8_t prev[64];        // DC grid of the frame before
+static bool have_prev = false;
+static uint32_t open_hour = 0;
+
+static uint32_t frames_seen = 0;
+static uint32_t hours_written = 0;
+
+static uint32_t block_check(const hour_t *h) {
+  const uint8_t *p = (const uint8_t *)h;
+  uint32_t sum = 2166136261u;
+  for (size_t i = 0; i < offsetof(hour_t, check); i++) {
+    sum = (sum ^ p[i]) * 16777619u;
+  }
+  return sum;
+}
+
+// Merge the segment with the weakest cut into the one before it; the first
+// segment has nothing before it and stays
+static int merge_weakest(summary_key_t *keys, int count) {
+  int weakest = 1;
+  for (int i = 2; i < count; i++) {
+    if (keys[i].score <= keys[weakest].score) {
+      weakest = i;
+    }
+  }
+  summary_key_t *prev = &keys[weakest - 1];
+  prev->end = keys[weakest].end > prev->end ? keys[weakest].end : prev->end;
+  prev->frames += keys[weakest].frames;
+  memmove(&keys[weakest], &keys[weakest + 1], (count - weakest - 1) * sizeof(summary_key_t));
+  return count - 1;
+}
+
+static hour_t *slot(uint32_t hour, bool create) {
+  hour_t *h = &hours[hour % hour_slots];
+  if (h->hour != hour) {
+    if (!create) {
+      return NULL;
+    }
+    memset(h, 0, sizeof(*h));
+    h->hour = hour;
+  }
+  return h;
+}
+
+static bool load_file() {
+  File file = summary_fs->open(SUMMARY_PATH, FILE_READ);
+  if (!file) {
+    return true;
+  }
+  summary_header_t header;
+  if (file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || header.magic != SUMMARY_MAGIC || header.version != SUMMARY_VERSION
+      || header.block_size != sizeof(hour_t)) {
+    log_e("Summary: %s has an unknown format", SUMMARY_PATH);
+    file.close();
+    return false;
+  }
+  size_t blocks = (file.size() - sizeof(header)) / sizeof(hour_t);
+  size_t first = blocks > hour_slots ? blocks - hour_slots : 0;
+  file.seek(sizeof(header) + first * sizeof(hour_t));
+  hour_t block;
+  while (file.read((uint8_t *)&block, sizeof(block)) == sizeof(block)) {
+    // Torn or padded blocks fail the check
+    if (block.check != block_check(&block) || !block.hour || block.count > SUMMARY_HOUR_KEYS) {
+      continue;
+    }
+    *slot(block.hour, true) = block;
+    last_hour = block.hour > last_hour ? block.hour : last_hour;
+  }
+  file.close();
+  if (!follow_pad_torn(*summary_fs, SUMMARY_PATH, sizeof(header), sizeof(hour_t))) {
+    log_w("Summary: cannot pad the torn block in %s", SUMMARY_PATH);
+  }
+  return true;
+}
+
+static void store(hour_t *h) {
+  File file = summary_fs->open(SUMMARY_PATH, FILE_APPEND);
+  bool ok = file;
+  if (ok && file.size() == 0) {
+    summary_header_t header = {SUMMARY_MAGIC, SUMMARY_VERSION, sizeof(hour_t)};
+    ok = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+  }
+  h->check = block_check(h);
+  ok = ok && file.write((const uint8_t *)h, sizeof(*h)) == sizeof(*h);
+  if (file) {
+    file.close();
+  }
+  if (ok) {
+    hours_written++;
+  } else {
+    log_e("Summary: cannot append to %s", SUMMARY_PATH);
+  }
+}
+
+static bool grid_of(uint32_t seq, uint8_t *grid) {
+  if (hint_take(&hints, seq, grid, 64)) {
+    return true;
+  }
+  char path[32];
+  catalog_path(seq, path, sizeof(path));
+  // Not swapped for a recompressed copy halfway through the read
+  int pin = catalog_pin_seq(seq);
+  File file = summary_fs->open(path, FILE_READ);
+  if (!file) {
+    catalog_unpin(pin);
+    return false;
+  }
+  size_t len;
+  uint8_t *jpeg = jpeghdr_read_all(file, &len);
+  file.close();
+  catalog_unpin(pin);
+  bool ok = jpeg && jpeg_dc_grid(jpeg, len, grid) == ESP_OK;
+  free(jpeg);
+  return ok;
+}
+
+static bool load() {
+  xSemaphoreTake(summary_lock, portMAX_DELAY);
+  bool ok = load_file();
+  xSemaphoreGive(summary_lock);
+  return ok;
+}
+
+// Carry on after the last finished hour; the first time, from a day back
+static size_t resume() {
+  size_t total = catalog_count();
+  uint32_t since = (last_hour + 1) * 3600;
+  catalog_entry_t entry;
+  if (!last_hour && total && catalog_get(total - 1, &entry)) {
+    since = entry.time > SUMMARY_BACKFILL_S ? (entry.time - SUMMARY_BACKFILL_S) / 3600 * 3600 : 0;
+  }
+  size_t next = catalog_lower_bound_time(since);
+  log_i("Summary: resuming at frame %u of %u", next, total);
+  return next;
+}
+
+static void visit(size_t index, const catalog_entry_t *entry) {
+  uint8_t grid[64];
+  // Frames from before the clock was set belong to no hour
+  if (!clock_valid(entry->time) || !grid_of(entry->seq, grid)) {
+    return;
+  }
+  uint32_t score = 0;
+  if (have_prev) {
+    for (int i = 0; i < 64; i++) {
+      score += abs((int)grid[i] - (int)prev[i]);
+    }
+    score = score / 4 < 0xFFFF ? score / 4 : 0xFFFF;  // mean x 16
+  }
+  memcpy(prev, grid, sizeof(prev));
+  have_prev = true;
+
+  uint32_t hour = entry->time / 3600;
+  xSemaphoreTake(summary_lock, portMAX_DELAY);
+  if (open_hour && hour != open_hour) {
+    hour_t *done = slot(open_hour, false);
+    if (done) {
+      store(done);
+    }
+  }
+  open_hour = hour;
+  hour_t *h = slot(hour, true);
+  if (h->count) {
+    // The previous frame may have stayed on screen until now
+    catalog_entry_t before;
+    summary_key_t *last = &h->keys[h->count - 1];
+    if (index && catalog_get(index - 1, &before) && before.still_until > last->end && before.still_until <= entry->time) {
+      last->end = before.still_until;
+    }
+  }
+  summary_key_t key = {entry->seq, entry->time, entry->time, (uint16_t)score, 1};
+  h->keys[h->count++] = key;
+  if (h->count > SUMMARY_HOUR_KEYS) {
+    h->count = merge_weakest(h->keys, h->count);
+  }
+  frames_seen++;
+  xSemaphoreGive(summary_lock);
+}
+
+static const follower_t follower = {"summary", load, resume, visit, NULL};
+
+bool summary_start(fs::FS &fs) {
+  if (summarizer) {
+    return true;
+  }
+  summary_fs = &fs;
+  hour_slots = (psramFound() ? SUMMARY_DAYS : 1) * 24;
+  hours = (hour_t *)(psramFound() ? ps_calloc(hour_slots, sizeof(hour_t)) : calloc(hour_slots, sizeof(hour_t)));
+  summary_lock = xSemaphoreCreateMutex();
+  if (!hours || !summary_lock || !follower_start(&follower, &summarizer)) {
+    log_e("Summary: cannot start");
+    free(hours);
+    hours = NULL;
+    return false;
+  }
+  return true;
+}
+
+void summary_hint(uint32_t seq, const uint8_t *grid) {
+  hint_put(&hints, seq, grid, 64);
+  if (summarizer) {
+    xTaskNotifyGive(summarizer);
+  }
+}
+
+int summary_get(uint32_t from, uint32_t to, summary_key_t *keys, int n) {
+  if (!hours || n < 1 || to <= from) {
+    return 0;
+  }
+  // Room for the working set plus one more hour before merging again
+  summary_key_t *all = (summary_key_t *)malloc((SUMMARY_MAX_KEYS + SUMMARY_HOUR_KEYS) * sizeof(summary_key_t));
+  if (!all) {
+    return 0;
+  }
+  int count = 0;
+  xSemaphoreTake(summary_lock, portMAX_DELAY);
+  for (uint32_t hour = from / 3600; hour <= (to - 1) / 3600; hour++) {
+    hour_t *h = slot(hour, false);
+    if (!h) {
+      continue;
+    }
+    memcpy(all + count, h->keys, h->count * sizeof(summary_key_t));
+    count += h->count;
+    while (count > SUMMARY_MAX_KEYS) {
+      count = merge_weakest(all, count);
+    }
+  }
+  xSemaphoreGive(summary_lock);
+  while (count > n) {
+    count = merge_weakest(all, count);
+  }
+  memcpy(keys, all, count * sizeof(summary_key_t));
+  free(all);
+  return count;
+}
+
+int summary_print_json(char *buf, size_t len) {
+  int n = snprintf(buf, len, "{\"frames\":%u,\"hours_written\":%u,\"hours_kept\":%u}", frames_seen, hours_written, hour_slots);
+  return n < (int)len ? n : (len ? len - 1 : 0);
+}
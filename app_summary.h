@@ -0,0 +1,54 @@
+/*
+ * Scene-change summaries of the recordings
+ *
+ * A low-priority task follows the catalog and scores each stored frame by
+ * how much it differs from the one before: the mean absolute difference of
+ * their 8x8 brightness maps (jpeg_dc_grid(), compressed domain only), so
+ * lighting shifts and noise score low and cuts score high. The recorder
+ * hands over the maps it already computed; other frames are read back.
+ *
+ * Every frame opens a segment, keyed by the frame and running until the
+ * next. Each hour keeps its SUMMARY_HOUR_KEYS best segments: whenever one
+ * too many are open, the one with the weakest cut is merged into the
+ * segment before it, so the hour stays covered without gaps and what
+ * remains are its strongest scene changes. A day summary merges the hours
+ * of the day the same way, down to the requested number of keyframes.
+ *
+ * Finished hours are appended to SUMMARY_PATH; the current hour is rebuilt
+ * from the catalog after a restart.
+ */
+
+#ifndef APP_SUMMARY_H
+#define APP_SUMMARY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "FS.h"
+
+#define SUMMARY_PATH        "/summary.bin"
+#define SUMMARY_HOUR_KEYS   16
+#define SUMMARY_DAYS        31  // hours kept in memory, as whole days
+#define SUMMARY_MAX_KEYS    (24 * SUMMARY_HOUR_KEYS)
+#define SUMMARY_BACKFILL_S  (24 * 3600)  // first run: summarize this far back
+
+typedef struct {
+  uint32_t seq;    // keyframe: first frame after the scene change
+  uint32_t start;  // unix seconds of the keyframe
+  uint32_t end;    // unix seconds of the last frame in the segment
+  uint16_t score;  // cut strength, mean brightness change x 16
+  uint16_t frames;
+} summary_key_t;
+
+// Start the summarizer task (storage may still be coming up)
+bool summary_start(fs::FS &fs);
+
+// 8x8 brightness map of a frame about to be stored, saves reading it back
+void summary_hint(uint32_t seq, const uint8_t *grid);
+
+// Keyframes of [from, to) (whole UTC hours), merged down to at most n,
+// oldest first; returns how many
+int summary_get(uint32_t from, uint32_t to, summary_key_t *keys, int n);
+
+int summary_print_json(char *buf, size_t len);
+
+#endif  // APP_SUMMARY_H
@@ -0,0 +1,167 @@
+// Shared scaled-down transcodes of live frames
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "img_converters.h"
+#include "app_transcode.h"
+
+static transcode_t slots[TRANSCODE_SLOTS];
+static portMUX_TYPE transcode_mux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t work = NULL;  // one transcode at a time, lookups under it too
+static uint8_t *scratch = NULL;        // RGB565 at the reduced size
+static size_t scratch_size = 0;
+static uint32_t use_clock = 0;
+static uint32_t hits = 0;
+static uint32_t transcodes = 0;
+static uint32_t failures = 0;
+static uint64_t total_us = 0;
+
+jpg_scale_t transcode_jpg_scale(uint8_t scale) {
+  switch (scale) {
+    case 2:  return JPG_SCALE_2X;
+    case 4:  return JPG_SCALE_4X;
+    case 8:  return JPG_SCALE_8X;
+    default: return JPG_SCALE_NONE;
+  }
+}
+
+void transcode_scaled_size(uint16_t width, uint16_t height, uint8_t scale, uint16_t *w, uint16_t *h) {
+  *w = width / scale;
+  *h = height / scale;
+}
+
+void transcode_init() {
+  if (!work) {
+    work = xSemaphoreCreateMutex();
+  }
+}
+
+static transcode_t *lookup(uint32_t seq, uint8_t scale) {
+  transcode_t *found = NULL;
+  portENTER_CRITICAL(&transcode_mux);
+  for (int i = 0; i < TRANSCODE_SLOTS; i++) {
+    if (slots[i].buf && slots[i].seq == seq && slots[i].scale == scale) {
+      found = &slots[i];
+      found->refs++;
+      found->last_used = ++use_clock;
+      hits++;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&transcode_mux);
+  return found;
+}
+
+// Free slot, or the least recently used one nobody holds
+static transcode_t *victim() {
+  transcode_t *v = NULL;
+  portENTER_CRITICAL(&transcode_mux);
+  for (int i = 0; i < TRANSCODE_SLOTS; i++) {
+    transcode_t *t = &slots[i];
+    if (t->refs) {
+      continue;
+    }
+    if (!t->buf) {
+      v = t;
+      break;
+    }
+    if (!v || t->last_used < v->last_used) {
+      v = t;
+    }
+  }
+  portEXIT_CRITICAL(&transcode_mux);
+  return v;
+}
+
+static bool transcode(camera_fb_t *fb, uint8_t scale, transcode_t *t) {
+  uint16_t w, h;
+  transcode_scaled_size(fb->width, fb->height, scale, &w, &h);
+  size_t need = (size_t)w * h * 2;
+  if (need > scratch_size) {
+    free(scratch);
+    scratch = (uint8_t *)(psramFound() ? ps_malloc(need) : malloc(need));
+    scratch_size = scratch ? need : 0;
+    if (!scratch) {
+      log_e("Transcode: cannot allocate %u bytes", need);
+      return false;
+    }
+  }
+  if (!jpg2rgb565(fb->buf, fb->len, scratch, transcode_jpg_scale(scale))) {
+    log_e("Transcode: decode failed");
+    return false;
+  }
+  uint8_t *out = NULL;
+  size_t out_len = 0;
+  if (!fmt2jpg(scratch, (size_t)w * h * 2, w, h, PIXFORMAT_RGB565, TRANSCODE_QUALITY, &out, &out_len)) {
+    log_e("Transcode: encode failed");
+    return false;
+  }
+  t->buf = out;
+  t->len = out_len;
+  t->width = w;
+  t->height = h;
+  return true;
+}
+
+transcode_t *transcode_get(frame_t *frame, uint8_t scale) {
+  camera_fb_t *fb = frame->fb;
+  if (!work || fb->format != PIXFORMAT_JPEG || transcode_jpg_scale(scale) == JPG_SCALE_NONE) {
+    return NULL;
+  }
+  xSemaphoreTake(work, portMAX_DELAY);
+  transcode_t *t = lookup(frame->seq, scale);
+  if (t) {
+    xSemaphoreGive(work);
+    return t;
+  }
+  // Lookups only run under work, so nobody can take a reference to the
+  // victim while it is being replaced
+  t = victim();
+  if (!t) {
+    xSemaphoreGive(work);
+    log_w("Transcode: all %d slots in use", TRANSCODE_SLOTS);
+    return NULL;
+  }
+  free(t->buf);
+  t->buf = NULL;
+
+  int64_t start = esp_timer_get_time();
+  bool ok = transcode(fb, scale, t);
+  int64_t took = esp_timer_get_time() - start;
+
+  portENTER_CRITICAL(&transcode_mux);
+  if (ok) {
+    t->seq = frame->seq;
+    t->scale = scale;
+    t->refs = 1;
+    t->last_used = ++use_clock;
+    transcodes++;
+    total_us += took;
+  } else {
+    failures++;
+  }
+  portEXIT_CRITICAL(&transcode_mux);
+  xSemaphoreGive(work);
+  return ok ? t : NULL;
+}
+
+void transcode_release(transcode_t *t) {
+  if (!t) {
+    return;
+  }
+  portENTER_CRITICAL(&transcode_mux);
+  if (t->refs) {
+    t->refs--;
+  }
+  portEXIT_CRITICAL(&transcode_mux);
+}
+
+int transcode_print_json(char *buf, size_t len) {
+  portENTER_CRITICAL(&transcode_mux);
+  uint32_t h = hits, n = transcodes, f = failures;
+  uint64_t us = total_us;
+  portEXIT_CRITICAL(&transcode_mux);
+  uint32_t avg_ms = n ? us / n / 1000 : 0;
+  int r = snprintf(buf, len, "{\"transcodes\":%u,\"hits\":%u,\"failures\":%u,\"avg_ms\":%u,\"quality\":%d}", n, h, f, avg_ms, TRANSCODE_QUALITY);
+  return r < (int)len ? r : (len ? len - 1 : 0);
+}
@@ -0,0 +1,51 @@
+/*
+ * Reduced-resolution copies of live frames
+ *
+ * Slow links ask for /stream?scale=2, 4 or 8. The frame is decoded straight
+ * at that scale (the decoder's scaled IDCT, so the full-size image is never
+ * produced), then encoded again at TRANSCODE_QUALITY. Results are cached per
+ * (frame, scale) and reference counted like frames, so any number of viewers
+ * at one scale, each served on its own task, cost one transcode per frame.
+ * Transcodes run one at a time:
+ * a second viewer of the same frame waits for the first and then hits the
+ * cache. The recorder and full-size viewers are not affected.
+ */
+
+#ifndef APP_TRANSCODE_H
+#define APP_TRANSCODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "img_converters.h"
+#include "app_frame.h"
+
+#define TRANSCODE_QUALITY 60  // fmt2jpg quality, 1-100
+#define TRANSCODE_SLOTS   6   // kept results; a slot in use is never evicted
+
+typedef struct {
+  uint8_t *buf;  // JPEG
+  size_t len;
+  uint16_t width;
+  uint16_t height;
+  uint32_t seq;   // frame it was made from
+  uint8_t scale;  // 2, 4 or 8
+  uint8_t refs;   // owned by app_transcode
+  uint32_t last_used;
+} transcode_t;
+
+void transcode_init();
+
+// Decoder setting for a reduction by 1, 2, 4 or 8 (JPG_SCALE_NONE otherwise)
+jpg_scale_t transcode_jpg_scale(uint8_t scale);
+// Size of the RGB565 image jpg2rgb565() writes at that reduction: the
+// decoder rounds down, dropping partial pixels at the right and bottom
+void transcode_scaled_size(uint16_t width, uint16_t height, uint8_t scale, uint16_t *w, uint16_t *h);
+
+// frame (JPEG) reduced by scale; NULL for other scales or formats, or when
+// every slot is in use. Release it with transcode_release().
+transcode_t *transcode_get(frame_t *frame, uint8_t scale);
+void transcode_release(transcode_t *t);
+
+int transcode_print_json(char *buf, size_t len);
+
+#endif  // APP_TRANSCODE_H
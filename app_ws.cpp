@@ -0,0 +1,162 @@
+// WebSocket live view with credit-based flow control
+#include "Arduino.h"
+#include "sdkconfig.h"
+#include "freertos/task.h"
+#include "app_frame.h"
+#include "app_ws.h"
+
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+
+typedef struct {
+  bool used;
+  httpd_handle_t hd;
+  int fd;
+  int credits;
+} ws_client_t;
+
+static ws_client_t clients[WS_MAX_CLIENTS];
+static portMUX_TYPE ws_mux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t ws_task = NULL;
+
+static bool send_frame(ws_client_t *client, const frame_t *frame) {
+  ws_frame_header_t hdr;
+  hdr.version = 1;
+  hdr.header_len = sizeof(hdr);
+  hdr.reserved = 0;
+  hdr.seq = frame->seq;
+  hdr.timestamp_us = frame->captured_us;
+  hdr.size = frame->fb->len;
+  hdr.width = frame->fb->width;
+  hdr.height = frame->fb->height;
+
+  // One message in two fragments: header, then the JPEG from the frame buffer
+  httpd_ws_frame_t head;
+  memset(&head, 0, sizeof(head));
+  head.type = HTTPD_WS_TYPE_BINARY;
+  head.fragmented = true;
+  head.final = false;
+  head.payload = (uint8_t *)&hdr;
+  head.len = sizeof(hdr);
+
+  httpd_ws_frame_t body;
+  memset(&body, 0, sizeof(body));
+  body.type = HTTPD_WS_TYPE_CONTINUE;
+  body.fragmented = true;
+  body.final = true;
+  body.payload = frame->fb->buf;
+  body.len = frame->fb->len;
+
+  return httpd_ws_send_frame_async(client->hd, client->fd, &head) == ESP_OK && httpd_ws_send_frame_async(client->hd, client->fd, &body) == ESP_OK;
+}
+
+static bool wants_frame() {
+  bool any = false;
+  portENTER_CRITICAL(&ws_mux);
+  for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+    any |= clients[i].used && clients[i].credits > 0;
+  }
+  portEXIT_CRITICAL(&ws_mux);
+  return any;
+}
+
+static void ws_stream_task(void *arg) {
+  uint32_t last_seq = 0;
+  while (true) {
+    if (!wants_frame()) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      continue;
+    }
+    frame_t *frame = frame_get(last_seq, 1000 / portTICK_PERIOD_MS);
+    if (!frame) {
+      continue;
+    }
+    last_seq = frame->seq;
+    if (frame->fb->format == PIXFORMAT_JPEG) {
+      for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        ws_client_t *client = &clients[i];
+        portENTER_CRITICAL(&ws_mux);
+        bool send = client->used && client->credits > 0;
+        if (send) {
+          client->credits--;
+        }
+        portEXIT_CRITICAL(&ws_mux);
+        if (send && !send_frame(client, frame)) {
+          log_w("WS: client %d gone", client->fd);
+          httpd_sess_trigger_close(client->hd, client->fd);
+          ws_stream_forget(client->hd, client->fd);
+        }
+      }
+    }
+    frame_release(frame);
+  }
+}
+
+bool ws_stream_init() {
+  if (ws_task) {
+    return true;
+  }
+  if (xTaskCreate(ws_stream_task, "ws_stream", 4096, NULL, 4, &ws_task) != pdPASS) {
+    log_e("WS: cannot create task");
+    return false;
+  }
+  return true;
+}
+
+bool ws_stream_add(httpd_handle_t hd, int fd) {
+  ws_client_t *client = NULL;
+  portENTER_CRITICAL(&ws_mux);
+  for (int i = 0; i < WS_MAX_CLIENTS && !client; i++) {
+    if (!clients[i].used) {
+      client = &clients[i];
+      client->used = true;
+      client->hd = hd;
+      client->fd = fd;
+      client->credits = WS_INITIAL_CREDITS;
+    }
+  }
+  portEXIT_CRITICAL(&ws_mux);
+  if (client && ws_task) {
+    xTaskNotifyGive(ws_task);
+  }
+  return client != NULL;
+}
+
+bool ws_stream_credit(httpd_handle_t hd, int fd, int credits) {
+  bool found = false;
+  portENTER_CRITICAL(&ws_mux);
+  for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+    ws_client_t *client = &clients[i];
+    if (client->used && client->hd == hd && client->fd == fd) {
+      client->credits += credits;
+      if (client->credits > WS_MAX_CREDITS) {
+        client->credits = WS_MAX_CREDITS;
+      }
+      found = true;
+    }
+  }
+  portEXIT_CRITICAL(&ws_mux);
+  if (found && ws_task) {
+    xTaskNotifyGive(ws_task);
+  }
+  return found;
+}
+
+void ws_stream_forget(httpd_handle_t hd, int fd) {
+  portENTER_CRITICAL(&ws_mux);
+  for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+    if (clients[i].used && clients[i].hd == hd && clients[i].fd == fd) {
+      clients[i].used = false;
+    }
+  }
+  portEXIT_CRITICAL(&ws_mux);
+}
+
+int ws_stream_client_count() {
+  int count = 0;
+  for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+    count += clients[i].used ? 1 : 0;
+  }
+  return count;
+}
+
+#endif  // CONFIG_HTTPD_WS_SUPPORT
@@ -0,0 +1,49 @@
+/*
+ * WebSocket live view (/ws/stream)
+ *
+ * Each JPEG is sent as one binary WebSocket message: a fixed little-endian
+ * header (ws_frame_header_t) followed by the JPEG bytes. The message goes
+ * out as two fragments so the JPEG is sent straight from the shared frame
+ * buffer without being copied behind the header.
+ *
+ * Flow control is credit based: a client gets one frame per credit and
+ * grants more by sending a text message with a number ("2"). A client that
+ * is still decoding simply has no credits and skips frames, so a slow
+ * browser always gets the newest frame instead of a growing backlog.
+ */
+
+#ifndef APP_WS_H
+#define APP_WS_H
+
+#include <stdint.h>
+#include "esp_http_server.h"
+
+#define WS_MAX_CLIENTS     4
+#define WS_INITIAL_CREDITS 1
+#define WS_MAX_CREDITS     8
+
+typedef struct __attribute__((packed)) {
+  uint8_t version;        // 1
+  uint8_t header_len;     // sizeof(ws_frame_header_t), JPEG starts here
+  uint16_t reserved;
+  uint32_t seq;           // frame hub sequence number
+  uint64_t timestamp_us;  // sensor capture time (esp_timer)
+  uint32_t size;          // JPEG bytes
+  uint16_t width;
+  uint16_t height;
+} ws_frame_header_t;
+
+bool ws_stream_init();
+
+// A client finished the handshake on this socket
+bool ws_stream_add(httpd_handle_t hd, int fd);
+
+// Add credits for a client; returns false if the socket is not a client
+bool ws_stream_credit(httpd_handle_t hd, int fd, int credits);
+
+// Session close hook
+void ws_stream_forget(httpd_handle_t hd, int fd);
+
+int ws_stream_client_count();
+
+#endif  // APP_WS_H
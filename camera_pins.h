@@ -336,3 +336,39 @@
 #else
 #error "Camera model not selected"
 #endif
+
+// SD card on the SDMMC host (slot 1). On the ESP32 these pins are fixed by
+// the IOMUX. 4-bit mode additionally needs D1-D3, which several boards also
+// route to the flash LED or the camera, so it is only offered when none of
+// them collide with the pins above.
+#if CONFIG_IDF_TARGET_ESP32
+#define SD_MMC_CLK_GPIO_NUM 14
+#define SD_MMC_CMD_GPIO_NUM 15
+#define SD_MMC_D0_GPIO_NUM  2
+#define SD_MMC_D1_GPIO_NUM  4
+#define SD_MMC_D2_GPIO_NUM  12
+#define SD_MMC_D3_GPIO_NUM  13
+
+#if defined(LED_GPIO_NUM)
+#define SD_MMC_LED_PIN LED_GPIO_NUM
+#else
+#define SD_MMC_LED_PIN -1
+#endif
+
+#define SD_MMC_PIN_USED(p)                                                                                                                           \
+  ((p) == SD_MMC_LED_PIN || (p) == PWDN_GPIO_NUM || (p) == RESET_GPIO_NUM || (p) == XCLK_GPIO_NUM || (p) == SIOD_GPIO_NUM || (p) == SIOC_GPIO_NUM \
+   || (p) == Y2_GPIO_NUM || (p) == Y3_GPIO_NUM || (p) == Y4_GPIO_NUM || (p) == Y5_GPIO_NUM || (p) == Y6_GPIO_NUM || (p) == Y7_GPIO_NUM           \
+   || (p) == Y8_GPIO_NUM || (p) == Y9_GPIO_NUM || (p) == VSYNC_GPIO_NUM || (p) == HREF_GPIO_NUM || (p) == PCLK_GPIO_NUM)
+
+// Define SD_MMC_ALLOW_4BIT to use 4-bit mode on boards where D1 doubles as
+// the flash LED (AI-Thinker); the LED then flickers with SD traffic.
+#if defined(SD_MMC_ALLOW_4BIT) \
+  || !(SD_MMC_PIN_USED(SD_MMC_D1_GPIO_NUM) || SD_MMC_PIN_USED(SD_MMC_D2_GPIO_NUM) || SD_MMC_PIN_USED(SD_MMC_D3_GPIO_NUM))
+#define SD_MMC_4BIT_CAPABLE 1
+#else
+#define SD_MMC_4BIT_CAPABLE 0
+#endif
+#else
+// Other targets keep the variant's default SDMMC pins in 1-bit mode
+#define SD_MMC_4BIT_CAPABLE 0
+#endif
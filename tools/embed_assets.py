@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""Embed the CSS/JS under web/ into web_assets.h.
+
+Each file is gzip-compressed and written as a flash-resident byte array,
+together with a versioned URL (/assets/<name>.<hash>.<ext>) and an ETag,
+both taken from a hash of the file contents. The pages link to the
+versioned URLs, so the assets can be cached forever by the browser and a
+changed file is picked up through its new URL.
+
+Run from the sketch directory after editing anything in web/:
+
+    python3 tools/embed_assets.py
+"""
+
+import gzip
+import hashlib
+import os
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+WEB_DIR = os.path.join(ROOT, "web")
+OUT_PATH = os.path.join(ROOT, "web_assets.h")
+
+MIME_TYPES = {
+    ".css": "text/css",
+    ".js": "application/javascript",
+}
+
+
+def c_array(data):
+    lines = []
+    for i in range(0, len(data), 26):
+        lines.append("  " + ", ".join("0x%02X" % b for b in data[i:i + 26]) + ",")
+    return "\n".join(lines)
+
+
+def main():
+    names = sorted(n for n in os.listdir(WEB_DIR) if os.path.splitext(n)[1] in MIME_TYPES)
+    if not names:
+        sys.exit("no assets found in %s" % WEB_DIR)
+
+    out = [
+        "// Generated by tools/embed_assets.py from web/, do not edit",
+        "",
+        "#ifndef WEB_ASSETS_H",
+        "#define WEB_ASSETS_H",
+        "",
+        "#include <stddef.h>",
+        "#include <stdint.h>",
+        "",
+        "typedef struct {",
+        "  const char *uri;   // versioned URL, e.g. /assets/home.1a2b3c4d.css",
+        "  const char *type;",
+        "  const char *etag;",
+        "  const uint8_t *data;  // gzip",
+        "  size_t len;",
+        "} web_asset_t;",
+        "",
+    ]
+    table = []
+    for name in names:
+        with open(os.path.join(WEB_DIR, name), "rb") as f:
+            raw = f.read()
+        digest = hashlib.sha256(raw).hexdigest()[:8]
+        stem, ext = os.path.splitext(name)
+        ident = "%s_%s" % (stem, ext[1:])
+        uri = "/assets/%s.%s%s" % (stem, digest, ext)
+        # mtime=0 keeps the output stable across runs
+        packed = gzip.compress(raw, compresslevel=9, mtime=0)
+
+        out.append("#define ASSET_%s \"%s\"" % (ident.upper(), uri))
+        out.append("//File: %s.gz, Size: %d (%d uncompressed)" % (name, len(packed), len(raw)))
+        out.append("#define %s_gz_len %d" % (ident, len(packed)))
+        out.append("static const uint8_t %s_gz[] = {" % ident)
+        out.append(c_array(packed))
+        out.append("};")
+        out.append("")
+        table.append('  {ASSET_%s, "%s", "\\"%s\\"", %s_gz, %s_gz_len},' % (ident.upper(), MIME_TYPES[ext], digest, ident, ident))
+
+    out.append("static const web_asset_t web_assets[] = {")
+    out.extend(table)
+    out.append("};")
+    out.append("#define WEB_ASSET_COUNT (sizeof(web_assets) / sizeof(web_assets[0]))")
+    out.append("")
+    out.append("#endif  // WEB_ASSETS_H")
+    out.append("")
+
+    with open(OUT_PATH, "w") as f:
+        f.write("\n".join(out))
+    print("wrote %s (%d assets)" % (os.path.relpath(OUT_PATH, ROOT), len(names)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,84 @@
+// Virtual scrolling over the whole catalog via /api/images. The listing is
+// pinned to an anchor cursor, so rows do not shift while frames are written;
+// blocks are fetched on demand with skip= and dropped again when far away.
+const ROW = 100, CELL = 110, BLOCK = 60;
+const list = document.getElementById('list'), spacer = document.getElementById('spacer'), win = document.getElementById('window');
+const info = document.getElementById('info'), fresh = document.getElementById('fresh');
+let anchor = null, total = 0, cols = 1, blocks = new Map(), queued = false, pending = 0;
+
+function range() {
+  let q = '';
+  for (const id of ['from', 'to']) {
+    const v = document.getElementById(id).value;
+    if (v) q += '&' + id + '=' + Math.floor(new Date(v).getTime() / 1000);
+  }
+  return q;
+}
+
+// Answers that arrive after reload() belong to the old filter: each request
+// remembers the map it was made for and drops its result if that map is gone
+function fetchBlock(k) {
+  const map = blocks;
+  map.set(k, null);
+  fetch('/api/images?limit=' + BLOCK + '&cursor=' + anchor + '&skip=' + k * BLOCK + range())
+    .then(r => r.json()).then(d => { if (map === blocks) { map.set(k, d.images); schedule(); } })
+    .catch(() => map.delete(k));
+}
+
+function render() {
+  queued = false;
+  cols = Math.max(1, Math.floor(list.clientWidth / CELL));
+  win.style.gridTemplateColumns = 'repeat(' + cols + ',1fr)';
+  spacer.style.height = Math.ceil(total / cols) * ROW + 'px';
+  const r0 = Math.max(0, Math.floor(list.scrollTop / ROW) - 2);
+  const r1 = Math.ceil((list.scrollTop + list.clientHeight) / ROW) + 2;
+  const first = r0 * cols, last = Math.min(total, r1 * cols);
+  let html = '';
+  for (let i = first; i < last; i++) {
+    const k = Math.floor(i / BLOCK);
+    if (!blocks.has(k)) fetchBlock(k);
+    const img = blocks.get(k) && blocks.get(k)[i % BLOCK];
+    html += img
+      ? "<div class='cell'><img src='" + img.thumb + "' data-full='/image/" + img.name + "' loading='lazy'>" + img.name + '<br>' + (img.size / 1024).toFixed(1) + ' KB</div>'
+      : "<div class='cell'></div>";
+  }
+  win.style.transform = 'translateY(' + r0 * ROW + 'px)';
+  win.innerHTML = html;
+  // Keep a few blocks around the view, forget the rest
+  const keep = Math.floor(first / BLOCK);
+  for (const k of blocks.keys()) if (Math.abs(k - keep) > 4) blocks.delete(k);
+}
+
+function schedule() {
+  if (!queued) { queued = true; requestAnimationFrame(render); }
+}
+
+function reload() {
+  const map = blocks = new Map();
+  pending = 0;
+  fresh.hidden = true;
+  list.scrollTop = 0;
+  fetch('/api/images?limit=' + BLOCK + range()).then(r => r.json()).then(d => {
+    if (map !== blocks) return;
+    anchor = d.anchor;
+    total = d.total;
+    blocks.set(0, d.images);
+    info.textContent = total + ' images';
+    schedule();
+  }).catch(e => { if (map === blocks) info.textContent = 'Catalog unavailable'; console.error(e); });
+}
+
+list.addEventListener('scroll', schedule);
+window.addEventListener('resize', schedule);
+win.addEventListener('click', e => { if (e.target.dataset.full) window.open(e.target.dataset.full, '_blank'); });
+document.getElementById('from').addEventListener('change', reload);
+document.getElementById('to').addEventListener('change', reload);
+fresh.addEventListener('click', reload);
+if (window.EventSource) {
+  new EventSource('/events').addEventListener('recording', () => {
+    pending++;
+    fresh.textContent = pending + ' new';
+    fresh.hidden = false;
+  });
+}
+reload();
@@ -0,0 +1,26 @@
+document.querySelectorAll('img').forEach(img=>{
+  img.classList.add('loading');
+  img.onload=()=>{img.classList.remove('loading');img.style.opacity='1';};
+  img.onerror=()=>{img.classList.remove('loading');img.style.opacity='0.3';};
+});
+document.querySelectorAll('.image-card img').forEach(img=>{
+  img.onclick=()=>window.open(img.dataset.full,'_blank');
+});
+let loaded=0,total=document.querySelectorAll('img').length;
+document.querySelectorAll('img').forEach(img=>{
+  img.addEventListener('load',()=>{
+    loaded++;if(loaded===total)console.log('Page images loaded: '+loaded+'/'+total);
+  });
+});
+// New recordings appear at the top of the first page without a reload
+const g=document.querySelector('.gallery');
+if(window.EventSource&&g&&!/[?&]page=([2-9]|\d\d)/.test(location.search)){
+  new EventSource('/events').addEventListener('recording',e=>{
+    const r=JSON.parse(e.data),c=document.createElement('div');
+    c.className='image-card';
+    c.innerHTML="<div class='new-badge'>NEW</div><img src='/image/"+r.name+"?thumb=1' loading='lazy'>"+
+      "<div class='image-info'>"+r.name+"<br>"+(r.size/1024).toFixed(1)+" KB</div>";
+    c.querySelector('img').onclick=()=>window.open('/image/'+r.name,'_blank');
+    g.prepend(c);
+  });
+}
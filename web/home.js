@@ -0,0 +1,41 @@
+let flashEnabled = false, statusEnabled = false;
+function toggleFlashLED() {
+  flashEnabled = !flashEnabled;
+  fetch('/control?var=led_enabled&val=' + (flashEnabled ? 1 : 0))
+    .then(r => {
+      document.getElementById('flashToggle').textContent = '🔦 Flash: ' + (flashEnabled ? 'ON' : 'OFF');
+      document.getElementById('flashToggle').style.background = flashEnabled ? '#4CAF50' : '#666';
+    }).catch(e => console.error('Flash LED failed:', e));
+}
+function toggleStatusLED() {
+  statusEnabled = !statusEnabled;
+  fetch('/control?var=status_led&val=' + (statusEnabled ? 1 : 0))
+    .then(r => {
+      document.getElementById('statusToggle').textContent = '🔴 Status: ' + (statusEnabled ? 'ON' : 'OFF');
+      document.getElementById('statusToggle').style.background = statusEnabled ? '#4CAF50' : '#666';
+    }).catch(e => console.error('Status LED failed:', e));
+}
+function loadStatus() {
+  fetch('/status').then(r=>r.json()).then(d=>{
+    flashEnabled = d.led_enabled === 1;
+    statusEnabled = d.status_led === 1;
+    document.getElementById('flashToggle').textContent = '🔦 Flash: ' + (flashEnabled ? 'ON' : 'OFF');
+    document.getElementById('flashToggle').style.background = flashEnabled ? '#4CAF50' : '#666';
+    document.getElementById('statusToggle').textContent = '🔴 Status: ' + (statusEnabled ? 'ON' : 'OFF');
+    document.getElementById('statusToggle').style.background = statusEnabled ? '#4CAF50' : '#666';
+  }).catch(e=>console.error('Status load failed:', e));
+}
+loadStatus();
+if (window.EventSource) {
+  const es = new EventSource('/events');
+  es.addEventListener('state', loadStatus);
+  es.addEventListener('overflow', loadStatus);
+  es.addEventListener('metrics', e => {
+    const m = JSON.parse(e.data);
+    document.getElementById('metrics').textContent = m.fps.toFixed(1) + ' fps · ' + m.stored + ' saved · ' + m.dropped + ' dropped · ' + (m.heap >> 10) + ' KB free';
+  });
+  es.addEventListener('recording', e => {
+    const r = JSON.parse(e.data);
+    document.getElementById('lastShot').textContent = 'Last saved: ' + r.name + ' (' + (r.size / 1024).toFixed(1) + ' KB)';
+  });
+}
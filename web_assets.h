@@ -0,0 +1,231 @@
+// Generated by tools/embed_assets.py from web/, do not edit
+
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  const char *uri;   // versioned URL, e.g. /assets/home.1a2b3c4d.css
+  const char *type;
+  const char *etag;
+  const uint8_t *data;  // gzip
+  size_t len;
+} web_asset_t;
+
+#define ASSET_BROWSE_CSS "/assets/browse.a1bee004.css"
+//File: browse.css.gz, Size: 420 (773 uncompressed)
+#define browse_css_gz_len 420
+static const uint8_t browse_css_gz[] = {
+  0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x8D, 0x52, 0xD1, 0x8E, 0xDC, 0x20, 0x0C, 0x7C, 0xEF, 0x57, 0x44, 0x5A, 0x55, 0xBA, 0x93, 0x9A,
+  0x13, 0xB9, 0xBD, 0x6E, 0xAF, 0xF0, 0xD4, 0x4F, 0x21, 0xC1, 0x24, 0x6E, 0x59, 0x1C, 0x01, 0xD9, 0x64, 0x1B, 0xF5, 0xDF, 0x6B, 0xC8, 0x45, 0xCD, 0x55, 0x7D,
+  0x68, 0xAC, 0x20, 0x04, 0x8C, 0x3D, 0x9E, 0x71, 0x4B, 0xE6, 0xBE, 0x5A, 0xF2, 0xA9, 0xB6, 0xFA, 0x8A, 0xEE, 0x2E, 0xBF, 0x05, 0xD4, 0x4E, 0x5D, 0x75, 0xE8,
+  0xD1, 0x4B, 0xA1, 0x5A, 0xDD, 0xFD, 0xE8, 0x03, 0x4D, 0xDE, 0xC8, 0x93, 0x15, 0x39, 0xD4, 0xAF, 0x0F, 0x4F, 0xAD, 0x0E, 0xAB, 0xC1, 0x38, 0x3A, 0x7D, 0x97,
+  0xD6, 0xC1, 0xA2, 0xF2, 0x52, 0xCF, 0x41, 0x8F, 0x32, 0x2F, 0x4A, 0x3B, 0xEC, 0x7D, 0x8D, 0x09, 0xAE, 0x51, 0x76, 0xE0, 0x13, 0x04, 0xD5, 0xF3, 0x5D, 0xF3,
+  0x3C, 0x2E, 0x6A, 0xD4, 0xC6, 0xA0, 0xEF, 0x65, 0x23, 0xC6, 0xA5, 0x6A, 0x2E, 0x7C, 0x72, 0xA8, 0x31, 0x0F, 0x0C, 0x52, 0x2D, 0x2D, 0x75, 0x1C, 0xB4, 0xA1,
+  0x59, 0x8A, 0x8A, 0x31, 0xD5, 0x0B, 0xFF, 0xA1, 0x6F, 0xF5, 0x83, 0xF8, 0x54, 0xE2, 0xA9, 0x79, 0x54, 0x85, 0x74, 0xC4, 0x9F, 0x20, 0x1B, 0xBE, 0x7E, 0x63,
+  0x55, 0xE9, 0xB5, 0x23, 0x47, 0x41, 0x9E, 0xCE, 0xE7, 0xB3, 0x4A, 0xB0, 0xA4, 0xDA, 0x40, 0x47, 0x41, 0x27, 0x24, 0x2F, 0x3D, 0x79, 0xD8, 0x70, 0x33, 0x60,
+  0x3F, 0x24, 0xD9, 0x92, 0x33, 0x8C, 0x3C, 0xA1, 0xB7, 0xB4, 0x03, 0x2F, 0x97, 0x4B, 0x3E, 0xB2, 0x01, 0xE2, 0xB0, 0xBE, 0x6B, 0xDF, 0xBE, 0xF0, 0xA7, 0xB6,
+  0x67, 0x3B, 0xD1, 0x60, 0x20, 0x6C, 0x79, 0xB7, 0x7D, 0x1D, 0xB4, 0xC1, 0x29, 0xBE, 0x6F, 0x35, 0xD3, 0xCF, 0xED, 0xAA, 0x6E, 0x0A, 0x91, 0xC1, 0x23, 0x61,
+  0xD1, 0x84, 0xCB, 0x38, 0x8C, 0x69, 0x1D, 0x29, 0x62, 0x21, 0x18, 0xC0, 0x31, 0xD3, 0x1B, 0x28, 0xBA, 0x41, 0xB0, 0x8E, 0xE6, 0xFA, 0x2E, 0xF5, 0x94, 0x48,
+  0x0D, 0x1B, 0xDF, 0x4E, 0xBB, 0xEE, 0xA1, 0x11, 0xE2, 0x36, 0x54, 0x75, 0xF5, 0x99, 0xB5, 0x7B, 0xCC, 0x39, 0x66, 0xF4, 0x2C, 0xD5, 0x9F, 0x2C, 0xBA, 0x8D,
+  0xE4, 0x26, 0xA6, 0xE7, 0xC0, 0x26, 0xF6, 0x30, 0x14, 0xAC, 0x50, 0x89, 0x46, 0x5E, 0x77, 0xDF, 0xFA, 0x80, 0xA6, 0xB8, 0xF2, 0x7A, 0x60, 0x2A, 0xAA, 0xD7,
+  0x4D, 0xCB, 0x0E, 0x9C, 0x5B, 0xDF, 0xAA, 0x7E, 0x7D, 0xFE, 0xB7, 0x49, 0xC7, 0x7E, 0x8B, 0x8F, 0xFF, 0x63, 0xDB, 0xDE, 0x99, 0x1C, 0xD0, 0x18, 0xF0, 0x9B,
+  0x47, 0x65, 0x5E, 0xF6, 0x49, 0x39, 0x18, 0x5B, 0x34, 0x3B, 0xDA, 0x52, 0x78, 0x55, 0x78, 0xED, 0xD7, 0x19, 0x4D, 0x1A, 0xF8, 0x85, 0xF8, 0xB8, 0x8B, 0xF3,
+  0x25, 0xBF, 0xA6, 0xF6, 0x3B, 0x74, 0x3C, 0xCC, 0xC8, 0x62, 0xE5, 0x52, 0x7F, 0x4B, 0x7E, 0x34, 0x14, 0x44, 0x0E, 0xCE, 0xFA, 0x1B, 0x7D, 0x07, 0x1A, 0x6F,
+  0x05, 0x03, 0x00, 0x00,
+};
+
+#define ASSET_BROWSE_JS "/assets/browse.ac423f42.js"
+//File: browse.js.gz, Size: 1506 (3467 uncompressed)
+#define browse_js_gz_len 1506
+static const uint8_t browse_js_gz[] = {
+  0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x8D, 0x56, 0x5D, 0x6F, 0xDB, 0x36, 0x14, 0x7D, 0xF7, 0xAF, 0xB8, 0x0D, 0xB0, 0x48, 0xAA, 0x5D,
+  0x39, 0x29, 0x8A, 0x3D, 0xD4, 0x71, 0x8A, 0x26, 0x6B, 0xD1, 0xA1, 0x29, 0x0A, 0x6C, 0xC1, 0x8A, 0xA1, 0x28, 0x06, 0x5A, 0xA2, 0x6C, 0xCE, 0x94, 0xE8, 0x92,
+  0x94, 0x9D, 0xB4, 0xC8, 0x7F, 0xDF, 0xB9, 0xA4, 0xE4, 0xD8, 0xAD, 0x9B, 0x15, 0x48, 0x00, 0x8A, 0x3E, 0xBC, 0x9F, 0xE7, 0x1E, 0x72, 0x3C, 0xA6, 0xBF, 0x94,
+  0xF5, 0xAD, 0xD0, 0xE4, 0x0A, 0x6B, 0xB4, 0x56, 0xCD, 0x9C, 0xCC, 0x5A, 0x5A, 0xF2, 0x0B, 0x49, 0x9B, 0x85, 0xD1, 0x92, 0x0A, 0xE1, 0x85, 0x36, 0x73, 0x5A,
+  0x2B, 0x41, 0x63, 0xB1, 0x52, 0x63, 0x55, 0x8B, 0xB9, 0x74, 0x39, 0x5D, 0x03, 0xA2, 0x95, 0xF3, 0x7C, 0x46, 0xB9, 0xC1, 0x78, 0x4C, 0x2B, 0xD5, 0x34, 0xB2,
+  0x24, 0x6F, 0x48, 0x34, 0xF8, 0x2B, 0x16, 0xC6, 0x52, 0xD1, 0x5A, 0x67, 0xEC, 0x88, 0x9C, 0x21, 0x6B, 0x36, 0x8E, 0x4A, 0x43, 0x8D, 0xF1, 0xE4, 0x16, 0xAA,
+  0xF2, 0xF0, 0xA0, 0xE0, 0xA1, 0xB2, 0xA2, 0x96, 0x8E, 0x84, 0x85, 0x4B, 0xAB, 0xBC, 0x97, 0xCD, 0x84, 0xAD, 0xCD, 0xB4, 0x29, 0x96, 0x71, 0xBB, 0x92, 0xBE,
+  0x58, 0xC0, 0xB2, 0x69, 0xA8, 0x94, 0xB5, 0x68, 0x4A, 0xDA, 0x28, 0xBF, 0x20, 0xB7, 0x54, 0xAB, 0x29, 0xF1, 0x67, 0x69, 0xCD, 0x6A, 0x05, 0x80, 0x98, 0x0B,
+  0xD5, 0xC0, 0xAC, 0x6C, 0xA8, 0x12, 0x96, 0xC4, 0x46, 0xDC, 0xE6, 0x83, 0xC2, 0x34, 0xCE, 0xD3, 0x1F, 0xEF, 0x3F, 0xD0, 0x94, 0x4E, 0x4F, 0x4E, 0x46, 0x74,
+  0xF9, 0xEA, 0xEA, 0x8A, 0xD7, 0xA7, 0x58, 0x5F, 0x5C, 0xBD, 0xBF, 0x7C, 0x8B, 0x8F, 0x5F, 0x4F, 0x26, 0x1D, 0x90, 0x73, 0xC2, 0x46, 0x69, 0x8A, 0xB6, 0x96,
+  0x8D, 0xCF, 0xE7, 0xD2, 0xBF, 0xD2, 0x92, 0x97, 0x17, 0xB7, 0xBF, 0x97, 0x69, 0xC2, 0xBF, 0x27, 0x19, 0x32, 0x5A, 0x89, 0x02, 0x95, 0x7A, 0x00, 0x19, 0x11,
+  0x8C, 0xDD, 0x20, 0xAA, 0x07, 0x80, 0xF8, 0xB9, 0x34, 0x9B, 0x24, 0xEB, 0x43, 0x50, 0x4D, 0x65, 0x1E, 0xC2, 0xF3, 0xEF, 0x6C, 0xB6, 0xB2, 0xD2, 0x2D, 0x1E,
+  0x02, 0x06, 0x00, 0xDB, 0xD5, 0xD2, 0xF7, 0x1D, 0x99, 0x52, 0xD3, 0x6A, 0x3D, 0x42, 0x9B, 0xD0, 0x58, 0x7C, 0xA1, 0x08, 0x85, 0xD1, 0x8E, 0x0B, 0x32, 0xEA,
+  0x8B, 0x0E, 0x8C, 0xDC, 0xD0, 0x3B, 0xB1, 0x4A, 0xE1, 0xE5, 0x73, 0x2B, 0x5B, 0xD4, 0x76, 0x8A, 0x92, 0x6A, 0x27, 0x47, 0xB4, 0x92, 0x4D, 0xC9, 0x4D, 0xC7,
+  0xD1, 0xC9, 0x60, 0x50, 0xB5, 0x4D, 0xE1, 0x15, 0x3A, 0x63, 0x45, 0x33, 0x97, 0x69, 0x46, 0x5F, 0x07, 0x44, 0xEC, 0xEE, 0x33, 0x00, 0x49, 0x32, 0xC1, 0x57,
+  0x05, 0xAF, 0x69, 0x97, 0x19, 0x9A, 0x58, 0xD1, 0x47, 0x04, 0x66, 0xEA, 0x64, 0x44, 0x89, 0x37, 0xC9, 0xA7, 0x78, 0x84, 0x28, 0x22, 0xD6, 0x0F, 0xE4, 0xA3,
+  0xCA, 0x2C, 0x5F, 0x0B, 0xDD, 0xCA, 0x49, 0x38, 0xA0, 0x2A, 0x4A, 0xD7, 0x19, 0x1C, 0x0D, 0xE1, 0xE9, 0x38, 0xA1, 0x21, 0x9B, 0x1F, 0x52, 0x32, 0xE5, 0xE5,
+  0x3B, 0xE1, 0x17, 0x79, 0xA5, 0x8D, 0xB1, 0x29, 0xE7, 0xF2, 0x9B, 0xF0, 0x12, 0x60, 0xB6, 0x78, 0xAD, 0x6A, 0x8E, 0x73, 0xCC, 0x64, 0x38, 0xC9, 0xD8, 0xD4,
+  0x1D, 0xFE, 0xAD, 0xF4, 0xAD, 0x6D, 0xE8, 0xF3, 0x64, 0x70, 0x37, 0x60, 0xFA, 0xBD, 0x6C, 0xDC, 0x46, 0x5A, 0x87, 0x49, 0x10, 0x28, 0x9D, 0xB5, 0x6A, 0x2D,
+  0x49, 0x54, 0x1E, 0x1D, 0xB7, 0x52, 0x1B, 0x51, 0xC2, 0xC2, 0x0C, 0x0B, 0xD4, 0x01, 0x7C, 0xE7, 0x71, 0x31, 0xBA, 0xA4, 0x4A, 0x69, 0x20, 0x9E, 0x93, 0x14,
+  0xC5, 0x02, 0x38, 0x54, 0xCE, 0x79, 0x36, 0x66, 0x91, 0x43, 0x3D, 0x8B, 0xE6, 0x24, 0xD5, 0x62, 0x45, 0x0A, 0xEC, 0x17, 0x0E, 0xCB, 0x52, 0x86, 0xFA, 0xF4,
+  0x2C, 0x76, 0xF8, 0xC5, 0x01, 0xEF, 0x5A, 0xED, 0x39, 0xC1, 0xE0, 0x3E, 0x1C, 0x70, 0x34, 0x37, 0x8D, 0xBC, 0xAF, 0x77, 0x18, 0x8A, 0x0B, 0xEE, 0x57, 0xBA,
+  0x8C, 0x25, 0x8C, 0x05, 0x64, 0xF0, 0xB4, 0x6B, 0x24, 0x27, 0x87, 0xEF, 0xDC, 0x49, 0x9F, 0x2E, 0x47, 0xA1, 0xF1, 0x21, 0xE1, 0x70, 0x36, 0x4D, 0x76, 0xE6,
+  0xF9, 0x85, 0x56, 0xB5, 0xF2, 0xA1, 0x72, 0x71, 0x24, 0x50, 0xC7, 0xE3, 0x38, 0xBC, 0x61, 0xB3, 0x23, 0x0F, 0xEF, 0x86, 0xB1, 0xE3, 0xBD, 0x25, 0x3D, 0xDE,
+  0x82, 0xBB, 0xEE, 0x67, 0xA1, 0x31, 0x39, 0xB2, 0x6C, 0x52, 0x50, 0xED, 0x9C, 0x6C, 0xFE, 0xAF, 0x33, 0x0D, 0x7E, 0x88, 0x7B, 0x25, 0xEF, 0x7D, 0x0D, 0x9D,
+  0x0B, 0x71, 0x4E, 0xFB, 0x48, 0x91, 0xC1, 0x6E, 0xA4, 0x65, 0x1E, 0xC3, 0xCA, 0x26, 0x50, 0x26, 0x8C, 0x7E, 0xAB, 0x61, 0x7C, 0x42, 0x77, 0x74, 0xD7, 0x79,
+  0x80, 0x2C, 0x21, 0x03, 0x34, 0x01, 0xF6, 0xF8, 0x5C, 0x29, 0xC1, 0x39, 0x89, 0x4A, 0x64, 0xA1, 0x81, 0xF7, 0xAC, 0x04, 0x59, 0xA5, 0xED, 0x68, 0xB9, 0xCF,
+  0xE4, 0x49, 0x28, 0x59, 0x60, 0x7E, 0x20, 0x4B, 0x2D, 0x6E, 0x52, 0x8C, 0xC0, 0x0E, 0x71, 0x78, 0xD4, 0xF3, 0x42, 0x2B, 0xF0, 0xEF, 0x83, 0x2A, 0xA1, 0x38,
+  0xE3, 0xA0, 0x1D, 0x59, 0xA8, 0x21, 0x86, 0x36, 0x77, 0xFE, 0x56, 0xCB, 0x7C, 0x6E, 0x55, 0x79, 0x2D, 0xEB, 0x95, 0x06, 0xC7, 0x2E, 0x8D, 0x6E, 0xEB, 0x86,
+  0x6D, 0x26, 0x56, 0xAE, 0xA4, 0xF0, 0x29, 0x57, 0x2A, 0xB8, 0x41, 0xED, 0x46, 0xA7, 0x95, 0xCD, 0xC2, 0x4C, 0x44, 0x6D, 0xE8, 0x0C, 0x2C, 0xA4, 0x9A, 0x2F,
+  0x7C, 0x1F, 0x47, 0x21, 0x95, 0x4E, 0xE3, 0x74, 0x8E, 0xC3, 0xC9, 0x0C, 0x75, 0x66, 0xF9, 0x82, 0x81, 0xD5, 0x4D, 0x32, 0xD9, 0x76, 0xDA, 0x9E, 0xEC, 0x86,
+  0x7E, 0xF2, 0x7D, 0xE8, 0x51, 0xD4, 0xAF, 0xCD, 0x0A, 0x86, 0x60, 0x20, 0xA3, 0x27, 0xF4, 0x34, 0xDB, 0x39, 0x7F, 0xBA, 0xE7, 0xF2, 0xDB, 0x33, 0x43, 0xDA,
+  0xC9, 0xFF, 0x4D, 0x08, 0x31, 0xEB, 0x0D, 0x0D, 0xE9, 0xE9, 0xBD, 0x9D, 0x4A, 0xD9, 0x20, 0x99, 0x88, 0xE7, 0x71, 0x08, 0x78, 0x44, 0x5A, 0xB8, 0x6D, 0x3E,
+  0xB5, 0x6A, 0x62, 0x3A, 0x23, 0xF6, 0x18, 0x11, 0x21, 0x0A, 0x56, 0x89, 0x85, 0xAF, 0xF5, 0xBE, 0x50, 0xF0, 0xAE, 0xE2, 0x1E, 0xB1, 0xD5, 0x09, 0x96, 0x67,
+  0xC1, 0x1A, 0x56, 0xC3, 0xE1, 0xBE, 0x54, 0x2C, 0x7B, 0x0F, 0x31, 0x65, 0x85, 0xE0, 0x02, 0x1D, 0xB3, 0x7B, 0x79, 0x78, 0x14, 0xD9, 0x95, 0x2F, 0x84, 0x63,
+  0x6E, 0xEC, 0x0F, 0xCD, 0x64, 0xC7, 0x96, 0xAA, 0xE7, 0xDB, 0xA9, 0x61, 0x91, 0xE0, 0x99, 0x3A, 0x3E, 0xDE, 0xDF, 0xF8, 0xA8, 0xE8, 0x97, 0xE8, 0xE1, 0x53,
+  0x3C, 0x1A, 0x82, 0x87, 0xF8, 0xE0, 0x70, 0xF8, 0x26, 0x7A, 0x41, 0x47, 0x67, 0xA5, 0x5A, 0x53, 0x81, 0x90, 0xDD, 0x34, 0x29, 0xA4, 0xD6, 0xC9, 0xF9, 0x19,
+  0x1B, 0x77, 0xB6, 0x98, 0x26, 0x47, 0xAC, 0x51, 0xF5, 0x1C, 0xB3, 0xD0, 0xD6, 0x33, 0xAC, 0x8F, 0x12, 0x2A, 0x71, 0xBF, 0x3E, 0xA9, 0x30, 0x98, 0xD3, 0x24,
+  0x8E, 0xE2, 0xB8, 0x07, 0x35, 0xB8, 0x16, 0x23, 0x86, 0xF5, 0x06, 0x8A, 0x3B, 0x4D, 0xB4, 0xF8, 0x72, 0x9B, 0x9C, 0x7F, 0x03, 0x48, 0xCE, 0x66, 0xF6, 0x9C,
+  0x59, 0x96, 0xF2, 0xA6, 0x53, 0x5F, 0x64, 0xD0, 0xB6, 0xA7, 0xCF, 0x30, 0x73, 0xE6, 0xB5, 0xBA, 0x91, 0x65, 0x7A, 0xCA, 0x1D, 0x4B, 0xE8, 0xED, 0xC5, 0xD9,
+  0x18, 0xD1, 0x9D, 0x27, 0x5D, 0xB4, 0xCF, 0x0F, 0x46, 0x1B, 0x20, 0x47, 0xBD, 0x2E, 0xDE, 0xD3, 0xDC, 0x63, 0xC6, 0x1D, 0x5A, 0x54, 0x73, 0xBF, 0xC2, 0x07,
+  0x13, 0xFE, 0xEF, 0x40, 0xF0, 0xD0, 0xFA, 0x2D, 0x47, 0x23, 0xC5, 0xF9, 0x24, 0xBF, 0x08, 0xEC, 0x9B, 0xEB, 0x77, 0x7C, 0xDF, 0x72, 0xB5, 0x78, 0x1F, 0x7A,
+  0xF8, 0x56, 0xCA, 0x15, 0x09, 0x74, 0x63, 0x73, 0x7F, 0xCD, 0x9B, 0x16, 0x12, 0xC8, 0xF2, 0xB8, 0x56, 0x72, 0x33, 0x62, 0x2E, 0xA0, 0xEA, 0x61, 0xC3, 0xB2,
+  0x8A, 0x6E, 0x9B, 0xCE, 0x47, 0xF7, 0xFA, 0x1E, 0xE9, 0xB7, 0xDB, 0xFB, 0x9D, 0x0B, 0x67, 0xC9, 0xF7, 0x4D, 0xD7, 0xC5, 0xA5, 0xBC, 0x75, 0x50, 0xA2, 0x40,
+  0x8C, 0x70, 0x5E, 0xCC, 0xC0, 0x0A, 0x0C, 0x05, 0xDB, 0xCC, 0xE8, 0x9C, 0x9E, 0x65, 0x3D, 0x74, 0x2B, 0x27, 0xFB, 0x6A, 0x72, 0xAF, 0x45, 0x81, 0x88, 0x81,
+  0x61, 0x51, 0x54, 0x58, 0xBF, 0xB6, 0xF2, 0xE2, 0x2D, 0xAE, 0xA8, 0x5E, 0xFF, 0x5F, 0x36, 0x68, 0x2B, 0x9F, 0x7E, 0xCD, 0xEF, 0x9C, 0x34, 0x0A, 0x12, 0x6B,
+  0xD9, 0x37, 0x3A, 0xD5, 0x5D, 0x2A, 0x87, 0x85, 0x7C, 0xF7, 0x46, 0xE6, 0x0C, 0xF7, 0xEE, 0x60, 0x8A, 0x0F, 0x81, 0x7C, 0xA1, 0xCA, 0x52, 0x36, 0xBD, 0x7F,
+  0x1E, 0xB0, 0xFD, 0x81, 0xEE, 0xC1, 0x3F, 0x23, 0xFE, 0xBD, 0x9E, 0xFF, 0x9F, 0x94, 0x6F, 0x27, 0x8D, 0xA3, 0x7D, 0xB4, 0x23, 0xE7, 0xF1, 0x3E, 0x8D, 0x73,
+  0xB2, 0x7D, 0x79, 0x94, 0x79, 0x5C, 0xC6, 0xED, 0xFE, 0x05, 0x52, 0xE6, 0x61, 0x15, 0x37, 0xBB, 0x06, 0xF0, 0x3D, 0x70, 0xB2, 0x7B, 0x0F, 0x44, 0x47, 0x78,
+  0xF8, 0xE4, 0x5E, 0xDE, 0xF8, 0x4B, 0xD3, 0xE0, 0x9D, 0xC8, 0x12, 0x13, 0x8D, 0x30, 0xBB, 0x23, 0x32, 0x89, 0xC8, 0x9D, 0x5B, 0x83, 0x89, 0x9C, 0x75, 0x17,
+  0x86, 0xFC, 0xF1, 0xFD, 0x73, 0xC0, 0x76, 0x72, 0xD9, 0x3D, 0x7E, 0xDB, 0x46, 0xAC, 0x85, 0xD2, 0x62, 0xA6, 0x65, 0x32, 0x09, 0xED, 0xC1, 0xD3, 0x38, 0x97,
+  0xD6, 0x82, 0x7E, 0x92, 0x7B, 0x19, 0x79, 0x12, 0xEA, 0x2D, 0xCA, 0xF2, 0xD5, 0x1A, 0xE7, 0xAF, 0xF0, 0x21, 0xC1, 0x7E, 0xBC, 0x03, 0x43, 0x07, 0xF0, 0xDC,
+  0xE9, 0x83, 0x02, 0x3A, 0x3E, 0xF9, 0x0E, 0x80, 0xD1, 0x49, 0x4C, 0xF0, 0x77, 0xE0, 0x03, 0x48, 0x08, 0x73, 0xB1, 0x04, 0x70, 0x27, 0x27, 0x0C, 0xA9, 0xE0,
+  0xB1, 0xC9, 0x59, 0x55, 0x50, 0xC2, 0x9C, 0x85, 0x25, 0xA3, 0xCE, 0x99, 0x01, 0x6B, 0x0E, 0x43, 0xF0, 0x12, 0xFB, 0x67, 0xA6, 0x45, 0xB3, 0x4C, 0xBA, 0x64,
+  0x1E, 0x78, 0x51, 0xE2, 0xE1, 0x96, 0x1D, 0x8A, 0x66, 0xC1, 0x8C, 0x41, 0x38, 0x91, 0xC9, 0x0F, 0xD9, 0xC0, 0xA3, 0xEF, 0xE7, 0x2C, 0x44, 0x5A, 0xFF, 0x38,
+  0xF3, 0x2D, 0x90, 0x73, 0xEF, 0x92, 0x0C, 0xD0, 0x3F, 0x4D, 0x6B, 0x0B, 0x19, 0x87, 0x89, 0xE7, 0x66, 0x67, 0x13, 0xC4, 0x97, 0xFC, 0xE5, 0x0E, 0xC6, 0x60,
+  0x65, 0x61, 0x2C, 0x4F, 0x16, 0xAC, 0xC7, 0xC7, 0x45, 0x64, 0x78, 0x37, 0x6F, 0xC3, 0x61, 0x64, 0x57, 0x0C, 0x6C, 0x9F, 0x2C, 0xFD, 0x48, 0x32, 0x15, 0xE1,
+  0x33, 0xD9, 0x45, 0x6E, 0x27, 0x73, 0xFB, 0xF0, 0x88, 0x8C, 0xE9, 0xA7, 0x7E, 0x32, 0xF8, 0x0F, 0x23, 0x55, 0x48, 0xF4, 0x8B, 0x0D, 0x00, 0x00,
+};
+
+#define ASSET_GALLERY_CSS "/assets/gallery.157e325c.css"
+//File: gallery.css.gz, Size: 772 (1794 uncompressed)
+#define gallery_css_gz_len 772
+static const uint8_t gallery_css_gz[] = {
+  0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x9D, 0x55, 0x61, 0x8F, 0xA2, 0x30, 0x10, 0xFD, 0x7E, 0xBF, 0x82, 0xC4, 0x98, 0x68, 0x62, 0x49,
+  0x51, 0x71, 0x77, 0xCB, 0x97, 0xDB, 0x5C, 0x72, 0xFF, 0xA3, 0xD0, 0x02, 0xDD, 0x85, 0x96, 0xB4, 0x75, 0xD5, 0x23, 0xF7, 0xDF, 0x6F, 0x5A, 0x0A, 0x87, 0x4A,
+  0x72, 0xC9, 0x49, 0x24, 0x48, 0xA6, 0x33, 0x6F, 0xDE, 0x7B, 0x33, 0xE6, 0x8A, 0xDD, 0xFA, 0x52, 0x49, 0x8B, 0x4A, 0xDA, 0x8A, 0xE6, 0x46, 0xDE, 0xB5, 0xA0,
+  0x4D, 0xD6, 0x52, 0x5D, 0x09, 0x49, 0xF6, 0xB8, 0xBB, 0x66, 0x39, 0x2D, 0x3E, 0x2B, 0xAD, 0xCE, 0x92, 0x91, 0x55, 0x89, 0xDD, 0x95, 0xFD, 0xFE, 0x16, 0x17,
+  0x70, 0x86, 0x0A, 0xC9, 0x75, 0xDF, 0xD2, 0x2B, 0xBA, 0x08, 0x66, 0x6B, 0x92, 0xEC, 0xB1, 0x3B, 0x10, 0x0E, 0xE3, 0x88, 0x9E, 0xAD, 0x72, 0xB1, 0x35, 0xA7,
+  0x0C, 0x02, 0x2D, 0xBF, 0x5A, 0x44, 0x1B, 0x51, 0x49, 0x52, 0x70, 0x69, 0xB9, 0x0E, 0x91, 0x28, 0x57, 0xD6, 0xAA, 0x96, 0x1C, 0xDC, 0x61, 0x08, 0xAF, 0x68,
+  0xD3, 0x70, 0x7D, 0xEB, 0x99, 0x30, 0x5D, 0x43, 0x6F, 0xA4, 0xD2, 0x82, 0x65, 0xEE, 0x86, 0x2C, 0x6F, 0xE1, 0x8D, 0xE5, 0xA8, 0x50, 0xCD, 0xB9, 0x95, 0x86,
+  0x68, 0xDE, 0x71, 0x6A, 0x37, 0xAE, 0x10, 0x2A, 0x45, 0xD3, 0xEC, 0x5A, 0x21, 0x01, 0xCF, 0x26, 0x71, 0x40, 0x76, 0x49, 0xA9, 0xB7, 0xDB, 0xAC, 0xA2, 0x1D,
+  0x79, 0x9D, 0x60, 0x8D, 0xC5, 0xF6, 0xA1, 0x98, 0x68, 0x69, 0x05, 0xF9, 0xA8, 0x66, 0xFD, 0xAC, 0xD1, 0x4B, 0x2D, 0x2C, 0xCF, 0x72, 0xA5, 0x01, 0x37, 0xD2,
+  0x94, 0x89, 0xB3, 0x21, 0x27, 0x38, 0xD0, 0x51, 0xC6, 0x84, 0xAC, 0xFC, 0x73, 0xAE, 0xAE, 0xC8, 0xD4, 0x94, 0xA9, 0x0B, 0xB4, 0xBA, 0xEF, 0xAE, 0xD1, 0x11,
+  0xBE, 0xBA, 0xCA, 0xE9, 0x06, 0xEF, 0xFC, 0x15, 0x27, 0xDB, 0xCC, 0x6A, 0x2A, 0x8D, 0xB0, 0x42, 0x49, 0xE2, 0x1F, 0x4B, 0xA5, 0xDB, 0x08, 0xC7, 0x7B, 0x93,
+  0x75, 0x2A, 0xBC, 0xD7, 0x1C, 0x5A, 0x12, 0x5F, 0xFC, 0x1E, 0x0D, 0xA9, 0xD5, 0x97, 0xE3, 0x6C, 0x3C, 0x44, 0x4C, 0x41, 0x1B, 0xBE, 0x49, 0x62, 0x9C, 0x6E,
+  0xEF, 0x23, 0x23, 0xD1, 0x56, 0x7D, 0x10, 0x00, 0xE3, 0x75, 0x56, 0x73, 0x51, 0xD5, 0x96, 0xBC, 0xB8, 0x06, 0x55, 0xFE, 0xC1, 0x0B, 0xD0, 0x56, 0x58, 0x52,
+  0xB8, 0x7C, 0x0F, 0x2D, 0x1D, 0x20, 0xA4, 0x38, 0x6B, 0xA3, 0x34, 0xE9, 0x94, 0xF0, 0x92, 0x2C, 0xA8, 0x3D, 0xEB, 0x01, 0x94, 0x01, 0xF4, 0x07, 0x93, 0x01,
+  0xD9, 0x10, 0x4D, 0x72, 0xED, 0x6A, 0x49, 0x6E, 0xCC, 0x06, 0xC7, 0x6F, 0x0B, 0xC0, 0x42, 0x1B, 0xCF, 0xE1, 0xC9, 0x42, 0x70, 0xDC, 0x28, 0xEA, 0xE8, 0xED,
+  0x55, 0x47, 0x0B, 0x61, 0x6F, 0x04, 0xC7, 0xE9, 0x1C, 0x50, 0x03, 0x7E, 0xA3, 0x1A, 0x55, 0x0E, 0x3D, 0x18, 0x68, 0xF3, 0x86, 0x19, 0xAF, 0x76, 0x01, 0x66,
+  0xB4, 0x4F, 0xD7, 0xBB, 0x15, 0xC7, 0xEE, 0x8A, 0x52, 0xBC, 0x9E, 0xDE, 0xBF, 0xA4, 0xEB, 0xED, 0x2C, 0x0B, 0x32, 0xE2, 0x17, 0x07, 0xF9, 0xF1, 0x3A, 0xF2,
+  0x74, 0x51, 0x09, 0x20, 0x7C, 0x73, 0xA1, 0x7A, 0x94, 0xC4, 0xA9, 0x89, 0x84, 0x2C, 0x85, 0x74, 0x26, 0x98, 0x50, 0xC2, 0x1B, 0xD5, 0x07, 0x13, 0x59, 0xD5,
+  0x11, 0x90, 0x3B, 0xF3, 0x93, 0xE3, 0x13, 0x26, 0x8E, 0x6E, 0xB0, 0x25, 0x50, 0xB9, 0x3A, 0x9D, 0x4E, 0xD9, 0xB3, 0xD9, 0x21, 0x91, 0xE4, 0x17, 0x94, 0x53,
+  0x56, 0xF1, 0x7E, 0x52, 0x9F, 0xE6, 0x06, 0xBC, 0x0C, 0x75, 0x5C, 0x4A, 0x70, 0x51, 0xE6, 0x29, 0xF2, 0x4F, 0x77, 0x52, 0x94, 0x47, 0xF8, 0x84, 0x02, 0x83,
+  0x3B, 0x47, 0x2F, 0x26, 0x83, 0xF5, 0x1E, 0xA4, 0x7D, 0xBD, 0x43, 0x37, 0xFD, 0xBA, 0x0C, 0xE6, 0xC8, 0x55, 0xC3, 0x00, 0xD0, 0xF7, 0x4F, 0x7E, 0x2B, 0x35,
+  0x6D, 0xB9, 0x89, 0x46, 0xEA, 0xF1, 0x7A, 0x36, 0x07, 0x68, 0x82, 0xE9, 0xF9, 0x82, 0xC1, 0x77, 0x94, 0x2D, 0x06, 0xA0, 0x31, 0x02, 0xDA, 0xEC, 0x28, 0x70,
+  0xE4, 0x39, 0x9D, 0x66, 0xB8, 0x6C, 0xF8, 0x35, 0xFB, 0x38, 0x1B, 0x2B, 0xCA, 0x1B, 0x72, 0xBB, 0x03, 0x38, 0x19, 0x89, 0xF1, 0x2C, 0x21, 0x68, 0xA9, 0x35,
+  0xF7, 0x8B, 0xC1, 0x6F, 0x04, 0xC8, 0xE9, 0x26, 0xD8, 0xF3, 0xEB, 0xB2, 0xA0, 0x8B, 0x86, 0x9F, 0xEE, 0x96, 0x0D, 0xA5, 0x38, 0xCA, 0xAD, 0xEC, 0x47, 0x36,
+  0xA0, 0xD3, 0x28, 0xD9, 0xFF, 0xDD, 0x42, 0x0F, 0x44, 0xCE, 0x07, 0xDB, 0x33, 0x07, 0xEC, 0x0B, 0x16, 0xAD, 0x18, 0x63, 0x0F, 0x04, 0x3A, 0x4A, 0xBD, 0x88,
+  0x8C, 0x17, 0x4A, 0x0F, 0x0E, 0x91, 0x4A, 0xF2, 0x51, 0xE4, 0xC3, 0xE1, 0xB0, 0x38, 0x19, 0x33, 0x50, 0xC1, 0xFC, 0x73, 0x1D, 0x8F, 0x3F, 0xDE, 0x7F, 0xA6,
+  0xF8, 0x4E, 0xC7, 0x50, 0x36, 0xA4, 0x0D, 0x01, 0xB3, 0x2C, 0x31, 0x2D, 0xDC, 0x7A, 0xF8, 0xAF, 0x34, 0x0B, 0x9A, 0x0F, 0x79, 0xBD, 0x99, 0x67, 0x76, 0x9D,
+  0x76, 0x76, 0x92, 0xDE, 0xDB, 0xFA, 0x38, 0xAC, 0x49, 0xA9, 0x90, 0x9F, 0x02, 0xB3, 0xB0, 0xC5, 0x9F, 0xD2, 0xF8, 0xF1, 0x48, 0xC3, 0x82, 0xD5, 0xBC, 0xD4,
+  0xDC, 0xD4, 0x5E, 0xA4, 0x7F, 0xB4, 0x30, 0x39, 0xDA, 0xC9, 0x3E, 0xFC, 0xF7, 0x0C, 0x42, 0x79, 0xDE, 0x9F, 0xE5, 0x79, 0x58, 0x5D, 0xA1, 0x87, 0xE4, 0xB9,
+  0xF0, 0x92, 0x10, 0x29, 0xC5, 0xC7, 0x37, 0x88, 0xFB, 0x03, 0x1C, 0x1F, 0x40, 0x7D, 0x02, 0x07, 0x00, 0x00,
+};
+
+#define ASSET_GALLERY_JS "/assets/gallery.a0940505.js"
+//File: gallery.js.gz, Size: 614 (1239 uncompressed)
+#define gallery_js_gz_len 614
+static const uint8_t gallery_js_gz[] = {
+  0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x9D, 0x53, 0xC1, 0x6E, 0x13, 0x31, 0x10, 0xBD, 0xF7, 0x2B, 0x4C, 0x0E, 0xF1, 0xAE, 0x36, 0xF5,
+  0x36, 0x85, 0x0B, 0x34, 0x4E, 0x05, 0x52, 0x10, 0xA2, 0x25, 0x20, 0x15, 0x89, 0x43, 0x5B, 0x21, 0xC7, 0x9E, 0x6C, 0xAC, 0x3A, 0xF6, 0x62, 0x3B, 0x09, 0x29,
+  0xF4, 0xDF, 0x19, 0xEF, 0x6E, 0x48, 0x0B, 0x6A, 0x91, 0xB8, 0xD9, 0x9E, 0x79, 0x6F, 0xDE, 0xBC, 0x19, 0x2B, 0x27, 0x57, 0x4B, 0xB0, 0x91, 0x7D, 0x5B, 0x81,
+  0xDF, 0x5E, 0x80, 0x01, 0x19, 0x9D, 0x7F, 0x6D, 0x4C, 0x46, 0xF5, 0xB2, 0xA2, 0x39, 0x9B, 0x3B, 0x3F, 0x11, 0x72, 0x91, 0xE1, 0x8D, 0x8F, 0x7F, 0x1C, 0x10,
+  0x82, 0x07, 0x26, 0x8D, 0x08, 0xE1, 0x5C, 0x87, 0xC8, 0x84, 0x52, 0x19, 0x35, 0x4E, 0x28, 0x6D, 0x31, 0xFB, 0xA4, 0x8B, 0x3B, 0x9B, 0x9E, 0x78, 0x96, 0x23,
+  0xE4, 0x61, 0xBE, 0x87, 0xA5, 0x5B, 0xC3, 0x7D, 0x48, 0x8A, 0x87, 0xB8, 0x35, 0xC0, 0x5C, 0x2D, 0xA4, 0x8E, 0x5B, 0x4E, 0x87, 0xF4, 0xE4, 0x6E, 0x4F, 0x05,
+  0xDE, 0x3B, 0xFF, 0xDF, 0x5C, 0x47, 0xEC, 0x79, 0xC3, 0x76, 0x87, 0xE2, 0xD4, 0xE3, 0xCD, 0x32, 0xBD, 0x14, 0x15, 0x1C, 0x4A, 0xE1, 0x15, 0x79, 0xA2, 0x71,
+  0x67, 0xA5, 0xD1, 0xF2, 0xA6, 0x51, 0xB3, 0xD1, 0x56, 0xB9, 0x0D, 0x56, 0x02, 0x9B, 0x92, 0x98, 0x12, 0x51, 0x04, 0x88, 0x6C, 0xBE, 0x32, 0x66, 0x40, 0xBF,
+  0xCE, 0x8C, 0xB0, 0x37, 0xC9, 0x92, 0x54, 0xD9, 0x40, 0x24, 0x49, 0x26, 0x28, 0x7E, 0x34, 0x88, 0x2E, 0x0A, 0xC3, 0xD5, 0xBF, 0x9C, 0x37, 0x60, 0xAB, 0xB8,
+  0x78, 0x52, 0xF5, 0x13, 0x4A, 0x71, 0x30, 0x93, 0x35, 0xA2, 0x92, 0x53, 0x80, 0x1E, 0xB6, 0x36, 0xD1, 0x41, 0xE3, 0x23, 0xE6, 0x90, 0x4E, 0x4F, 0x51, 0x9C,
+  0xE8, 0x79, 0xD6, 0x69, 0xE3, 0xBC, 0xD1, 0x96, 0x4B, 0x67, 0x83, 0x43, 0x17, 0x8D, 0xAB, 0x32, 0xFA, 0x09, 0x8D, 0x21, 0x8D, 0x3D, 0xA1, 0xC3, 0xBC, 0x22,
+  0xB4, 0xE8, 0xD0, 0xB4, 0xA4, 0x45, 0x8B, 0x49, 0x03, 0xBB, 0xEB, 0xDA, 0x2D, 0x4B, 0x32, 0x85, 0x0D, 0xF1, 0x20, 0x9D, 0x4F, 0xA3, 0x09, 0x44, 0xD4, 0x35,
+  0x08, 0x4F, 0x44, 0x24, 0x71, 0x01, 0x24, 0xBA, 0x9A, 0xB8, 0x79, 0x73, 0x9C, 0x6B, 0x1F, 0x22, 0xA9, 0x53, 0x8D, 0x8D, 0x8E, 0x0B, 0xB7, 0x8A, 0x44, 0x20,
+  0x30, 0xD1, 0x1F, 0x24, 0x19, 0x91, 0x54, 0x8F, 0x58, 0x85, 0x43, 0xAB, 0x84, 0x31, 0xF8, 0x92, 0x5C, 0xC6, 0x26, 0xBA, 0x81, 0x34, 0x6D, 0x5F, 0xB8, 0x95,
+  0x97, 0xD0, 0xEF, 0x57, 0xFD, 0xFE, 0xB3, 0xF2, 0xF2, 0xB4, 0x7F, 0x9D, 0x2A, 0xF0, 0xEC, 0xF2, 0xF8, 0xF0, 0xE5, 0xF5, 0xCF, 0x2B, 0x75, 0xA5, 0xF2, 0x92,
+  0x45, 0x08, 0x11, 0x3B, 0x97, 0x22, 0x6A, 0x67, 0x59, 0x40, 0x7D, 0x72, 0x91, 0xE7, 0xC9, 0x1C, 0x8B, 0xE2, 0xEF, 0xD1, 0x64, 0xB4, 0x84, 0x74, 0x0B, 0x68,
+  0xF6, 0xDF, 0xBE, 0xFE, 0xEE, 0x92, 0x0E, 0x60, 0xE7, 0x6D, 0xAB, 0xDC, 0xF3, 0xF7, 0x17, 0x1F, 0xA7, 0xAC, 0x16, 0x3E, 0x40, 0x06, 0xCD, 0x82, 0xE4, 0x03,
+  0xB9, 0x6F, 0x47, 0x7A, 0x10, 0x11, 0x26, 0x06, 0xD2, 0x2D, 0xA3, 0x4A, 0xAF, 0xDB, 0x2F, 0x84, 0xF8, 0x76, 0xCD, 0xA7, 0x62, 0x09, 0x9C, 0xEE, 0x57, 0x93,
+  0xEE, 0xA2, 0xDA, 0x62, 0xE9, 0x77, 0x9F, 0x3F, 0x9C, 0xF3, 0xDE, 0x08, 0x61, 0xA4, 0xC9, 0xE6, 0x14, 0x75, 0x1F, 0xCE, 0x84, 0xAA, 0x80, 0x8E, 0xA7, 0x93,
+  0x2F, 0xA3, 0x12, 0x43, 0xE3, 0x11, 0x6E, 0x03, 0x09, 0x5E, 0x72, 0x5A, 0x36, 0x44, 0x65, 0xAF, 0xF0, 0xCC, 0x22, 0x71, 0xD1, 0x3B, 0x8D, 0x8B, 0xD5, 0x72,
+  0xC6, 0x87, 0x94, 0x74, 0x5F, 0x88, 0x53, 0x23, 0x6E, 0xB7, 0x74, 0xDC, 0x2B, 0x9A, 0x3A, 0x84, 0x3C, 0x60, 0x6F, 0x75, 0x68, 0x3B, 0x77, 0x29, 0x63, 0x47,
+  0x32, 0x9A, 0x79, 0xBC, 0x65, 0x9E, 0x05, 0x7D, 0x0B, 0xE5, 0xF0, 0xE8, 0xF8, 0x45, 0xCE, 0xA2, 0x7B, 0xAB, 0xBF, 0x83, 0xCA, 0x86, 0x79, 0xD1, 0x23, 0x67,
+  0x6F, 0x5A, 0x21, 0xBD, 0x9D, 0xF8, 0x3F, 0xA6, 0xD8, 0x2E, 0xF1, 0x63, 0x3F, 0x6B, 0xA7, 0x9A, 0x76, 0x05, 0xEF, 0xFF, 0xAC, 0x44, 0x57, 0xB1, 0xDA, 0x03,
+  0x26, 0xAA, 0x4C, 0xEE, 0x57, 0xF0, 0xE0, 0x17, 0xBB, 0xD9, 0x08, 0x75, 0xD7, 0x04, 0x00, 0x00,
+};
+
+#define ASSET_HOME_CSS "/assets/home.c2f2ea0e.css"
+//File: home.css.gz, Size: 351 (662 uncompressed)
+#define home_css_gz_len 351
+static const uint8_t home_css_gz[] = {
+  0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x6D, 0x92, 0xCB, 0x6E, 0xC3, 0x20, 0x10, 0x45, 0xF7, 0xFD, 0x0A, 0x4B, 0xD9, 0xB4, 0x52, 0x89,
+  0x20, 0x38, 0x8E, 0x02, 0xAB, 0xA8, 0x52, 0xFE, 0x63, 0x30, 0x60, 0xA3, 0xD8, 0x60, 0x61, 0xD2, 0xD8, 0xB5, 0xFA, 0xEF, 0xC5, 0x8F, 0x3E, 0x9C, 0x46, 0x88,
+  0x0D, 0x73, 0xE7, 0xCC, 0x9D, 0x2B, 0x84, 0x93, 0xFD, 0xA0, 0x9D, 0x0D, 0x48, 0x43, 0x6D, 0xAA, 0x9E, 0x9D, 0xBC, 0x81, 0x8A, 0x07, 0xD5, 0x05, 0x04, 0x95,
+  0x29, 0x2C, 0xCB, 0x95, 0x0D, 0xCA, 0xF3, 0x1A, 0x7C, 0x61, 0x2C, 0xDB, 0xE3, 0xA6, 0xE3, 0x02, 0xF2, 0x4B, 0xE1, 0xDD, 0xD5, 0x4A, 0xB6, 0xD1, 0x78, 0x3C,
+  0xFC, 0xF3, 0x69, 0x9B, 0x47, 0x0A, 0x18, 0xAB, 0xFC, 0x50, 0x43, 0x87, 0x6E, 0x46, 0x86, 0x92, 0x65, 0x78, 0xD4, 0x2F, 0xBD, 0x38, 0x81, 0x6B, 0x70, 0x7F,
+  0xBB, 0x6F, 0xA5, 0x09, 0x8A, 0x37, 0x20, 0xA5, 0xB1, 0x05, 0xA3, 0x13, 0xDB, 0x79, 0xA9, 0x3C, 0xF2, 0x20, 0xCD, 0xB5, 0x65, 0x64, 0x7E, 0xEA, 0x50, 0x5B,
+  0x82, 0x74, 0xB7, 0x88, 0x48, 0x9B, 0x2E, 0xC9, 0xE2, 0xF5, 0x85, 0x80, 0x67, 0xFC, 0x3A, 0x9D, 0x2D, 0x79, 0x89, 0x06, 0x4A, 0x32, 0xE4, 0xAE, 0x72, 0x9E,
+  0x6D, 0x28, 0xA5, 0xCB, 0x4C, 0x24, 0x5C, 0x08, 0xAE, 0x9E, 0xD1, 0xD1, 0xA3, 0x08, 0x76, 0x90, 0xA6, 0x6D, 0x2A, 0xE8, 0x99, 0xB1, 0x55, 0x74, 0x8B, 0x44,
+  0xE5, 0xF2, 0xCB, 0x8F, 0x07, 0xB2, 0x8F, 0x6C, 0xFA, 0xC7, 0x34, 0xB9, 0x5F, 0x38, 0x7D, 0x3B, 0x9D, 0xF7, 0x98, 0xCF, 0xA3, 0xE6, 0x05, 0xA6, 0xB4, 0xA4,
+  0xCA, 0x9D, 0x87, 0x60, 0x9C, 0x65, 0xD6, 0x59, 0x75, 0xB7, 0x48, 0xC4, 0xF2, 0x29, 0xE6, 0xD6, 0x7C, 0x28, 0x46, 0xE2, 0x06, 0x3C, 0x78, 0xB0, 0xAD, 0x99,
+  0x1A, 0x7E, 0xF9, 0x09, 0xDE, 0xD2, 0x76, 0x71, 0xCA, 0x4A, 0xF7, 0x1E, 0xD3, 0x5C, 0x0D, 0xDF, 0x03, 0x4E, 0x8F, 0x4B, 0x1D, 0xB5, 0x71, 0xA4, 0x95, 0xE0,
+  0xFB, 0x95, 0x66, 0x47, 0x8E, 0xD9, 0x99, 0xFE, 0xD3, 0x3C, 0xA0, 0x61, 0x71, 0x90, 0x12, 0xBE, 0x95, 0x12, 0x6C, 0x71, 0x27, 0xD0, 0x69, 0x4A, 0x69, 0xB6,
+  0x16, 0x3C, 0xE0, 0x48, 0x20, 0x47, 0x2C, 0x46, 0x99, 0xB1, 0xDA, 0xAD, 0x4A, 0xEA, 0xA0, 0xA9, 0xD6, 0xAB, 0x78, 0x1F, 0x24, 0xB3, 0x64, 0xBD, 0x8B, 0x59,
+  0x27, 0xE3, 0x5F, 0xFA, 0x02, 0x15, 0xE7, 0x1A, 0xDE, 0x96, 0x02, 0x00, 0x00,
+};
+
+#define ASSET_HOME_JS "/assets/home.a5565414.js"
+//File: home.js.gz, Size: 644 (2123 uncompressed)
+#define home_js_gz_len 644
+static const uint8_t home_js_gz[] = {
+  0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xBD, 0x54, 0xC1, 0x6E, 0xDA, 0x40, 0x10, 0xBD, 0xF3, 0x15, 0x13, 0x45, 0xEA, 0xDA, 0x6A, 0xB4,
+  0x09, 0x55, 0xCA, 0x01, 0x64, 0xA2, 0x26, 0x05, 0xA9, 0x4D, 0x94, 0x1C, 0xE8, 0x3D, 0xDA, 0x78, 0xC7, 0xE0, 0xD6, 0xF6, 0xA2, 0xDD, 0x05, 0x92, 0x46, 0xFC,
+  0x45, 0xEF, 0xBD, 0xF5, 0x0B, 0x2A, 0xF5, 0xDE, 0x2F, 0xEA, 0x27, 0x74, 0xBC, 0x0B, 0x01, 0x0C, 0x34, 0x0D, 0x52, 0xC2, 0xC9, 0xDE, 0x19, 0xDE, 0xBC, 0x37,
+  0xEF, 0xAD, 0x33, 0xB4, 0x90, 0x64, 0xC2, 0x0C, 0x3A, 0x85, 0xB8, 0xC9, 0x50, 0x42, 0x04, 0x89, 0xC8, 0x0C, 0x1E, 0x80, 0xB1, 0xC2, 0x8E, 0x4C, 0xE5, 0xB8,
+  0x55, 0x4B, 0x46, 0x45, 0x6C, 0x53, 0x55, 0x80, 0x55, 0xFD, 0x7E, 0x86, 0xDD, 0xF2, 0xBF, 0x17, 0x9D, 0xF7, 0x41, 0x08, 0xF7, 0x35, 0xA8, 0x42, 0xED, 0x2D,
+  0xBF, 0xB7, 0xCA, 0x3A, 0xDA, 0x78, 0x10, 0xB0, 0xC3, 0x58, 0x15, 0x56, 0xAB, 0xEC, 0x64, 0x2C, 0x74, 0x44, 0xA5, 0x6B, 0xF4, 0x2D, 0xAF, 0xC6, 0x22, 0x8B,
+  0x18, 0xBC, 0x86, 0x60, 0x05, 0xE8, 0x04, 0xEA, 0xD0, 0x84, 0xA3, 0x30, 0x24, 0x04, 0x00, 0x6E, 0x07, 0x58, 0x04, 0x1A, 0xA2, 0xB6, 0x1B, 0x59, 0xFE, 0xA4,
+  0x8A, 0x47, 0x39, 0x16, 0x96, 0xF7, 0xD1, 0x76, 0x32, 0x2C, 0x1F, 0x4F, 0xEF, 0x3E, 0xC8, 0x80, 0x39, 0x98, 0x4F, 0x8E, 0x29, 0x0B, 0xB9, 0xC5, 0x5B, 0x7B,
+  0x46, 0x93, 0xA9, 0x4C, 0xE4, 0xD8, 0x9F, 0xEF, 0xDF, 0x7E, 0x80, 0x13, 0xD0, 0x84, 0x4D, 0x43, 0xD9, 0xD5, 0x25, 0xA3, 0xB9, 0xEC, 0xAA, 0xDB, 0x65, 0x61,
+  0xEB, 0x69, 0xA3, 0x8C, 0xBD, 0xCB, 0x90, 0xDF, 0x88, 0xF8, 0x4B, 0x5F, 0xAB, 0x51, 0xE1, 0x16, 0x58, 0x41, 0xDF, 0x3F, 0x3E, 0x7B, 0xD7, 0x7D, 0x7B, 0xE4,
+  0x46, 0xEC, 0x37, 0x1A, 0x0D, 0xE6, 0x47, 0x4C, 0x43, 0x1E, 0x8B, 0x72, 0x4B, 0x58, 0x2A, 0xA4, 0x45, 0x19, 0x45, 0x48, 0xA8, 0xB5, 0xD2, 0x01, 0x73, 0x6C,
+  0x81, 0xF6, 0x4D, 0x76, 0xA4, 0x84, 0xD3, 0x64, 0x07, 0x80, 0x21, 0x91, 0x9B, 0x56, 0x8D, 0xE9, 0x39, 0xFB, 0x16, 0xCE, 0x54, 0xED, 0xDC, 0x5B, 0x39, 0xD8,
+  0xE6, 0x8D, 0x6F, 0xBA, 0x5E, 0xB1, 0x66, 0x15, 0x69, 0x77, 0x6F, 0x3C, 0xCE, 0x3F, 0xCC, 0xF9, 0x09, 0x5E, 0xC4, 0xCC, 0x9D, 0xEA, 0xDC, 0xA7, 0xD9, 0x53,
+  0x99, 0xB6, 0xC1, 0x9F, 0x35, 0xFC, 0x5D, 0x0C, 0xF2, 0x8C, 0x1F, 0x71, 0x28, 0x53, 0x42, 0xFA, 0xC6, 0xF9, 0xB5, 0x99, 0xAD, 0xDE, 0x53, 0x28, 0x97, 0xE1,
+  0xD6, 0x18, 0xB5, 0x35, 0xFF, 0x6C, 0x54, 0x11, 0x84, 0xB3, 0x13, 0x19, 0xB5, 0xFD, 0x5A, 0x2B, 0xF7, 0x4C, 0xF2, 0xA5, 0x4B, 0x04, 0x51, 0x14, 0x41, 0xDD,
+  0x73, 0xAD, 0xBA, 0x2E, 0xF9, 0xC2, 0xD1, 0xE5, 0xBE, 0x17, 0xBB, 0x40, 0xCF, 0x7E, 0x7D, 0x5E, 0x32, 0x6E, 0xCF, 0x1E, 0xB6, 0x45, 0xD4, 0xA2, 0xF6, 0xE6,
+  0xA0, 0x95, 0x51, 0x5A, 0x4F, 0xDA, 0x72, 0xC0, 0x5A, 0xB5, 0x34, 0x81, 0x60, 0x92, 0x16, 0x52, 0x4D, 0x78, 0x67, 0x4C, 0x1C, 0x7B, 0x6A, 0xA4, 0x63, 0xF4,
+  0xC9, 0x2B, 0x51, 0x2D, 0xA0, 0x21, 0x4A, 0x05, 0x4E, 0x60, 0xA9, 0x4E, 0x71, 0xC4, 0xF2, 0xCD, 0x78, 0xB5, 0x68, 0xB8, 0x90, 0xD2, 0xD5, 0x2F, 0x52, 0x43,
+  0x6B, 0x43, 0xED, 0x75, 0x22, 0x8D, 0x5D, 0xCC, 0xDB, 0xDE, 0xAB, 0xC6, 0xA8, 0x93, 0x4C, 0x4D, 0xFE, 0xB3, 0x3D, 0x47, 0xAB, 0xD3, 0xD8, 0x94, 0x9A, 0x16,
+  0x5F, 0x13, 0xCF, 0x36, 0x27, 0xB2, 0x1F, 0x7B, 0x57, 0x97, 0x7C, 0x28, 0xB4, 0xC1, 0x00, 0xB9, 0x14, 0x56, 0x3C, 0x66, 0xC9, 0x1C, 0xAF, 0xEA, 0x7C, 0xCE,
+  0x93, 0xA1, 0xE1, 0x56, 0x75, 0xD3, 0x5B, 0x94, 0x41, 0x3D, 0x24, 0xEB, 0x19, 0xD0, 0x11, 0xFC, 0xFE, 0xE5, 0x72, 0x90, 0x93, 0x7B, 0x4A, 0x93, 0x47, 0xE5,
+  0xB9, 0x11, 0x63, 0x7A, 0x7A, 0xA8, 0x48, 0xAD, 0x86, 0xC3, 0x59, 0x69, 0xFE, 0x3C, 0x2B, 0x06, 0x39, 0x1F, 0xA0, 0x18, 0x42, 0xBB, 0x0D, 0xF5, 0x23, 0x0F,
+  0x7A, 0x7E, 0x0A, 0x89, 0x46, 0x9C, 0x19, 0xBB, 0x55, 0xB8, 0xC6, 0x58, 0x69, 0x99, 0x16, 0xFD, 0x4D, 0xD2, 0xF5, 0x2E, 0xD2, 0xE9, 0xE2, 0xD8, 0xDE, 0x40,
+  0xD9, 0xF5, 0xD4, 0x5F, 0x50, 0xC5, 0x8B, 0xF2, 0xA1, 0xD7, 0xBC, 0x10, 0x39, 0x3A, 0xB6, 0x81, 0x53, 0xA1, 0xB9, 0x49, 0xBF, 0x22, 0x1C, 0x92, 0x88, 0x37,
+  0xC7, 0x61, 0x75, 0x4D, 0xE7, 0xA7, 0xE1, 0x83, 0x9A, 0x69, 0xED, 0x2F, 0x8E, 0x91, 0x50, 0x56, 0x4B, 0x08, 0x00, 0x00,
+};
+
+static const web_asset_t web_assets[] = {
+  {ASSET_BROWSE_CSS, "text/css", "\"a1bee004\"", browse_css_gz, browse_css_gz_len},
+  {ASSET_BROWSE_JS, "application/javascript", "\"ac423f42\"", browse_js_gz, browse_js_gz_len},
+  {ASSET_GALLERY_CSS, "text/css", "\"157e325c\"", gallery_css_gz, gallery_css_gz_len},
+  {ASSET_GALLERY_JS, "application/javascript", "\"a0940505\"", gallery_js_gz, gallery_js_gz_len},
+  {ASSET_HOME_CSS, "text/css", "\"c2f2ea0e\"", home_css_gz, home_css_gz_len},
+  {ASSET_HOME_JS, "application/javascript", "\"a5565414\"", home_js_gz, home_js_gz_len},
+};
+#define WEB_ASSET_COUNT (sizeof(web_assets) / sizeof(web_assets[0]))
+
+#endif  // WEB_ASSETS_H